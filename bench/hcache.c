@@ -0,0 +1,911 @@
+/**
+ * @file
+ * Benchmark the header cache
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @page bench_hcache Benchmark the header cache
+ *
+ * Generate a synthetic set of Emails, then time each layer of the header
+ * cache separately:
+ * - Serialising and restoring the Emails
+ * - Compressing and decompressing the records, with each compression method
+ * - Storing, fetching and deleting the records, with each store backend
+ *
+ * For each operation, the throughput and the 50th and 99th percentile
+ * latencies are reported.  For the stores, the size of the files is reported,
+ * too.
+ *
+ * The corpus is generated from a seed, so runs on different machines can be
+ * compared.
+ */
+
+#include "config.h"
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "mutt/lib.h"
+#include "address/lib.h"
+#include "email/lib.h"
+#include "hcache/serialize.h"
+#include "store/lib.h"
+#ifdef USE_HCACHE_COMPRESSION
+#include "compress/lib.h"
+#endif
+
+#define BENCH_EMAILS 10000 ///< Default number of Emails in the corpus
+#define BENCH_BATCH 100    ///< Default number of stores in a batch
+
+/**
+ * struct Record - A serialised Email
+ */
+struct Record
+{
+  unsigned char *data; ///< Serialised Email
+  int len;             ///< Length of the data
+};
+
+/**
+ * struct Timings - Latencies of a set of operations
+ */
+struct Timings
+{
+  uint64_t *ns; ///< Latency of each operation, in nanoseconds
+  size_t count; ///< Number of operations
+  size_t bytes; ///< Number of bytes processed
+};
+
+static uint64_t RandState = 1; ///< State of the random number generator
+static bool KeepFiles = false; ///< Don't delete the databases
+
+// clang-format off
+/// Words used to build the subjects and names
+static const char *Words[] = {
+  "access", "account", "agenda", "alpha", "archive", "budget", "build",
+  "bug", "change", "client", "config", "daily", "deploy", "draft", "export",
+  "feature", "final", "fix", "meeting", "minutes", "mirror", "monthly",
+  "network", "notes", "patch", "plan", "quarterly", "release", "report",
+  "request", "review", "schedule", "security", "server", "status", "summary",
+  "team", "update", "urgent", "weekly",
+};
+
+/// Domains used to build the addresses and Message-IDs
+static const char *Domains[] = {
+  "example.com", "example.org", "example.net", "lists.example.com",
+  "mail.example.org", "neomutt.org",
+};
+// clang-format on
+
+/**
+ * rand_next - Get a pseudo-random number
+ * @retval num Random number
+ *
+ * This is xorshift64, so the corpus is the same on every platform.
+ */
+static uint64_t rand_next(void)
+{
+  RandState ^= RandState << 13;
+  RandState ^= RandState >> 7;
+  RandState ^= RandState << 17;
+  return RandState;
+}
+
+/**
+ * rand_below - Get a pseudo-random number less than a limit
+ * @param limit Upper limit
+ * @retval num Random number, 0 <= num < limit
+ */
+static size_t rand_below(size_t limit)
+{
+  return rand_next() % limit;
+}
+
+/**
+ * now_ns - Read the monotonic clock
+ * @retval num Time in nanoseconds
+ */
+static uint64_t now_ns(void)
+{
+  struct timespec ts = { 0 };
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t) ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+/**
+ * corpus_words - Append some random words to a Buffer
+ * @param buf   Buffer for the result
+ * @param count Number of words
+ */
+static void corpus_words(struct Buffer *buf, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    if (i != 0)
+      mutt_buffer_addch(buf, ' ');
+    mutt_buffer_addstr(buf, Words[rand_below(mutt_array_size(Words))]);
+  }
+}
+
+/**
+ * corpus_address - Add a random address to a list
+ * @param al List of addresses
+ */
+static void corpus_address(struct AddressList *al)
+{
+  char mailbox[256];
+  const char *first = Words[rand_below(mutt_array_size(Words))];
+  const char *last = Words[rand_below(mutt_array_size(Words))];
+  const char *domain = Domains[rand_below(mutt_array_size(Domains))];
+
+  snprintf(mailbox, sizeof(mailbox), "%s.%s@%s", first, last, domain);
+
+  struct Buffer personal = mutt_buffer_make(0);
+  if (rand_below(4) != 0)
+    mutt_buffer_printf(&personal, "%c%s %c%s", first[0] - 32, first + 1, last[0] - 32, last + 1);
+
+  mutt_addrlist_append(al, mutt_addr_create(mutt_b2s(&personal), mailbox));
+  mutt_buffer_dealloc(&personal);
+}
+
+/**
+ * corpus_message_id - Create a random Message-ID
+ * @retval ptr New Message-ID
+ */
+static char *corpus_message_id(void)
+{
+  char buf[128];
+  snprintf(buf, sizeof(buf), "<%08llx.%04x@%s>", (unsigned long long) rand_next(),
+           (unsigned int) rand_below(0x10000), Domains[rand_below(mutt_array_size(Domains))]);
+  return mutt_str_dup(buf);
+}
+
+/**
+ * corpus_email - Create a random Email
+ * @retval ptr New Email
+ *
+ * The Emails look like typical list and office mail: a few recipients, a
+ * thread of References and a plain text or multipart Body.
+ */
+static struct Email *corpus_email(void)
+{
+  struct Email *e = email_new();
+  struct Envelope *env = mutt_env_new();
+  struct Body *b = mutt_body_new();
+  e->env = env;
+  e->content = b;
+
+  e->date_sent = 1577836800 + rand_below(365 * 24 * 3600);
+  e->received = e->date_sent + rand_below(3600);
+  e->offset = rand_below(1 << 30);
+  e->lines = 5 + rand_below(500);
+  e->mime = true;
+  e->read = (rand_below(4) != 0);
+  e->old = !e->read && (rand_below(2) != 0);
+  e->flagged = (rand_below(20) == 0);
+  e->replied = (rand_below(10) == 0);
+  e->zhours = rand_below(13);
+
+  corpus_address(&env->from);
+  for (size_t i = 1 + rand_below(4); i > 0; i--)
+    corpus_address(&env->to);
+  for (size_t i = rand_below(3); i > 0; i--)
+    corpus_address(&env->cc);
+  if (rand_below(4) == 0)
+    corpus_address(&env->reply_to);
+
+  struct Buffer buf = mutt_buffer_make(256);
+  if (rand_below(3) == 0)
+    mutt_buffer_addstr(&buf, "Re: ");
+  corpus_words(&buf, 3 + rand_below(8));
+  env->subject = mutt_buffer_strdup(&buf);
+  env->real_subj = env->subject + ((strncmp(env->subject, "Re: ", 4) == 0) ? 4 : 0);
+
+  env->message_id = corpus_message_id();
+  for (size_t i = rand_below(8); i > 0; i--)
+    mutt_list_insert_tail(&env->references, corpus_message_id());
+  struct ListNode *np = STAILQ_FIRST(&env->references);
+  if (np)
+    mutt_list_insert_tail(&env->in_reply_to, mutt_str_dup(np->data));
+
+  if (rand_below(3) == 0)
+  {
+    mutt_buffer_printf(&buf, "<mailto:%s@%s>", Words[rand_below(mutt_array_size(Words))],
+                       Domains[rand_below(mutt_array_size(Domains))]);
+    env->list_post = mutt_buffer_strdup(&buf);
+  }
+
+  if (rand_below(3) == 0)
+  {
+    b->type = TYPE_MULTIPART;
+    b->subtype = mutt_str_dup((rand_below(2) == 0) ? "alternative" : "mixed");
+    mutt_buffer_printf(&buf, "----=_Part_%llu", (unsigned long long) rand_next());
+    mutt_param_set(&b->parameter, "boundary", mutt_b2s(&buf));
+  }
+  else
+  {
+    b->type = TYPE_TEXT;
+    b->subtype = mutt_str_dup("plain");
+    mutt_param_set(&b->parameter, "charset", (rand_below(4) == 0) ? "iso-8859-1" : "utf-8");
+    if (rand_below(5) == 0)
+      mutt_param_set(&b->parameter, "format", "flowed");
+  }
+  b->encoding = (rand_below(3) == 0) ? ENC_QUOTED_PRINTABLE : ENC_7BIT;
+  b->length = 200 + rand_below(50000);
+  b->offset = e->offset + 500 + rand_below(3000);
+  b->hdr_offset = e->offset;
+
+  mutt_buffer_dealloc(&buf);
+  return e;
+}
+
+/**
+ * record_dump - Serialise an Email, like the header cache does
+ * @param[in]  e   Email
+ * @param[out] len Length of the record
+ * @retval ptr Serialised Email
+ */
+static unsigned char *record_dump(const struct Email *e, int *len)
+{
+  unsigned char *d = mutt_mem_malloc(4096);
+  *len = 0;
+
+  d = serial_dump_uint32_t(0, d, len);
+  d = serial_dump_int(0, d, len);
+  d = serial_dump_email(e, d, len);
+  d = serial_dump_envelope(e->env, d, len, false);
+  d = serial_dump_body(e->content, d, len, false);
+
+  return d;
+}
+
+/**
+ * record_restore - Restore an Email from a record
+ * @param d Serialised Email
+ * @retval ptr New Email
+ */
+static struct Email *record_restore(const unsigned char *d)
+{
+  int off = 0;
+  uint32_t uidvalidity = 0;
+  unsigned int crc = 0;
+
+  serial_restore_uint32_t(&uidvalidity, d, &off);
+  serial_restore_int(&crc, d, &off);
+
+  struct Email *e = email_new();
+  serial_restore_email(e, d, &off);
+  e->env = mutt_env_new();
+  serial_restore_envelope(e->env, d, &off, false);
+  e->content = mutt_body_new();
+  serial_restore_body(e->content, d, &off, false);
+
+  return e;
+}
+
+/**
+ * timings_new - Create a set of Timings
+ * @param count Number of operations
+ * @retval obj Empty Timings
+ */
+static struct Timings timings_new(size_t count)
+{
+  struct Timings t = { 0 };
+  t.ns = mutt_mem_calloc(count ? count : 1, sizeof(uint64_t));
+  return t;
+}
+
+/**
+ * timings_add - Record the latency of an operation
+ * @param t     Timings
+ * @param start Time the operation started, from now_ns()
+ * @param bytes Number of bytes processed
+ */
+static void timings_add(struct Timings *t, uint64_t start, size_t bytes)
+{
+  t->ns[t->count++] = now_ns() - start;
+  t->bytes += bytes;
+}
+
+/**
+ * compare_ns - Compare two latencies - Implements ::sort_t
+ */
+static int compare_ns(const void *a, const void *b)
+{
+  const uint64_t x = *(const uint64_t *) a;
+  const uint64_t y = *(const uint64_t *) b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * timings_report - Print a line of results, and free the Timings
+ * @param name Name of the operation
+ * @param t    Timings
+ * @param size Size of the output, or 0 if it's not relevant
+ */
+static void timings_report(const char *name, struct Timings *t, size_t size)
+{
+  if (t->count == 0)
+  {
+    printf("%-28s %12s\n", name, "failed");
+    FREE(&t->ns);
+    return;
+  }
+
+  uint64_t total = 0;
+  for (size_t i = 0; i < t->count; i++)
+    total += t->ns[i];
+  if (total == 0)
+    total = 1;
+
+  qsort(t->ns, t->count, sizeof(uint64_t), compare_ns);
+
+  const double secs = total / 1e9;
+  printf("%-28s %12.0f %9.1f %9.2f %9.2f", name, t->count / secs,
+         t->bytes / secs / (1024 * 1024), t->ns[(t->count - 1) / 2] / 1e3,
+         t->ns[(t->count - 1) * 99 / 100] / 1e3);
+  if (size != 0)
+    printf(" %11zu", size);
+  printf("\n");
+
+  FREE(&t->ns);
+}
+
+/**
+ * report_once - Print a line of results for a single operation
+ * @param name  Name of the operation
+ * @param ns    Time taken, in nanoseconds
+ * @param items Number of items processed
+ * @param bytes Number of bytes processed
+ */
+static void report_once(const char *name, uint64_t ns, size_t items, size_t bytes)
+{
+  const double secs = (ns ? ns : 1) / 1e9;
+  printf("%-28s %12.0f %9.1f %9.2f %9s\n", name, items / secs,
+         bytes / secs / (1024 * 1024), ns / 1e3, "-");
+}
+
+/**
+ * dir_size - Total the size of the files in a directory
+ * @param path Directory
+ * @retval num Size in bytes
+ *
+ * Some backends create a directory, or extra files alongside the database.
+ * Subdirectories are included.
+ */
+static size_t dir_size(const char *path)
+{
+  DIR *dir = opendir(path);
+  if (!dir)
+    return 0;
+
+  size_t total = 0;
+  struct Buffer file = mutt_buffer_make(PATH_MAX);
+  struct dirent *de = NULL;
+  while ((de = readdir(dir)))
+  {
+    if (mutt_str_equal(de->d_name, ".") || mutt_str_equal(de->d_name, ".."))
+      continue;
+
+    mutt_buffer_concat_path(&file, path, de->d_name);
+    struct stat st = { 0 };
+    if (lstat(mutt_b2s(&file), &st) != 0)
+      continue;
+
+    if (S_ISDIR(st.st_mode))
+      total += dir_size(mutt_b2s(&file));
+    else
+      total += st.st_size;
+  }
+
+  mutt_buffer_dealloc(&file);
+  closedir(dir);
+  return total;
+}
+
+/**
+ * wanted - Is a name in a comma-separated list?
+ * @param list List of names, or NULL to match every name
+ * @param name Name to look for
+ * @retval true The name is in the list
+ */
+static bool wanted(const char *list, const char *name)
+{
+  if (!list)
+    return true;
+
+  struct ListHead names = STAILQ_HEAD_INITIALIZER(names);
+  mutt_list_str_split(&names, list, ',');
+
+  bool found = false;
+  struct ListNode *np = NULL;
+  STAILQ_FOREACH(np, &names, entries)
+  {
+    if (mutt_str_equal(mutt_str_skip_whitespace(np->data), name))
+    {
+      found = true;
+      break;
+    }
+  }
+
+  mutt_list_free(&names);
+  return found;
+}
+
+/**
+ * bench_serial - Time serialising and restoring the Emails
+ * @param emails Corpus of Emails
+ * @param recs   Array for the serialised Emails
+ * @param num    Number of Emails
+ */
+static void bench_serial(struct Email **emails, struct Record *recs, size_t num)
+{
+  struct Timings t = timings_new(num);
+  size_t size = 0;
+  for (size_t i = 0; i < num; i++)
+  {
+    uint64_t start = now_ns();
+    recs[i].data = record_dump(emails[i], &recs[i].len);
+    timings_add(&t, start, recs[i].len);
+    size += recs[i].len;
+  }
+  timings_report("serialise", &t, size);
+
+  t = timings_new(num);
+  for (size_t i = 0; i < num; i++)
+  {
+    uint64_t start = now_ns();
+    struct Email *e = record_restore(recs[i].data);
+    timings_add(&t, start, recs[i].len);
+    email_free(&e);
+  }
+  timings_report("restore", &t, 0);
+}
+
+#ifdef USE_HCACHE_COMPRESSION
+/**
+ * bench_compress_level - Time one compression method, at one level
+ * @param cops Compression backend
+ * @param level Compression level
+ * @param dict  Train a dictionary first
+ * @param recs  Serialised Emails
+ * @param num   Number of Emails
+ */
+static void bench_compress_level(const struct ComprOps *cops, short level,
+                                 bool dict, struct Record *recs, size_t num)
+{
+  char name[64];
+  snprintf(name, sizeof(name), "%s -%d%s", cops->name, level, dict ? " +dict" : "");
+
+  void *cctx = cops->open(level);
+  if (!cctx)
+    return;
+
+  if (dict)
+  {
+    /* Train from the first records, like the header cache does */
+    size_t count = MIN(num, 256);
+    size_t *sizes = mutt_mem_calloc(count, sizeof(size_t));
+    struct Buffer samples = mutt_buffer_make(0);
+    for (size_t i = 0; i < count; i++)
+    {
+      mutt_buffer_addstr_n(&samples, (char *) recs[i].data, recs[i].len);
+      sizes[i] = recs[i].len;
+    }
+    size_t dlen = 0;
+    void *d = cops->dict_train(cctx, samples.data, sizes, count, &dlen);
+    mutt_buffer_dealloc(&samples);
+    FREE(&sizes);
+    if (!d)
+    {
+      cops->close(&cctx);
+      return;
+    }
+  }
+
+  struct Record *crecs = mutt_mem_calloc(num, sizeof(struct Record));
+  struct Timings t = timings_new(num);
+  size_t size = 0;
+  for (size_t i = 0; i < num; i++)
+  {
+    size_t clen = 0;
+    uint64_t start = now_ns();
+    void *cdata = cops->compress(cctx, (char *) recs[i].data, recs[i].len, &clen);
+    timings_add(&t, start, recs[i].len);
+    if (!cdata)
+      break;
+    crecs[i].data = mutt_mem_malloc(clen);
+    memcpy(crecs[i].data, cdata, clen);
+    crecs[i].len = clen;
+    size += clen;
+  }
+  snprintf(name + strlen(name), sizeof(name) - strlen(name), " compress");
+  timings_report(name, &t, size);
+
+  name[strlen(name) - strlen(" compress")] = '\0';
+  snprintf(name + strlen(name), sizeof(name) - strlen(name), " decompress");
+  t = timings_new(num);
+  for (size_t i = 0; (i < num) && crecs[i].data; i++)
+  {
+    uint64_t start = now_ns();
+    size_t dlen = 0;
+    void *data = cops->decompress(cctx, (char *) crecs[i].data, crecs[i].len, &dlen);
+    if (!data)
+      break;
+    timings_add(&t, start, recs[i].len);
+  }
+  timings_report(name, &t, 0);
+
+  for (size_t i = 0; i < num; i++)
+    FREE(&crecs[i].data);
+  FREE(&crecs);
+  cops->close(&cctx);
+}
+
+/**
+ * bench_compress - Time each compression method
+ * @param list List of methods, or NULL for all of them
+ * @param recs Serialised Emails
+ * @param num  Number of Emails
+ *
+ * Each method is tried at its minimum, middle and maximum levels.
+ */
+static void bench_compress(const char *list, struct Record *recs, size_t num)
+{
+  const char *names = compress_list();
+  struct ListHead head = STAILQ_HEAD_INITIALIZER(head);
+  mutt_list_str_split(&head, names, ',');
+
+  struct ListNode *np = NULL;
+  STAILQ_FOREACH(np, &head, entries)
+  {
+    const char *name = mutt_str_skip_whitespace(np->data);
+    if (!wanted(list, name))
+      continue;
+
+    const struct ComprOps *cops = compress_get_ops(name);
+    if (!cops)
+      continue;
+
+    const short levels[] = { cops->min_level,
+                             (cops->min_level + cops->max_level) / 2,
+                             cops->max_level };
+    for (size_t i = 0; i < mutt_array_size(levels); i++)
+    {
+      bench_compress_level(cops, levels[i], false, recs, num);
+      if (cops->dict_train)
+        bench_compress_level(cops, levels[i], true, recs, num);
+    }
+  }
+
+  mutt_list_free(&head);
+  FREE(&names);
+}
+#endif
+
+/**
+ * count_scan - Count the records in a store - Implements ::store_scan_t
+ */
+static bool count_scan(const char *key, size_t klen, const void *value,
+                       size_t vlen, void *data)
+{
+  struct Timings *t = data;
+  t->count++;
+  t->bytes += vlen;
+  return true;
+}
+
+/**
+ * bench_store_backend - Time one store backend
+ * @param sops  Store backend
+ * @param dir   Directory for the database
+ * @param recs  Serialised Emails
+ * @param num   Number of Emails
+ * @param batch Number of stores in each batch, 0 for none
+ */
+static void bench_store_backend(const struct StoreOps *sops, const char *dir,
+                                struct Record *recs, size_t num, size_t batch)
+{
+  char name[64];
+  struct Buffer path = mutt_buffer_make(PATH_MAX);
+  mutt_buffer_concat_path(&path, dir, sops->name);
+  if (mutt_file_mkdir(mutt_b2s(&path), S_IRWXU) != 0)
+  {
+    printf("%-28s can't create %s\n", sops->name, mutt_b2s(&path));
+    mutt_buffer_dealloc(&path);
+    return;
+  }
+  struct Buffer db = mutt_buffer_make(PATH_MAX);
+  mutt_buffer_concat_path(&db, mutt_b2s(&path), "hcache");
+
+  char key[64];
+  void *store = sops->open(mutt_b2s(&db));
+  if (!store)
+  {
+    printf("%-28s can't open %s\n", sops->name, mutt_b2s(&db));
+    goto done;
+  }
+
+  struct Timings t = timings_new(num);
+  for (size_t i = 0; i < num; i++)
+  {
+    int klen = snprintf(key, sizeof(key), "/bench/%zu", i);
+    uint64_t start = now_ns();
+    if ((batch != 0) && ((i % batch) == 0))
+      sops->begin(store);
+    int rc = sops->store(store, key, klen, recs[i].data, recs[i].len);
+    if ((batch != 0) && (((i + 1) % batch == 0) || (i + 1 == num)))
+      sops->commit(store);
+    if (rc != 0)
+      break;
+    timings_add(&t, start, recs[i].len);
+  }
+
+  uint64_t start = now_ns();
+  sops->close(&store);
+  uint64_t close_ns = now_ns() - start;
+
+  snprintf(name, sizeof(name), "%s store", sops->name);
+  timings_report(name, &t, dir_size(mutt_b2s(&path)));
+
+  snprintf(name, sizeof(name), "%s close", sops->name);
+  report_once(name, close_ns, 1, 0);
+
+  start = now_ns();
+  store = sops->open(mutt_b2s(&db));
+  uint64_t open_ns = now_ns() - start;
+  if (!store)
+  {
+    printf("%-28s can't reopen %s\n", sops->name, mutt_b2s(&db));
+    goto done;
+  }
+  snprintf(name, sizeof(name), "%s open", sops->name);
+  report_once(name, open_ns, 1, 0);
+
+  /* Fetch in a random order, so the backend can't just read ahead */
+  t = timings_new(num);
+  for (size_t n = 0; n < num; n++)
+  {
+    size_t i = rand_below(num);
+    int klen = snprintf(key, sizeof(key), "/bench/%zu", i);
+    size_t vlen = 0;
+    start = now_ns();
+    void *data = sops->fetch(store, key, klen, &vlen);
+    sops->free(store, &data);
+    timings_add(&t, start, vlen);
+  }
+  snprintf(name, sizeof(name), "%s fetch", sops->name);
+  timings_report(name, &t, 0);
+
+  /* Hash-based backends can't be scanned */
+  struct Timings scanned = { 0 };
+  start = now_ns();
+  if (sops->scan(store, "/bench/", 7, count_scan, &scanned) == 0)
+  {
+    snprintf(name, sizeof(name), "%s scan", sops->name);
+    report_once(name, now_ns() - start, scanned.count, scanned.bytes);
+  }
+
+  t = timings_new(num);
+  for (size_t i = 0; i < num; i++)
+  {
+    int klen = snprintf(key, sizeof(key), "/bench/%zu", i);
+    start = now_ns();
+    if ((batch != 0) && ((i % batch) == 0))
+      sops->begin(store);
+    sops->delete_record(store, key, klen);
+    if ((batch != 0) && (((i + 1) % batch == 0) || (i + 1 == num)))
+      sops->commit(store);
+    timings_add(&t, start, 0);
+  }
+  sops->close(&store);
+  snprintf(name, sizeof(name), "%s delete", sops->name);
+  timings_report(name, &t, dir_size(mutt_b2s(&path)));
+
+done:
+  if (!KeepFiles)
+    mutt_file_rmtree(mutt_b2s(&path));
+  mutt_buffer_dealloc(&db);
+  mutt_buffer_dealloc(&path);
+}
+
+/**
+ * bench_store - Time each store backend
+ * @param list  List of backends, or NULL for all of them
+ * @param dir   Directory for the databases
+ * @param recs  Serialised Emails
+ * @param num   Number of Emails
+ * @param batch Number of stores in each batch, 0 for none
+ */
+static void bench_store(const char *list, const char *dir, struct Record *recs,
+                        size_t num, size_t batch)
+{
+  const char *names = store_backend_list();
+  struct ListHead head = STAILQ_HEAD_INITIALIZER(head);
+  mutt_list_str_split(&head, names, ',');
+
+  struct ListNode *np = NULL;
+  STAILQ_FOREACH(np, &head, entries)
+  {
+    const char *name = mutt_str_skip_whitespace(np->data);
+    if (!wanted(list, name))
+      continue;
+
+    const struct StoreOps *sops = store_get_backend_ops(name);
+    if (sops)
+      bench_store_backend(sops, dir, recs, num, batch);
+  }
+
+  mutt_list_free(&head);
+  FREE(&names);
+}
+
+/**
+ * usage - Print the command line options
+ * @param prog Name of the program
+ */
+static void usage(const char *prog)
+{
+  printf("Usage: %s [-n emails] [-s seed] [-B batch] [-d dir] [-k]\n"
+         "          [-b backends]"
+#ifdef USE_HCACHE_COMPRESSION
+         " [-c compressors]"
+#endif
+         "\n"
+         "\n"
+         "  -n  Number of Emails to generate (default %d)\n"
+         "  -s  Seed for the generator (default 1)\n"
+         "  -B  Number of stores in each batch, 0 for none (default %d)\n"
+         "  -d  Directory for the databases (default: a new one in $TMPDIR)\n"
+         "  -k  Keep the databases afterwards\n"
+         "  -b  Comma-separated list of store backends (default: all)\n"
+#ifdef USE_HCACHE_COMPRESSION
+         "  -c  Comma-separated list of compression methods (default: all)\n"
+#endif
+         "\n",
+         prog, BENCH_EMAILS, BENCH_BATCH);
+
+  const char *names = store_backend_list();
+  printf("Store backends: %s\n", NONULL(names));
+  FREE(&names);
+#ifdef USE_HCACHE_COMPRESSION
+  names = compress_list();
+  printf("Compression methods: %s\n", NONULL(names));
+  FREE(&names);
+#endif
+}
+
+/**
+ * main - Start the header cache benchmark
+ * @param argc Number of command line arguments
+ * @param argv List of command line arguments
+ * @retval 0 Success
+ * @retval 1 Error
+ */
+int main(int argc, char *argv[])
+{
+  size_t num = BENCH_EMAILS;
+  size_t batch = BENCH_BATCH;
+  const char *dir = NULL;
+  const char *backends = NULL;
+#ifdef USE_HCACHE_COMPRESSION
+  const char *compressors = NULL;
+  const char *opts = "B:b:c:d:hkn:s:";
+#else
+  const char *opts = "B:b:d:hkn:s:";
+#endif
+
+  int opt;
+  while ((opt = getopt(argc, argv, opts)) != -1)
+  {
+    switch (opt)
+    {
+      case 'B':
+        batch = strtoul(optarg, NULL, 10);
+        break;
+      case 'b':
+        backends = optarg;
+        break;
+#ifdef USE_HCACHE_COMPRESSION
+      case 'c':
+        compressors = optarg;
+        break;
+#endif
+      case 'd':
+        dir = optarg;
+        break;
+      case 'k':
+        KeepFiles = true;
+        break;
+      case 'n':
+        num = strtoul(optarg, NULL, 10);
+        break;
+      case 's':
+        RandState = strtoull(optarg, NULL, 10);
+        break;
+      case 'h':
+      default:
+        usage(argv[0]);
+        return (opt == 'h') ? 0 : 1;
+    }
+  }
+
+  if ((num == 0) || (RandState == 0))
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
+  char tmpdir[PATH_MAX];
+  if (!dir)
+  {
+    const char *tmp = mutt_str_getenv("TMPDIR");
+    snprintf(tmpdir, sizeof(tmpdir), "%s/hcache-bench-XXXXXX", tmp ? tmp : "/tmp");
+    if (!mkdtemp(tmpdir))
+    {
+      perror(tmpdir);
+      return 1;
+    }
+    dir = tmpdir;
+  }
+  else if ((mutt_file_mkdir(dir, S_IRWXU) != 0) && (errno != EEXIST))
+  {
+    perror(dir);
+    return 1;
+  }
+
+  const uint64_t seed = RandState;
+  struct Email **emails = mutt_mem_calloc(num, sizeof(struct Email *));
+  for (size_t i = 0; i < num; i++)
+    emails[i] = corpus_email();
+
+  struct Record *recs = mutt_mem_calloc(num, sizeof(struct Record));
+
+  printf("%zu emails, seed %llu, batches of %zu, in %s\n\n", num,
+         (unsigned long long) seed, batch, dir);
+  printf("%-28s %12s %9s %9s %9s %11s\n", "operation", "ops/s", "MiB/s",
+         "p50 us", "p99 us", "bytes");
+
+  bench_serial(emails, recs, num);
+#ifdef USE_HCACHE_COMPRESSION
+  bench_compress(compressors, recs, num);
+#endif
+  bench_store(backends, dir, recs, num, batch);
+
+  if (dir == tmpdir)
+    rmdir(dir);
+
+  for (size_t i = 0; i < num; i++)
+  {
+    email_free(&emails[i]);
+    FREE(&recs[i].data);
+  }
+  FREE(&emails);
+  FREE(&recs);
+
+  return 0;
+}
@@ -50,6 +50,7 @@
 #include "mutt_commands.h"
 #include "mutt_globals.h"
 #include "mutt_logging.h"
+#include "mutt_mailbox.h"
 #include "mutt_menu.h"
 #include "mutt_parse.h"
 #include "muttlib.h"
@@ -1973,6 +1974,7 @@ enum CommandResult parse_unmailboxes(struct Buffer *buf, struct Buffer *s,
 #ifdef USE_INOTIFY
       mutt_monitor_remove(np->mailbox);
 #endif
+      mutt_mailbox_probe_forget(np->mailbox);
       if (Context && (Context->mailbox == np->mailbox))
       {
         np->mailbox->flags |= MB_HIDDEN;
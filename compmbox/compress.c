@@ -939,6 +939,7 @@ struct MxOps MxCompOps = {
   .ac_find          = comp_ac_find,
   .ac_add           = comp_ac_add,
   .mbox_open        = comp_mbox_open,
+  .mbox_load        = NULL,
   .mbox_open_append = comp_mbox_open_append,
   .mbox_check       = comp_mbox_check,
   .mbox_check_stats = NULL,
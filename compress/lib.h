@@ -42,11 +42,17 @@
  * Usage with Compression Level set to X:
  * - open(level X) -> N times compress() -> close()
  * - open(level X) -> N times decompress() -> close()
+ *
+ * Small records compress badly on their own.  A backend may support a shared
+ * dictionary, trained from sample records:
+ * - open(level X) -> dict_train() -> N times compress() -> close()
+ * - open(level X) -> dict_load() -> N times decompress() -> close()
  */
 
 #ifndef MUTT_COMPRESS_LIB_H
 #define MUTT_COMPRESS_LIB_H
 
+#include <stdbool.h>
 #include <stdlib.h>
 
 /**
@@ -82,16 +88,51 @@ struct ComprOps
 
   /**
    * decompress - Decompress header cache data
-   * @param[in] cctx Compression context
-   * @param[in] cbuf Data to be decompressed
-   * @param[in] clen Length of the compressed input data
+   * @param[in]  cctx Compression context
+   * @param[in]  cbuf Data to be decompressed
+   * @param[in]  clen Length of the compressed input data
+   * @param[out] dlen Length of the decompressed data
    * @retval ptr  Success, pointer to decompressed data
    * @retval NULL Otherwise
    *
    * @note This function returns a pointer to data, which will be freed by the
    *       close() function.
    */
-  void *(*decompress)(void *cctx, const char *cbuf, size_t clen);
+  void *(*decompress)(void *cctx, const char *cbuf, size_t clen, size_t *dlen);
+
+  /**
+   * dict_train - Create a dictionary from sample data, and use it
+   * @param[in]  cctx    Compression context
+   * @param[in]  samples Sample data, one sample after another
+   * @param[in]  sizes   Length of each sample
+   * @param[in]  count   Number of samples
+   * @param[out] dlen    Length of the returned dictionary
+   * @retval ptr  Success, pointer to the dictionary
+   * @retval NULL Otherwise
+   *
+   * The caller should save the dictionary, and pass it to dict_load() next
+   * time.  Data compressed before the dictionary was created can still be
+   * decompressed.
+   *
+   * @note This function is optional.
+   *
+   * @note This function returns a pointer to data, which will be freed by the
+   *       close() function.
+   */
+  void *(*dict_train)(void *cctx, const void *samples, const size_t *sizes,
+                      size_t count, size_t *dlen);
+
+  /**
+   * dict_load - Use a dictionary created by dict_train()
+   * @param[in] cctx Compression context
+   * @param[in] dict Dictionary
+   * @param[in] dlen Length of the dictionary
+   * @retval true  Success
+   * @retval false The dictionary isn't valid
+   *
+   * @note This function is optional.
+   */
+  bool (*dict_load)(void *cctx, const void *dict, size_t dlen);
 
   /**
    * close - Close a compression context
@@ -104,7 +104,7 @@ static void *compr_zlib_compress(void *cctx, const char *data, size_t dlen, size
 /**
  * compr_zlib_decompress - Implements ComprOps::decompress()
  */
-static void *compr_zlib_decompress(void *cctx, const char *cbuf, size_t clen)
+static void *compr_zlib_decompress(void *cctx, const char *cbuf, size_t clen, size_t *dlen)
 {
   if (!cctx)
     return NULL;
@@ -124,6 +124,7 @@ static void *compr_zlib_decompress(void *cctx, const char *cbuf, size_t clen)
   if (ret != Z_OK)
     return NULL;
 
+  *dlen = ulen;
   return ubuf;
 }
 
@@ -25,10 +25,15 @@
  *
  * Zstandard (zstd) compression.
  * https://www.zstd.net
+ *
+ * Header cache records are small, so zstd supports a trained dictionary.  Each
+ * frame records the ID of its dictionary, so frames compressed without one can
+ * still be read.
  */
 
 #include "config.h"
 #include <stdio.h>
+#include <zdict.h>
 #include <zstd.h>
 #include "private.h"
 #include "mutt/lib.h"
@@ -38,6 +43,8 @@
 #define MIN_COMP_LEVEL 1  ///< Minimum compression level for zstd
 #define MAX_COMP_LEVEL 22 ///< Maximum compression level for zstd
 
+#define DICT_SIZE (16 * 1024) ///< Size of a trained dictionary
+
 /**
  * struct ComprZstdCtx - Private Zstandard Compression Context
  */
@@ -48,6 +55,11 @@ struct ComprZstdCtx
 
   ZSTD_CCtx *cctx; ///< Compression context
   ZSTD_DCtx *dctx; ///< Decompression context
+
+  void *dict;           ///< Trained dictionary
+  ZSTD_CDict *cdict;    ///< Digested dictionary for compression
+  ZSTD_DDict *ddict;    ///< Digested dictionary for decompression
+  unsigned int dict_id; ///< ID of the dictionary, stored in each frame
 };
 
 /**
@@ -55,7 +67,7 @@ struct ComprZstdCtx
  */
 static void *compr_zstd_open(short level)
 {
-  struct ComprZstdCtx *ctx = mutt_mem_malloc(sizeof(struct ComprZstdCtx));
+  struct ComprZstdCtx *ctx = mutt_mem_calloc(1, sizeof(struct ComprZstdCtx));
 
   ctx->buf = mutt_mem_malloc(ZSTD_compressBound(1024 * 128));
   ctx->cctx = ZSTD_createCCtx();
@@ -97,7 +109,11 @@ static void *compr_zstd_compress(void *cctx, const char *data, size_t dlen, size
   size_t len = ZSTD_compressBound(dlen);
   mutt_mem_realloc(&ctx->buf, len);
 
-  size_t ret = ZSTD_compressCCtx(ctx->cctx, ctx->buf, len, data, dlen, ctx->level);
+  size_t ret;
+  if (ctx->cdict)
+    ret = ZSTD_compress_usingCDict(ctx->cctx, ctx->buf, len, data, dlen, ctx->cdict);
+  else
+    ret = ZSTD_compressCCtx(ctx->cctx, ctx->buf, len, data, dlen, ctx->level);
   if (ZSTD_isError(ret))
     return NULL; // LCOV_EXCL_LINE
 
@@ -109,7 +125,7 @@ static void *compr_zstd_compress(void *cctx, const char *data, size_t dlen, size
 /**
  * compr_zstd_decompress - Implements ComprOps::decompress()
  */
-static void *compr_zstd_decompress(void *cctx, const char *cbuf, size_t clen)
+static void *compr_zstd_decompress(void *cctx, const char *cbuf, size_t clen, size_t *dlen)
 {
   struct ComprZstdCtx *ctx = cctx;
 
@@ -123,15 +139,98 @@ static void *compr_zstd_decompress(void *cctx, const char *cbuf, size_t clen)
     return NULL;
   else if (len == 0)
     return NULL; // LCOV_EXCL_LINE
+
+  /* Data compressed before the dictionary was trained doesn't use it */
+  unsigned int id = ZSTD_getDictID_fromFrame(cbuf, clen);
+  if ((id != 0) && (id != ctx->dict_id))
+  {
+    mutt_debug(LL_DEBUG2, "unknown dictionary %u\n", id);
+    return NULL;
+  }
+
   mutt_mem_realloc(&ctx->buf, len);
 
-  size_t ret = ZSTD_decompressDCtx(ctx->dctx, ctx->buf, len, cbuf, clen);
+  size_t ret;
+  if (id != 0)
+    ret = ZSTD_decompress_usingDDict(ctx->dctx, ctx->buf, len, cbuf, clen, ctx->ddict);
+  else
+    ret = ZSTD_decompressDCtx(ctx->dctx, ctx->buf, len, cbuf, clen);
   if (ZSTD_isError(ret))
     return NULL; // LCOV_EXCL_LINE
 
+  *dlen = ret;
   return ctx->buf;
 }
 
+/**
+ * compr_zstd_dict_load - Implements ComprOps::dict_load()
+ */
+static bool compr_zstd_dict_load(void *cctx, const void *dict, size_t dlen)
+{
+  if (!cctx || !dict)
+    return false;
+
+  struct ComprZstdCtx *ctx = cctx;
+
+  /* Without an ID, we couldn't tell which frames need the dictionary */
+  unsigned int id = ZDICT_getDictID(dict, dlen);
+  if (id == 0)
+    return false;
+
+  ZSTD_CDict *cdict = ZSTD_createCDict(dict, dlen, ctx->level);
+  ZSTD_DDict *ddict = ZSTD_createDDict(dict, dlen);
+  if (!cdict || !ddict)
+  {
+    // LCOV_EXCL_START
+    ZSTD_freeCDict(cdict);
+    ZSTD_freeDDict(ddict);
+    return false;
+    // LCOV_EXCL_STOP
+  }
+
+  ZSTD_freeCDict(ctx->cdict);
+  ZSTD_freeDDict(ctx->ddict);
+  ctx->cdict = cdict;
+  ctx->ddict = ddict;
+  ctx->dict_id = id;
+
+  return true;
+}
+
+/**
+ * compr_zstd_dict_train - Implements ComprOps::dict_train()
+ */
+static void *compr_zstd_dict_train(void *cctx, const void *samples,
+                                   const size_t *sizes, size_t count, size_t *dlen)
+{
+  if (!cctx || !samples || !sizes || !dlen)
+    return NULL;
+
+  struct ComprZstdCtx *ctx = cctx;
+
+  void *dict = mutt_mem_malloc(DICT_SIZE);
+  size_t ret = ZDICT_trainFromBuffer(dict, DICT_SIZE, samples, sizes, count);
+  if (ZDICT_isError(ret))
+  {
+    mutt_debug(LL_DEBUG1, "can't train a dictionary from %zu samples: %s\n",
+               count, ZDICT_getErrorName(ret));
+    FREE(&dict);
+    return NULL;
+  }
+
+  if (!compr_zstd_dict_load(ctx, dict, ret))
+  {
+    FREE(&dict); // LCOV_EXCL_LINE
+    return NULL; // LCOV_EXCL_LINE
+  }
+
+  FREE(&ctx->dict);
+  ctx->dict = dict;
+  *dlen = ret;
+
+  return ctx->dict;
+}
+
 /**
  * compr_zstd_close - Implements ComprOps::close()
  */
@@ -148,8 +247,11 @@ static void compr_zstd_close(void **cctx)
   if (ctx->dctx)
     ZSTD_freeDCtx(ctx->dctx);
 
+  ZSTD_freeCDict(ctx->cdict);
+  ZSTD_freeDDict(ctx->ddict);
+  FREE(&ctx->dict);
   FREE(&ctx->buf);
   FREE(cctx);
 }
 
-COMPRESS_OPS(zstd, MIN_COMP_LEVEL, MAX_COMP_LEVEL)
+COMPRESS_DICT_OPS(zstd, MIN_COMP_LEVEL, MAX_COMP_LEVEL)
@@ -97,6 +97,77 @@ static void ctx_cleanup(struct Context *ctx)
   ctx->mailbox = m;
 }
 
+/**
+ * ctx_add_email - Add one Email to the Context's counts and tables
+ * @param ctx   Mailbox
+ * @param msgno Index of the Email in the Mailbox
+ */
+static void ctx_add_email(struct Context *ctx, int msgno)
+{
+  struct Mailbox *m = ctx->mailbox;
+  struct Email *e = m->emails[msgno];
+  if (!e)
+    return;
+
+  if (WithCrypto)
+  {
+    /* NOTE: this _must_ be done before the check for mailcap! */
+    e->security = crypt_query(e->content);
+  }
+
+  if (ctx->pattern)
+  {
+    e->vnum = -1;
+  }
+  else
+  {
+    m->v2r[m->vcount] = msgno;
+    e->vnum = m->vcount++;
+  }
+  e->msgno = msgno;
+
+  if (e->env->supersedes)
+  {
+    struct Email *e2 = NULL;
+
+    if (!m->id_hash)
+      m->id_hash = mutt_make_id_hash(m);
+
+    e2 = mutt_hash_find(m->id_hash, e->env->supersedes);
+    if (e2)
+    {
+      e2->superseded = true;
+      if (C_Score)
+        mutt_score_message(ctx->mailbox, e2, true);
+    }
+  }
+
+  /* add this message to the hash tables */
+  if (m->id_hash && e->env->message_id)
+    mutt_hash_insert(m->id_hash, e->env->message_id, e);
+  if (m->subj_hash && e->env->real_subj)
+    mutt_hash_insert(m->subj_hash, e->env->real_subj, e);
+  mutt_label_hash_add(m, e);
+
+  if (C_Score)
+    mutt_score_message(ctx->mailbox, e, false);
+
+  if (e->changed)
+    m->changed = true;
+  if (e->flagged)
+    m->msg_flagged++;
+  if (e->deleted)
+    m->msg_deleted++;
+  if (e->tagged)
+    m->msg_tagged++;
+  if (!e->read)
+  {
+    m->msg_unread++;
+    if (!e->old)
+      m->msg_new++;
+  }
+}
+
 /**
  * ctx_update - Update the Context's message counts
  * @param ctx          Mailbox
@@ -124,73 +195,28 @@ void ctx_update(struct Context *ctx)
 
   mutt_clear_threads(ctx);
 
-  struct Email *e = NULL;
   for (int msgno = 0; msgno < m->msg_count; msgno++)
-  {
-    e = m->emails[msgno];
-    if (!e)
-      continue;
+    ctx_add_email(ctx, msgno);
 
-    if (WithCrypto)
-    {
-      /* NOTE: this _must_ be done before the check for mailcap! */
-      e->security = crypt_query(e->content);
-    }
-
-    if (ctx->pattern)
-    {
-      e->vnum = -1;
-    }
-    else
-    {
-      m->v2r[m->vcount] = msgno;
-      e->vnum = m->vcount++;
-    }
-    e->msgno = msgno;
-
-    if (e->env->supersedes)
-    {
-      struct Email *e2 = NULL;
-
-      if (!m->id_hash)
-        m->id_hash = mutt_make_id_hash(m);
-
-      e2 = mutt_hash_find(m->id_hash, e->env->supersedes);
-      if (e2)
-      {
-        e2->superseded = true;
-        if (C_Score)
-          mutt_score_message(ctx->mailbox, e2, true);
-      }
-    }
+  mutt_sort_headers(ctx, true); /* rethread from scratch */
+}
 
-    /* add this message to the hash tables */
-    if (m->id_hash && e->env->message_id)
-      mutt_hash_insert(m->id_hash, e->env->message_id, e);
-    if (m->subj_hash && e->env->real_subj)
-      mutt_hash_insert(m->subj_hash, e->env->real_subj, e);
-    mutt_label_hash_add(m, e);
-
-    if (C_Score)
-      mutt_score_message(ctx->mailbox, e, false);
-
-    if (e->changed)
-      m->changed = true;
-    if (e->flagged)
-      m->msg_flagged++;
-    if (e->deleted)
-      m->msg_deleted++;
-    if (e->tagged)
-      m->msg_tagged++;
-    if (!e->read)
-    {
-      m->msg_unread++;
-      if (!e->old)
-        m->msg_new++;
-    }
-  }
+/**
+ * ctx_update_added - Add the Emails read by mx_mbox_load() to the Context
+ * @param ctx      Mailbox
+ * @param oldcount Number of Emails the Context already knew about
+ *
+ * Unlike ctx_update(), the existing Emails and threads are left alone.
+ * The caller sorts the Mailbox, which threads the new Emails.
+ */
+void ctx_update_added(struct Context *ctx, int oldcount)
+{
+  if (!ctx || !ctx->mailbox)
+    return;
 
-  mutt_sort_headers(ctx, true); /* rethread from scratch */
+  struct Mailbox *m = ctx->mailbox;
+  for (int msgno = oldcount; msgno < m->msg_count; msgno++)
+    ctx_add_email(ctx, msgno);
 }
 
 /**
@@ -74,6 +74,7 @@ void            ctx_free            (struct Context **ptr);
 int             ctx_mailbox_observer(struct NotifyCallback *nc);
 struct Context *ctx_new             (void);
 void            ctx_update          (struct Context *ctx);
+void            ctx_update_added    (struct Context *ctx, int oldcount);
 void            ctx_update_tables   (struct Context *ctx, bool committing);
 
 bool message_is_tagged (struct Context *ctx, struct Email *e);
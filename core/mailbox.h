@@ -114,11 +114,14 @@ struct Mailbox
   bool changed                : 1;    ///< Mailbox has been modified
   bool dontwrite              : 1;    ///< Don't write the mailbox on close
   bool first_check_stats_done : 1;    ///< True when the check have been done at least on time
+  bool loading                : 1;    ///< Some Emails haven't been read yet, see mx_mbox_load()
+  bool monitored              : 1;    ///< The file monitor reports every change to the Mailbox
   bool peekonly               : 1;    ///< Just taking a glance, revert atime
   bool verbose                : 1;    ///< Display status messages?
   bool readonly               : 1;    ///< Don't allow changes to the mailbox
 
   AclFlags rights;                    ///< ACL bits, see #AclFlags
+  int load_batch;                     ///< Number of Emails to read at a time, 0 to read them all
 
 #ifdef USE_COMP_MBOX
   void *compress_info;                ///< Compressed mbox module private data
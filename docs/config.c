@@ -1470,6 +1470,10 @@
 ** .pp
 ** Header caching can greatly improve speed when opening POP, IMAP
 ** MH or Maildir folders, see "$caching" for details.
+** .pp
+** Mbox and MMDF folders are cached too.  If the folder hasn't changed,
+** or new mail has only been appended to it, the messages are read from the
+** cache and only the new ones are parsed.
 */
 
 { "header_cache_backend", DT_STRING, 0 },
@@ -1741,6 +1745,21 @@
 ** headers.
 */
 
+{ "imap_fetch_connections", DT_NUMBER, 0 },
+/*
+** .pp
+** When set to a value greater than 0, NeoMutt opens up to this many extra,
+** read-only, connections to the server to download the headers of a
+** large mailbox when it is first opened.  Each connection fetches its own
+** share of the headers, in groups of $$imap_fetch_chunk_size if that is
+** set.  The flags of the messages are always taken from the main
+** connection.
+** .pp
+** This only helps if the server, rather than the network, is the
+** bottleneck.  Each connection logs in separately, so it may count
+** against a per-user connection limit.
+*/
+
 { "imap_headers", DT_STRING, 0 },
 /*
 ** .pp
@@ -1794,6 +1813,18 @@
 ** This variable defaults to the value of $$imap_user.
 */
 
+{ "imap_notify", DT_BOOL, false },
+/*
+** .pp
+** When \fIset\fP, NeoMutt will use the IMAP NOTIFY extension (RFC5465), if
+** the server supports it, to learn about new mail and flag changes in the
+** other mailboxes of an account.  The server sends the new counts as soon as
+** they change, instead of NeoMutt sending a STATUS command for each mailbox
+** at every $$mail_check.
+** .pp
+** Servers without NOTIFY, or that refuse the request, are polled as usual.
+*/
+
 { "imap_oauth_refresh_command", DT_COMMAND, 0 },
 /*
 ** .pp
@@ -1877,6 +1908,24 @@
 ** https://github.com/neomutt/neomutt/issues/1689
 */
 
+{ "imap_server_sort", DT_BOOL, false },
+/*
+** .pp
+** When \fIset\fP, and the server supports the SORT extension, NeoMutt
+** asks the server for the order of an IMAP mailbox, instead of sorting
+** it itself.  This is done for $$sort, or for $$sort_aux when threading,
+** if it is one of: \fIdate\fP, \fIdate-received\fP, \fIsize\fP or
+** \fIsubject\fP.  If the server also supports SORT=DISPLAY, \fIfrom\fP
+** and \fIto\fP are sorted, too.
+** .pp
+** The order is fetched when the mailbox is opened and when new mail
+** arrives, so a large mailbox can be shown in its final order while the
+** headers are still being downloaded (see $$progressive_open).  The server
+** may order some messages slightly differently, e.g. \fIsize\fP counts
+** the whole message.  After changing $$sort, NeoMutt sorts the mailbox
+** itself until the server's order is next fetched.
+*/
+
 { "imap_servernoise", DT_BOOL, true },
 /*
 ** .pp
@@ -2134,6 +2183,31 @@
 ** how often (in seconds) NeoMutt will update message counts.
 */
 
+{ "mail_check_threads", DT_NUMBER, 0 },
+/*
+** .pp
+** The number of worker threads used to look for local mailboxes while
+** checking for new mail.  Each mailbox has to be found and stat()ed, which
+** can be slow on a network filesystem.  With several threads, the mailboxes
+** are looked at together and one slow mailbox can't hold up the others.
+** .pp
+** If this is 0, NeoMutt looks at every mailbox itself, one at a time.
+** This option has no effect if NeoMutt was built without thread support.
+** Also see $$mail_check_timeout.
+*/
+
+{ "mail_check_timeout", DT_NUMBER, 10 },
+/*
+** .pp
+** This variable configures how long (in seconds) a check for new mail may
+** take.  When $$mail_check_threads is set, mailboxes that haven't answered in
+** time are skipped until their check finishes.  If counting the messages
+** takes too long, the remaining mailboxes keep their old counts and are
+** checked first next time.  If this is 0, NeoMutt waits for every mailbox.
+** .pp
+** IMAP mailboxes are limited by $$imap_poll_timeout instead.
+*/
+
 { "mailcap_path", DT_SLIST, "~/.mailcap:" PKGDATADIR "/mailcap:" SYSCONFDIR "/mailcap:/etc/mailcap:/usr/etc/mailcap:/usr/local/etc/mailcap" },
 /*
 ** .pp
@@ -2179,6 +2253,18 @@
 */
 #endif
 
+{ "maildir_parse_threads", DT_NUMBER, 0 },
+/*
+** .pp
+** The number of worker threads used to read and parse the headers of
+** Maildir and MH messages that aren't in the header cache.  Reading a large
+** folder for the first time is dominated by opening and parsing every file,
+** which can be spread across several processor cores.
+** .pp
+** If this is 0, NeoMutt parses every message itself, one at a time.
+** This option has no effect if NeoMutt was built without thread support.
+*/
+
 { "maildir_trash", DT_BOOL, false },
 /*
 ** .pp
@@ -2232,6 +2318,22 @@
 ** Also see the $$move variable.
 */
 
+{ "mbox_index", DT_BOOL, false },
+/*
+** .pp
+** When \fIset\fP, NeoMutt keeps an index of the messages in each mbox and
+** MMDF folder it opens.  The index is stored next to the folder, in a hidden
+** file called \fC.NAME.index\fP.
+** .pp
+** When the folder is opened again, NeoMutt only needs to read the headers of
+** the messages, rather than the whole file.  If new mail has been appended to
+** the folder, only the new messages are parsed.  If the folder has been changed
+** in any other way, the index is ignored.
+** .pp
+** The index is only used if the $$header_cache doesn't already contain the
+** folder.
+*/
+
 { "mbox_type", DT_ENUM, MUTT_MBOX },
 /*
 ** .pp
@@ -3489,6 +3591,22 @@
 ** most likely want to \fIset\fP this option.
 */
 
+{ "progressive_open", DT_NUMBER, 0 },
+/*
+** .pp
+** When this is set, the index is shown as soon as this many emails of a
+** folder have been read.  The rest of the folder is read in batches while
+** NeoMutt waits for a key, and the new emails are sorted and threaded into
+** the index as they arrive.  A value a little larger than the height of the
+** index is a good choice.
+** .pp
+** Functions that act on every email, such as searching, limiting, tagging
+** by pattern, syncing and closing the folder, first read the rest of it.
+** .pp
+** Only Maildir, MH and IMAP folders are read this way.  If this is 0,
+** NeoMutt reads the whole folder before showing the index.
+*/
+
 { "prompt_after", DT_BOOL, true },
 /*
 ** .pp
@@ -65,17 +65,25 @@ static struct Body *parse_multipart(FILE *fp, const char *boundary,
 /**
  * mutt_auto_subscribe - Check if user is subscribed to mailing list
  * @param mailto URL of mailing list subscribe
+ *
+ * @note This may be called by a WorkQueue job, so it holds the shared lock
+ *       while it updates the global lists.
  */
 void mutt_auto_subscribe(const char *mailto)
 {
   if (!mailto)
     return;
 
+  mutt_workqueue_lock();
+
   if (!AutoSubscribeCache)
     AutoSubscribeCache = mutt_hash_new(200, MUTT_HASH_STRCASECMP | MUTT_HASH_STRDUP_KEYS);
 
   if (mutt_hash_find(AutoSubscribeCache, mailto))
+  {
+    mutt_workqueue_unlock();
     return;
+  }
 
   mutt_hash_insert(AutoSubscribeCache, mailto, AutoSubscribeCache);
 
@@ -95,6 +103,7 @@ void mutt_auto_subscribe(const char *mailto)
     }
   }
 
+  mutt_workqueue_unlock();
   mutt_env_free(&lpenv);
 }
 
@@ -1248,7 +1257,10 @@ struct Envelope *mutt_rfc822_read_header(FILE *fp, struct Email *e, bool user_hd
 #ifdef USE_AUTOCRYPT
     if (C_Autocrypt)
     {
+      /* The Autocrypt database is shared with any other parsing threads */
+      mutt_workqueue_lock();
       mutt_autocrypt_process_autocrypt_header(e, env);
+      mutt_workqueue_unlock();
       /* No sense in taking up memory after the header is processed */
       mutt_autocrypthdr_free(&env->autocrypt);
     }
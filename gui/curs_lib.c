@@ -148,6 +148,27 @@ void mutt_getch_timeout(int delay)
   timeout(delay);
 }
 
+/**
+ * mutt_getch_pending - Is there any input waiting to be read?
+ * @retval true mutt_getch() will return without blocking
+ *
+ * The keyboard is checked without consuming any input.
+ */
+bool mutt_getch_pending(void)
+{
+  if (UngetCount || (MacroBufferCount && !OptIgnoreMacroEvents))
+    return true;
+
+  timeout(0);
+  int ch = getch();
+  timeout(MuttGetchTimeout);
+  if (ch == ERR)
+    return false;
+
+  ungetch(ch);
+  return true;
+}
+
 #ifdef USE_INOTIFY
 /**
  * mutt_monitor_getch - Get a character and poll the filesystem monitor
@@ -53,12 +53,13 @@
 #include "store/lib.h"
 
 #if !(defined(HAVE_BDB) || defined(HAVE_GDBM) || defined(HAVE_KC) ||           \
-      defined(HAVE_LMDB) || defined(HAVE_QDBM) || defined(HAVE_ROCKSDB) ||     \
-      defined(HAVE_TC) || defined(HAVE_TDB))
+      defined(HAVE_KVLOG) || defined(HAVE_LMDB) || defined(HAVE_QDBM) ||        \
+      defined(HAVE_ROCKSDB) || defined(HAVE_TC) || defined(HAVE_TDB))
 #error "No hcache backend defined"
 #endif
 
 static unsigned int hcachever = 0x0;
+static unsigned int hcachever_legacy = 0x0;
 
 #define hcache_get_ops() store_get_backend_ops(C_HeaderCacheBackend)
 
@@ -75,6 +76,62 @@ static size_t header_size(void)
   return sizeof(int) + sizeof(uint32_t);
 }
 
+/**
+ * enum HcacheSection - Sections of a header cache record
+ */
+enum HcacheSection
+{
+  HC_SECTION_EMAIL = 0, ///< Scalar fields of the Email
+  HC_SECTION_ENVELOPE,  ///< Envelope
+  HC_SECTION_BODY,      ///< Body
+  HC_SECTION_MAX,
+};
+
+/// Identifies a header cache record in the flat format, "HCR2"
+#define HC_RECORD_MAGIC 0x32524348
+/// Version of the flat record format
+#define HC_RECORD_VERSION 2
+
+/**
+ * struct HcacheRecord - Table of contents of a header cache record
+ *
+ * A record is made up of this header, followed by the sections, in order.
+ * The offsets are relative to the start of the record.
+ *
+ * The scalar fields of the Email are decoded straight away.  The Envelope and
+ * Body can be left undecoded until they're needed.
+ *
+ * Records that were written before this format contain a copy of the struct
+ * Email, instead.  They're converted when they're read, see restore_legacy().
+ */
+struct HcacheRecord
+{
+  uint32_t magic;        ///< #HC_RECORD_MAGIC
+  uint16_t version;      ///< #HC_RECORD_VERSION
+  uint16_t num_sections; ///< Number of sections, #HC_SECTION_MAX
+  uint32_t length;       ///< Length of the whole record
+  struct
+  {
+    uint32_t offset;     ///< Start of the section
+    uint32_t length;     ///< Length of the section
+  } sections[HC_SECTION_MAX];
+};
+
+/**
+ * dump_section - Record where a section ends
+ * @param hr    Record header
+ * @param sec   Section, e.g. #HC_SECTION_BODY
+ * @param start Offset of the record in the blob
+ * @param off   Offset of the end of the section
+ */
+static void dump_section(struct HcacheRecord *hr, enum HcacheSection sec, int start, int off)
+{
+  const uint32_t begin = (sec == 0) ? sizeof(*hr) :
+                                      (hr->sections[sec - 1].offset + hr->sections[sec - 1].length);
+  hr->sections[sec].offset = begin;
+  hr->sections[sec].length = (off - start) - begin;
+}
+
 /**
  * dump - Serialise an Email object
  * @param hc          Header cache handle
@@ -88,7 +145,6 @@ static size_t header_size(void)
  */
 static void *dump(struct HeaderCache *hc, const struct Email *e, int *off, uint32_t uidvalidity)
 {
-  struct Email e_dump;
   bool convert = !CharsetIsUtf8;
 
   *off = 0;
@@ -99,49 +155,107 @@ static void *dump(struct HeaderCache *hc, const struct Email *e, int *off, uint3
 
   assert((size_t) *off == header_size());
 
-  lazy_realloc(&d, *off + sizeof(struct Email));
-  memcpy(&e_dump, e, sizeof(struct Email));
-
-  /* some fields are not safe to cache */
-  e_dump.tagged = false;
-  e_dump.changed = false;
-  e_dump.threaded = false;
-  e_dump.recip_valid = false;
-  e_dump.searched = false;
-  e_dump.matched = false;
-  e_dump.collapsed = false;
-  e_dump.limited = false;
-  e_dump.num_hidden = 0;
-  e_dump.recipient = 0;
-  e_dump.pair = 0;
-  e_dump.attach_valid = false;
-  e_dump.path = NULL;
-  e_dump.tree = NULL;
-  e_dump.thread = NULL;
-  STAILQ_INIT(&e_dump.tags);
-#ifdef MIXMASTER
-  STAILQ_INIT(&e_dump.chain);
-#endif
-  e_dump.edata = NULL;
+  /* Leave space for the table of contents */
+  const int start = *off;
+  struct HcacheRecord hr = { 0 };
+  lazy_realloc(&d, *off + sizeof(hr));
+  *off += sizeof(hr);
+
+  d = serial_dump_email(e, d, off);
+  dump_section(&hr, HC_SECTION_EMAIL, start, *off);
+
+  d = serial_dump_envelope(e->env, d, off, convert);
+  dump_section(&hr, HC_SECTION_ENVELOPE, start, *off);
 
-  memcpy(d + *off, &e_dump, sizeof(struct Email));
-  *off += sizeof(struct Email);
+  d = serial_dump_body(e->content, d, off, convert);
+  dump_section(&hr, HC_SECTION_BODY, start, *off);
 
-  d = serial_dump_envelope(e_dump.env, d, off, convert);
-  d = serial_dump_body(e_dump.content, d, off, convert);
+  hr.magic = HC_RECORD_MAGIC;
+  hr.version = HC_RECORD_VERSION;
+  hr.num_sections = HC_SECTION_MAX;
+  hr.length = *off - start;
+  memcpy(d + start, &hr, sizeof(hr));
 
   return d;
 }
 
 /**
- * restore - Restore an Email from data retrieved from the cache
+ * record_parse - Read the table of contents of a record
+ * @param[in]  rec    Record, following the uidvalidity and crc
+ * @param[in]  reclen Length of the record
+ * @param[out] hr     Table of contents
+ * @retval true The record is in the flat format and looks valid
+ */
+static bool record_parse(const unsigned char *rec, size_t reclen, struct HcacheRecord *hr)
+{
+  if (reclen < sizeof(*hr))
+    return false;
+
+  memcpy(hr, rec, sizeof(*hr));
+  if ((hr->magic != HC_RECORD_MAGIC) || (hr->version != HC_RECORD_VERSION) ||
+      (hr->num_sections < HC_SECTION_MAX) || (hr->length > reclen))
+  {
+    return false;
+  }
+
+  for (int i = 0; i < HC_SECTION_MAX; i++)
+  {
+    if ((hr->sections[i].offset < sizeof(*hr)) ||
+        (hr->sections[i].offset + (uint64_t) hr->sections[i].length > hr->length))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * restore_email - Restore the scalar fields of an Email
+ * @param rec Record
+ * @param hr  Table of contents
+ * @retval ptr New Email, without an Envelope or Body
+ */
+static struct Email *restore_email(const unsigned char *rec, const struct HcacheRecord *hr)
+{
+  struct Email *e = email_new();
+  int off = hr->sections[HC_SECTION_EMAIL].offset;
+  serial_restore_email(e, rec, &off);
+  return e;
+}
+
+/**
+ * restore_details - Restore the Envelope and Body of an Email
+ * @param e   Email
+ * @param rec Record
+ * @param hr  Table of contents
+ */
+static void restore_details(struct Email *e, const unsigned char *rec,
+                            const struct HcacheRecord *hr)
+{
+  bool convert = !CharsetIsUtf8;
+  int off;
+
+  e->env = mutt_env_new();
+  off = hr->sections[HC_SECTION_ENVELOPE].offset;
+  serial_restore_envelope(e->env, rec, &off, convert);
+
+  e->content = mutt_body_new();
+  off = hr->sections[HC_SECTION_BODY].offset;
+  serial_restore_body(e->content, rec, &off, convert);
+}
+
+/**
+ * restore_legacy - Restore an Email from an old-style record
  * @param d Data retrieved using mutt_hcache_dump
  * @retval ptr Success, the restored header (can't be NULL)
  *
+ * Old records contain a copy of the whole struct Email.
+ *
  * @note The returned Email must be free'd by caller code with
  *       email_free()
  */
-static struct Email *restore(const unsigned char *d)
+static struct Email *restore_legacy(const unsigned char *d)
 {
   int off = 0;
   struct Email *e = email_new();
@@ -156,6 +270,16 @@ static struct Email *restore(const unsigned char *d)
   memcpy(e, d + off, sizeof(struct Email));
   off += sizeof(struct Email);
 
+  /* Don't trust any of the pointers */
+  e->path = NULL;
+  e->tree = NULL;
+  e->thread = NULL;
+  e->edata = NULL;
+  e->edata_free = NULL;
+  e->notify = NULL;
+#ifdef USE_NOTMUCH
+  e->nm_edata = NULL;
+#endif
   STAILQ_INIT(&e->tags);
 #ifdef MIXMASTER
   STAILQ_INIT(&e->chain);
@@ -165,7 +289,7 @@ static struct Email *restore(const unsigned char *d)
   serial_restore_envelope(e->env, d, &off, convert);
 
   e->content = mutt_body_new();
-  serial_restore_body(e->content, d, &off, convert);
+  serial_restore_body_legacy(e->content, d, &off, convert);
 
   return e;
 }
@@ -310,52 +434,187 @@ static char *get_foldername(const char *folder)
   return p;
 }
 
+#ifdef USE_HCACHE_COMPRESSION
+/// Train a compression dictionary after this many records
+#define HC_DICT_SAMPLES 256
+/// Don't train a compression dictionary from fewer records than this
+#define HC_DICT_SAMPLES_MIN 32
+/// Maximum size of the sample records
+#define HC_DICT_SAMPLES_SIZE (1024 * 1024)
+
 /**
- * mutt_hcache_open - Multiplexor for StoreOps::open
+ * struct HcacheDict - Sample records for training a compression dictionary
  */
-struct HeaderCache *mutt_hcache_open(const char *path, const char *folder, hcache_namer_t namer)
+struct HcacheDict
 {
-  const struct StoreOps *ops = hcache_get_ops();
-  if (!ops)
-    return NULL;
+  struct Buffer samples;         ///< Sample records, one after another
+  size_t sizes[HC_DICT_SAMPLES]; ///< Length of each sample
+  size_t count;                  ///< Number of samples
+};
 
-  struct HeaderCache *hc = mutt_mem_calloc(1, sizeof(struct HeaderCache));
+/**
+ * dict_key - Get the key of the compression dictionary
+ * @param buf  Buffer for the key
+ * @param cops Compression backend
+ * @retval num Length of the key
+ *
+ * The key doesn't contain a folder name, so there's one dictionary per file.
+ */
+static size_t dict_key(struct Buffer *buf, const struct ComprOps *cops)
+{
+  return mutt_buffer_printf(buf, "hcache-dict-%s", cops->name);
+}
 
-  /* Calculate the current hcache version from dynamic configuration */
-  if (hcachever == 0x0)
-  {
-    union
-    {
-      unsigned char charval[16];
-      unsigned int intval;
-    } digest;
-    struct Md5Ctx md5ctx;
+/**
+ * dict_open - Load the compression dictionary
+ * @param hc Header cache handle
+ *
+ * If the file doesn't have a dictionary yet, start collecting samples.
+ */
+static void dict_open(struct HeaderCache *hc)
+{
+  const struct ComprOps *cops = compr_get_ops();
+  if (!cops->dict_load)
+    return;
 
-    hcachever = HCACHEVER;
+  const struct StoreOps *ops = hcache_get_ops();
+  struct Buffer key = mutt_buffer_make(64);
+  size_t klen = dict_key(&key, cops);
 
-    mutt_md5_init_ctx(&md5ctx);
+  size_t dlen = 0;
+  void *dict = ops->fetch(hc->ctx, mutt_b2s(&key), klen, &dlen);
+  bool loaded = dict && cops->dict_load(hc->cctx, dict, dlen);
+  ops->free(hc->ctx, &dict);
+  mutt_buffer_dealloc(&key);
 
-    /* Seed with the compiled-in header structure hash */
-    mutt_md5_process_bytes(&hcachever, sizeof(hcachever), &md5ctx);
+  if (!loaded)
+    hc->dict = mutt_mem_calloc(1, sizeof(struct HcacheDict));
+}
 
-    /* Mix in user's spam list */
-    struct Replace *sp = NULL;
-    STAILQ_FOREACH(sp, &SpamList, entries)
+/**
+ * dict_train - Train a compression dictionary, and save it
+ * @param hc Header cache handle
+ *
+ * Records stored before this don't use the dictionary.
+ */
+static void dict_train(struct HeaderCache *hc)
+{
+  struct HcacheDict *hd = hc->dict;
+  hc->dict = NULL;
+
+  if (hd->count >= HC_DICT_SAMPLES_MIN)
+  {
+    const struct ComprOps *cops = compr_get_ops();
+    const struct StoreOps *ops = hcache_get_ops();
+    struct Buffer key = mutt_buffer_make(64);
+    size_t klen = dict_key(&key, cops);
+
+    /* Another NeoMutt may have saved a dictionary since we looked */
+    size_t dlen = 0;
+    void *dict = ops->fetch(hc->ctx, mutt_b2s(&key), klen, &dlen);
+    if (dict && cops->dict_load(hc->cctx, dict, dlen))
     {
-      mutt_md5_process(sp->regex->pattern, &md5ctx);
-      mutt_md5_process(sp->templ, &md5ctx);
+      ops->free(hc->ctx, &dict);
     }
-
-    /* Mix in user's nospam list */
-    struct RegexNode *np = NULL;
-    STAILQ_FOREACH(np, &NoSpamList, entries)
+    else
     {
-      mutt_md5_process(np->regex->pattern, &md5ctx);
+      ops->free(hc->ctx, &dict);
+      dict = cops->dict_train(hc->cctx, hd->samples.data, hd->sizes, hd->count, &dlen);
+      if (dict)
+      {
+        mutt_debug(LL_DEBUG2, "trained a %zu byte dictionary from %zu records\n",
+                   dlen, hd->count);
+        ops->store(hc->ctx, mutt_b2s(&key), klen, dict, dlen);
+      }
     }
+    mutt_buffer_dealloc(&key);
+  }
+
+  mutt_buffer_dealloc(&hd->samples);
+  FREE(&hd);
+}
+
+/**
+ * dict_sample - Keep a record for training the compression dictionary
+ * @param hc   Header cache handle
+ * @param data Uncompressed record
+ * @param dlen Length of the record
+ */
+static void dict_sample(struct HeaderCache *hc, const char *data, size_t dlen)
+{
+  struct HcacheDict *hd = hc->dict;
+  if (!hd)
+    return;
+
+  if ((mutt_buffer_len(&hd->samples) + dlen) <= HC_DICT_SAMPLES_SIZE)
+  {
+    mutt_buffer_addstr_n(&hd->samples, data, dlen);
+    hd->sizes[hd->count++] = dlen;
+  }
+
+  if ((hd->count == HC_DICT_SAMPLES) ||
+      (mutt_buffer_len(&hd->samples) > (HC_DICT_SAMPLES_SIZE / 2)))
+  {
+    dict_train(hc);
+  }
+}
+#endif
+
+/**
+ * hcache_version - Calculate a header cache version from dynamic configuration
+ * @param base Compiled-in header structure hash, e.g. #HCACHEVER
+ * @retval num Header cache version
+ */
+static unsigned int hcache_version(unsigned int base)
+{
+  union
+  {
+    unsigned char charval[16];
+    unsigned int intval;
+  } digest;
+  struct Md5Ctx md5ctx;
+
+  mutt_md5_init_ctx(&md5ctx);
+
+  /* Seed with the compiled-in header structure hash */
+  mutt_md5_process_bytes(&base, sizeof(base), &md5ctx);
+
+  /* Mix in user's spam list */
+  struct Replace *sp = NULL;
+  STAILQ_FOREACH(sp, &SpamList, entries)
+  {
+    mutt_md5_process(sp->regex->pattern, &md5ctx);
+    mutt_md5_process(sp->templ, &md5ctx);
+  }
+
+  /* Mix in user's nospam list */
+  struct RegexNode *np = NULL;
+  STAILQ_FOREACH(np, &NoSpamList, entries)
+  {
+    mutt_md5_process(np->regex->pattern, &md5ctx);
+  }
+
+  /* Get a hash and take its bytes as an (unsigned int) hash version */
+  mutt_md5_finish_ctx(&md5ctx, digest.charval);
+  return digest.intval;
+}
+
+/**
+ * mutt_hcache_open - Multiplexor for StoreOps::open
+ */
+struct HeaderCache *mutt_hcache_open(const char *path, const char *folder, hcache_namer_t namer)
+{
+  const struct StoreOps *ops = hcache_get_ops();
+  if (!ops)
+    return NULL;
+
+  struct HeaderCache *hc = mutt_mem_calloc(1, sizeof(struct HeaderCache));
 
-    /* Get a hash and take its bytes as an (unsigned int) hash version */
-    mutt_md5_finish_ctx(&md5ctx, digest.charval);
-    hcachever = digest.intval;
+  /* Calculate the current hcache version from dynamic configuration */
+  if (hcachever == 0x0)
+  {
+    hcachever = hcache_version(HCACHEVER);
+    hcachever_legacy = hcache_version(HCACHEVER_LEGACY);
   }
 
 #ifdef USE_HCACHE_COMPRESSION
@@ -377,6 +636,7 @@ struct HeaderCache *mutt_hcache_open(const char *path, const char *folder, hcach
 
   hc->folder = get_foldername(folder);
   hc->crc = hcachever;
+  hc->crc_legacy = hcachever_legacy;
 
   if (!path || (path[0] == '\0'))
   {
@@ -403,6 +663,11 @@ struct HeaderCache *mutt_hcache_open(const char *path, const char *folder, hcach
     }
   }
 
+#ifdef USE_HCACHE_COMPRESSION
+  if (hc && hc->ctx && C_HeaderCacheCompressMethod)
+    dict_open(hc);
+#endif
+
   mutt_buffer_pool_release(&hcpath);
   return hc;
 }
@@ -417,6 +682,8 @@ void mutt_hcache_close(struct HeaderCache *hc)
     return;
 
 #ifdef USE_HCACHE_COMPRESSION
+  if (hc->dict)
+    dict_train(hc);
   if (C_HeaderCacheCompressMethod)
     compr_get_ops()->close(&hc->cctx);
 #endif
@@ -427,54 +694,314 @@ void mutt_hcache_close(struct HeaderCache *hc)
 }
 
 /**
- * mutt_hcache_fetch - Multiplexor for StoreOps::fetch
+ * hcache_decode - Restore an Email from a raw record
+ * @param[in]  hc          Header cache handle
+ * @param[in]  data        Raw record, from the Store
+ * @param[in]  dlen        Length of the record
+ * @param[in]  uidvalidity Only restore if it matches the stored uidvalidity
+ * @param[in]  lazy        Leave the Envelope and Body undecoded
+ * @param[out] legacy      Set to true if the record is in the old layout
+ * @retval obj HCacheEntry containing an Email, empty on failure
+ *
+ * If the record doesn't match, the entry's uidvalidity may still be set.
  */
-struct HCacheEntry mutt_hcache_fetch(struct HeaderCache *hc, const char *key,
-                                     size_t keylen, uint32_t uidvalidity)
+static struct HCacheEntry hcache_decode(struct HeaderCache *hc, const void *data,
+                                        size_t dlen, uint32_t uidvalidity,
+                                        bool lazy, bool *legacy)
 {
-  struct RealKey *rk = realkey(key, keylen);
   struct HCacheEntry entry = { 0 };
-
-  size_t dlen;
-  void *data = mutt_hcache_fetch_raw(hc, rk->key, rk->len, &dlen);
-  void *to_free = data;
-  if (!data)
-  {
-    goto end;
-  }
+  *legacy = false;
 
   /* restore uidvalidity and crc */
   size_t hlen = header_size();
+  if (dlen < hlen)
+    return entry;
   int off = 0;
   serial_restore_uint32_t(&entry.uidvalidity, data, &off);
   serial_restore_int(&entry.crc, data, &off);
   assert((size_t) off == hlen);
-  if (entry.crc != hc->crc || ((uidvalidity != 0) && uidvalidity != entry.uidvalidity))
+  const bool old = (entry.crc == hc->crc_legacy) && (entry.crc != hc->crc);
+  if (((entry.crc != hc->crc) && !old) ||
+      ((uidvalidity != 0) && uidvalidity != entry.uidvalidity))
   {
-    goto end;
+    return entry;
   }
 
+  size_t reclen = dlen - hlen;
 #ifdef USE_HCACHE_COMPRESSION
   if (C_HeaderCacheCompressMethod)
   {
     const struct ComprOps *cops = compr_get_ops();
 
-    void *dblob = cops->decompress(hc->cctx, (char *) data + hlen, dlen - hlen);
+    void *dblob = cops->decompress(hc->cctx, (const char *) data + hlen,
+                                   dlen - hlen, &reclen);
     if (!dblob)
     {
-      goto end;
+      return entry;
     }
     data = (char *) dblob - hlen; /* restore skips uidvalidity and crc */
   }
 #endif
 
-  entry.email = restore(data);
+  const unsigned char *rec = (const unsigned char *) data + hlen;
+  struct HcacheRecord hr;
+  if (record_parse(rec, reclen, &hr))
+  {
+    entry.email = restore_email(rec, &hr);
+    if (lazy)
+    {
+      entry.record = mutt_mem_malloc(hr.length);
+      memcpy(entry.record, rec, hr.length);
+    }
+    else
+    {
+      restore_details(entry.email, rec, &hr);
+    }
+  }
+  else if (old && (reclen >= sizeof(struct Email) + sizeof(struct Body)))
+  {
+    /* Written by a version before the flat format */
+    entry.email = restore_legacy(data);
+    *legacy = true;
+  }
 
-end:
-  mutt_hcache_free_raw(hc, &to_free);
   return entry;
 }
 
+/**
+ * hcache_fetch - Fetch and restore an Email
+ * @param hc          Header cache handle
+ * @param key         Message identification string
+ * @param keylen      Length of the string pointed to by key
+ * @param uidvalidity Only restore if it matches the stored uidvalidity
+ * @param lazy        Leave the Envelope and Body undecoded
+ * @retval obj HCacheEntry containing an Email, empty on failure
+ *
+ * Old-style records are restored in full, then saved in the current format.
+ */
+static struct HCacheEntry hcache_fetch(struct HeaderCache *hc, const char *key,
+                                       size_t keylen, uint32_t uidvalidity, bool lazy)
+{
+  struct RealKey *rk = realkey(key, keylen);
+  struct HCacheEntry entry = { 0 };
+  bool legacy = false;
+
+  size_t dlen = 0;
+  void *data = mutt_hcache_fetch_raw(hc, rk->key, rk->len, &dlen);
+  if (!data)
+    return entry;
+
+  entry = hcache_decode(hc, data, dlen, uidvalidity, lazy, &legacy);
+  mutt_hcache_free_raw(hc, &data);
+
+  if (legacy)
+  {
+    mutt_debug(LL_DEBUG3, "converting %s to the current format\n", rk->key);
+    mutt_hcache_store(hc, key, keylen, entry.email, entry.uidvalidity);
+  }
+
+  return entry;
+}
+
+/**
+ * mutt_hcache_fetch - Multiplexor for StoreOps::fetch
+ */
+struct HCacheEntry mutt_hcache_fetch(struct HeaderCache *hc, const char *key,
+                                     size_t keylen, uint32_t uidvalidity)
+{
+  return hcache_fetch(hc, key, keylen, uidvalidity, false);
+}
+
+/**
+ * mutt_hcache_fetch_lazy - Fetch a message's header, but don't decode it all
+ */
+struct HCacheEntry mutt_hcache_fetch_lazy(struct HeaderCache *hc, const char *key,
+                                          size_t keylen, uint32_t uidvalidity)
+{
+  return hcache_fetch(hc, key, keylen, uidvalidity, true);
+}
+
+/**
+ * mutt_hcache_entry_restore - Decode the rest of a lazily fetched Email
+ */
+bool mutt_hcache_entry_restore(struct HCacheEntry *hce)
+{
+  if (!hce || !hce->email)
+    return false;
+
+  if (!hce->record)
+    return true; /* Already complete */
+
+  struct HcacheRecord hr;
+  memcpy(&hr, hce->record, sizeof(hr));
+  restore_details(hce->email, hce->record, &hr);
+  FREE(&hce->record);
+  return true;
+}
+
+/**
+ * mutt_hcache_entry_free - Free a HCacheEntry
+ */
+void mutt_hcache_entry_free(struct HCacheEntry *hce)
+{
+  if (!hce)
+    return;
+
+  email_free(&hce->email);
+  FREE(&hce->record);
+}
+
+/**
+ * struct HcacheScan - Private data for mutt_hcache_fetch_all()
+ */
+struct HcacheScan
+{
+  struct HeaderCache *hc; ///< Header cache handle
+  size_t skip;            ///< Length of the folder name, at the start of each key
+  size_t plen;            ///< Length of the caller's prefix
+  uint32_t uidvalidity;   ///< Only restore if it matches the stored uidvalidity
+  bool lazy;              ///< Leave the Envelope and Body undecoded
+  hcache_scan_t cb;       ///< Caller's callback
+  void *cb_data;          ///< Caller's private data
+  struct Buffer key;      ///< Key, as seen by the caller
+  struct ListHead legacy; ///< Keys of old-style records to be converted
+  int count;              ///< Number of entries passed to the caller
+  bool stopped;           ///< The caller stopped the scan
+};
+
+/**
+ * scan_key - Turn a Store key into a caller's key
+ * @param scan Scan data
+ * @param key  Key, from the Store
+ * @param klen Length of the key
+ * @retval true The key belongs to a record of this folder, in the current format
+ *
+ * The folder name is removed from the start of the key.  If compression is
+ * enabled, the compressor's name is removed from the end.  Otherwise records
+ * that were compressed earlier are skipped.
+ *
+ * The folder name is a prefix of its subfolders' names, so keys with a '/'
+ * after the caller's prefix belong to another folder and are skipped.
+ */
+static bool scan_key(struct HcacheScan *scan, const char *key, size_t klen)
+{
+  key += scan->skip;
+  klen -= scan->skip;
+
+#ifdef USE_HCACHE_COMPRESSION
+  const char *dash = NULL;
+  for (size_t i = klen; (i > 0) && !dash; i--)
+  {
+    if (key[i - 1] == '-')
+      dash = key + i - 1;
+  }
+
+  char name[32];
+  size_t nlen = dash ? (klen - (dash - key) - 1) : 0;
+  if (dash && (nlen < sizeof(name)))
+  {
+    memcpy(name, dash + 1, nlen);
+    name[nlen] = '\0';
+  }
+  else
+    name[0] = '\0';
+
+  if (C_HeaderCacheCompressMethod)
+  {
+    if (!mutt_str_equal(name, compr_get_ops()->name))
+      return false;
+    klen = dash - key;
+  }
+  else if ((name[0] != '\0') && compress_get_ops(name))
+  {
+    return false;
+  }
+#endif
+
+  if ((klen < scan->plen) || memchr(key + scan->plen, '/', klen - scan->plen))
+    return false;
+
+  mutt_buffer_reset(&scan->key);
+  mutt_buffer_addstr_n(&scan->key, key, klen);
+  return true;
+}
+
+/**
+ * scan_record - Decode a record for mutt_hcache_fetch_all() - Implements ::store_scan_t
+ */
+static bool scan_record(const char *key, size_t klen, const void *value,
+                        size_t vlen, void *data)
+{
+  struct HcacheScan *scan = data;
+
+  if (!scan_key(scan, key, klen))
+    return true;
+
+  bool legacy = false;
+  struct HCacheEntry hce =
+      hcache_decode(scan->hc, value, vlen, scan->uidvalidity, scan->lazy, &legacy);
+  if (!hce.email)
+    return true;
+
+  /* Old-style records can't be rewritten while the Store is being read */
+  if (legacy)
+    mutt_list_insert_tail(&scan->legacy, mutt_buffer_strdup(&scan->key));
+
+  scan->count++;
+  if (scan->cb(mutt_b2s(&scan->key), mutt_buffer_len(&scan->key), &hce, scan->cb_data))
+    return true;
+
+  scan->stopped = true;
+  return false;
+}
+
+/**
+ * mutt_hcache_fetch_all - Multiplexor for StoreOps::scan
+ */
+int mutt_hcache_fetch_all(struct HeaderCache *hc, const char *prefix, size_t plen,
+                          uint32_t uidvalidity, bool lazy, hcache_scan_t cb, void *data)
+{
+  const struct StoreOps *ops = hcache_get_ops();
+
+  if (!hc || !ops || !ops->scan || !cb)
+    return -1;
+
+  struct HcacheScan scan = { 0 };
+  scan.hc = hc;
+  scan.skip = mutt_str_len(hc->folder);
+  scan.plen = prefix ? plen : 0;
+  scan.uidvalidity = uidvalidity;
+  scan.lazy = lazy;
+  scan.cb = cb;
+  scan.cb_data = data;
+  scan.key = mutt_buffer_make(256);
+  STAILQ_INIT(&scan.legacy);
+
+  struct Buffer path = mutt_buffer_make(1024);
+  plen = mutt_buffer_printf(&path, "%s%.*s", hc->folder, (int) plen, prefix ? prefix : "");
+  int rc = ops->scan(hc->ctx, mutt_b2s(&path), plen, scan_record, &scan);
+  mutt_buffer_dealloc(&path);
+  mutt_buffer_dealloc(&scan.key);
+
+  struct ListNode *np = NULL;
+  STAILQ_FOREACH(np, &scan.legacy, entries)
+  {
+    struct HCacheEntry hce = hcache_fetch(hc, np->data, strlen(np->data), 0, true);
+    mutt_hcache_entry_free(&hce);
+  }
+  mutt_list_free(&scan.legacy);
+
+  if (rc != 0)
+  {
+    mutt_debug(LL_DEBUG1, "scan of %s failed: %d\n", hc->folder, rc);
+    return -1;
+  }
+
+  mutt_debug(LL_DEBUG2, "scanned %d entries from %s%s\n", scan.count,
+             hc->folder, scan.stopped ? " (stopped)" : "");
+  return scan.count;
+}
+
 /**
  * mutt_hcache_fetch_raw - Fetch a message's header from the cache
  * @param[in]  hc     Pointer to the struct HeaderCache structure got by mutt_hcache_open()
@@ -536,6 +1063,8 @@ int mutt_hcache_store(struct HeaderCache *hc, const char *key, size_t keylen,
 
     const struct ComprOps *cops = compr_get_ops();
 
+    dict_sample(hc, data + hlen, dlen - hlen);
+
     /* data / dlen gets ptr to compressed data here */
     size_t clen = dlen;
     void *cdata = cops->compress(hc->cctx, data + hlen, dlen - hlen, &clen);
@@ -609,3 +1138,27 @@ int mutt_hcache_delete_record(struct HeaderCache *hc, const char *key, size_t ke
   mutt_buffer_dealloc(&path);
   return rc;
 }
+
+/**
+ * mutt_hcache_begin - Multiplexor for StoreOps::begin
+ */
+int mutt_hcache_begin(struct HeaderCache *hc)
+{
+  const struct StoreOps *ops = hcache_get_ops();
+  if (!hc || !ops)
+    return -1;
+
+  return ops->begin(hc->ctx);
+}
+
+/**
+ * mutt_hcache_commit - Multiplexor for StoreOps::commit
+ */
+int mutt_hcache_commit(struct HeaderCache *hc)
+{
+  const struct StoreOps *ops = hcache_get_ops();
+  if (!hc || !ops)
+    return -1;
+
+  return ops->commit(hc->ctx);
+}
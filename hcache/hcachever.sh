@@ -1,6 +1,8 @@
 #!/bin/sh
 
-BASEVERSION=6
+BASEVERSION=7
+# Records written with this version are in the old layout, see restore_legacy()
+LEGACYVERSION=6
 STRUCTURES="Address Body Buffer Email Envelope ListNode Parameter"
 
 cleanstruct () {
@@ -91,7 +93,7 @@ md5prog () {
 DEST="$1"
 TMPD="$DEST.tmp"
 
-TEXT="$BASEVERSION"
+TEXT=""
 
 echo "/* base version: $BASEVERSION" > $TMPD
 while read line
@@ -112,8 +114,10 @@ done
 echo " */" >> $TMPD
 
 MD5PROG=$(md5prog)
-MD5TEXT=`echo "$TEXT" | $MD5PROG | cut -c-8`
+MD5TEXT=`echo "$BASEVERSION$TEXT" | $MD5PROG | cut -c-8`
 echo "#define HCACHEVER 0x$MD5TEXT" >> $TMPD
+MD5TEXT=`echo "$LEGACYVERSION$TEXT" | $MD5PROG | cut -c-8`
+echo "#define HCACHEVER_LEGACY 0x$MD5TEXT" >> $TMPD
 
 # TODO: validate we have all structs
 
@@ -55,6 +55,19 @@
  * **not** affect the CRC.  In this case, it is vital that you bump the
  * **`BASEVERSION`** variable in `hcache/hcachever.sh`
  *
+ * Each record is split into sections, with a table of contents at the start.
+ * mutt_hcache_fetch_lazy() only decodes the scalar fields of the Email; the
+ * Envelope and Body are decoded by mutt_hcache_entry_restore(), if they're
+ * needed.  Records written by older versions, which contain a copy of the
+ * struct Email, are recognised by `LEGACYVERSION` and converted when they're
+ * fetched.
+ *
+ * mutt_hcache_fetch_all() reads every message in a folder in one pass, if the
+ * \ref store keeps its keys in order.  This saves a lookup per message.
+ *
+ * If the \ref compress backend supports it, a compression dictionary is
+ * trained from the first records stored in a file, and saved alongside them.
+ *
  * ## Source
  *
  * | File                | Description        |
@@ -67,12 +80,14 @@
 #ifndef MUTT_HCACHE_LIB_H
 #define MUTT_HCACHE_LIB_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 struct Buffer;
 struct ConfigSet;
 struct Email;
+struct HcacheDict;
 
 /**
  * struct HeaderCache - header cache structure
@@ -86,8 +101,10 @@ struct HeaderCache
 {
   char *folder;
   unsigned int crc;
+  unsigned int crc_legacy; ///< CRC of records in the old layout, see restore_legacy()
   void *ctx;
   void *cctx;
+  struct HcacheDict *dict;
 };
 
 /**
@@ -98,6 +115,7 @@ struct HCacheEntry
   uint32_t uidvalidity; ///< IMAP-specific UIDVALIDITY
   unsigned int crc;     ///< CRC of Email/Body/etc structs
   struct Email *email;  ///< Retrieved email
+  void *record;         ///< Undecoded Envelope and Body, see mutt_hcache_fetch_lazy()
 };
 
 /**
@@ -107,6 +125,19 @@ struct HCacheEntry
  */
 typedef void (*hcache_namer_t)(const char *path, struct Buffer *dest);
 
+/**
+ * typedef hcache_scan_t - Prototype for a mutt_hcache_fetch_all() callback
+ * @param key    Message identification string
+ * @param keylen Length of the key string
+ * @param hce    Entry from the header cache
+ * @param data   Private data passed to mutt_hcache_fetch_all()
+ * @retval true  Continue the scan
+ * @retval false Stop the scan
+ *
+ * The callback owns the entry.  It must keep it, or mutt_hcache_entry_free() it.
+ */
+typedef bool (*hcache_scan_t)(const char *key, size_t keylen, struct HCacheEntry *hce, void *data);
+
 extern char *C_HeaderCache;
 extern char *C_HeaderCacheBackend;
 extern short C_HeaderCacheCompressLevel;
@@ -156,6 +187,57 @@ int mutt_hcache_store(struct HeaderCache *hc, const char *key, size_t keylen,
  */
 struct HCacheEntry mutt_hcache_fetch(struct HeaderCache *hc, const char *key, size_t keylen, uint32_t uidvalidity);
 
+/**
+ * mutt_hcache_fetch_lazy - fetch a message's header, decoding as little as possible
+ * @param hc     Pointer to the struct HeaderCache structure got by mutt_hcache_open()
+ * @param key    Message identification string
+ * @param keylen Length of the string pointed to by key
+ * @param uidvalidity Only restore if it matches the stored uidvalidity
+ * @retval obj HCacheEntry containing an Email, empty on failure
+ *
+ * Only the scalar fields of the Email are restored.  The Email has no Envelope
+ * or Body until mutt_hcache_entry_restore() is called.
+ *
+ * @note The entry must be freed with mutt_hcache_entry_free(), unless it has
+ *       been restored, in which case the Email belongs to the caller.
+ */
+struct HCacheEntry mutt_hcache_fetch_lazy(struct HeaderCache *hc, const char *key, size_t keylen, uint32_t uidvalidity);
+
+/**
+ * mutt_hcache_entry_restore - decode the Envelope and Body of a lazily fetched entry
+ * @param hce Entry from mutt_hcache_fetch_lazy()
+ * @retval true The Email is complete
+ */
+bool mutt_hcache_entry_restore(struct HCacheEntry *hce);
+
+/**
+ * mutt_hcache_entry_free - free a header cache entry, and its Email
+ * @param hce Entry from mutt_hcache_fetch() or mutt_hcache_fetch_lazy()
+ */
+void mutt_hcache_entry_free(struct HCacheEntry *hce);
+
+/**
+ * mutt_hcache_fetch_all - fetch all the messages whose key starts with a prefix
+ * @param hc     Pointer to the struct HeaderCache structure got by mutt_hcache_open()
+ * @param prefix Start of the message identification strings
+ * @param plen   Length of the prefix
+ * @param uidvalidity Only restore if it matches the stored uidvalidity
+ * @param lazy   Leave the Envelope and Body undecoded, like mutt_hcache_fetch_lazy()
+ * @param cb     Function to call for each entry
+ * @param data   Private data passed to the callback
+ * @retval num Number of entries passed to the callback
+ * @retval -1  The backend can't be scanned, or an error occurred
+ *
+ * The whole folder is read in one pass, in key order.  Entries that don't
+ * match the crc, or uidvalidity, are skipped.  So are keys that contain a '/'
+ * after the prefix, which belong to a subfolder.
+ *
+ * If this fails, the caller should fall back to mutt_hcache_fetch() for each
+ * key.  Some entries may already have been passed to the callback.
+ */
+int mutt_hcache_fetch_all(struct HeaderCache *hc, const char *prefix, size_t plen,
+                          uint32_t uidvalidity, bool lazy, hcache_scan_t cb, void *data);
+
 int mutt_hcache_store_raw(struct HeaderCache *hc, const char *key, size_t keylen,
                           void *data, size_t dlen);
 
@@ -178,4 +260,22 @@ void mutt_hcache_free_raw(struct HeaderCache *hc, void **data);
  */
 int mutt_hcache_delete_record(struct HeaderCache *hc, const char *key, size_t keylen);
 
+/**
+ * mutt_hcache_begin - start a batch of writes
+ * @param hc Pointer to the struct HeaderCache structure got by mutt_hcache_open()
+ * @retval 0   Success
+ * @retval num Generic or backend-specific error code otherwise
+ *
+ * Any stores or deletes, until mutt_hcache_commit(), are written as one batch.
+ */
+int mutt_hcache_begin(struct HeaderCache *hc);
+
+/**
+ * mutt_hcache_commit - write a batch started by mutt_hcache_begin()
+ * @param hc Pointer to the struct HeaderCache structure got by mutt_hcache_open()
+ * @retval 0   Success
+ * @retval num Generic or backend-specific error code otherwise
+ */
+int mutt_hcache_commit(struct HeaderCache *hc);
+
 #endif /* MUTT_HCACHE_LIB_H */
@@ -31,6 +31,7 @@
 
 #include "config.h"
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <sys/types.h>
 #include "mutt/lib.h"
@@ -410,6 +411,161 @@ void serial_restore_parameter(struct ParameterList *pl, const unsigned char *d,
   }
 }
 
+/**
+ * struct HcacheEmail - The scalar fields of an Email, as cached
+ *
+ * The fields have a fixed size, so the record doesn't depend on the layout of
+ * struct Email.
+ */
+struct HcacheEmail
+{
+  int64_t date_sent;  ///< Email::date_sent
+  int64_t received;   ///< Email::received
+  int64_t offset;     ///< Email::offset
+  uint32_t flags;     ///< Boolean fields, e.g. #HC_EMAIL_READ
+  uint16_t security;  ///< Email::security
+  uint8_t zhours;     ///< Email::zhours
+  uint8_t zminutes;   ///< Email::zminutes
+  int32_t lines;      ///< Email::lines
+  int32_t index;      ///< Email::index
+  int32_t msgno;      ///< Email::msgno
+  int32_t vnum;       ///< Email::vnum
+  int32_t score;      ///< Email::score
+};
+
+#define HC_EMAIL_MIME            (1 << 0)  ///< Email::mime
+#define HC_EMAIL_FLAGGED         (1 << 1)  ///< Email::flagged
+#define HC_EMAIL_DELETED         (1 << 2)  ///< Email::deleted
+#define HC_EMAIL_PURGE           (1 << 3)  ///< Email::purge
+#define HC_EMAIL_QUASI_DELETED   (1 << 4)  ///< Email::quasi_deleted
+#define HC_EMAIL_ATTACH_DEL      (1 << 5)  ///< Email::attach_del
+#define HC_EMAIL_OLD             (1 << 6)  ///< Email::old
+#define HC_EMAIL_READ            (1 << 7)  ///< Email::read
+#define HC_EMAIL_EXPIRED         (1 << 8)  ///< Email::expired
+#define HC_EMAIL_SUPERSEDED      (1 << 9)  ///< Email::superseded
+#define HC_EMAIL_REPLIED         (1 << 10) ///< Email::replied
+#define HC_EMAIL_SUBJECT_CHANGED (1 << 11) ///< Email::subject_changed
+#define HC_EMAIL_DISPLAY_SUBJECT (1 << 12) ///< Email::display_subject
+#define HC_EMAIL_ACTIVE          (1 << 13) ///< Email::active
+#define HC_EMAIL_TRASH           (1 << 14) ///< Email::trash
+#define HC_EMAIL_ZOCCIDENT       (1 << 15) ///< Email::zoccident
+
+/**
+ * struct HcacheBody - The scalar fields of a Body, as cached
+ */
+struct HcacheBody
+{
+  int64_t hdr_offset;   ///< Body::hdr_offset
+  int64_t offset;       ///< Body::offset
+  int64_t length;       ///< Body::length
+  int64_t stamp;        ///< Body::stamp
+  uint32_t flags;       ///< Boolean fields, e.g. #HC_BODY_USE_DISP
+  int16_t attach_count; ///< Body::attach_count
+  uint8_t type;         ///< Body::type
+  uint8_t encoding;     ///< Body::encoding
+  uint8_t disposition;  ///< Body::disposition
+  uint8_t padding[3];   ///< Unused
+};
+
+#define HC_BODY_USE_DISP      (1 << 0) ///< Body::use_disp
+#define HC_BODY_NOCONV        (1 << 1) ///< Body::noconv
+#define HC_BODY_FORCE_CHARSET (1 << 2) ///< Body::force_charset
+#define HC_BODY_GOODSIG       (1 << 3) ///< Body::goodsig
+#define HC_BODY_WARNSIG       (1 << 4) ///< Body::warnsig
+#define HC_BODY_BADSIG        (1 << 5) ///< Body::badsig
+#define HC_BODY_IS_AUTOCRYPT  (1 << 6) ///< Body::is_autocrypt
+
+/**
+ * serial_dump_email - Pack the scalar fields of an Email into a binary blob
+ * @param e   Email to pack
+ * @param d   Binary blob to add to
+ * @param off Offset into the blob
+ * @retval ptr End of the newly packed binary
+ *
+ * Fields that describe the current view, e.g. tagged, aren't saved.
+ */
+unsigned char *serial_dump_email(const struct Email *e, unsigned char *d, int *off)
+{
+  struct HcacheEmail he = { 0 };
+
+  he.date_sent = e->date_sent;
+  he.received = e->received;
+  he.offset = e->offset;
+  he.security = e->security;
+  he.zhours = e->zhours;
+  he.zminutes = e->zminutes;
+  he.lines = e->lines;
+  he.index = e->index;
+  he.msgno = e->msgno;
+  he.vnum = e->vnum;
+  he.score = e->score;
+
+  he.flags |= e->mime ? HC_EMAIL_MIME : 0;
+  he.flags |= e->flagged ? HC_EMAIL_FLAGGED : 0;
+  he.flags |= e->deleted ? HC_EMAIL_DELETED : 0;
+  he.flags |= e->purge ? HC_EMAIL_PURGE : 0;
+  he.flags |= e->quasi_deleted ? HC_EMAIL_QUASI_DELETED : 0;
+  he.flags |= e->attach_del ? HC_EMAIL_ATTACH_DEL : 0;
+  he.flags |= e->old ? HC_EMAIL_OLD : 0;
+  he.flags |= e->read ? HC_EMAIL_READ : 0;
+  he.flags |= e->expired ? HC_EMAIL_EXPIRED : 0;
+  he.flags |= e->superseded ? HC_EMAIL_SUPERSEDED : 0;
+  he.flags |= e->replied ? HC_EMAIL_REPLIED : 0;
+  he.flags |= e->subject_changed ? HC_EMAIL_SUBJECT_CHANGED : 0;
+  he.flags |= e->display_subject ? HC_EMAIL_DISPLAY_SUBJECT : 0;
+  he.flags |= e->active ? HC_EMAIL_ACTIVE : 0;
+  he.flags |= e->trash ? HC_EMAIL_TRASH : 0;
+  he.flags |= e->zoccident ? HC_EMAIL_ZOCCIDENT : 0;
+
+  lazy_realloc(&d, *off + sizeof(he));
+  memcpy(d + *off, &he, sizeof(he));
+  *off += sizeof(he);
+
+  return d;
+}
+
+/**
+ * serial_restore_email - Unpack the scalar fields of an Email from a binary blob
+ * @param e   Store the unpacked Email here
+ * @param d   Binary blob to read from
+ * @param off Offset into the blob
+ */
+void serial_restore_email(struct Email *e, const unsigned char *d, int *off)
+{
+  struct HcacheEmail he;
+  memcpy(&he, d + *off, sizeof(he));
+  *off += sizeof(he);
+
+  e->date_sent = he.date_sent;
+  e->received = he.received;
+  e->offset = he.offset;
+  e->security = he.security;
+  e->zhours = he.zhours;
+  e->zminutes = he.zminutes;
+  e->lines = he.lines;
+  e->index = he.index;
+  e->msgno = he.msgno;
+  e->vnum = he.vnum;
+  e->score = he.score;
+
+  e->mime = he.flags & HC_EMAIL_MIME;
+  e->flagged = he.flags & HC_EMAIL_FLAGGED;
+  e->deleted = he.flags & HC_EMAIL_DELETED;
+  e->purge = he.flags & HC_EMAIL_PURGE;
+  e->quasi_deleted = he.flags & HC_EMAIL_QUASI_DELETED;
+  e->attach_del = he.flags & HC_EMAIL_ATTACH_DEL;
+  e->old = he.flags & HC_EMAIL_OLD;
+  e->read = he.flags & HC_EMAIL_READ;
+  e->expired = he.flags & HC_EMAIL_EXPIRED;
+  e->superseded = he.flags & HC_EMAIL_SUPERSEDED;
+  e->replied = he.flags & HC_EMAIL_REPLIED;
+  e->subject_changed = he.flags & HC_EMAIL_SUBJECT_CHANGED;
+  e->display_subject = he.flags & HC_EMAIL_DISPLAY_SUBJECT;
+  e->active = he.flags & HC_EMAIL_ACTIVE;
+  e->trash = he.flags & HC_EMAIL_TRASH;
+  e->zoccident = he.flags & HC_EMAIL_ZOCCIDENT;
+}
+
 /**
  * serial_dump_body - Pack an Body into a binary blob
  * @param c       Body to pack
@@ -420,33 +576,40 @@ void serial_restore_parameter(struct ParameterList *pl, const unsigned char *d,
  */
 unsigned char *serial_dump_body(struct Body *c, unsigned char *d, int *off, bool convert)
 {
-  struct Body nb;
-
-  memcpy(&nb, c, sizeof(struct Body));
-
-  /* some fields are not safe to cache */
-  nb.content = NULL;
-  nb.charset = NULL;
-  nb.next = NULL;
-  nb.parts = NULL;
-  nb.email = NULL;
-  nb.aptr = NULL;
-  nb.mime_headers = NULL;
-  nb.language = NULL;
-
-  lazy_realloc(&d, *off + sizeof(struct Body));
-  memcpy(d + *off, &nb, sizeof(struct Body));
-  *off += sizeof(struct Body);
+  struct HcacheBody hb = { 0 };
+
+  hb.hdr_offset = c->hdr_offset;
+  hb.offset = c->offset;
+  hb.length = c->length;
+  hb.stamp = c->stamp;
+  hb.attach_count = c->attach_count;
+  hb.type = c->type;
+  hb.encoding = c->encoding;
+  hb.disposition = c->disposition;
+
+  hb.flags |= c->use_disp ? HC_BODY_USE_DISP : 0;
+  hb.flags |= c->noconv ? HC_BODY_NOCONV : 0;
+  hb.flags |= c->force_charset ? HC_BODY_FORCE_CHARSET : 0;
+  hb.flags |= c->goodsig ? HC_BODY_GOODSIG : 0;
+  hb.flags |= c->warnsig ? HC_BODY_WARNSIG : 0;
+  hb.flags |= c->badsig ? HC_BODY_BADSIG : 0;
+#ifdef USE_AUTOCRYPT
+  hb.flags |= c->is_autocrypt ? HC_BODY_IS_AUTOCRYPT : 0;
+#endif
+
+  lazy_realloc(&d, *off + sizeof(hb));
+  memcpy(d + *off, &hb, sizeof(hb));
+  *off += sizeof(hb);
 
-  d = serial_dump_char(nb.xtype, d, off, false);
-  d = serial_dump_char(nb.subtype, d, off, false);
+  d = serial_dump_char(c->xtype, d, off, false);
+  d = serial_dump_char(c->subtype, d, off, false);
 
-  d = serial_dump_parameter(&nb.parameter, d, off, convert);
+  d = serial_dump_parameter(&c->parameter, d, off, convert);
 
-  d = serial_dump_char(nb.description, d, off, convert);
-  d = serial_dump_char(nb.form_name, d, off, convert);
-  d = serial_dump_char(nb.filename, d, off, convert);
-  d = serial_dump_char(nb.d_filename, d, off, convert);
+  d = serial_dump_char(c->description, d, off, convert);
+  d = serial_dump_char(c->form_name, d, off, convert);
+  d = serial_dump_char(c->filename, d, off, convert);
+  d = serial_dump_char(c->d_filename, d, off, convert);
 
   return d;
 }
@@ -459,6 +622,52 @@ unsigned char *serial_dump_body(struct Body *c, unsigned char *d, int *off, bool
  * @param convert If true, the strings will be converted from utf-8
  */
 void serial_restore_body(struct Body *c, const unsigned char *d, int *off, bool convert)
+{
+  struct HcacheBody hb;
+  memcpy(&hb, d + *off, sizeof(hb));
+  *off += sizeof(hb);
+
+  c->hdr_offset = hb.hdr_offset;
+  c->offset = hb.offset;
+  c->length = hb.length;
+  c->stamp = hb.stamp;
+  c->attach_count = hb.attach_count;
+  c->type = hb.type;
+  c->encoding = hb.encoding;
+  c->disposition = hb.disposition;
+
+  c->use_disp = hb.flags & HC_BODY_USE_DISP;
+  c->noconv = hb.flags & HC_BODY_NOCONV;
+  c->force_charset = hb.flags & HC_BODY_FORCE_CHARSET;
+  c->goodsig = hb.flags & HC_BODY_GOODSIG;
+  c->warnsig = hb.flags & HC_BODY_WARNSIG;
+  c->badsig = hb.flags & HC_BODY_BADSIG;
+#ifdef USE_AUTOCRYPT
+  c->is_autocrypt = hb.flags & HC_BODY_IS_AUTOCRYPT;
+#endif
+
+  serial_restore_char(&c->xtype, d, off, false);
+  serial_restore_char(&c->subtype, d, off, false);
+
+  serial_restore_parameter(&c->parameter, d, off, convert);
+
+  serial_restore_char(&c->description, d, off, convert);
+  serial_restore_char(&c->form_name, d, off, convert);
+  serial_restore_char(&c->filename, d, off, convert);
+  serial_restore_char(&c->d_filename, d, off, convert);
+}
+
+/**
+ * serial_restore_body_legacy - Unpack a Body from an old-style binary blob
+ * @param c       Store the unpacked Body here
+ * @param d       Binary blob to read from
+ * @param off     Offset into the blob
+ * @param convert If true, the strings will be converted from utf-8
+ *
+ * Old header cache records contain a copy of the whole struct Body.
+ * This is only used to convert them to the current format.
+ */
+void serial_restore_body_legacy(struct Body *c, const unsigned char *d, int *off, bool convert)
 {
   memcpy(c, d + *off, sizeof(struct Body));
   *off += sizeof(struct Body);
@@ -149,25 +149,52 @@ static int browse_add_list_result(struct ImapAccountData *adata, const char *cmd
   int rc;
   struct Url *url = url_parse(state->folder);
 
+  /* the folder added last, to attach its LIST-STATUS counts */
+  char *last = NULL;
+  size_t last_entry = 0;
+
   imap_cmd_start(adata, cmd);
+  list.want_status = (adata->capabilities & IMAP_CAP_LIST_STATUS);
   adata->cmdresult = &list;
   do
   {
     list.name = NULL;
+    list.has_status = false;
     rc = imap_cmd_step(adata);
 
-    if ((rc == IMAP_RES_CONTINUE) && list.name)
+    if ((rc == IMAP_RES_CONTINUE) && list.name && list.has_status)
+    {
+      if (last && mutt_str_equal(last, list.name))
+      {
+        struct FolderFile *ff = &state->entry[last_entry];
+        ff->has_mailbox = true;
+        ff->has_new_mail = (list.unseen > 0);
+        ff->msg_count = list.messages;
+        ff->msg_unread = list.unseen;
+      }
+    }
+    else if ((rc == IMAP_RES_CONTINUE) && list.name)
     {
       /* Let a parent folder never be selectable for navigation */
       if (isparent)
         list.noselect = true;
       /* prune current folder from output */
+      FREE(&last);
       if (isparent || !mutt_str_startswith(url->path, list.name))
+      {
+        const size_t entrylen = state->entrylen;
         add_folder(list.delim, list.name, list.noselect, list.noinferiors, state, isparent);
+        if (state->entrylen > entrylen)
+        {
+          last = mutt_str_dup(list.name);
+          last_entry = entrylen;
+        }
+      }
     }
   } while (rc == IMAP_RES_CONTINUE);
   adata->cmdresult = NULL;
 
+  FREE(&last);
   url_free(&url);
 
   return (rc == IMAP_RES_OK) ? 0 : -1;
@@ -350,8 +377,14 @@ int imap_browse(const char *path, struct BrowserState *state)
   imap_munge_mbox_name(adata->unicode, munged_mbox, sizeof(munged_mbox), buf);
   mutt_debug(LL_DEBUG3, "%s\n", munged_mbox);
   len = snprintf(buf, sizeof(buf), "%s \"\" %s", list_cmd, munged_mbox);
+  /* LIST-STATUS needs LIST-EXTENDED, so LSUB isn't used with it */
   if (adata->capabilities & IMAP_CAP_LIST_EXTENDED)
-    snprintf(buf + len, sizeof(buf) - len, " RETURN (CHILDREN)");
+  {
+    snprintf(buf + len, sizeof(buf) - len, " RETURN (CHILDREN%s)",
+             (adata->capabilities & IMAP_CAP_LIST_STATUS) ?
+                 " STATUS (MESSAGES UNSEEN RECENT UIDNEXT UIDVALIDITY)" :
+                 "");
+  }
   if (browse_add_list_result(adata, buf, state, false))
     goto fail;
 
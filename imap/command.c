@@ -79,6 +79,14 @@ static const char *const Capabilities[] = {
   "LIST-EXTENDED",
   "COMPRESS=DEFLATE",
   "X-GM-EXT-1",
+  "SORT",
+  "SORT=DISPLAY",
+  "THREAD=REFERENCES",
+  "ESORT",
+  "NOTIFY",
+  "LIST-STATUS",
+  "MOVE",
+  "UIDPLUS",
   NULL,
 };
 
@@ -573,7 +581,9 @@ static void cmd_parse_list(struct ImapAccountData *adata, char *s)
   else
     list = &lb;
 
+  const bool want_status = list->want_status;
   memset(list, 0, sizeof(struct ImapList));
+  list->want_status = want_status;
 
   /* flags */
   s = imap_next_word(s);
@@ -832,15 +842,30 @@ static void cmd_parse_status(struct ImapAccountData *adata, char *s)
     imap_unmunge_mbox_name(adata->unicode, mailbox);
   }
 
+  /* LIST-STATUS: the caller wants the counts of every folder listed */
+  struct ImapList *list = NULL;
+  if (adata->cmdresult && adata->cmdresult->want_status)
+    list = adata->cmdresult;
+
   struct Mailbox *m = find_mailbox(adata, mailbox);
   struct ImapMboxData *mdata = imap_mdata_get(m);
+  /* The selected mailbox's counts are kept by EXISTS and FETCH */
+  if (list && m && (m == adata->mailbox))
+    mdata = NULL;
+  struct ImapMboxData lb = { 0 };
   if (!mdata)
   {
-    mutt_debug(LL_DEBUG3, "Received status for an unexpected mailbox: %s\n", mailbox);
-    return;
+    if (!list)
+    {
+      mutt_debug(LL_DEBUG3, "Received status for an unexpected mailbox: %s\n", mailbox);
+      return;
+    }
+    m = NULL;
+    mdata = &lb;
   }
   uint32_t olduv = mdata->uidvalidity;
   unsigned int oldun = mdata->uid_next;
+  bool has_unseen = false;
 
   if (*s++ != '(')
   {
@@ -869,16 +894,39 @@ static void cmd_parse_status(struct ImapAccountData *adata, char *s)
     else if (mutt_str_startswith(s, "UIDVALIDITY"))
       mdata->uidvalidity = count;
     else if (mutt_str_startswith(s, "UNSEEN"))
+    {
       mdata->unseen = count;
+      has_unseen = true;
+    }
 
     s = value;
     if ((s[0] != '\0') && (*s != ')'))
       s = imap_next_word(s);
   }
   mutt_debug(LL_DEBUG3, "%s (UIDVALIDITY: %u, UIDNEXT: %u) %d messages, %d recent, %d unseen\n",
-             mdata->name, mdata->uidvalidity, mdata->uid_next, mdata->messages,
+             mailbox, mdata->uidvalidity, mdata->uid_next, mdata->messages,
              mdata->recent, mdata->unseen);
 
+  if (list)
+  {
+    list->name = mailbox;
+    list->has_status = true;
+    list->messages = mdata->messages;
+    list->unseen = mdata->unseen;
+  }
+
+  if (!m)
+    return;
+
+  /* A NOTIFY event may not say how many messages are unseen.
+   * Ask for the full STATUS at the next mail check, see imap_notify_poll() */
+  if (adata->notify && !has_unseen)
+  {
+    mdata->uid_next = oldun;
+    mdata->notify_stale = true;
+    return;
+  }
+
   mutt_debug(LL_DEBUG3, "Running default STATUS handler\n");
 
   mutt_debug(LL_DEBUG3, "Found %s in mailbox list (OV: %u ON: %u U: %d)\n",
@@ -977,6 +1025,40 @@ static void cmd_parse_exists(struct ImapAccountData *adata, const char *pn)
   }
 }
 
+/**
+ * cmd_parse_copyuid - Parse a COPYUID response code (RFC4315)
+ * @param adata Imap Account data
+ * @param s     Response code, e.g. `[COPYUID 38505 304,319:320 3956:3958]`
+ *
+ * The code is sent with the tagged reply to COPY, or untagged before the
+ * EXPUNGEs of a MOVE.
+ */
+static void cmd_parse_copyuid(struct ImapAccountData *adata, const char *s)
+{
+  unsigned int uidvalidity = 0;
+
+  mutt_debug(LL_DEBUG2, "Handling COPYUID\n");
+
+  if (!adata->copy_dest)
+    return;
+
+  /* the sets can be long, so they're cut out of a copy of the line */
+  char *code = mutt_str_dup(s);
+  char *uv = imap_next_word(code);
+  char *src_set = imap_next_word(uv);
+  char *dst_set = imap_next_word(src_set);
+  uv[strcspn(uv, " ")] = '\0';
+  src_set[strcspn(src_set, " ")] = '\0';
+  dst_set[strcspn(dst_set, "] ")] = '\0';
+
+  if ((mutt_str_atoui(uv, &uidvalidity) < 0) || (*src_set == '\0') || (*dst_set == '\0'))
+    mutt_debug(LL_DEBUG1, "Error parsing COPYUID\n");
+  else
+    imap_copy_seed(adata, uidvalidity, src_set, dst_set);
+
+  FREE(&code);
+}
+
 /**
  * cmd_handle_untagged - fallback parser for otherwise unhandled messages
  * @param adata Imap Account data
@@ -1011,6 +1093,8 @@ static int cmd_handle_untagged(struct ImapAccountData *adata)
     cmd_parse_capability(adata, pn);
   else if (mutt_istr_startswith(pn, "OK [CAPABILITY"))
     cmd_parse_capability(adata, imap_next_word(pn));
+  else if (mutt_istr_startswith(s, "OK [COPYUID"))
+    cmd_parse_copyuid(adata, pn);
   else if (mutt_istr_startswith(s, "LIST"))
     cmd_parse_list(adata, s);
   else if (mutt_istr_startswith(s, "LSUB"))
@@ -1019,6 +1103,10 @@ static int cmd_handle_untagged(struct ImapAccountData *adata)
     cmd_parse_myrights(adata, s);
   else if (mutt_istr_startswith(s, "SEARCH"))
     cmd_parse_search(adata, s);
+  else if (mutt_istr_startswith(s, "SORT"))
+    cmd_parse_sort(adata, s);
+  else if (mutt_istr_startswith(s, "ESEARCH"))
+    cmd_parse_esearch(adata, s);
   else if (mutt_istr_startswith(s, "STATUS"))
     cmd_parse_status(adata, s);
   else if (mutt_istr_startswith(s, "ENABLED"))
@@ -41,11 +41,13 @@ bool          C_ImapDeflate;             ///< Config: (imap) Compress network tr
 #endif
 char *        C_ImapDelimChars;          ///< Config: (imap) Characters that denote separators in IMAP folders
 long          C_ImapFetchChunkSize;      ///< Config: (imap) Download headers in blocks of this size
+short         C_ImapFetchConnections;    ///< Config: (imap) Number of extra connections used to download headers
 char *        C_ImapHeaders;             ///< Config: (imap) Additional email headers to download when getting index
 bool          C_ImapIdle;                ///< Config: (imap) Use the IMAP IDLE extension to check for new mail
 short         C_ImapKeepalive;           ///< Config: (imap) Time to wait before polling an open IMAP connection
 bool          C_ImapListSubscribed;      ///< Config: (imap) When browsing a mailbox, only display subscribed folders
 char *        C_ImapLogin;               ///< Config: (imap) Login name for the IMAP server (defaults to #C_ImapUser)
+bool          C_ImapNotify;              ///< Config: (imap) Use the IMAP NOTIFY extension to check for new mail
 char *        C_ImapOauthRefreshCommand; ///< Config: (imap) External command to generate OAUTH refresh token
 char *        C_ImapPass;                ///< Config: (imap) Password for the IMAP server
 bool          C_ImapPassive;             ///< Config: (imap) Reuse an existing IMAP connection to check for new mail
@@ -55,6 +57,7 @@ short         C_ImapPollTimeout;         ///< Config: (imap) Maximum time to wai
 bool          C_ImapQresync;             ///< Config: (imap) Enable the QRESYNC extension
 bool          C_ImapRfc5161;             ///< Config: (imap) Use the IMAP ENABLE extension to select capabilities
 bool          C_ImapServernoise;         ///< Config: (imap) Display server warnings as error messages
+bool          C_ImapServerSort;          ///< Config: (imap) Let the server sort the mailbox
 char *        C_ImapUser;                ///< Config: (imap) Username for the IMAP server
 // clang-format on
 
@@ -80,6 +83,9 @@ struct ConfigDef ImapVars[] = {
   { "imap_fetch_chunk_size", DT_LONG|DT_NOT_NEGATIVE, &C_ImapFetchChunkSize, 0, 0, NULL,
     "(imap) Download headers in blocks of this size"
   },
+  { "imap_fetch_connections", DT_NUMBER|DT_NOT_NEGATIVE, &C_ImapFetchConnections, 0, 0, NULL,
+    "(imap) Number of extra connections used to download headers"
+  },
   { "imap_headers", DT_STRING|R_INDEX, &C_ImapHeaders, 0, 0, NULL,
     "(imap) Additional email headers to download when getting index"
   },
@@ -89,6 +95,9 @@ struct ConfigDef ImapVars[] = {
   { "imap_login", DT_STRING|DT_SENSITIVE, &C_ImapLogin, 0, 0, NULL,
     "(imap) Login name for the IMAP server (defaults to #C_ImapUser)"
   },
+  { "imap_notify", DT_BOOL, &C_ImapNotify, false, 0, NULL,
+    "(imap) Use the IMAP NOTIFY extension to check for new mail"
+  },
   { "imap_oauth_refresh_command", DT_STRING|DT_COMMAND|DT_SENSITIVE, &C_ImapOauthRefreshCommand, 0, 0, NULL,
     "(imap) External command to generate OAUTH refresh token"
   },
@@ -104,6 +113,9 @@ struct ConfigDef ImapVars[] = {
   { "imap_servernoise", DT_BOOL, &C_ImapServernoise, true, 0, NULL,
     "(imap) Display server warnings as error messages"
   },
+  { "imap_server_sort", DT_BOOL|R_RESORT, &C_ImapServerSort, false, 0, NULL,
+    "(imap) Let the server sort the mailbox"
+  },
   { "imap_keepalive", DT_NUMBER|DT_NOT_NEGATIVE, &C_ImapKeepalive, 300, 0, NULL,
     "(imap) Time to wait before polling an open IMAP connection"
   },
@@ -815,6 +815,7 @@ void imap_close_connection(struct ImapAccountData *adata)
   adata->nextcmd = 0;
   adata->lastcmd = 0;
   adata->status = 0;
+  adata->notify = false;
   memset(adata->cmds, 0, sizeof(struct ImapCommand) * adata->cmdslots);
 }
 
@@ -1161,14 +1162,130 @@ static int imap_status(struct ImapAccountData *adata, struct ImapMboxData *mdata
     mutt_debug(LL_DEBUG1, "Error queueing command\n");
     return rc;
   }
+  if (queue)
+    adata->status_queued = true;
   return mdata->messages;
 }
 
+/**
+ * imap_notify_set - Ask the server to report changes to the Account's Mailboxes
+ * @param adata Imap Account data
+ * @retval  0 NOTIFY is in effect
+ * @retval -1 NOTIFY isn't available, the Mailboxes must be polled
+ *
+ * The request covers the selected Mailbox and every Mailbox of the Account
+ * (RFC5465).  The selected Mailbox uses SELECTED-DELAYED, so expunges are
+ * only reported when a command allows them.  The message sequence numbers
+ * can't shift under a running command.
+ *
+ * The names are only gathered again after a Mailbox has been added or
+ * removed, see imap_account_observer(), or after a reconnect.  The request is
+ * repeated if they differ.  If the server refuses it, it isn't tried again on
+ * this connection.
+ */
+static int imap_notify_set(struct ImapAccountData *adata)
+{
+  if (!C_ImapNotify || !(adata->capabilities & IMAP_CAP_NOTIFY) ||
+      (adata->state < IMAP_AUTHENTICATED))
+  {
+    return -1;
+  }
+
+  if (adata->notify && !adata->notify_dirty)
+    return 0;
+
+  struct Buffer *names = mutt_buffer_pool_get();
+  struct MailboxNode *np = NULL;
+  STAILQ_FOREACH(np, &adata->account->mailboxes, entries)
+  {
+    struct ImapMboxData *mdata = imap_mdata_get(np->mailbox);
+    if (!mdata)
+      continue;
+    if (!mutt_buffer_is_empty(names))
+      mutt_buffer_addch(names, ' ');
+    mutt_buffer_addstr(names, mdata->munge_name);
+  }
+  adata->notify_dirty = false;
+
+  int rc = 0;
+  if (adata->notify && mutt_str_equal(mutt_b2s(names), adata->notify_names))
+    goto done;
+
+  struct Buffer *cmd = mutt_buffer_pool_get();
+  mutt_buffer_strcpy(cmd, "NOTIFY SET STATUS (SELECTED-DELAYED (MessageNew MessageExpunge FlagChange))");
+  if (!mutt_buffer_is_empty(names))
+  {
+    mutt_buffer_add_printf(cmd, " (MAILBOXES (%s) (MessageNew MessageExpunge FlagChange))",
+                           mutt_b2s(names));
+  }
+
+  adata->notify = false;
+  if (imap_exec(adata, mutt_b2s(cmd), IMAP_CMD_NO_FLAGS) == IMAP_EXEC_SUCCESS)
+  {
+    adata->notify = true;
+    mutt_str_replace(&adata->notify_names, mutt_b2s(names));
+  }
+  else
+  {
+    mutt_debug(LL_DEBUG1, "NOTIFY failed, polling with STATUS\n");
+    adata->capabilities &= ~IMAP_CAP_NOTIFY;
+    rc = -1;
+  }
+  mutt_buffer_pool_release(&cmd);
+
+done:
+  mutt_buffer_pool_release(&names);
+  return rc;
+}
+
+/**
+ * imap_notify_poll - Read the events the server has sent
+ * @param adata Imap Account data
+ * @retval  0 Success
+ * @retval -1 Error
+ *
+ * The events arrive as untagged STATUS, EXISTS, EXPUNGE and FETCH responses,
+ * which update the Mailboxes as they're read.
+ */
+static int imap_notify_poll(struct ImapAccountData *adata)
+{
+  int rc;
+  while ((rc = mutt_socket_poll(adata->conn, 0)) > 0)
+  {
+    const int res = imap_cmd_step(adata);
+    if ((res != IMAP_RES_OK) && (res != IMAP_RES_CONTINUE))
+    {
+      mutt_debug(LL_DEBUG1, "Error reading NOTIFY events\n");
+      return -1;
+    }
+  }
+
+  return (rc < 0) ? -1 : 0;
+}
+
 /**
  * imap_mbox_check_stats - Check the Mailbox statistics - Implements MxOps::mbox_check_stats()
+ *
+ * If the server supports NOTIFY, the counts are kept up to date by the
+ * server's events.  A STATUS command is only needed if an event didn't carry
+ * all the counts.
  */
 static int imap_mbox_check_stats(struct Mailbox *m, int flags)
 {
+  struct ImapAccountData *adata = imap_adata_get(m);
+  struct ImapMboxData *mdata = imap_mdata_get(m);
+  if (!adata || !mdata)
+    return -1;
+
+  if (imap_notify_set(adata) == 0)
+  {
+    if (imap_notify_poll(adata) < 0)
+      return -1;
+    if (!mdata->notify_stale)
+      return mdata->messages;
+    mdata->notify_stale = false;
+  }
+
   return imap_mailbox_status(m, true);
 }
 
@@ -1221,6 +1338,36 @@ int imap_mailbox_status(struct Mailbox *m, bool queue)
   return imap_status(adata, mdata, queue);
 }
 
+/**
+ * imap_mailbox_status_flush - Wait for the replies to queued STATUS commands
+ * @param m Mailbox
+ * @retval  0 Success, or nothing was queued
+ * @retval -1 Error
+ *
+ * imap_mbox_check_stats() only queues a STATUS command.  This sends all the
+ * commands queued for the Mailbox's Account, in one go, and reads the replies,
+ * so the counts are up to date before the caller uses them.
+ *
+ * The wait is limited by `$imap_poll_timeout`.
+ */
+int imap_mailbox_status_flush(struct Mailbox *m)
+{
+  struct ImapAccountData *adata = imap_adata_get(m);
+  if (!adata || !adata->status_queued)
+    return 0;
+
+  adata->status_queued = false;
+
+  /* The pipeline may have been drained already */
+  if (mutt_buffer_is_empty(&adata->cmdbuf))
+    return 0;
+
+  if (imap_exec(adata, NULL, IMAP_CMD_POLL) != IMAP_EXEC_SUCCESS)
+    return -1;
+
+  return 0;
+}
+
 /**
  * imap_subscribe - Subscribe to a mailbox
  * @param path      Mailbox path
@@ -1354,7 +1501,7 @@ int imap_complete(char *buf, size_t buflen, const char *path)
 }
 
 /**
- * imap_fast_trash - Use server COPY command to copy deleted messages to trash
+ * imap_fast_trash - Use server COPY or MOVE command to move deleted messages to trash
  * @param m    Mailbox
  * @param dest Mailbox to move to
  * @retval -1 Error
@@ -1369,12 +1516,18 @@ int imap_fast_trash(struct Mailbox *m, char *dest)
   enum QuadOption err_continue = MUTT_NO;
 
   struct ImapAccountData *adata = imap_adata_get(m);
+  struct ImapMboxData *mdata = imap_mdata_get(m);
   struct ImapAccountData *dest_adata = NULL;
   struct ImapMboxData *dest_mdata = NULL;
 
   if (imap_adata_find(dest, &dest_adata, &dest_mdata) < 0)
     return -1;
 
+  /* MOVE (RFC6851) copies and expunges in one go */
+  const bool other = !mutt_str_equal(dest_mdata->name, mdata->name);
+  const bool move = other && (adata->capabilities & IMAP_CAP_MOVE);
+  const ImapOpenFlags reopen = mdata->reopen;
+
   struct Buffer sync_cmd = mutt_buffer_make(0);
 
   /* check that the save-to folder is in the same account */
@@ -1400,10 +1553,20 @@ int imap_fast_trash(struct Mailbox *m, char *dest)
     }
   }
 
+  /* The EXPUNGEs of a MOVE are handled later, not while the caller is using
+   * the Emails */
+  if (move)
+    mdata->reopen &= ~IMAP_REOPEN_ALLOW;
+
+  /* UIDPLUS (RFC4315) tells us the UIDs of the copies */
+  if (other && (adata->capabilities & IMAP_CAP_UIDPLUS))
+    adata->copy_dest = dest_mdata;
+
   /* loop in case of TRYCREATE */
   do
   {
-    rc = imap_exec_msgset(m, "UID COPY", dest_mdata->munge_name, MUTT_TRASH, false, false);
+    rc = imap_exec_msgset(m, move ? "UID MOVE" : "UID COPY", dest_mdata->munge_name,
+                          MUTT_TRASH, false, false);
     if (rc == 0)
     {
       mutt_debug(LL_DEBUG1, "No messages to trash\n");
@@ -1456,7 +1619,14 @@ int imap_fast_trash(struct Mailbox *m, char *dest)
 
 out:
   mutt_buffer_dealloc(&sync_cmd);
+  adata->copy_dest = NULL;
   imap_mdata_free((void *) &dest_mdata);
+  if (move)
+  {
+    if (mdata->reopen & IMAP_EXPUNGE_PENDING)
+      mdata->reopen |= IMAP_EXPUNGE_EXPECTED;
+    mdata->reopen |= (reopen & IMAP_REOPEN_ALLOW);
+  }
 
   return ((rc == IMAP_EXEC_SUCCESS) ? 0 : -1);
 }
@@ -1593,7 +1763,7 @@ int imap_sync_mailbox(struct Mailbox *m, bool expunge, bool close)
     memcpy(m->emails, emails, m->msg_count * sizeof(struct Email *));
 
     C_Sort = SORT_ORDER;
-    qsort(m->emails, m->msg_count, sizeof(struct Email *), mutt_get_sort_func(SORT_ORDER));
+    qsort(m->emails, m->msg_count, sizeof(struct Email *), mutt_get_sort_func(SORT_ORDER, m));
   }
 
   rc = sync_helper(m, MUTT_ACL_DELETE, MUTT_DELETED, "\\Deleted");
@@ -1870,6 +2040,58 @@ int imap_login(struct ImapAccountData *adata)
   return 0;
 }
 
+/**
+ * imap_examine_open - Open an extra, read-only, connection to a Mailbox
+ * @param adata Imap Account data of the selected Mailbox
+ * @retval ptr  New Imap Account data, logged in and EXAMINEd
+ * @retval NULL Failure
+ *
+ * The connection is kept in the authenticated state, with no Mailbox, so
+ * that untagged responses can't touch the selected Mailbox.  It is never
+ * reconnected: a failure just closes it.
+ */
+struct ImapAccountData *imap_examine_open(struct ImapAccountData *adata)
+{
+  if (!adata || !adata->mailbox)
+    return NULL;
+
+  struct ImapMboxData *mdata = adata->mailbox->mdata;
+
+  struct ImapAccountData *xdata = imap_adata_new(adata->account);
+  xdata->conn = mutt_conn_new(&adata->conn->account);
+  if (!xdata->conn)
+    goto fail;
+
+  xdata->recovering = true;
+  if (imap_login(xdata) < 0)
+    goto fail;
+
+  char buf[PATH_MAX];
+  snprintf(buf, sizeof(buf), "EXAMINE %s", mdata->munge_name);
+  if (imap_exec(xdata, buf, IMAP_CMD_NO_FLAGS) != IMAP_EXEC_SUCCESS)
+    goto fail;
+
+  return xdata;
+
+fail:
+  imap_examine_close(&xdata);
+  return NULL;
+}
+
+/**
+ * imap_examine_close - Close a connection opened by imap_examine_open()
+ * @param ptr Imap Account data to free
+ */
+void imap_examine_close(struct ImapAccountData **ptr)
+{
+  if (!ptr || !*ptr)
+    return;
+
+  if ((*ptr)->status != IMAP_FATAL)
+    imap_logout(*ptr);
+  imap_adata_free((void **) ptr);
+}
+
 /**
  * imap_mbox_open - Open a mailbox - Implements MxOps::mbox_open()
  */
@@ -2072,6 +2294,18 @@ fail:
   return -1;
 }
 
+/**
+ * imap_mbox_load - Read the next batch of Emails - Implements MxOps::mbox_load()
+ */
+static int imap_mbox_load(struct Mailbox *m)
+{
+  struct ImapAccountData *adata = imap_adata_get(m);
+  if (!adata || (adata->mailbox != m) || (adata->state < IMAP_SELECTED))
+    return -1;
+
+  return imap_read_headers_batch(m);
+}
+
 /**
  * imap_mbox_open_append - Open a Mailbox for appending - Implements MxOps::mbox_open_append()
  */
@@ -2436,6 +2670,7 @@ struct MxOps MxImapOps = {
   .ac_find          = imap_ac_find,
   .ac_add           = imap_ac_add,
   .mbox_open        = imap_mbox_open,
+  .mbox_load        = imap_mbox_load,
   .mbox_open_append = imap_mbox_open_append,
   .mbox_check       = imap_mbox_check,
   .mbox_check_stats = imap_mbox_check_stats,
@@ -43,6 +43,7 @@
  * | imap/imap.c       | @subpage imap_imap       |
  * | imap/message.c    | @subpage imap_message    |
  * | imap/search.c     | @subpage imap_search     |
+ * | imap/sort.c       | @subpage imap_sort       |
  * | imap/utf7.c       | @subpage imap_utf7       |
  * | imap/util.c       | @subpage imap_util       |
  */
@@ -78,6 +79,7 @@ int imap_delete_mailbox(struct Mailbox *m, char *path);
 int imap_sync_mailbox(struct Mailbox *m, bool expunge, bool close);
 int imap_path_status(const char *path, bool queue);
 int imap_mailbox_status(struct Mailbox *m, bool queue);
+int imap_mailbox_status_flush(struct Mailbox *m);
 int imap_subscribe(char *path, bool subscribe);
 int imap_complete(char *buf, size_t buflen, const char *path);
 int imap_fast_trash(struct Mailbox *m, char *dest);
@@ -112,4 +114,9 @@ void imap_clean_path(char *path, size_t plen);
 /* search.c */
 bool imap_search(struct Mailbox *m, const struct PatternList *pat);
 
+/* sort.c */
+int imap_compare_rank(const void *a, const void *b);
+int imap_sort_fetch(struct Mailbox *m);
+bool imap_sort_ranked(struct Mailbox *m, int method);
+
 #endif /* MUTT_IMAP_LIB_H */
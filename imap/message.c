@@ -35,6 +35,8 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/select.h>
+#include <sys/time.h>
 #include <unistd.h>
 #include "private.h"
 #include "mutt/lib.h"
@@ -423,22 +425,21 @@ static int msg_parse_fetch(struct ImapHeader *h, char *s)
 
 /**
  * msg_fetch_header - import IMAP FETCH response into an ImapHeader
- * @param m   Mailbox
- * @param ih  ImapHeader
- * @param buf Server string containing FETCH response
- * @param fp  Connection to server
+ * @param adata Imap Account data of the connection that sent the response
+ * @param ih    ImapHeader
+ * @param buf   Server string containing FETCH response
+ * @param fp    File for the header literal
  * @retval  0 Success
  * @retval -1 String is not a fetch response
  * @retval -2 String is a corrupt fetch response
  *
  * Expects string beginning with * n FETCH.
  */
-static int msg_fetch_header(struct Mailbox *m, struct ImapHeader *ih, char *buf, FILE *fp)
+static int msg_fetch_header(struct ImapAccountData *adata, struct ImapHeader *ih,
+                            char *buf, FILE *fp)
 {
   int rc = -1; /* default now is that string isn't FETCH response */
 
-  struct ImapAccountData *adata = imap_adata_get(m);
-
   if (buf[0] != '*')
     return rc;
 
@@ -590,6 +591,7 @@ static void imap_alloc_uid_hash(struct ImapAccountData *adata, unsigned int msn_
  * @param[in]  evalhc        If true, check the Header Cache
  * @param[in]  msn_begin     First Message Sequence Number
  * @param[in]  msn_end       Last Message Sequence Number
+ * @param[in]  max_headers   Most headers to put in the set, 0 for $imap_fetch_chunk_size
  * @param[out] fetch_msn_end Highest Message Sequence Number fetched
  *
  * Generates a more complicated sequence set after using the header cache,
@@ -597,7 +599,8 @@ static void imap_alloc_uid_hash(struct ImapAccountData *adata, unsigned int msn_
  */
 static unsigned int imap_fetch_msn_seqset(struct Buffer *buf, struct ImapAccountData *adata,
                                           bool evalhc, unsigned int msn_begin,
-                                          unsigned int msn_end, unsigned int *fetch_msn_end)
+                                          unsigned int msn_end, unsigned int max_headers,
+                                          unsigned int *fetch_msn_end)
 {
   struct ImapMboxData *mdata = adata->mailbox->mdata;
   unsigned int max_headers_per_fetch = UINT_MAX;
@@ -612,7 +615,9 @@ static unsigned int imap_fetch_msn_seqset(struct Buffer *buf, struct ImapAccount
   if (msn_end < msn_begin)
     return 0;
 
-  if (C_ImapFetchChunkSize > 0)
+  if (max_headers > 0)
+    max_headers_per_fetch = max_headers;
+  else if (C_ImapFetchChunkSize > 0)
     max_headers_per_fetch = C_ImapFetchChunkSize;
 
   if (!evalhc)
@@ -749,13 +754,20 @@ static int read_headers_normal_eval_cache(struct ImapAccountData *adata,
 
   imap_cmd_start(adata, buf);
 
+  /* Read the whole cache in one pass, while the server replies */
+  struct HashTable *cache = imap_hcache_get_all(mdata, msn_end);
+
   int rc = IMAP_RES_CONTINUE;
+  int result = 0;
   int mfhrc = 0;
   struct ImapHeader h;
   for (int msgno = 1; rc == IMAP_RES_CONTINUE; msgno++)
   {
     if (SigInt && query_abort_header_download(adata))
-      return -1;
+    {
+      result = -1;
+      break;
+    }
 
     if (m->verbose)
       mutt_progress_update(&progress, msgno, -1);
@@ -768,7 +780,7 @@ static int read_headers_normal_eval_cache(struct ImapAccountData *adata,
       if (rc != IMAP_RES_CONTINUE)
         break;
 
-      mfhrc = msg_fetch_header(m, &h, adata->buf, NULL);
+      mfhrc = msg_fetch_header(adata, &h, adata->buf, NULL);
       if (mfhrc < 0)
         continue;
 
@@ -793,7 +805,8 @@ static int read_headers_normal_eval_cache(struct ImapAccountData *adata,
         continue;
       }
 
-      struct Email *e = imap_hcache_get(mdata, h.edata->uid);
+      struct Email *e = cache ? imap_hcache_take(cache, h.edata->uid) :
+                                imap_hcache_get(mdata, h.edata->uid);
       m->emails[idx] = e;
       if (e)
       {
@@ -849,10 +862,14 @@ static int read_headers_normal_eval_cache(struct ImapAccountData *adata,
     imap_edata_free((void **) &h.edata);
 
     if ((mfhrc < -1) || ((rc != IMAP_RES_CONTINUE) && (rc != IMAP_RES_OK)))
-      return -1;
+    {
+      result = -1;
+      break;
+    }
   }
 
-  return 0;
+  mutt_hash_free(&cache);
+  return result;
 }
 
 /**
@@ -1023,6 +1040,369 @@ static int read_headers_condstore_qresync_updates(struct ImapAccountData *adata,
 }
 #endif /* USE_HCACHE */
 
+/**
+ * read_headers_parse - Parse a downloaded header into a new Email
+ * @param fp File containing the header
+ * @param ih ImapHeader from the FETCH response
+ * @retval ptr New Email
+ */
+static struct Email *read_headers_parse(FILE *fp, struct ImapHeader *ih)
+{
+  struct Email *e = email_new();
+
+  e->received = ih->received;
+
+  rewind(fp);
+  /* NOTE: if Date: header is missing, mutt_rfc822_read_header depends
+   *   on h.received being set */
+  e->env = mutt_rfc822_read_header(fp, e, false, false);
+  /* content built as a side-effect of mutt_rfc822_read_header */
+  e->content->length = ih->content_length;
+
+  return e;
+}
+
+/**
+ * read_headers_add_email - Add a downloaded Email to the Mailbox
+ * @param[in]  m      Imap Selected Mailbox
+ * @param[in]  e      Email, from read_headers_parse()
+ * @param[in]  edata  Imap Email data, with the MSN, UID and flags
+ * @param[out] maxuid Highest UID seen
+ */
+static void read_headers_add_email(struct Mailbox *m, struct Email *e,
+                                   struct ImapEmailData *edata, unsigned int *maxuid)
+{
+  struct ImapMboxData *mdata = imap_mdata_get(m);
+  const int idx = m->msg_count;
+
+  m->emails[idx] = e;
+
+  mdata->max_msn = MAX(mdata->max_msn, edata->msn);
+  mdata->msn_index[edata->msn - 1] = e;
+  mutt_hash_int_insert(mdata->uid_hash, edata->uid, e);
+
+  e->index = idx;
+  /* messages which have not been expunged are ACTIVE (borrowed from mh
+   * folders) */
+  e->active = true;
+  e->changed = false;
+  e->read = edata->read;
+  e->old = edata->old;
+  e->deleted = edata->deleted;
+  e->flagged = edata->flagged;
+  e->replied = edata->replied;
+  e->edata = (void *) edata;
+  e->edata_free = imap_edata_free;
+  STAILQ_INIT(&e->tags);
+
+  /* We take a copy of the tags so we can split the string */
+  char *tags_copy = mutt_str_dup(edata->flags_remote);
+  driver_tags_replace(&e->tags, tags_copy);
+  FREE(&tags_copy);
+
+  if (*maxuid < edata->uid)
+    *maxuid = edata->uid;
+
+  mailbox_size_add(m, e);
+
+#ifdef USE_HCACHE
+  imap_hcache_put(mdata, e);
+#endif /* USE_HCACHE */
+
+  m->msg_count++;
+}
+
+/**
+ * struct HeaderFetcher - A connection taking part in a parallel download
+ */
+struct HeaderFetcher
+{
+  struct ImapAccountData *adata; ///< Connection, NULL once it has failed
+  FILE *fp;                      ///< Temporary file for the header literals
+  bool busy;                     ///< A FETCH is in progress
+};
+
+/**
+ * fetchers_wait - Wait for a response on any busy connection
+ * @param hf    Connections
+ * @param num   Number of connections
+ * @param start Connection to check first
+ * @retval >=0 Index of a connection with data waiting
+ * @retval -1  No connection is busy, or interrupted
+ *
+ * The connections are checked in turn, from start, so that a fast one
+ * can't starve the others.
+ */
+static int fetchers_wait(struct HeaderFetcher *hf, int num, int start)
+{
+  while (!SigInt)
+  {
+    fd_set rfds;
+    int max_fd = -1;
+
+    FD_ZERO(&rfds);
+    for (int j = 0; j < num; j++)
+    {
+      const int i = (start + j) % num;
+      if (!hf[i].busy)
+        continue;
+
+      /* TLS or compression may already hold some data */
+      if (mutt_socket_poll(hf[i].adata->conn, 0) != 0)
+        return i;
+
+      FD_SET(hf[i].adata->conn->fd, &rfds);
+      max_fd = MAX(max_fd, hf[i].adata->conn->fd);
+    }
+
+    if (max_fd < 0)
+      return -1;
+
+    struct timeval tv = { 1, 0 };
+    select(max_fd + 1, &rfds, NULL, NULL, &tv);
+  }
+
+  return -1;
+}
+
+/**
+ * read_headers_fetch_parallel - Download new headers over extra connections
+ * @param[in]  m         Imap Selected Mailbox
+ * @param[in]  hdrreq    Header fields to request
+ * @param[in]  msn_begin First Message Sequence number
+ * @param[in]  msn_end   Last Message Sequence number
+ * @param[out] maxuid    Highest UID seen
+ * @retval  0 Success, though some headers may still be missing
+ * @retval -1 Error, or the user aborted the download
+ *
+ * The missing headers are shared out, a chunk at a time, between up to
+ * $imap_fetch_connections read-only connections.  Meanwhile the selected
+ * connection fetches the UIDs and flags of the same messages.  It stays
+ * authoritative: a header is only used if its UID matches the one the
+ * selected connection has for that MSN.  Anything left over is fetched
+ * by the caller, in the usual way.
+ */
+static int read_headers_fetch_parallel(struct Mailbox *m, const char *hdrreq,
+                                       unsigned int msn_begin,
+                                       unsigned int msn_end, unsigned int *maxuid)
+{
+  struct ImapAccountData *adata = imap_adata_get(m);
+  struct ImapMboxData *mdata = imap_mdata_get(m);
+  struct Progress progress;
+  struct ImapHeader h;
+  int retval = 0;
+
+  unsigned int num_missing = 0;
+  for (unsigned int msn = msn_begin; msn <= msn_end; msn++)
+    if (!mdata->msn_index[msn - 1])
+      num_missing++;
+
+  /* Extra connections aren't worth it for a few headers */
+  const int num_extra = MIN((unsigned int) C_ImapFetchConnections, num_missing / 256);
+  if (num_extra < 1)
+    return 0;
+
+  /* hf[0] is the selected connection, which fetches the flags */
+  struct HeaderFetcher *hf = mutt_mem_calloc(num_extra + 1, sizeof(*hf));
+  hf[0].adata = adata;
+  int num = 1;
+  for (int i = 0; i < num_extra; i++)
+  {
+    struct ImapAccountData *xdata = imap_examine_open(adata);
+    if (!xdata)
+      break;
+    hf[num].fp = mutt_file_mkstemp();
+    if (!hf[num].fp)
+    {
+      imap_examine_close(&xdata);
+      break;
+    }
+    hf[num].adata = xdata;
+    num++;
+  }
+  mutt_debug(LL_DEBUG2, "fetching %u headers over %d extra connections\n",
+             num_missing, num - 1);
+  if (num == 1)
+  {
+    FREE(&hf);
+    return 0;
+  }
+
+  /* Several chunks per connection keep them all busy until the end */
+  unsigned int chunk = C_ImapFetchChunkSize;
+  if (chunk == 0)
+    chunk = (num_missing + (4 * (num - 1)) - 1) / (4 * (num - 1));
+
+  struct ImapEmailData **flags = mutt_mem_calloc(msn_end - msn_begin + 1, sizeof(*flags));
+  struct HashTable *fetched = mutt_hash_int_new(num_missing, MUTT_HASH_NO_FLAGS);
+  struct Buffer *buf = mutt_buffer_pool_get();
+  unsigned int flags_msn = msn_begin;
+  unsigned int hdr_msn = msn_begin;
+  unsigned int fetch_msn_end = 0;
+  unsigned int num_fetched = 0;
+  int ready = 0;
+
+  if (m->verbose)
+  {
+    mutt_progress_init(&progress, _("Fetching message headers..."),
+                       MUTT_PROGRESS_READ, num_missing);
+  }
+
+  while (true)
+  {
+    if (!hf[0].busy && imap_fetch_msn_seqset(buf, adata, true, flags_msn, msn_end,
+                                             UINT_MAX, &fetch_msn_end))
+    {
+      char *cmd = NULL;
+      mutt_str_asprintf(&cmd, "FETCH %s (UID FLAGS)", mutt_b2s(buf));
+      int rc = imap_cmd_start(adata, cmd);
+      FREE(&cmd);
+      if (rc < 0)
+      {
+        retval = -1;
+        break;
+      }
+      hf[0].busy = true;
+      flags_msn = fetch_msn_end + 1;
+    }
+
+    for (int i = 1; i < num; i++)
+    {
+      if (!hf[i].adata || hf[i].busy ||
+          !imap_fetch_msn_seqset(buf, adata, true, hdr_msn, msn_end, chunk, &fetch_msn_end))
+      {
+        continue;
+      }
+
+      char *cmd = NULL;
+      mutt_str_asprintf(&cmd, "FETCH %s (UID INTERNALDATE RFC822.SIZE %s)",
+                        mutt_b2s(buf), hdrreq);
+      int rc = imap_cmd_start(hf[i].adata, cmd);
+      FREE(&cmd);
+      /* A failed chunk is left for the caller */
+      hdr_msn = fetch_msn_end + 1;
+      if (rc < 0)
+      {
+        imap_examine_close(&hf[i].adata);
+        continue;
+      }
+      hf[i].busy = true;
+    }
+
+    ready = fetchers_wait(hf, num, ready + 1);
+    if (ready < 0)
+    {
+      if (!SigInt)
+        break;
+      if (query_abort_header_download(adata))
+      {
+        retval = -1;
+        break;
+      }
+      ready = 0;
+      continue;
+    }
+
+    struct HeaderFetcher *f = &hf[ready];
+    memset(&h, 0, sizeof(h));
+    h.edata = imap_edata_new();
+    if (f->fp)
+      rewind(f->fp);
+
+    int mfhrc = 0;
+    int rc = imap_cmd_step(f->adata);
+    if (rc == IMAP_RES_CONTINUE)
+      mfhrc = msg_fetch_header(f->adata, &h, f->adata->buf, f->fp);
+
+    if ((rc == IMAP_RES_CONTINUE) && (mfhrc == 0))
+    {
+      if (ready == 0)
+      {
+        if ((h.edata->uid != 0) && (h.edata->msn >= msn_begin) && (h.edata->msn <= msn_end))
+        {
+          imap_edata_free((void **) &flags[h.edata->msn - msn_begin]);
+          flags[h.edata->msn - msn_begin] = h.edata;
+          h.edata = NULL;
+        }
+      }
+      else if ((ftello(f->fp) != 0) && !mutt_hash_int_find(fetched, h.edata->uid))
+      {
+        /* make sure we don't get remnants from older larger message headers */
+        fputs("\n\n", f->fp);
+        mutt_hash_int_insert(fetched, h.edata->uid, read_headers_parse(f->fp, &h));
+        num_fetched++;
+        if (m->verbose)
+          mutt_progress_update(&progress, num_fetched, -1);
+      }
+    }
+    imap_edata_free((void **) &h.edata);
+
+    if ((rc == IMAP_RES_OK) || (rc == IMAP_RES_NO))
+    {
+      f->busy = false;
+    }
+    else if ((rc != IMAP_RES_CONTINUE) || (mfhrc < -1))
+    {
+      if (ready == 0)
+      {
+        retval = -1;
+        break;
+      }
+      mutt_debug(LL_DEBUG1, "closing extra connection after an error\n");
+      f->busy = false;
+      imap_examine_close(&f->adata);
+    }
+  }
+
+  for (int i = 1; i < num; i++)
+  {
+    imap_examine_close(&hf[i].adata);
+    mutt_file_fclose(&hf[i].fp);
+  }
+  FREE(&hf);
+
+  if (retval == 0)
+  {
+#ifdef USE_HCACHE
+    const bool hc_batch = (mdata->hcache && (mutt_hcache_begin(mdata->hcache) == 0));
+#endif
+    for (unsigned int msn = msn_begin; msn <= msn_end; msn++)
+    {
+      struct ImapEmailData *edata = flags[msn - msn_begin];
+      if (!edata || mdata->msn_index[msn - 1])
+        continue;
+
+      struct Email *e = mutt_hash_int_find(fetched, edata->uid);
+      if (!e)
+        continue;
+
+      mutt_hash_int_delete(fetched, edata->uid, e);
+      flags[msn - msn_begin] = NULL;
+      read_headers_add_email(m, e, edata, maxuid);
+    }
+#ifdef USE_HCACHE
+    if (hc_batch)
+      mutt_hcache_commit(mdata->hcache);
+#endif
+  }
+
+  struct HashWalkState state = { 0 };
+  struct HashElem *he = NULL;
+  while ((he = mutt_hash_walk(fetched, &state)))
+  {
+    struct Email *e = he->data;
+    email_free(&e);
+  }
+  mutt_hash_free(&fetched);
+
+  for (unsigned int msn = msn_begin; msn <= msn_end; msn++)
+    imap_edata_free((void **) &flags[msn - msn_begin]);
+  FREE(&flags);
+  mutt_buffer_pool_release(&buf);
+
+  return retval;
+}
+
 /**
  * read_headers_fetch_new - Retrieve new messages from the server
  * @param[in]  m                Imap Selected Mailbox
@@ -1046,6 +1426,9 @@ static int read_headers_fetch_new(struct Mailbox *m, unsigned int msn_begin,
   FILE *fp = NULL;
   struct ImapHeader h;
   struct Buffer *buf = NULL;
+#ifdef USE_HCACHE
+  bool hc_batch = false;
+#endif
   static const char *const want_headers =
       "DATE FROM SENDER SUBJECT TO CC MESSAGE-ID REFERENCES CONTENT-TYPE "
       "CONTENT-DESCRIPTION IN-REPLY-TO REPLY-TO LINES LIST-POST X-LABEL "
@@ -1053,7 +1436,6 @@ static int read_headers_fetch_new(struct Mailbox *m, unsigned int msn_begin,
 
   struct ImapAccountData *adata = imap_adata_get(m);
   struct ImapMboxData *mdata = imap_mdata_get(m);
-  int idx = m->msg_count;
 
   if (!adata || (adata->mailbox != m))
     return -1;
@@ -1102,6 +1484,14 @@ static int read_headers_fetch_new(struct Mailbox *m, unsigned int msn_begin,
   unlink(mutt_b2s(tempfile));
   mutt_buffer_pool_release(&tempfile);
 
+  if (initial_download && (C_ImapFetchConnections > 0))
+  {
+    if (read_headers_fetch_parallel(m, hdrreq, msn_begin, msn_end, maxuid) < 0)
+      goto bail;
+    /* Only fetch the headers the extra connections didn't */
+    evalhc = true;
+  }
+
   if (m->verbose)
   {
     mutt_progress_init(&progress, _("Fetching message headers..."),
@@ -1121,7 +1511,7 @@ static int read_headers_fetch_new(struct Mailbox *m, unsigned int msn_begin,
    *   cautious I'm keeping it.
    */
   while ((fetch_msn_end < msn_end) &&
-         imap_fetch_msn_seqset(buf, adata, evalhc, msn_begin, msn_end, &fetch_msn_end))
+         imap_fetch_msn_seqset(buf, adata, evalhc, msn_begin, msn_end, 0, &fetch_msn_end))
   {
     char *cmd = NULL;
     mutt_str_asprintf(&cmd, "FETCH %s (UID FLAGS INTERNALDATE RFC822.SIZE %s)",
@@ -1129,6 +1519,11 @@ static int read_headers_fetch_new(struct Mailbox *m, unsigned int msn_begin,
     imap_cmd_start(adata, cmd);
     FREE(&cmd);
 
+#ifdef USE_HCACHE
+    /* Save the headers of each chunk in one batch */
+    hc_batch = (mdata->hcache && (mutt_hcache_begin(mdata->hcache) == 0));
+#endif
+
     rc = IMAP_RES_CONTINUE;
     for (int msgno = msn_begin; rc == IMAP_RES_CONTINUE; msgno++)
     {
@@ -1151,7 +1546,7 @@ static int read_headers_fetch_new(struct Mailbox *m, unsigned int msn_begin,
         if (rc != IMAP_RES_CONTINUE)
           break;
 
-        mfhrc = msg_fetch_header(m, &h, adata->buf, fp);
+        mfhrc = msg_fetch_header(adata, &h, adata->buf, fp);
         if (mfhrc < 0)
           continue;
 
@@ -1179,52 +1574,9 @@ static int read_headers_fetch_new(struct Mailbox *m, unsigned int msn_begin,
           continue;
         }
 
-        struct Email *e = email_new();
-        m->emails[idx] = e;
-
-        mdata->max_msn = MAX(mdata->max_msn, h.edata->msn);
-        mdata->msn_index[h.edata->msn - 1] = e;
-        mutt_hash_int_insert(mdata->uid_hash, h.edata->uid, e);
-
-        e->index = idx;
-        /* messages which have not been expunged are ACTIVE (borrowed from mh
-         * folders) */
-        e->active = true;
-        e->changed = false;
-        e->read = h.edata->read;
-        e->old = h.edata->old;
-        e->deleted = h.edata->deleted;
-        e->flagged = h.edata->flagged;
-        e->replied = h.edata->replied;
-        e->received = h.received;
-        e->edata = (void *) (h.edata);
-        e->edata_free = imap_edata_free;
-        STAILQ_INIT(&e->tags);
-
-        /* We take a copy of the tags so we can split the string */
-        char *tags_copy = mutt_str_dup(h.edata->flags_remote);
-        driver_tags_replace(&e->tags, tags_copy);
-        FREE(&tags_copy);
-
-        if (*maxuid < h.edata->uid)
-          *maxuid = h.edata->uid;
-
-        rewind(fp);
-        /* NOTE: if Date: header is missing, mutt_rfc822_read_header depends
-         *   on h.received being set */
-        e->env = mutt_rfc822_read_header(fp, e, false, false);
-        /* content built as a side-effect of mutt_rfc822_read_header */
-        e->content->length = h.content_length;
-        mailbox_size_add(m, e);
-
-#ifdef USE_HCACHE
-        imap_hcache_put(mdata, e);
-#endif /* USE_HCACHE */
-
-        m->msg_count++;
-
+        struct Email *e = read_headers_parse(fp, &h);
+        read_headers_add_email(m, e, h.edata, maxuid);
         h.edata = NULL;
-        idx++;
       } while (mfhrc == -1);
 
       imap_edata_free((void **) &h.edata);
@@ -1233,6 +1585,12 @@ static int read_headers_fetch_new(struct Mailbox *m, unsigned int msn_begin,
         goto bail;
     }
 
+#ifdef USE_HCACHE
+    if (hc_batch)
+      mutt_hcache_commit(mdata->hcache);
+    hc_batch = false;
+#endif
+
     /* In case we get new mail while fetching the headers. */
     if (mdata->reopen & IMAP_NEWMAIL_PENDING)
     {
@@ -1259,6 +1617,11 @@ static int read_headers_fetch_new(struct Mailbox *m, unsigned int msn_begin,
   retval = 0;
 
 bail:
+#ifdef USE_HCACHE
+  /* Keep the headers we've already downloaded */
+  if (hc_batch)
+    mutt_hcache_commit(mdata->hcache);
+#endif
   mutt_buffer_pool_release(&hdr_list);
   mutt_buffer_pool_release(&buf);
   mutt_buffer_pool_release(&tempfile);
@@ -1268,6 +1631,55 @@ bail:
   return retval;
 }
 
+#ifdef USE_HCACHE
+/**
+ * read_headers_store_modseq - Save the CONDSTORE/QRESYNC state to the header cache
+ * @param adata Imap Account data
+ * @param mdata Imap Mailbox data
+ *
+ * This may only be done once every header has been downloaded.
+ */
+static void read_headers_store_modseq(struct ImapAccountData *adata,
+                                      struct ImapMboxData *mdata)
+{
+  const bool has_qresync = mdata->modseq && adata->qresync;
+  const bool has_condstore = mdata->modseq && (adata->capabilities & IMAP_CAP_CONDSTORE) &&
+                             C_ImapCondstore;
+
+  if (has_condstore || has_qresync)
+  {
+    mutt_hcache_store_raw(mdata->hcache, "/MODSEQ", 7, &mdata->modseq,
+                          sizeof(mdata->modseq));
+  }
+  else
+    mutt_hcache_delete_record(mdata->hcache, "/MODSEQ", 7);
+
+  if (has_qresync)
+    imap_hcache_store_uid_seqset(mdata);
+  else
+    imap_hcache_clear_uid_seqset(mdata);
+}
+#endif /* USE_HCACHE */
+
+/**
+ * read_headers_batch_end - Find the end of a batch of missing headers
+ * @param mdata     Imap Mailbox data
+ * @param msn_begin First Message Sequence Number
+ * @param msn_end   Last Message Sequence Number
+ * @param num       Number of missing headers in the batch
+ * @retval num Last MSN of the batch
+ */
+static unsigned int read_headers_batch_end(struct ImapMboxData *mdata, unsigned int msn_begin,
+                                           unsigned int msn_end, int num)
+{
+  for (; msn_begin < msn_end; msn_begin++)
+  {
+    if (!mdata->msn_index[msn_begin - 1] && (--num <= 0))
+      break;
+  }
+  return msn_begin;
+}
+
 /**
  * imap_read_headers - Read headers from the server
  * @param m                Imap Selected Mailbox
@@ -1400,9 +1812,27 @@ int imap_read_headers(struct Mailbox *m, unsigned int msn_begin,
   }
 #endif /* USE_HCACHE */
 
-  if (read_headers_fetch_new(m, msn_begin, msn_end, evalhc, &maxuid, initial_download) < 0)
+  /* When the Mailbox is opened progressively, only the first batch is
+   * downloaded now.  The missing headers are treated like holes in the
+   * header cache and filled by imap_read_headers_batch(). */
+  unsigned int fetch_end = msn_end;
+  if (initial_download && (m->load_batch > 0))
+    fetch_end = read_headers_batch_end(mdata, msn_begin, msn_end, m->load_batch);
+
+  if (read_headers_fetch_new(m, msn_begin, fetch_end, evalhc, &maxuid, initial_download) < 0)
     goto bail;
 
+  if (fetch_end < msn_end)
+  {
+    mdata->max_msn = MAX(mdata->max_msn, msn_end);
+    m->loading = true;
+  }
+
+  /* The server's order is only an optimisation, so carry on without it.
+   * New mail isn't ranked, so it's sorted locally until the next resort. */
+  if (initial_download)
+    imap_sort_fetch(m);
+
   if (maxuid && (mdata->uid_next < maxuid + 1))
     mdata->uid_next = maxuid + 1;
 
@@ -1424,21 +1854,8 @@ int imap_read_headers(struct Mailbox *m, unsigned int msn_begin,
    * To do it more often, we'll need to deal with flag updates combined with
    * unsync'ed local flag changes.  We'll also need to properly sync flags to
    * the header cache on close.  I'm not sure it's worth the added complexity.  */
-  if (initial_download)
-  {
-    if (has_condstore || has_qresync)
-    {
-      mutt_hcache_store_raw(mdata->hcache, "/MODSEQ", 7, &mdata->modseq,
-                            sizeof(mdata->modseq));
-    }
-    else
-      mutt_hcache_delete_record(mdata->hcache, "/MODSEQ", 7);
-
-    if (has_qresync)
-      imap_hcache_store_uid_seqset(mdata);
-    else
-      imap_hcache_clear_uid_seqset(mdata);
-  }
+  if (initial_download && !m->loading)
+    read_headers_store_modseq(adata, mdata);
 #endif /* USE_HCACHE */
 
   if (m->msg_count > oldmsgcount)
@@ -1461,6 +1878,283 @@ bail:
   return retval;
 }
 
+/**
+ * imap_read_headers_batch - Read the next batch of headers
+ * @param m Imap Selected Mailbox
+ * @retval num Number of Emails read
+ * @retval -1  Failure
+ *
+ * Fill the next few holes left by a progressive imap_read_headers().
+ * Mailbox.loading is cleared when none are left.
+ */
+int imap_read_headers_batch(struct Mailbox *m)
+{
+  unsigned int maxuid = 0;
+  int retval = -1;
+
+  struct ImapAccountData *adata = imap_adata_get(m);
+  struct ImapMboxData *mdata = imap_mdata_get(m);
+  if (!adata || (adata->mailbox != m))
+    return -1;
+
+  const int oldmsgcount = m->msg_count;
+
+  /* Expunges may have moved the holes, so look for the first one */
+  unsigned int msn_begin = 1;
+  while ((msn_begin <= mdata->max_msn) && mdata->msn_index[msn_begin - 1])
+    msn_begin++;
+
+#ifdef USE_HCACHE
+  imap_hcache_open(adata, mdata);
+#endif
+
+  if (msn_begin <= mdata->max_msn)
+  {
+    const unsigned int msn_end =
+        read_headers_batch_end(mdata, msn_begin, mdata->max_msn, m->load_batch);
+
+    while (msn_end > m->email_max)
+      mx_alloc_memory(m);
+
+    mdata->reopen &= ~IMAP_REOPEN_ALLOW;
+    int rc = read_headers_fetch_new(m, msn_begin, msn_end, true, &maxuid, false);
+    mdata->reopen |= IMAP_REOPEN_ALLOW;
+    if (rc < 0)
+      goto bail;
+
+    if (maxuid && (mdata->uid_next < maxuid + 1))
+      mdata->uid_next = maxuid + 1;
+
+    imap_sort_apply(m, oldmsgcount);
+  }
+
+  /* A server that doesn't return some headers leaves holes for good */
+  if ((msn_begin > mdata->max_msn) || (m->msg_count == oldmsgcount))
+  {
+    m->loading = false;
+#ifdef USE_HCACHE
+    if (mdata->uid_next > 1)
+    {
+      mutt_hcache_store_raw(mdata->hcache, "/UIDNEXT", 8, &mdata->uid_next,
+                            sizeof(mdata->uid_next));
+    }
+    read_headers_store_modseq(adata, mdata);
+#endif
+  }
+
+  retval = m->msg_count - oldmsgcount;
+
+bail:
+#ifdef USE_HCACHE
+  imap_hcache_close(mdata);
+#endif
+  return retval;
+}
+
+/**
+ * seed_open - Prepare to add messages to another Mailbox's caches
+ * @param adata       Imap Account data
+ * @param dest        Imap Mailbox data of the destination
+ * @param uidvalidity UIDVALIDITY of the destination, from UIDPLUS
+ * @retval ptr  Body cache of the destination
+ * @retval NULL The body cache can't be used
+ *
+ * The header cache is only used if it belongs to the same UIDVALIDITY.
+ */
+static struct BodyCache *seed_open(struct ImapAccountData *adata,
+                                   struct ImapMboxData *dest, uint32_t uidvalidity)
+{
+  dest->uidvalidity = uidvalidity;
+
+#ifdef USE_HCACHE
+  imap_hcache_open(adata, dest);
+  if (dest->hcache)
+  {
+    size_t dlen = 0;
+    void *uv = mutt_hcache_fetch_raw(dest->hcache, "/UIDVALIDITY", 12, &dlen);
+    if (!uv)
+    {
+      mutt_hcache_store_raw(dest->hcache, "/UIDVALIDITY", 12, &uidvalidity,
+                            sizeof(uidvalidity));
+    }
+    else
+    {
+      const bool stale = (*(uint32_t *) uv != uidvalidity);
+      mutt_hcache_free_raw(dest->hcache, &uv);
+      if (stale)
+        imap_hcache_close(dest);
+    }
+  }
+#endif
+
+  struct Buffer *mailbox = mutt_buffer_pool_get();
+  imap_cachepath(adata->delim, dest->name, mailbox);
+  struct BodyCache *bc = mutt_bcache_open(&adata->conn->account, mutt_b2s(mailbox));
+  mutt_buffer_pool_release(&mailbox);
+
+  return bc;
+}
+
+/**
+ * seed_email - Add a message to another Mailbox's caches
+ * @param dest Imap Mailbox data of the destination
+ * @param bc   Body cache of the destination
+ * @param e    Email
+ * @param uid  UID of the message in the destination
+ * @param fp   Whole message, may be NULL
+ */
+static void seed_email(struct ImapMboxData *dest, struct BodyCache *bc,
+                       struct Email *e, unsigned int uid, FILE *fp)
+{
+#ifdef USE_HCACHE
+  if (dest->hcache)
+  {
+    struct ImapEmailData *edata = imap_edata_get(e);
+    const unsigned int src_uid = edata->uid;
+    edata->uid = uid;
+    imap_hcache_put(dest, e);
+    edata->uid = src_uid;
+  }
+#endif
+
+  if (!bc || !fp)
+    return;
+
+  char id[64];
+  snprintf(id, sizeof(id), "%u-%u", dest->uidvalidity, uid);
+  FILE *fp_out = mutt_bcache_put(bc, id);
+  if (!fp_out)
+    return;
+
+  const int rc = mutt_file_copy_stream(fp, fp_out);
+  if ((mutt_file_fclose(&fp_out) == 0) && (rc >= 0))
+    mutt_bcache_commit(bc, id);
+}
+
+/**
+ * seed_close - Finish adding messages to another Mailbox's caches
+ * @param dest   Imap Mailbox data of the destination
+ * @param bc     Body cache of the destination
+ * @param maxuid Highest UID added
+ *
+ * The cached UIDNEXT is raised, so the next open of the destination checks
+ * the new UIDs against the header cache, rather than downloading them.
+ */
+static void seed_close(struct ImapMboxData *dest, struct BodyCache **bc, unsigned int maxuid)
+{
+#ifdef USE_HCACHE
+  if (dest->hcache && maxuid)
+  {
+    size_t dlen = 0;
+    unsigned int uid_next = 0;
+    void *puid_next = mutt_hcache_fetch_raw(dest->hcache, "/UIDNEXT", 8, &dlen);
+    if (puid_next)
+    {
+      uid_next = *(unsigned int *) puid_next;
+      mutt_hcache_free_raw(dest->hcache, &puid_next);
+    }
+    if (uid_next < maxuid + 1)
+    {
+      uid_next = maxuid + 1;
+      mutt_hcache_store_raw(dest->hcache, "/UIDNEXT", 8, &uid_next, sizeof(uid_next));
+    }
+  }
+  imap_hcache_close(dest);
+#endif
+  mutt_bcache_close(bc);
+}
+
+/**
+ * imap_copy_seed - Add copied messages to the destination's caches
+ * @param adata       Imap Account data
+ * @param uidvalidity UIDVALIDITY of the destination
+ * @param src_set     UIDs of the messages in the selected Mailbox
+ * @param dst_set     UIDs of the copies, in the same order
+ *
+ * The server has told us the UIDs of the copies (RFC4315 COPYUID).  The
+ * destination is `adata->copy_dest`, set by the caller of COPY or MOVE.
+ * The headers and any cached bodies are stored under the new UIDs, so opening
+ * the destination won't download them again.
+ */
+void imap_copy_seed(struct ImapAccountData *adata, uint32_t uidvalidity,
+                    const char *src_set, const char *dst_set)
+{
+  struct ImapMboxData *dest = adata->copy_dest;
+  struct Mailbox *m = adata->mailbox;
+  struct ImapMboxData *mdata = imap_mdata_get(m);
+  if (!dest || !mdata || !mdata->uid_hash)
+    return;
+
+  struct SeqsetIterator *src_iter = mutt_seqset_iterator_new(src_set);
+  struct SeqsetIterator *dst_iter = mutt_seqset_iterator_new(dst_set);
+  struct BodyCache *bc = seed_open(adata, dest, uidvalidity);
+  mdata->bcache = msg_cache_open(m);
+
+  unsigned int src_uid = 0;
+  unsigned int dst_uid = 0;
+  unsigned int maxuid = 0;
+  unsigned int count = 0;
+  while (src_iter && dst_iter && (mutt_seqset_iterator_next(src_iter, &src_uid) == 0) &&
+         (mutt_seqset_iterator_next(dst_iter, &dst_uid) == 0))
+  {
+    struct Email *e = mutt_hash_int_find(mdata->uid_hash, src_uid);
+    if (!e)
+      continue;
+
+    char id[64];
+    snprintf(id, sizeof(id), "%u-%u", mdata->uidvalidity, src_uid);
+    FILE *fp = mutt_bcache_get(mdata->bcache, id);
+    seed_email(dest, bc, e, dst_uid, fp);
+    mutt_file_fclose(&fp);
+
+    maxuid = MAX(maxuid, dst_uid);
+    count++;
+  }
+
+  mutt_debug(LL_DEBUG2, "cached %u copies in %s\n", count, dest->name);
+  seed_close(dest, &bc, maxuid);
+  mutt_seqset_iterator_free(&src_iter);
+  mutt_seqset_iterator_free(&dst_iter);
+}
+
+/**
+ * append_seed - Add an appended message to the destination's caches
+ * @param m           Destination Mailbox
+ * @param msg         Message that was appended
+ * @param uidvalidity UIDVALIDITY of the destination
+ * @param uid         UID of the new message (RFC4315 APPENDUID)
+ */
+static void append_seed(struct Mailbox *m, struct Message *msg,
+                        uint32_t uidvalidity, unsigned int uid)
+{
+  struct ImapAccountData *adata = imap_adata_get(m);
+  struct ImapMboxData *mdata = imap_mdata_get(m);
+
+  FILE *fp = fopen(msg->path, "r");
+  if (!fp)
+    return;
+
+  struct Email *e = email_new();
+  e->received = msg->received;
+  e->env = mutt_rfc822_read_header(fp, e, false, false);
+  fseek(fp, 0, SEEK_END);
+  e->content->length = ftell(fp) - e->content->offset;
+  e->read = msg->flags.read;
+  e->replied = msg->flags.replied;
+  e->flagged = msg->flags.flagged;
+  e->edata = imap_edata_new();
+  e->edata_free = imap_edata_free;
+  imap_edata_get(e)->uid = uid;
+
+  struct BodyCache *bc = seed_open(adata, mdata, uidvalidity);
+  rewind(fp);
+  seed_email(mdata, bc, e, uid, fp);
+  seed_close(mdata, &bc, uid);
+
+  email_free(&e);
+  mutt_file_fclose(&fp);
+}
+
 /**
  * imap_append_message - Write an email back to the server
  * @param m   Mailbox
@@ -1571,6 +2265,15 @@ int imap_append_message(struct Mailbox *m, struct Message *msg)
   if (rc != IMAP_RES_OK)
     goto cmd_step_fail;
 
+  /* UIDPLUS tells us the new message's UID */
+  uint32_t uidvalidity = 0;
+  unsigned int uid = 0;
+  if ((adata->capabilities & IMAP_CAP_UIDPLUS) && (adata->mailbox != m) &&
+      (sscanf(imap_get_qualifier(adata->buf), "[APPENDUID %u %u]", &uidvalidity, &uid) == 2))
+  {
+    append_seed(m, msg, uidvalidity, uid);
+  }
+
   return 0;
 
 cmd_step_fail:
@@ -1615,6 +2318,9 @@ int imap_copy_messages(struct Mailbox *m, struct EmailList *el, const char *dest
   struct EmailNode *en = STAILQ_FIRST(el);
   bool single = !STAILQ_NEXT(en, entries);
   struct ImapAccountData *adata = imap_adata_get(m);
+  struct ImapMboxData *mdata = imap_mdata_get(m);
+  struct ImapMboxData *dest_mdata = NULL;
+  const ImapOpenFlags reopen = mdata->reopen;
 
   if (single && en->email->attach_del)
   {
@@ -1640,6 +2346,23 @@ int imap_copy_messages(struct Mailbox *m, struct EmailList *el, const char *dest
     mutt_str_copy(mbox, "INBOX", sizeof(mbox));
   imap_munge_mbox_name(adata->unicode, mmbox, sizeof(mmbox), mbox);
 
+  /* MOVE (RFC6851) copies and expunges in one go */
+  const bool other = !mutt_str_equal(mbox, mdata->name);
+  const bool move = other && delete_original && (adata->capabilities & IMAP_CAP_MOVE);
+  const char *copy_cmd = move ? "UID MOVE" : "UID COPY";
+  if (move)
+  {
+    /* The EXPUNGEs are handled later, not while the caller is using the Emails */
+    mdata->reopen &= ~IMAP_REOPEN_ALLOW;
+  }
+
+  /* UIDPLUS (RFC4315) tells us the UIDs of the copies */
+  if (other && (adata->capabilities & IMAP_CAP_UIDPLUS))
+  {
+    dest_mdata = imap_mdata_new(adata, mbox);
+    adata->copy_dest = dest_mdata;
+  }
+
   /* loop in case of TRYCREATE */
   do
   {
@@ -1657,7 +2380,8 @@ int imap_copy_messages(struct Mailbox *m, struct EmailList *el, const char *dest
         {
           mutt_debug(LL_DEBUG3,
                      "#2 Message contains attachments to be deleted\n");
-          return 1;
+          rc = 1;
+          goto out;
         }
 
         if (en->email->active && en->email->changed)
@@ -1671,7 +2395,7 @@ int imap_copy_messages(struct Mailbox *m, struct EmailList *el, const char *dest
         }
       }
 
-      rc = imap_exec_msgset(m, "UID COPY", mmbox, MUTT_TAG, false, false);
+      rc = imap_exec_msgset(m, copy_cmd, mmbox, MUTT_TAG, false, false);
       if (rc == 0)
       {
         mutt_debug(LL_DEBUG1, "No messages tagged\n");
@@ -1692,7 +2416,7 @@ int imap_copy_messages(struct Mailbox *m, struct EmailList *el, const char *dest
     else
     {
       mutt_message(_("Copying message %d to %s..."), en->email->index + 1, mbox);
-      mutt_buffer_add_printf(&cmd, "UID COPY %u %s", imap_edata_get(en->email)->uid, mmbox);
+      mutt_buffer_add_printf(&cmd, "%s %u %s", copy_cmd, imap_edata_get(en->email)->uid, mmbox);
 
       if (en->email->active && en->email->changed)
       {
@@ -1759,6 +2483,14 @@ int imap_copy_messages(struct Mailbox *m, struct EmailList *el, const char *dest
 out:
   FREE(&cmd.data);
   FREE(&sync_cmd.data);
+  adata->copy_dest = NULL;
+  imap_mdata_free((void *) &dest_mdata);
+  if (move)
+  {
+    if (mdata->reopen & IMAP_EXPUNGE_PENDING)
+      mdata->reopen |= IMAP_EXPUNGE_EXPECTED;
+    mdata->reopen |= (reopen & IMAP_REOPEN_ALLOW);
+  }
 
   return (rc < 0) ? -1 : rc;
 }
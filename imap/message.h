@@ -43,6 +43,7 @@ struct ImapEmailData
 
   unsigned int uid; ///< 32-bit Message UID
   unsigned int msn; ///< Message Sequence Number
+  unsigned int sort_rank; ///< Position in the server's sort order, 0 if unknown
 
   char *flags_system;
   char *flags_remote;
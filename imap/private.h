@@ -138,8 +138,16 @@ typedef uint32_t ImapCapFlags;              ///< Flags, e.g. #IMAP_CAP_IMAP4
 #define IMAP_CAP_LIST_EXTENDED    (1 << 16) ///< RFC5258: IMAP4 LIST Command Extensions
 #define IMAP_CAP_COMPRESS         (1 << 17) ///< RFC4978: COMPRESS=DEFLATE
 #define IMAP_CAP_X_GM_EXT_1       (1 << 18) ///< https://developers.google.com/gmail/imap/imap-extensions
+#define IMAP_CAP_SORT             (1 << 19) ///< RFC5256: SORT
+#define IMAP_CAP_SORT_DISPLAY     (1 << 20) ///< RFC5957: SORT=DISPLAY
+#define IMAP_CAP_THREAD_REFERENCES (1 << 21) ///< RFC5256: THREAD=REFERENCES
+#define IMAP_CAP_ESORT            (1 << 22) ///< RFC5267: ESORT
+#define IMAP_CAP_NOTIFY           (1 << 23) ///< RFC5465: NOTIFY
+#define IMAP_CAP_LIST_STATUS      (1 << 24) ///< RFC5819: LIST-STATUS
+#define IMAP_CAP_MOVE             (1 << 25) ///< RFC6851: MOVE
+#define IMAP_CAP_UIDPLUS          (1 << 26) ///< RFC4315: UIDPLUS
 
-#define IMAP_CAP_ALL             ((1 << 19) - 1)
+#define IMAP_CAP_ALL             ((1 << 27) - 1)
 
 /**
  * struct ImapList - Items in an IMAP browser
@@ -150,6 +158,12 @@ struct ImapList
   char delim;
   bool noselect;
   bool noinferiors;
+
+  // LIST-STATUS (RFC5819) counts, see browse_add_list_result()
+  bool want_status;      ///< Store the STATUS responses here too
+  bool has_status;       ///< This is a STATUS response, not a LIST
+  unsigned int messages; ///< Number of messages
+  unsigned int unseen;   ///< Number of unseen messages
 };
 
 /**
@@ -201,6 +215,11 @@ struct ImapAccountData
   int nextcmd;
   int lastcmd;
   struct Buffer cmdbuf;
+  bool status_queued; ///< STATUS commands are waiting, see imap_mailbox_status_flush()
+  bool notify;        ///< NOTIFY SET is in effect, see imap_notify_set()
+  bool notify_dirty;  ///< Mailboxes have been added or removed since NOTIFY SET
+  char *notify_names; ///< Mailboxes covered by NOTIFY SET
+  struct ImapMboxData *copy_dest; ///< Destination of a COPY or MOVE, see imap_copy_seed()
 
   char delim;
   struct Mailbox *mailbox;      ///< Current selected mailbox
@@ -231,6 +250,7 @@ struct ImapMboxData
   unsigned int messages;
   unsigned int recent;
   unsigned int unseen;
+  bool notify_stale; ///< A NOTIFY event needs a STATUS, see imap_notify_poll()
 
   // Cached data used only when the mailbox is opened
   struct HashTable *uid_hash;
@@ -239,6 +259,12 @@ struct ImapMboxData
   unsigned int max_msn;        ///< the largest MSN fetched so far
   struct BodyCache *bcache;
 
+  // Server-side sort order, see imap_sort_fetch()
+  struct HashTable *sort_rank;    ///< Position of each UID in the server's order
+  struct HashTable *sort_pending; ///< Positions still being received
+  unsigned int sort_count;        ///< Number of positions received
+  short sort_method;              ///< Sort method of sort_rank, e.g. #SORT_DATE
+
   struct HeaderCache *hcache;
 };
 
@@ -265,9 +291,11 @@ extern bool          C_ImapDeflate;
 #endif
 extern char *        C_ImapDelimChars;
 extern long          C_ImapFetchChunkSize;
+extern short         C_ImapFetchConnections;
 extern char *        C_ImapHeaders;
 extern bool          C_ImapIdle;
 extern char *        C_ImapLogin;
+extern bool          C_ImapNotify;
 extern char *        C_ImapOauthRefreshCommand;
 extern char *        C_ImapPass;
 extern short         C_ImapPipelineDepth;
@@ -275,6 +303,7 @@ extern short         C_ImapPollTimeout;
 extern bool          C_ImapQresync;
 extern bool          C_ImapRfc5161;
 extern bool          C_ImapServernoise;
+extern bool          C_ImapServerSort;
 extern char *        C_ImapUser;
 
 /* -- private IMAP functions -- */
@@ -288,6 +317,8 @@ void imap_close_connection(struct ImapAccountData *adata);
 int imap_read_literal(FILE *fp, struct ImapAccountData *adata, unsigned long bytes, struct Progress *pbar);
 void imap_expunge_mailbox(struct Mailbox *m);
 int imap_login(struct ImapAccountData *adata);
+struct ImapAccountData *imap_examine_open(struct ImapAccountData *adata);
+void imap_examine_close(struct ImapAccountData **ptr);
 int imap_sync_message_for_copy(struct Mailbox *m, struct Email *e, struct Buffer *cmd, enum QuadOption *err_continue);
 bool imap_has_flag(struct ListHead *flag_list, const char *flag);
 int imap_adata_find(const char *path, struct ImapAccountData **adata, struct ImapMboxData **mdata);
@@ -308,10 +339,12 @@ int imap_cmd_idle(struct ImapAccountData *adata);
 void imap_edata_free(void **ptr);
 struct ImapEmailData *imap_edata_get(struct Email *e);
 int imap_read_headers(struct Mailbox *m, unsigned int msn_begin, unsigned int msn_end, bool initial_download);
+int imap_read_headers_batch(struct Mailbox *m);
 char *imap_set_flags(struct Mailbox *m, struct Email *e, char *s, bool *server_changes);
 int imap_cache_del(struct Mailbox *m, struct Email *e);
 int imap_cache_clean(struct Mailbox *m);
 int imap_append_message(struct Mailbox *m, struct Message *msg);
+void imap_copy_seed(struct ImapAccountData *adata, uint32_t uidvalidity, const char *src_set, const char *dst_set);
 
 int imap_msg_open(struct Mailbox *m, struct Message *msg, int msgno);
 int imap_msg_close(struct Mailbox *m, struct Message *msg);
@@ -325,6 +358,8 @@ struct ImapMboxData *imap_mdata_get(struct Mailbox *m);
 void imap_hcache_open(struct ImapAccountData *adata, struct ImapMboxData *mdata);
 void imap_hcache_close(struct ImapMboxData *mdata);
 struct Email *imap_hcache_get(struct ImapMboxData *mdata, unsigned int uid);
+struct HashTable *imap_hcache_get_all(struct ImapMboxData *mdata, size_t num);
+struct Email *imap_hcache_take(struct HashTable *cache, unsigned int uid);
 int imap_hcache_put(struct ImapMboxData *mdata, struct Email *e);
 int imap_hcache_del(struct ImapMboxData *mdata, unsigned int uid);
 int imap_hcache_store_uid_seqset(struct ImapMboxData *mdata);
@@ -365,4 +400,9 @@ void imap_disallow_reopen(struct Mailbox *m);
 /* search.c */
 void cmd_parse_search(struct ImapAccountData *adata, const char *s);
 
+/* sort.c */
+void cmd_parse_esearch(struct ImapAccountData *adata, const char *s);
+void cmd_parse_sort(struct ImapAccountData *adata, const char *s);
+void imap_sort_apply(struct Mailbox *m, int first);
+
 #endif /* MUTT_IMAP_PRIVATE_H */
@@ -0,0 +1,276 @@
+/**
+ * @file
+ * IMAP server-side sorting
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @page imap_sort IMAP server-side sorting
+ *
+ * Ask the server for the order of a Mailbox (RFC5256 SORT, RFC5267 ESORT).
+ *
+ * The server's answer is a list of UIDs.  The position of each UID is kept,
+ * so that Emails can be sorted by it, even those whose headers haven't been
+ * downloaded yet.  Threading is still done by NeoMutt, but the threads are
+ * sorted by the server's order for $sort_aux.
+ */
+
+#include "config.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "private.h"
+#include "mutt/lib.h"
+#include "config/lib.h"
+#include "email/lib.h"
+#include "core/lib.h"
+#include "lib.h"
+#include "message.h"
+#include "options.h"
+#include "sort.h"
+
+/**
+ * sort_criterion - Get the IMAP sort criterion for a sort method
+ * @param adata  Imap Account data
+ * @param method Sort method, e.g. #SORT_DATE
+ * @retval ptr  Sort criterion, e.g. "DATE"
+ * @retval NULL The server can't sort this way
+ *
+ * NeoMutt sorts From and To by display name, which needs RFC5957.
+ */
+static const char *sort_criterion(const struct ImapAccountData *adata, int method)
+{
+  switch (method)
+  {
+    case SORT_DATE:
+      return "DATE";
+    case SORT_RECEIVED:
+      return "ARRIVAL";
+    case SORT_SIZE:
+      return "SIZE";
+    case SORT_SUBJECT:
+      return "SUBJECT";
+    case SORT_FROM:
+      return (adata->capabilities & IMAP_CAP_SORT_DISPLAY) ? "DISPLAYFROM" : NULL;
+    case SORT_TO:
+      return (adata->capabilities & IMAP_CAP_SORT_DISPLAY) ? "DISPLAYTO" : NULL;
+    default:
+      return NULL;
+  }
+}
+
+/**
+ * sort_add_uid - Record the next UID of the server's order
+ * @param mdata Imap Mailbox data
+ * @param uid   UID
+ */
+static void sort_add_uid(struct ImapMboxData *mdata, unsigned int uid)
+{
+  if (mutt_hash_int_find(mdata->sort_pending, uid))
+    return;
+
+  mdata->sort_count++;
+  mutt_hash_int_insert(mdata->sort_pending, uid, (void *) (uintptr_t) mdata->sort_count);
+}
+
+/**
+ * cmd_parse_sort - Store a SORT response
+ * @param adata Imap Account data
+ * @param s     Command string with sorted UIDs
+ */
+void cmd_parse_sort(struct ImapAccountData *adata, const char *s)
+{
+  unsigned int uid;
+  struct ImapMboxData *mdata = adata->mailbox->mdata;
+
+  mutt_debug(LL_DEBUG2, "Handling SORT\n");
+
+  if (!mdata->sort_pending)
+    return;
+
+  while ((s = imap_next_word((char *) s)) && (*s != '\0'))
+  {
+    if (mutt_str_atoui(s, &uid) < 0)
+      continue;
+    sort_add_uid(mdata, uid);
+  }
+}
+
+/**
+ * cmd_parse_esearch - Store an ESEARCH response to UID SORT RETURN (ALL)
+ * @param adata Imap Account data
+ * @param s     Command string, e.g. `ESEARCH (TAG "a1") UID ALL 5,3:4`
+ */
+void cmd_parse_esearch(struct ImapAccountData *adata, const char *s)
+{
+  unsigned int uid;
+  struct ImapMboxData *mdata = adata->mailbox->mdata;
+
+  mutt_debug(LL_DEBUG2, "Handling ESEARCH\n");
+
+  if (!mdata->sort_pending)
+    return;
+
+  s = imap_next_word((char *) s);
+  if (*s == '(')
+  {
+    s = strchr(s, ')');
+    if (!s)
+      return;
+    s = imap_next_word((char *) s);
+  }
+
+  while (*s != '\0')
+  {
+    if (mutt_istr_startswith(s, "UID") && ((s[3] == '\0') || IS_SPACE(s[3])))
+    {
+      s = imap_next_word((char *) s);
+      continue;
+    }
+
+    const bool all = mutt_istr_startswith(s, "ALL") && IS_SPACE(s[3]);
+    s = imap_next_word((char *) s);
+    if (all)
+    {
+      struct Buffer *buf = mutt_buffer_pool_get();
+      while ((*s != '\0') && !IS_SPACE(*s))
+        mutt_buffer_addch(buf, *s++);
+
+      struct SeqsetIterator *iter = mutt_seqset_iterator_new(mutt_b2s(buf));
+      while (iter && (mutt_seqset_iterator_next(iter, &uid) == 0))
+        sort_add_uid(mdata, uid);
+      mutt_seqset_iterator_free(&iter);
+      mutt_buffer_pool_release(&buf);
+    }
+    s = imap_next_word((char *) s);
+  }
+}
+
+/**
+ * imap_sort_apply - Give Emails their position in the server's order
+ * @param m     Imap Selected Mailbox
+ * @param first Index of the first Email to update
+ */
+void imap_sort_apply(struct Mailbox *m, int first)
+{
+  struct ImapMboxData *mdata = imap_mdata_get(m);
+  if (!mdata || !mdata->sort_rank)
+    return;
+
+  for (int i = first; i < m->msg_count; i++)
+  {
+    struct Email *e = m->emails[i];
+    if (!e)
+      break;
+    struct ImapEmailData *edata = imap_edata_get(e);
+    edata->sort_rank = (uintptr_t) mutt_hash_int_find(mdata->sort_rank, edata->uid);
+  }
+}
+
+/**
+ * imap_sort_fetch - Ask the server for the order of a Mailbox
+ * @param m Imap Selected Mailbox
+ * @retval  0 Success, or the server can't sort this way
+ * @retval -1 Error
+ *
+ * The order is requested for $sort, or for $sort_aux when threading.
+ * Every UID in the Mailbox is ranked, whether it has been downloaded or not.
+ * This is done when the Mailbox is opened and when the user resorts it.
+ */
+int imap_sort_fetch(struct Mailbox *m)
+{
+  struct ImapAccountData *adata = imap_adata_get(m);
+  struct ImapMboxData *mdata = imap_mdata_get(m);
+  if (!adata || !mdata)
+    return -1;
+
+  mutt_hash_free(&mdata->sort_rank);
+
+  if (!C_ImapServerSort || !(adata->capabilities & IMAP_CAP_SORT))
+    return 0;
+
+  short method = C_Sort & SORT_MASK;
+  if (method == SORT_THREADS)
+    method = C_SortAux & SORT_MASK;
+
+  const char *criterion = sort_criterion(adata, method);
+  if (!criterion)
+    return 0;
+
+  char buf[128];
+  snprintf(buf, sizeof(buf), "UID SORT %s(%s) UTF-8 ALL",
+           (adata->capabilities & IMAP_CAP_ESORT) ? "RETURN (ALL) " : "", criterion);
+
+  mdata->sort_pending = mutt_hash_int_new(MAX(mdata->max_msn, 30), MUTT_HASH_NO_FLAGS);
+  mdata->sort_count = 0;
+
+  const int rc = imap_exec(adata, buf, IMAP_CMD_NO_FLAGS);
+  if (rc != IMAP_EXEC_SUCCESS)
+  {
+    mutt_hash_free(&mdata->sort_pending);
+    return -1;
+  }
+
+  mutt_debug(LL_DEBUG2, "server sorted %u messages by %s\n", mdata->sort_count, criterion);
+  mdata->sort_rank = mdata->sort_pending;
+  mdata->sort_pending = NULL;
+  mdata->sort_method = method;
+  imap_sort_apply(m, 0);
+
+  return 0;
+}
+
+/**
+ * imap_sort_ranked - Can a Mailbox be sorted in the server's order?
+ * @param m      Mailbox
+ * @param method Sort method, e.g. #SORT_DATE
+ * @retval true Every Email has a position in the server's order for method
+ */
+bool imap_sort_ranked(struct Mailbox *m, int method)
+{
+  struct ImapMboxData *mdata = imap_mdata_get(m);
+  if (!C_ImapServerSort || !mdata || !mdata->sort_rank || (mdata->sort_method != method))
+    return false;
+
+  for (int i = 0; i < m->msg_count; i++)
+  {
+    struct Email *e = m->emails[i];
+    if (!e)
+      break;
+    if (imap_edata_get(e)->sort_rank == 0)
+      return false;
+  }
+
+  return true;
+}
+
+/**
+ * imap_compare_rank - Sort in the server's order - Implements ::sort_t
+ */
+int imap_compare_rank(const void *a, const void *b)
+{
+  struct Email const *const *ea = (struct Email const *const *) a;
+  struct Email const *const *eb = (struct Email const *const *) b;
+  const struct ImapEmailData *da = (*ea)->edata;
+  const struct ImapEmailData *db = (*eb)->edata;
+
+  /* no need to auxsort because the server's order is strict */
+  return SORT_CODE((int) da->sort_rank - (int) db->sort_rank);
+}
@@ -59,6 +59,28 @@
 #include "hcache/lib.h"
 #endif
 
+/**
+ * imap_account_observer - Watch for Mailboxes joining or leaving the Account - Implements ::observer_t
+ *
+ * The list of Mailboxes covered by NOTIFY is rebuilt on the next check, see
+ * imap_notify_set().
+ */
+static int imap_account_observer(struct NotifyCallback *nc)
+{
+  if (!nc->global_data)
+    return -1;
+  if (nc->event_type != NT_MAILBOX)
+    return 0;
+
+  if ((nc->event_subtype == NT_MAILBOX_ADD) || (nc->event_subtype == NT_MAILBOX_REMOVE))
+  {
+    struct ImapAccountData *adata = nc->global_data;
+    adata->notify_dirty = true;
+  }
+
+  return 0;
+}
+
 /**
  * imap_adata_free - Free the private Account data - Implements Account::adata_free()
  */
@@ -69,7 +91,11 @@ void imap_adata_free(void **ptr)
 
   struct ImapAccountData *adata = *ptr;
 
+  if (adata->account)
+    notify_observer_remove(adata->account->notify, imap_account_observer, adata);
+
   FREE(&adata->capstr);
+  FREE(&adata->notify_names);
   mutt_buffer_dealloc(&adata->cmdbuf);
   FREE(&adata->buf);
   FREE(&adata->cmds);
@@ -102,6 +128,9 @@ struct ImapAccountData *imap_adata_new(struct Account *a)
   if (++new_seqid > 'z')
     new_seqid = 'a';
 
+  if (a)
+    notify_observer_add(a->notify, imap_account_observer, adata);
+
   return adata;
 }
 
@@ -218,6 +247,8 @@ void imap_mdata_cache_reset(struct ImapMboxData *mdata)
   mdata->msn_index_size = 0;
   mdata->max_msn = 0;
   mutt_bcache_close(&mdata->bcache);
+  mutt_hash_free(&mdata->sort_rank);
+  mutt_hash_free(&mdata->sort_pending);
 }
 
 /**
@@ -506,6 +537,91 @@ struct Email *imap_hcache_get(struct ImapMboxData *mdata, unsigned int uid)
   return hce.email;
 }
 
+/**
+ * imap_hcache_entry_free - Free a cached entry - Implements ::hash_hdata_free_t
+ */
+static void imap_hcache_entry_free(int type, void *obj, intptr_t data)
+{
+  struct HCacheEntry *hce = obj;
+  mutt_hcache_entry_free(hce);
+  FREE(&hce);
+}
+
+/**
+ * imap_hcache_scan - Keep a message from the header cache - Implements ::hcache_scan_t
+ */
+static bool imap_hcache_scan(const char *key, size_t keylen,
+                             struct HCacheEntry *hce, void *data)
+{
+  struct HashTable *cache = data;
+
+  /* Skip the records that aren't messages, e.g. "/UIDVALIDITY" */
+  unsigned int uid = 0;
+  if ((key[0] != '/') || (mutt_str_atoui(key + 1, &uid) != 0) || (uid == 0))
+  {
+    mutt_hcache_entry_free(hce);
+    return true;
+  }
+
+  struct HCacheEntry *copy = mutt_mem_malloc(sizeof(struct HCacheEntry));
+  *copy = *hce;
+  if (!mutt_hash_int_insert(cache, uid, copy))
+    imap_hcache_entry_free(0, copy, 0);
+
+  return true;
+}
+
+/**
+ * imap_hcache_get_all - Read all the messages from the header cache
+ * @param mdata Imap Mailbox data
+ * @param num   Expected number of messages
+ * @retval ptr  Hash Table of HCacheEntry, keyed by UID
+ * @retval NULL The header cache can't be read in one pass
+ *
+ * Only the scalar fields of each Email are decoded here.  The Envelope and
+ * Body are decoded by imap_hcache_take(), so messages that are no longer on
+ * the server are never decoded in full.
+ */
+struct HashTable *imap_hcache_get_all(struct ImapMboxData *mdata, size_t num)
+{
+  if (!mdata->hcache)
+    return NULL;
+
+  struct HashTable *cache = mutt_hash_int_new(MAX(num, 1024), MUTT_HASH_NO_FLAGS);
+  mutt_hash_set_destructor(cache, imap_hcache_entry_free, 0);
+
+  if (mutt_hcache_fetch_all(mdata->hcache, "/", 1, mdata->uidvalidity, true,
+                            imap_hcache_scan, cache) < 0)
+  {
+    mutt_hash_free(&cache);
+  }
+
+  return cache;
+}
+
+/**
+ * imap_hcache_take - Take a message from the Hash Table of cached messages
+ * @param cache Hash Table from imap_hcache_get_all()
+ * @param uid   UID to find
+ * @retval ptr  Email
+ * @retval NULL The message isn't cached
+ */
+struct Email *imap_hcache_take(struct HashTable *cache, unsigned int uid)
+{
+  struct HCacheEntry *hce = mutt_hash_int_find(cache, uid);
+  if (!hce)
+    return NULL;
+
+  struct Email *e = NULL;
+  if (mutt_hcache_entry_restore(hce))
+  {
+    e = hce->email;
+    hce->email = NULL;
+  }
+  mutt_hash_int_delete(cache, uid, hce);
+  return e;
+}
+
 /**
  * imap_hcache_put - Add an entry to the header cache
  * @param mdata Imap Mailbox data
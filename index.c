@@ -687,6 +687,117 @@ void mutt_update_index(struct Menu *menu, struct Context *ctx, int check,
   update_index(menu, ctx, check, oldcount, &se);
 }
 
+/**
+ * index_load_more - Read the next batch of a progressively opened Mailbox
+ * @param menu Current Menu
+ * @param ctx  Mailbox
+ * @param cur  Remember our place in the index
+ * @retval >=0 Number of Emails read
+ * @retval  -1 Error
+ */
+static int index_load_more(struct Menu *menu, struct Context *ctx, struct CurrentEmail *cur)
+{
+  struct Mailbox *m = ctx->mailbox;
+  const int oldcount = m->msg_count;
+
+  set_current_email(cur, mutt_get_virt_email(m, menu->current));
+
+  /* The batches are read, threaded and sorted quietly */
+  const bool verbose = m->verbose;
+  m->verbose = false;
+
+  const int rc = mx_mbox_load(m);
+  if (rc < 0)
+    mutt_error(_("Reading from %s interrupted..."), mailbox_path(m));
+
+  if (m->msg_count > oldcount)
+  {
+    ctx_update_added(ctx, oldcount);
+    update_index(menu, ctx, MUTT_NEW_MAIL, oldcount, cur);
+    menu->max = m->vcount;
+    menu->redraw |= REDRAW_INDEX | REDRAW_STATUS;
+    OptSearchInvalid = true;
+  }
+
+  m->verbose = verbose;
+  return rc;
+}
+
+/**
+ * index_load_all - Finish reading a progressively opened Mailbox
+ * @param menu Current Menu
+ * @param ctx  Mailbox
+ * @param cur  Remember our place in the index
+ *
+ * Searching, limiting and syncing act on every Email, so they wait for the
+ * rest of the Mailbox first.  The user can interrupt the wait with Ctrl-C.
+ */
+static void index_load_all(struct Menu *menu, struct Context *ctx, struct CurrentEmail *cur)
+{
+  if (!ctx || !ctx->mailbox || !ctx->mailbox->loading)
+    return;
+
+  struct Mailbox *m = ctx->mailbox;
+  mutt_message(_("Reading %s..."), mailbox_path(m));
+
+  SigInt = 0;
+  int rc = 0;
+  while (m->loading && (rc >= 0))
+  {
+    rc = index_load_more(menu, ctx, cur);
+    if (SigInt)
+    {
+      mutt_error(_("Reading from %s interrupted..."), mailbox_path(m));
+      SigInt = 0;
+      return;
+    }
+  }
+
+  if (rc >= 0)
+    mutt_clear_error();
+}
+
+/**
+ * index_close_needs_all - Does closing a Mailbox act on every Email?
+ * @param m Mailbox
+ * @retval true The Mailbox must be read completely first, see index_load_all()
+ *
+ * The Emails that haven't been read yet, haven't been changed, so closing
+ * only needs them to mark new mail as old, or to move read mail.
+ */
+static bool index_close_needs_all(struct Mailbox *m)
+{
+  if (!m || !m->loading)
+    return false;
+
+  return (C_MarkOld && !m->peekonly) || (C_Move != MUTT_NO);
+}
+
+/**
+ * index_needs_all - Does a function act on every Email in the Mailbox?
+ * @param op Function, e.g. OP_MAIN_LIMIT
+ * @retval true The Mailbox must be read completely first, see index_load_all()
+ */
+static bool index_needs_all(int op)
+{
+  switch (op)
+  {
+    case OP_MAIN_DELETE_PATTERN:
+    case OP_MAIN_LIMIT:
+    case OP_MAIN_SYNC_FOLDER:
+    case OP_MAIN_TAG_PATTERN:
+    case OP_MAIN_UNDELETE_PATTERN:
+    case OP_MAIN_UNTAG_PATTERN:
+    case OP_SEARCH:
+    case OP_SEARCH_NEXT:
+    case OP_SEARCH_OPPOSITE:
+    case OP_SEARCH_REVERSE:
+      return true;
+    default:
+      return false;
+  }
+}
+
 /**
  * mailbox_index_observer - Listen for Mailbox changes - Implements ::observer_t
  *
@@ -727,6 +838,12 @@ static void change_folder_mailbox(struct Menu *menu, struct Mailbox *m, int *old
 
   if (Context && Context->mailbox)
   {
+    if (index_close_needs_all(Context->mailbox))
+    {
+      struct CurrentEmail cur_all = *cur;
+      index_load_all(menu, Context, &cur_all);
+    }
+
     char *new_last_folder = NULL;
 #ifdef USE_INOTIFY
     int monitor_remove_rc = mutt_monitor_remove(NULL);
@@ -783,7 +900,7 @@ static void change_folder_mailbox(struct Menu *menu, struct Mailbox *m, int *old
     return;
 
   const int flags = read_only ? MUTT_READONLY : MUTT_OPEN_NO_FLAGS;
-  Context = mx_mbox_open(m, flags);
+  Context = mx_mbox_open(m, flags | MUTT_PROGRESSIVE);
   if (Context)
   {
     menu->current = ci_first_message(Context);
@@ -1412,6 +1529,13 @@ int mutt_index_menu(struct MuttWindow *dlg)
         continue;
       }
 
+      /* Read the rest of a progressively opened Mailbox between keystrokes */
+      if (Context && Context->mailbox && Context->mailbox->loading && !mutt_getch_pending())
+      {
+        index_load_more(menu, Context, &cur);
+        continue;
+      }
+
       op = km_dokey(MENU_MAIN);
 
       /* either user abort or timeout */
@@ -1478,6 +1602,9 @@ int mutt_index_menu(struct MuttWindow *dlg)
       nm_db_debug_check(Context->mailbox);
 #endif
 
+    if (index_needs_all(op))
+      index_load_all(menu, Context, &cur);
+
     switch (op)
     {
         /* ----------------------------------------------------------------------
@@ -1896,6 +2023,8 @@ int mutt_index_menu(struct MuttWindow *dlg)
         {
           int check;
 
+          if (Context && index_close_needs_all(Context->mailbox))
+            index_load_all(menu, Context, &cur);
           oldcount = (Context && Context->mailbox) ? Context->mailbox->msg_count : 0;
 
           mutt_startup_shutdown_hook(MUTT_SHUTDOWN_HOOK);
@@ -1944,6 +2073,12 @@ int mutt_index_menu(struct MuttWindow *dlg)
         if (mutt_select_sort((op == OP_SORT_REVERSE)) != 0)
           break;
 
+#ifdef USE_IMAP
+        /* Ask the server for the new order, see $imap_server_sort */
+        if (Context && Context->mailbox && (Context->mailbox->type == MUTT_IMAP))
+          imap_sort_fetch(Context->mailbox);
+#endif
+
         if (Context && Context->mailbox && (Context->mailbox->msg_count != 0))
         {
           resort_index(Context, menu);
@@ -2048,6 +2183,8 @@ int mutt_index_menu(struct MuttWindow *dlg)
       case OP_MAIN_IMAP_LOGOUT_ALL:
         if (Context && Context->mailbox && (Context->mailbox->type == MUTT_IMAP))
         {
+          if (index_close_needs_all(Context->mailbox))
+            index_load_all(menu, Context, &cur);
           int check = mx_mbox_close(&Context);
           if (check != 0)
           {
@@ -35,6 +35,7 @@
 // clang-format off
 bool  C_CheckNew;        ///< Config: (maildir,mh) Check for new mail while the mailbox is open
 bool  C_MaildirCheckCur; ///< Config: Check both 'new' and 'cur' directories for new mail
+short C_MaildirParseThreads; ///< Config: (maildir,mh) Number of threads used to read new messages
 bool  C_MaildirTrash;    ///< Config: Use the maildir 'trashed' flag, rather than deleting
 bool  C_MhPurge;         ///< Config: Really delete files in MH mailboxes
 char *C_MhSeqFlagged;    ///< Config: MH sequence for flagged message
@@ -50,6 +51,9 @@ struct ConfigDef MaildirVars[] = {
   { "maildir_check_cur", DT_BOOL, &C_MaildirCheckCur, false, 0, NULL,
     "Check both 'new' and 'cur' directories for new mail"
   },
+  { "maildir_parse_threads", DT_NUMBER|DT_NOT_NEGATIVE, &C_MaildirParseThreads, 0, 0, NULL,
+    "(maildir,mh) Number of threads used to read new messages"
+  },
   { "maildir_trash", DT_BOOL, &C_MaildirTrash, false, 0, NULL,
     "Use the maildir 'trashed' flag, rather than deleting"
   },
@@ -50,6 +50,20 @@ extern bool C_MaildirTrash;
 extern struct MxOps MxMaildirOps;
 extern struct MxOps MxMhOps;
 
+/**
+ * enum MaildirEvent - Changes to a Maildir reported by the file monitor
+ */
+enum MaildirEvent
+{
+  MAILDIR_EV_WATCH,    ///< The monitor is watching new/ and cur/
+  MAILDIR_EV_UNWATCH,  ///< The monitor has stopped watching
+  MAILDIR_EV_START,    ///< The Mailbox is open, queue its events
+  MAILDIR_EV_STOP,     ///< Stop queueing events
+  MAILDIR_EV_ADD,      ///< A file was added to a subdirectory
+  MAILDIR_EV_REMOVE,   ///< A file was removed from a subdirectory
+  MAILDIR_EV_OVERFLOW, ///< Some events were lost
+};
+
 int           maildir_check_empty      (const char *path);
 void          maildir_gen_flags        (char *dest, size_t destlen, struct Email *e);
 int           maildir_msg_open_new     (struct Mailbox *m, struct Message *msg, struct Email *e);
@@ -58,6 +72,7 @@ void          maildir_parse_flags      (struct Email *e, const char *path);
 struct Email *maildir_parse_message    (enum MailboxType type, const char *fname, bool is_old, struct Email *e);
 struct Email *maildir_parse_stream     (enum MailboxType type, FILE *fp, const char *fname, bool is_old, struct Email *e);
 bool          maildir_update_flags     (struct Mailbox *m, struct Email *e_old, struct Email *e_new);
+void          maildir_monitor_event    (struct Mailbox *m, enum MaildirEvent ev, const char *subdir, const char *name);
 int           mh_check_empty           (const char *path);
 int           mh_sync_mailbox_message  (struct Mailbox *m, int msgno, struct HeaderCache *hc);
 
@@ -59,17 +59,20 @@
 #define MMC_NEW_DIR (1 << 0) ///< 'new' directory changed
 #define MMC_CUR_DIR (1 << 1) ///< 'cur' directory changed
 
+#define MAILDIR_EVENTS_MAX 10000 ///< Queue this many changed files before falling back to a rescan
+
 /**
  * maildir_check_dir - Check for new mail / mail counts
  * @param m           Mailbox to check
  * @param dir_name    Path to Mailbox
  * @param check_new   if true, check for new mail
  * @param check_stats if true, count total, new, and flagged messages
+ * @param fresh       if not NULL, add the canonical names of all new messages
  *
  * Checks the specified maildir subdir (cur or new) for new mail or mail counts.
  */
-static void maildir_check_dir(struct Mailbox *m, const char *dir_name,
-                              bool check_new, bool check_stats)
+static void maildir_check_dir(struct Mailbox *m, const char *dir_name, bool check_new,
+                              bool check_stats, struct HashTable *fresh)
 {
   DIR *dirp = NULL;
   struct dirent *de = NULL;
@@ -133,8 +136,15 @@ static void maildir_check_dir(struct Mailbox *m, const char *dir_name,
           }
         }
         m->has_new = true;
-        check_new = false;
         m->msg_new++;
+        if (fresh)
+        {
+          maildir_canon_filename(msgpath, de->d_name);
+          if (!mutt_hash_find_elem(fresh, mutt_b2s(msgpath)))
+            mutt_hash_insert(fresh, mutt_b2s(msgpath), fresh);
+          continue;
+        }
+        check_new = false;
         if (!check_stats)
           break;
       }
@@ -193,12 +203,50 @@ void maildir_gen_flags(char *dest, size_t destlen, struct Email *e)
   }
 }
 
+/**
+ * struct MaildirRename - A rename queued by maildir_sync_message()
+ */
+struct MaildirRename
+{
+  struct Mailbox *mailbox; ///< Mailbox
+  struct Email *email;     ///< Email being renamed
+  char *path;              ///< New path, relative to the Mailbox
+};
+
+/**
+ * maildir_rename_done - Apply the result of a queued rename - Implements ::filebatch_done_t
+ */
+static void maildir_rename_done(int err, void *data)
+{
+  struct MaildirRename *mr = data;
+
+  if (err == 0)
+  {
+    FREE(&mr->email->path);
+    mr->email->path = mr->path;
+    mr->path = NULL;
+  }
+  else
+  {
+    errno = err;
+    mutt_perror("rename");
+    struct MaildirMboxData *mdata = maildir_mdata_get(mr->mailbox);
+    if (mdata)
+      mdata->batch_errors++;
+  }
+
+  FREE(&mr->path);
+  FREE(&mr);
+}
+
 /**
  * maildir_sync_message - Sync an email to a Maildir folder
  * @param m     Mailbox
  * @param msgno Index number
  * @retval  0 Success
  * @retval -1 Error
+ *
+ * If the Mailbox is being synced, the rename is queued, see mh_mbox_sync().
  */
 int maildir_sync_message(struct Mailbox *m, int msgno)
 {
@@ -268,6 +316,18 @@ int maildir_sync_message(struct Mailbox *m, int msgno)
     /* record that the message is possibly marked as trashed on disk */
     e->trash = e->deleted;
 
+    struct MaildirMboxData *mdata = maildir_mdata_get(m);
+    if (mdata && mdata->batch)
+    {
+      struct MaildirRename *mr = mutt_mem_calloc(1, sizeof(struct MaildirRename));
+      mr->mailbox = m;
+      mr->email = e;
+      mr->path = mutt_buffer_strdup(partpath);
+      mutt_filebatch_rename(mdata->batch, mutt_b2s(oldpath), mutt_b2s(fullpath),
+                            maildir_rename_done, mr);
+      goto cleanup;
+    }
+
     if (rename(mutt_b2s(oldpath), mutt_b2s(fullpath)) != 0)
     {
       mutt_perror("rename");
@@ -356,6 +416,357 @@ static int maildir_mbox_open_append(struct Mailbox *m, OpenMailboxFlags flags)
   return 0;
 }
 
+/**
+ * maildir_changed_free - Free a list of changed files - Implements ::hash_hdata_free_t
+ */
+static void maildir_changed_free(int type, void *obj, intptr_t data)
+{
+  struct ListHead *names = obj;
+  mutt_list_free(names);
+  FREE(&names);
+}
+
+/**
+ * maildir_stats_update - Adjust the running counts for one file
+ * @param stats  Counts to update
+ * @param subdir Subdirectory of the file, e.g. 'new'
+ * @param name   Filename
+ * @param delta  1 if the file was added, -1 if it was removed
+ *
+ * The files are counted the same way as maildir_check_dir().  A file that
+ * arrives while the Mailbox is watched is newer than the last visit, so it's
+ * new if it's unread.
+ */
+static void maildir_stats_update(struct MaildirStats *stats, const char *subdir,
+                                 const char *name, int delta)
+{
+  if (*name == '.')
+    return;
+
+  if (!stats->valid)
+  {
+    stats->raced = true;
+    return;
+  }
+
+  const char *p = strstr(name, ":2,");
+  if (p && strchr(p + 3, 'T'))
+    return;
+
+  const bool unread = !p || !strchr(p + 3, 'S');
+
+  stats->count += delta;
+  if (p && strchr(p + 3, 'F'))
+    stats->flagged += delta;
+  if (unread)
+    stats->unread += delta;
+
+  struct Buffer *buf = mutt_buffer_pool_get();
+  maildir_canon_filename(buf, name);
+  if (delta < 0)
+  {
+    mutt_hash_delete(stats->fresh, mutt_b2s(buf), NULL);
+  }
+  else if (unread && (C_MaildirCheckCur || mutt_str_equal(subdir, "new")) &&
+           !mutt_hash_find_elem(stats->fresh, mutt_b2s(buf)))
+  {
+    mutt_hash_insert(stats->fresh, mutt_b2s(buf), stats->fresh);
+  }
+  mutt_buffer_pool_release(&buf);
+
+  /* We've missed something, count them again */
+  if ((stats->count < 0) || (stats->unread < 0) || (stats->flagged < 0))
+    stats->valid = false;
+}
+
+/**
+ * maildir_monitor_event - Handle a change reported by the file monitor
+ * @param m      Mailbox
+ * @param ev     Event, e.g. #MAILDIR_EV_ADD
+ * @param subdir Subdirectory of the file, e.g. 'new'
+ * @param name   Filename
+ *
+ * While a Mailbox is watched, its message counts are kept up to date, so
+ * maildir_mbox_check_stats() doesn't need to read the directories.
+ *
+ * While it's open, the files are also queued.  maildir_mbox_check() looks at
+ * them, so the mailbox is updated without scanning its directories.  If too
+ * many events arrive, or some are lost, the next check falls back to a full
+ * scan.
+ */
+void maildir_monitor_event(struct Mailbox *m, enum MaildirEvent ev,
+                           const char *subdir, const char *name)
+{
+  if (!m || (m->type != MUTT_MAILDIR))
+    return;
+
+  struct MaildirMboxData *mdata = (ev == MAILDIR_EV_WATCH) ? maildir_mdata_init(m) :
+                                                             maildir_mdata_get(m);
+  if (!mdata)
+    return;
+
+  switch (ev)
+  {
+    case MAILDIR_EV_WATCH:
+      mutt_hash_free(&mdata->stats.fresh);
+      memset(&mdata->stats, 0, sizeof(mdata->stats));
+      m->monitored = true;
+      return;
+
+    case MAILDIR_EV_UNWATCH:
+      mdata->stats.valid = false;
+      m->monitored = false;
+      return;
+
+    case MAILDIR_EV_START:
+      mutt_hash_free(&mdata->changed);
+      mdata->events = MD_EVENTS_RESYNC;
+      return;
+
+    case MAILDIR_EV_STOP:
+      mutt_hash_free(&mdata->changed);
+      mutt_hash_free(&mdata->canon);
+      mdata->events = MD_EVENTS_OFF;
+      return;
+
+    case MAILDIR_EV_OVERFLOW:
+      mdata->stats.valid = false;
+      mdata->stats.raced = true;
+      if (mdata->events == MD_EVENTS_OFF)
+        return;
+      mutt_debug(LL_DEBUG1, "lost events for %s\n", mailbox_path(m));
+      mutt_hash_free(&mdata->changed);
+      mdata->events = MD_EVENTS_RESYNC;
+      return;
+
+    case MAILDIR_EV_ADD:
+    case MAILDIR_EV_REMOVE:
+      if (name)
+        maildir_stats_update(&mdata->stats, subdir, name, (ev == MAILDIR_EV_ADD) ? 1 : -1);
+      break;
+  }
+
+  if ((mdata->events == MD_EVENTS_OFF) || !subdir || !name || (*name == '.'))
+    return;
+
+  if (!mdata->changed)
+  {
+    mdata->changed = mutt_hash_new(128, MUTT_HASH_STRDUP_KEYS);
+    mutt_hash_set_destructor(mdata->changed, maildir_changed_free, 0);
+  }
+
+  struct Buffer *buf = mutt_buffer_pool_get();
+  maildir_canon_filename(buf, name);
+
+  struct ListHead *names = mutt_hash_find(mdata->changed, mutt_b2s(buf));
+  if (!names)
+  {
+    if (mdata->changed->num_elems >= MAILDIR_EVENTS_MAX)
+    {
+      /* Rescanning will be quicker */
+      mutt_debug(LL_DEBUG1, "too many events for %s\n", mailbox_path(m));
+      mutt_hash_free(&mdata->changed);
+      mdata->events = MD_EVENTS_RESYNC;
+      mutt_buffer_pool_release(&buf);
+      return;
+    }
+
+    names = mutt_mem_calloc(1, sizeof(*names));
+    STAILQ_INIT(names);
+    mutt_hash_insert(mdata->changed, mutt_b2s(buf), names);
+  }
+
+  mutt_buffer_printf(buf, "%s/%s", subdir, name);
+  mutt_list_insert_tail(names, mutt_buffer_strdup(buf));
+  mutt_buffer_pool_release(&buf);
+}
+
+/**
+ * maildir_update_email - Merge a rescanned message into an existing Email
+ * @param m     Mailbox
+ * @param e     Email in the Mailbox
+ * @param e_new Email built from the message's current filename
+ * @retval true The flags of the Email were changed
+ */
+static bool maildir_update_email(struct Mailbox *m, struct Email *e, struct Email *e_new)
+{
+  bool flags_changed = false;
+
+  /* check to see if the message has moved to a different
+   * subdirectory.  If so, update the associated filename.  */
+  if (!mutt_str_equal(e->path, e_new->path))
+    mutt_str_replace(&e->path, e_new->path);
+
+  /* if the user hasn't modified the flags on this message, update
+   * the flags we just detected.  */
+  if (!e->changed)
+    if (maildir_update_flags(m, e, e_new))
+      flags_changed = true;
+
+  if (e->deleted == e->trash)
+  {
+    if (e->deleted != e_new->deleted)
+    {
+      e->deleted = e_new->deleted;
+      flags_changed = true;
+    }
+  }
+  e->trash = e_new->trash;
+
+  return flags_changed;
+}
+
+/**
+ * maildir_canon_index - Index the Emails by their canonical filenames
+ * @param m Mailbox
+ * @retval ptr Hash Table, canonical name -> Email
+ */
+static struct HashTable *maildir_canon_index(struct Mailbox *m)
+{
+  struct HashTable *canon = mutt_hash_new(MAX(m->msg_count, 128), MUTT_HASH_STRDUP_KEYS);
+  struct Buffer *buf = mutt_buffer_pool_get();
+
+  for (int i = 0; i < m->msg_count; i++)
+  {
+    struct Email *e = m->emails[i];
+    if (!e)
+      break;
+    if (e->purge)
+      continue;
+
+    maildir_canon_filename(buf, e->path);
+    mutt_hash_insert(canon, mutt_b2s(buf), e);
+  }
+
+  mutt_buffer_pool_release(&buf);
+  return canon;
+}
+
+/**
+ * maildir_check_events - Apply the queued file events to the Mailbox
+ * @param m Mailbox
+ * @retval num Same as maildir_mbox_check()
+ *
+ * Only the files named by the monitor are examined, so the cost depends on the
+ * number of changes, not on the size of the mailbox.  Each file is checked on
+ * disk, which makes repeated events, and our own renames, harmless.
+ */
+static int maildir_check_events(struct Mailbox *m)
+{
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+
+#ifdef USE_INOTIFY
+  MonitorContextChanged = false;
+#endif
+
+  if (!mdata->changed || (mdata->changed->num_elems == 0))
+    return 0;
+
+  if (!mdata->canon)
+    mdata->canon = maildir_canon_index(m);
+
+  bool occult = false;
+  bool flags_changed = false;
+  struct Maildir *md = NULL;
+  struct Maildir **last = &md;
+  struct Buffer *buf = mutt_buffer_pool_get();
+  struct HashWalkState state = { 0 };
+  struct HashElem *he = NULL;
+  struct stat st;
+
+  while ((he = mutt_hash_walk(mdata->changed, &state)))
+  {
+    struct Email *e = mutt_hash_find(mdata->canon, he->key.strkey);
+
+    /* The most recent name that still exists is the message's location */
+    const char *found = NULL;
+    ino_t inode = 0;
+    if (e)
+    {
+      mutt_buffer_printf(buf, "%s/%s", mailbox_path(m), e->path);
+      if (lstat(mutt_b2s(buf), &st) == 0)
+      {
+        found = e->path;
+        inode = st.st_ino;
+      }
+    }
+
+    struct ListHead *names = he->data;
+    struct ListNode *np = NULL;
+    STAILQ_FOREACH(np, names, entries)
+    {
+      mutt_buffer_printf(buf, "%s/%s", mailbox_path(m), np->data);
+      if (lstat(mutt_b2s(buf), &st) == 0)
+      {
+        found = np->data;
+        inode = st.st_ino;
+      }
+    }
+
+    if (!found)
+    {
+      if (e)
+      {
+        /* This message disappeared, so we need to simulate a "reopen" event */
+        occult = true;
+        e->deleted = true;
+        e->purge = true;
+        mutt_hash_delete(mdata->canon, he->key.strkey, e);
+      }
+      continue;
+    }
+
+    mutt_buffer_strcpy(buf, found);
+    char *slash = strchr(buf->data, '/');
+    if (!slash)
+      continue;
+    *slash = '\0';
+    struct Maildir *entry = maildir_entry_parse(m, mutt_b2s(buf), slash + 1, inode);
+
+    if (e)
+    {
+      if (maildir_update_email(m, e, entry->email))
+        flags_changed = true;
+      email_free(&entry->email);
+    }
+
+    *last = entry;
+    last = &entry->next;
+  }
+
+  mutt_hash_free(&mdata->changed);
+
+  if (occult)
+    mailbox_changed(m, NT_MAILBOX_RESORT);
+
+  /* do any delayed parsing we need to do. */
+  maildir_delayed_parsing(m, &md, NULL);
+
+  /* Incorporate new messages */
+  int first = m->msg_count;
+  int num_new = maildir_move_to_mailbox(m, &md);
+  if (num_new > 0)
+  {
+    for (int i = first; i < m->msg_count; i++)
+    {
+      maildir_canon_filename(buf, m->emails[i]->path);
+      mutt_hash_insert(mdata->canon, mutt_b2s(buf), m->emails[i]);
+    }
+    mailbox_changed(m, NT_MAILBOX_INVALID);
+    m->changed = true;
+  }
+
+  mutt_buffer_pool_release(&buf);
+
+  if (occult)
+    return MUTT_REOPENED;
+  if (num_new > 0)
+    return MUTT_NEW_MAIL;
+  if (flags_changed)
+    return MUTT_FLAGS;
+  return 0;
+}
+
 /**
  * maildir_mbox_check - Check for new mail - Implements MxOps::mbox_check()
  *
@@ -365,6 +776,12 @@ static int maildir_mbox_open_append(struct Mailbox *m, OpenMailboxFlags flags)
  * We check for newly added messages, and then merge the flags messages we
  * already knew about.  We don't treat either subdirectory differently, as mail
  * could be copied directly into the cur directory from another agent.
+ *
+ * While the file monitor is watching the mailbox, only the files it reported
+ * are examined, see maildir_check_events().
+ *
+ * While the mailbox is being read in batches, the files that aren't in the
+ * Mailbox yet replace the unread entries, see maildir_pending_update().
  */
 int maildir_mbox_check(struct Mailbox *m)
 {
@@ -389,6 +806,17 @@ int maildir_mbox_check(struct Mailbox *m)
   if (!C_CheckNew)
     return 0;
 
+  /* The events can't be matched against the unread entries, so scan instead */
+  if (m->loading && (mdata->events == MD_EVENTS_ON))
+  {
+    mutt_hash_free(&mdata->changed);
+    mdata->events = MD_EVENTS_RESYNC;
+  }
+
+  /* The monitor has told us exactly which files have changed */
+  if (mdata->events == MD_EVENTS_ON)
+    return maildir_check_events(m);
+
   struct Buffer *buf = mutt_buffer_pool_get();
   mutt_buffer_printf(buf, "%s/new", mailbox_path(m));
   if (stat(mutt_b2s(buf), &st_new) == -1)
@@ -410,6 +838,19 @@ int maildir_mbox_check(struct Mailbox *m)
   if (mutt_file_stat_timespec_compare(&st_cur, MUTT_STAT_MTIME, &mdata->mtime_cur) > 0)
     changed |= MMC_CUR_DIR;
 
+  if (mdata->events == MD_EVENTS_RESYNC)
+  {
+    /* If the directories haven't changed since we last scanned them, the
+     * queued events are complete.  Otherwise, the scan makes them redundant. */
+    mdata->events = MD_EVENTS_ON;
+    if ((changed == MMC_NO_DIRS) && !m->loading)
+    {
+      mutt_buffer_pool_release(&buf);
+      return maildir_check_events(m);
+    }
+    mutt_hash_free(&mdata->changed);
+  }
+
   if (changed == MMC_NO_DIRS)
   {
     mutt_buffer_pool_release(&buf);
@@ -467,27 +908,8 @@ int maildir_mbox_check(struct Mailbox *m)
     {
       /* message already exists, merge flags */
       e->active = true;
-
-      /* check to see if the message has moved to a different
-       * subdirectory.  If so, update the associated filename.  */
-      if (!mutt_str_equal(e->path, p->email->path))
-        mutt_str_replace(&e->path, p->email->path);
-
-      /* if the user hasn't modified the flags on this message, update
-       * the flags we just detected.  */
-      if (!e->changed)
-        if (maildir_update_flags(m, e, p->email))
-          flags_changed = true;
-
-      if (e->deleted == e->trash)
-      {
-        if (e->deleted != p->email->deleted)
-        {
-          e->deleted = p->email->deleted;
-          flags_changed = true;
-        }
-      }
-      e->trash = p->email->trash;
+      if (maildir_update_email(m, e, p->email))
+        flags_changed = true;
 
       /* this is a duplicate of an existing email, so remove it */
       email_free(&p->email);
@@ -516,11 +938,16 @@ int maildir_mbox_check(struct Mailbox *m)
 
   /* destroy the file name hash */
   mutt_hash_free(&fnames);
+  mutt_hash_free(&mdata->canon);
 
   /* If we didn't just get new mail, update the tables. */
   if (occult)
     mailbox_changed(m, NT_MAILBOX_RESORT);
 
+  /* The rest will be read with the next batches */
+  if (m->loading)
+    maildir_pending_update(m, &md, (changed & MMC_NEW_DIR), (changed & MMC_CUR_DIR));
+
   /* do any delayed parsing we need to do. */
   maildir_delayed_parsing(m, &md, NULL);
 
@@ -543,6 +970,43 @@ int maildir_mbox_check(struct Mailbox *m)
   return 0;
 }
 
+/**
+ * maildir_check_stats_monitored - Check the statistics of a monitored Mailbox
+ * @param m           Mailbox
+ * @param check_stats If true, copy the total, unread and flagged counts
+ * @retval num Number of new messages
+ *
+ * The counts, and the names of the new messages, are kept up to date by
+ * maildir_monitor_event(), so the directories aren't read.
+ */
+static int maildir_check_stats_monitored(struct Mailbox *m, bool check_stats)
+{
+  struct MaildirStats *stats = &maildir_mdata_get(m)->stats;
+
+  if (check_stats)
+  {
+    m->msg_count = stats->count;
+    m->msg_unread = stats->unread;
+    m->msg_flagged = stats->flagged;
+  }
+
+  /* Visiting the Mailbox has made its messages old */
+  if (C_MailCheckRecent && (mutt_file_timespec_compare(&stats->visited, &m->last_visited) != 0))
+  {
+    mutt_hash_free(&stats->fresh);
+    stats->fresh = mutt_hash_new(128, MUTT_HASH_STRDUP_KEYS);
+    stats->visited = m->last_visited;
+  }
+
+  const int num = stats->fresh->num_elems;
+  if (num > 0)
+    m->has_new = true;
+  if (check_stats)
+    m->msg_new = num;
+
+  return num;
+}
+
 /**
  * maildir_mbox_check_stats - Check the Mailbox statistics - Implements MxOps::mbox_check_stats()
  */
@@ -553,6 +1017,27 @@ static int maildir_mbox_check_stats(struct Mailbox *m, int flags)
 
   bool check_stats = flags;
   bool check_new = true;
+  struct HashTable *fresh = NULL;
+
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (m->monitored && mdata && mdata->stats.valid)
+    return maildir_check_stats_monitored(m, check_stats);
+
+#ifdef USE_INOTIFY
+  /* The count will include any changes that are already queued.  Handle them
+   * now, while the counts are invalid, so they aren't applied twice. */
+  if (m->monitored && mdata)
+    mutt_monitor_drain();
+#endif
+
+  /* Count the messages, so that the monitor's events can keep them up to date */
+  if (m->monitored && mdata)
+  {
+    mdata->stats.raced = false;
+    check_stats = true;
+    mutt_hash_free(&mdata->stats.fresh);
+    fresh = mutt_hash_new(128, MUTT_HASH_STRDUP_KEYS);
+  }
 
   if (check_stats)
   {
@@ -562,11 +1047,32 @@ static int maildir_mbox_check_stats(struct Mailbox *m, int flags)
     m->msg_new = 0;
   }
 
-  maildir_check_dir(m, "new", check_new, check_stats);
+  maildir_check_dir(m, "new", check_new, check_stats, fresh);
 
-  check_new = !m->has_new && C_MaildirCheckCur;
+  check_new = (!m->has_new || fresh) && C_MaildirCheckCur;
   if (check_new || check_stats)
-    maildir_check_dir(m, "cur", check_new, check_stats);
+    maildir_check_dir(m, "cur", check_new, check_stats, fresh);
+
+#ifdef USE_INOTIFY
+  /* The events that arrived during the scan may, or may not, be in the count.
+   * Drop them, and count again next time. */
+  if (fresh)
+    mutt_monitor_drain();
+#endif
+
+  if (fresh && (m->type == MUTT_MAILDIR) && !mdata->stats.raced)
+  {
+    mdata->stats.count = m->msg_count;
+    mdata->stats.unread = m->msg_unread;
+    mdata->stats.flagged = m->msg_flagged;
+    mdata->stats.fresh = fresh;
+    mdata->stats.visited = m->last_visited;
+    mdata->stats.valid = true;
+  }
+  else
+  {
+    mutt_hash_free(&fresh);
+  }
 
   return m->msg_new;
 }
@@ -715,6 +1221,7 @@ struct MxOps MxMaildirOps = {
   .ac_find          = maildir_ac_find,
   .ac_add           = maildir_ac_add,
   .mbox_open        = maildir_mbox_open,
+  .mbox_load        = mh_mbox_load,
   .mbox_open_append = maildir_mbox_open_append,
   .mbox_check       = maildir_mbox_check,
   .mbox_check_stats = maildir_mbox_check_stats,
@@ -51,24 +51,119 @@
 #include "mx.h"
 
 /**
- * mhs_alloc - Allocate more memory for sequences
- * @param mhs Existing sequences
- * @param i   Number required
+ * mhs_find - Find the first range that could hold a message number
+ * @param set Sequence
+ * @param n   Message number
+ * @retval num Index of the first range ending at, or after, n
+ */
+static size_t mhs_find(const struct MhSeqSet *set, int n)
+{
+  size_t lo = 0;
+  size_t hi = set->num;
+
+  while (lo < hi)
+  {
+    const size_t mid = lo + ((hi - lo) / 2);
+    if (set->ranges[mid].last < n)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/**
+ * mhs_alloc - Allocate more memory for a sequence
+ * @param set Sequence
+ * @param num Number of ranges required
  *
- * @note Memory is allocated in blocks of 128.
+ * @note Memory is allocated in blocks of 16 ranges.
  */
-static void mhs_alloc(struct MhSequences *mhs, int i)
+static void mhs_alloc(struct MhSeqSet *set, size_t num)
 {
-  if ((i <= mhs->max) && mhs->flags)
+  if (num <= set->size)
     return;
 
-  const int newmax = i + 128;
-  int j = mhs->flags ? mhs->max + 1 : 0;
-  mutt_mem_realloc(&mhs->flags, sizeof(mhs->flags[0]) * (newmax + 1));
-  while (j <= newmax)
-    mhs->flags[j++] = 0;
+  set->size = num + 16;
+  mutt_mem_realloc(&set->ranges, set->size * sizeof(struct MhSeqRange));
+}
+
+/**
+ * mhs_add_range - Add a range of message numbers to a sequence
+ * @param set   Sequence
+ * @param first First message number
+ * @param last  Last message number
+ *
+ * Any ranges that overlap, or touch, the new one are merged into it.
+ */
+static void mhs_add_range(struct MhSeqSet *set, int first, int last)
+{
+  /* Ranges ending just before 'first' are adjacent, so they're merged too */
+  size_t lo = mhs_find(set, (first > INT_MIN) ? first - 1 : first);
+  size_t hi = lo;
+
+  while ((hi < set->num) && ((last == INT_MAX) || (set->ranges[hi].first <= last + 1)))
+  {
+    if (set->ranges[hi].first < first)
+      first = set->ranges[hi].first;
+    if (set->ranges[hi].last > last)
+      last = set->ranges[hi].last;
+    hi++;
+  }
+
+  if (lo == hi)
+  {
+    mhs_alloc(set, set->num + 1);
+    memmove(&set->ranges[lo + 1], &set->ranges[lo],
+            (set->num - lo) * sizeof(struct MhSeqRange));
+    set->num++;
+  }
+  else if (hi > (lo + 1))
+  {
+    memmove(&set->ranges[lo + 1], &set->ranges[hi],
+            (set->num - hi) * sizeof(struct MhSeqRange));
+    set->num -= hi - lo - 1;
+  }
+
+  set->ranges[lo].first = first;
+  set->ranges[lo].last = last;
+}
+
+/**
+ * mhs_remove - Remove a message number from a sequence
+ * @param set Sequence
+ * @param n   Message number
+ */
+static void mhs_remove(struct MhSeqSet *set, int n)
+{
+  size_t i = mhs_find(set, n);
+  if ((i == set->num) || (set->ranges[i].first > n))
+    return;
 
-  mhs->max = newmax;
+  struct MhSeqRange *r = &set->ranges[i];
+  if (r->first == r->last)
+  {
+    memmove(r, r + 1, (set->num - i - 1) * sizeof(struct MhSeqRange));
+    set->num--;
+  }
+  else if (r->first == n)
+  {
+    r->first++;
+  }
+  else if (r->last == n)
+  {
+    r->last--;
+  }
+  else
+  {
+    /* Split the range in two */
+    mhs_alloc(set, set->num + 1);
+    r = &set->ranges[i];
+    memmove(r + 1, r, (set->num - i) * sizeof(struct MhSeqRange));
+    set->num++;
+    r[0].last = n - 1;
+    r[1].first = n + 1;
+  }
 }
 
 /**
@@ -77,7 +172,12 @@ static void mhs_alloc(struct MhSequences *mhs, int i)
  */
 void mhs_sequences_free(struct MhSequences *mhs)
 {
-  FREE(&mhs->flags);
+  for (size_t i = 0; i < mutt_array_size(mhs->seqs); i++)
+  {
+    FREE(&mhs->seqs[i].ranges);
+    mhs->seqs[i].num = 0;
+    mhs->seqs[i].size = 0;
+  }
 }
 
 /**
@@ -88,9 +188,32 @@ void mhs_sequences_free(struct MhSequences *mhs)
  */
 MhSeqFlags mhs_check(struct MhSequences *mhs, int i)
 {
-  if (!mhs->flags || (i > mhs->max))
-    return 0;
-  return mhs->flags[i];
+  MhSeqFlags flags = MH_SEQ_NO_FLAGS;
+
+  for (size_t s = 0; s < mutt_array_size(mhs->seqs); s++)
+  {
+    const struct MhSeqSet *set = &mhs->seqs[s];
+    const size_t r = mhs_find(set, i);
+    if ((r < set->num) && (set->ranges[r].first <= i))
+      flags |= (1 << s);
+  }
+  return flags;
+}
+
+/**
+ * mhs_set_range - Set a flag for a range of sequence numbers
+ * @param mhs   Sequences
+ * @param first First index number
+ * @param last  Last index number
+ * @param f     Flags, see #MhSeqFlags
+ */
+static void mhs_set_range(struct MhSequences *mhs, int first, int last, MhSeqFlags f)
+{
+  for (size_t s = 0; s < mutt_array_size(mhs->seqs); s++)
+  {
+    if (f & (1 << s))
+      mhs_add_range(&mhs->seqs[s], first, last);
+  }
 }
 
 /**
@@ -102,9 +225,57 @@ MhSeqFlags mhs_check(struct MhSequences *mhs, int i)
  */
 MhSeqFlags mhs_set(struct MhSequences *mhs, int i, MhSeqFlags f)
 {
-  mhs_alloc(mhs, i);
-  mhs->flags[i] |= f;
-  return mhs->flags[i];
+  mhs_set_range(mhs, i, i, f);
+  return mhs_check(mhs, i);
+}
+
+/**
+ * mhs_clear - Clear a flag for a given sequence
+ * @param mhs Sequences
+ * @param i   Index number
+ * @param f   Flags, see #MhSeqFlags
+ * @retval num Resulting flags, see #MhSeqFlags
+ */
+MhSeqFlags mhs_clear(struct MhSequences *mhs, int i, MhSeqFlags f)
+{
+  for (size_t s = 0; s < mutt_array_size(mhs->seqs); s++)
+  {
+    if (f & (1 << s))
+      mhs_remove(&mhs->seqs[s], i);
+  }
+  return mhs_check(mhs, i);
+}
+
+/**
+ * mhs_get_set - Get the sequence for a flag
+ * @param mhs Sequences
+ * @param f   Flag, see #MhSeqFlags
+ * @retval ptr Sequence
+ */
+static struct MhSeqSet *mhs_get_set(struct MhSequences *mhs, MhSeqFlags f)
+{
+  if (f & MH_SEQ_REPLIED)
+    return &mhs->seqs[1];
+  if (f & MH_SEQ_FLAGGED)
+    return &mhs->seqs[2];
+  return &mhs->seqs[0];
+}
+
+/**
+ * mhs_count - Count the messages in a sequence
+ * @param mhs Sequences
+ * @param f   Flag, see #MhSeqFlags
+ * @retval num Number of messages
+ */
+static int mhs_count(struct MhSequences *mhs, MhSeqFlags f)
+{
+  const struct MhSeqSet *set = mhs_get_set(mhs, f);
+  int count = 0;
+
+  for (size_t i = 0; i < set->num; i++)
+    count += set->ranges[i].last - set->ranges[i].first + 1;
+
+  return count;
 }
 
 /**
@@ -117,79 +288,72 @@ MhSeqFlags mhs_set(struct MhSequences *mhs, int i, MhSeqFlags f)
 static void mhs_write_one_sequence(FILE *fp, struct MhSequences *mhs,
                                    MhSeqFlags f, const char *tag)
 {
-  fprintf(fp, "%s:", tag);
-
-  int first = -1;
-  int last = -1;
-
-  for (int i = 0; i <= mhs->max; i++)
-  {
-    if ((mhs_check(mhs, i) & f))
-    {
-      if (first < 0)
-        first = i;
-      else
-        last = i;
-    }
-    else if (first >= 0)
-    {
-      if (last < 0)
-        fprintf(fp, " %d", first);
-      else
-        fprintf(fp, " %d-%d", first, last);
+  const struct MhSeqSet *set = mhs_get_set(mhs, f);
+  if (set->num == 0)
+    return;
 
-      first = -1;
-      last = -1;
-    }
-  }
+  fprintf(fp, "%s:", tag);
 
-  if (first >= 0)
+  for (size_t i = 0; i < set->num; i++)
   {
-    if (last < 0)
-      fprintf(fp, " %d", first);
+    if (set->ranges[i].first == set->ranges[i].last)
+      fprintf(fp, " %d", set->ranges[i].first);
     else
-      fprintf(fp, " %d-%d", first, last);
+      fprintf(fp, " %d-%d", set->ranges[i].first, set->ranges[i].last);
   }
 
   fputc('\n', fp);
 }
 
 /**
- * mh_update_sequences - Update sequence numbers
- * @param m Mailbox
+ * mh_msg_num - Get the number of an MH message
+ * @param path Path of the message, relative to the Mailbox
+ * @retval num Message number
+ * @retval -1  Not a numbered message
+ */
+static int mh_msg_num(const char *path)
+{
+  const char *p = strrchr(path, '/');
+  if (p)
+    p++;
+  else
+    p = path;
+
+  int num = 0;
+  if ((mutt_str_atoi(p, &num) < 0) || (num < 1))
+    return -1;
+  return num;
+}
+
+/**
+ * mh_sequences_write - Write a set of MH sequences
+ * @param m   Mailbox
+ * @param mhs Sequences
+ * @retval  0 Success
+ * @retval -1 Error
  *
- * XXX we don't currently remove deleted messages from sequences we don't know.
- * Should we?
+ * Sequences we don't know about are copied from the old file.  The new file
+ * replaces the old one with rename(), so other MH programs never see a partly
+ * written file.
  */
-void mh_update_sequences(struct Mailbox *m)
+int mh_sequences_write(struct Mailbox *m, struct MhSequences *mhs)
 {
   char sequences[PATH_MAX];
   char *tmpfname = NULL;
   char *buf = NULL;
-  char *p = NULL;
   size_t s;
-  int seq_num = 0;
-
-  int unseen = 0;
-  int flagged = 0;
-  int replied = 0;
 
   char seq_unseen[256];
   char seq_replied[256];
   char seq_flagged[256];
 
-  struct MhSequences mhs = { 0 };
-
   snprintf(seq_unseen, sizeof(seq_unseen), "%s:", NONULL(C_MhSeqUnseen));
   snprintf(seq_replied, sizeof(seq_replied), "%s:", NONULL(C_MhSeqReplied));
   snprintf(seq_flagged, sizeof(seq_flagged), "%s:", NONULL(C_MhSeqFlagged));
 
   FILE *fp_new = NULL;
   if (mh_mkstemp(m, &fp_new, &tmpfname) != 0)
-  {
-    /* error message? */
-    return;
-  }
+    return -1;
 
   snprintf(sequences, sizeof(sequences), "%s/.mh_sequences", mailbox_path(m));
 
@@ -209,8 +373,40 @@ void mh_update_sequences(struct Mailbox *m)
     }
   }
   mutt_file_fclose(&fp_old);
+  FREE(&buf);
+
+  /* now, write our unseen, flagged, and replied sequences */
+  mhs_write_one_sequence(fp_new, mhs, MH_SEQ_UNSEEN, NONULL(C_MhSeqUnseen));
+  mhs_write_one_sequence(fp_new, mhs, MH_SEQ_FLAGGED, NONULL(C_MhSeqFlagged));
+  mhs_write_one_sequence(fp_new, mhs, MH_SEQ_REPLIED, NONULL(C_MhSeqReplied));
+
+  int rc = 0;
+  if ((mutt_file_fclose(&fp_new) != 0) || (rename(tmpfname, sequences) != 0))
+  {
+    mutt_debug(LL_DEBUG1, "Can't write %s: %s\n", sequences, strerror(errno));
+    unlink(tmpfname);
+    rc = -1;
+  }
+
+  FREE(&tmpfname);
+  return rc;
+}
+
+/**
+ * mh_sequences_load - Rebuild the MH sequences from the Mailbox's Emails
+ * @param m Mailbox
+ *
+ * The sequences are then kept up to date by mh_sequences_update(), so that a
+ * sync doesn't need to look at every Email.
+ */
+void mh_sequences_load(struct Mailbox *m)
+{
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (!mdata)
+    return;
+
+  mhs_sequences_free(&mdata->mhs);
 
-  /* now, update our unseen, flagged, and replied sequences */
   for (int i = 0; i < m->msg_count; i++)
   {
     struct Email *e = m->emails[i];
@@ -220,53 +416,85 @@ void mh_update_sequences(struct Mailbox *m)
     if (e->deleted)
       continue;
 
-    p = strrchr(e->path, '/');
-    if (p)
-      p++;
-    else
-      p = e->path;
-
-    if (mutt_str_atoi(p, &seq_num) < 0)
+    const int num = mh_msg_num(e->path);
+    if (num < 0)
       continue;
 
+    MhSeqFlags flags = MH_SEQ_NO_FLAGS;
     if (!e->read)
-    {
-      mhs_set(&mhs, seq_num, MH_SEQ_UNSEEN);
-      unseen++;
-    }
+      flags |= MH_SEQ_UNSEEN;
     if (e->flagged)
-    {
-      mhs_set(&mhs, seq_num, MH_SEQ_FLAGGED);
-      flagged++;
-    }
+      flags |= MH_SEQ_FLAGGED;
     if (e->replied)
-    {
-      mhs_set(&mhs, seq_num, MH_SEQ_REPLIED);
-      replied++;
-    }
-  }
+      flags |= MH_SEQ_REPLIED;
 
-  /* write out the new sequences */
-  if (unseen)
-    mhs_write_one_sequence(fp_new, &mhs, MH_SEQ_UNSEEN, NONULL(C_MhSeqUnseen));
-  if (flagged)
-    mhs_write_one_sequence(fp_new, &mhs, MH_SEQ_FLAGGED, NONULL(C_MhSeqFlagged));
-  if (replied)
-    mhs_write_one_sequence(fp_new, &mhs, MH_SEQ_REPLIED, NONULL(C_MhSeqReplied));
+    /* The Emails are usually in order, so this appends to the last range */
+    mhs_set_range(&mdata->mhs, num, num, flags);
+  }
 
-  mhs_sequences_free(&mhs);
+  mdata->mhs_dirty = false;
+}
 
-  /* try to commit the changes - no guarantee here */
-  mutt_file_fclose(&fp_new);
+/**
+ * mh_sequences_set - Make the MH sequences match one Email
+ * @param mhs     Sequences to update
+ * @param e       Email
+ * @param present false if the message has gone
+ */
+static void mh_sequences_set(struct MhSequences *mhs, struct Email *e, bool present)
+{
+  const int num = mh_msg_num(e->path);
+  if (num < 0)
+    return;
 
-  unlink(sequences);
-  if (mutt_file_safe_rename(tmpfname, sequences) != 0)
+  MhSeqFlags flags = MH_SEQ_NO_FLAGS;
+  if (present && !e->deleted)
   {
-    /* report an error? */
-    unlink(tmpfname);
+    if (!e->read)
+      flags |= MH_SEQ_UNSEEN;
+    if (e->flagged)
+      flags |= MH_SEQ_FLAGGED;
+    if (e->replied)
+      flags |= MH_SEQ_REPLIED;
   }
 
-  FREE(&tmpfname);
+  mhs_set_range(mhs, num, num, flags);
+  mhs_clear(mhs, num, (MH_SEQ_UNSEEN | MH_SEQ_FLAGGED | MH_SEQ_REPLIED) & ~flags);
+}
+
+/**
+ * mh_sequences_update - Update the MH sequences for one Email
+ * @param m Mailbox
+ * @param e Email that has been changed, or deleted
+ */
+void mh_sequences_update(struct Mailbox *m, struct Email *e)
+{
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (!mdata || !e)
+    return;
+
+  mh_sequences_set(&mdata->mhs, e, true);
+  mdata->mhs_dirty = true;
+}
+
+/**
+ * mh_update_sequences - Update sequence numbers
+ * @param m Mailbox
+ *
+ * The sequences are only written if an Email has changed since they were
+ * last loaded, or written.
+ *
+ * XXX we don't currently remove deleted messages from sequences we don't know.
+ * Should we?
+ */
+void mh_update_sequences(struct Mailbox *m)
+{
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (!mdata || !mdata->mhs_dirty)
+    return;
+
+  if (mh_sequences_write(m, &mdata->mhs) == 0)
+    mdata->mhs_dirty = false;
 }
 
 /**
@@ -340,8 +568,10 @@ int mh_read_sequences(struct MhSequences *mhs, const char *path)
         rc = -1;
         goto out;
       }
-      for (; first <= last; first++)
-        mhs_set(mhs, first, flags);
+      if (first < 1)
+        first = 1;
+      if (first <= last)
+        mhs_set_range(mhs, first, last, flags);
     }
   }
 
@@ -440,30 +670,19 @@ static int mh_mbox_check_stats(struct Mailbox *m, int flags)
     return -1;
 
   m->msg_count = 0;
-  m->msg_unread = 0;
-  m->msg_flagged = 0;
+  m->msg_unread = mhs_count(&mhs, MH_SEQ_UNSEEN);
+  m->msg_flagged = mhs_count(&mhs, MH_SEQ_FLAGGED);
 
-  for (int i = mhs.max; i > 0; i--)
+  /* Only the highest unseen message matters.  If it was in the mailbox during
+   * the last visit, don't notify about it. */
+  const struct MhSeqSet *unseen = mhs_get_set(&mhs, MH_SEQ_UNSEEN);
+  if (unseen->num > 0)
   {
-    if ((mhs_check(&mhs, i) & MH_SEQ_FLAGGED))
-      m->msg_flagged++;
-    if (mhs_check(&mhs, i) & MH_SEQ_UNSEEN)
+    const int last = unseen->ranges[unseen->num - 1].last;
+    if (!C_MailCheckRecent || (mh_already_notified(m, last) == 0))
     {
-      m->msg_unread++;
-      if (check_new)
-      {
-        /* if the first unseen message we encounter was in the m during the
-         * last visit, don't notify about it */
-        if (!C_MailCheckRecent || (mh_already_notified(m, i) == 0))
-        {
-          m->has_new = true;
-          rc = 1;
-        }
-        /* Because we are traversing from high to low, we can stop
-         * checking for new mail after the first unseen message.
-         * Whether it resulted in "new mail" or not. */
-        check_new = false;
-      }
+      m->has_new = true;
+      rc = 1;
     }
   }
 
@@ -692,14 +911,21 @@ int mh_mbox_check(struct Mailbox *m)
     {
       e->active = true;
       /* found the right message */
-      if (!e->changed)
-        if (maildir_update_flags(m, e, p->email))
-          flags_changed = true;
+      if (!e->changed && maildir_update_flags(m, e, p->email))
+      {
+        flags_changed = true;
+        if (mdata)
+          mh_sequences_set(&mdata->mhs, e, true);
+      }
 
       email_free(&p->email);
     }
     else /* message has disappeared */
+    {
       occult = true;
+      if (mdata)
+        mh_sequences_set(&mdata->mhs, e, false);
+    }
   }
 
   /* destroy the file name hash */
@@ -710,8 +936,23 @@ int mh_mbox_check(struct Mailbox *m)
   if (occult)
     mailbox_changed(m, NT_MAILBOX_RESORT);
 
+  /* The rest will be read with the next batches, using the sequences that
+   * were just read */
+  if (m->loading && mdata)
+  {
+    for (p = md; p; p = p->next)
+    {
+      if (p->email)
+        mh_sequences_set(&mdata->mhs, p->email, true);
+    }
+    maildir_pending_update(m, &md, true, true);
+  }
+
   /* Incorporate new messages */
+  const int old_count = m->msg_count;
   num_new = maildir_move_to_mailbox(m, &md);
+  for (int i = old_count; mdata && (i < m->msg_count); i++)
+    mh_sequences_set(&mdata->mhs, m->emails[i], true);
   if (num_new > 0)
   {
     mailbox_changed(m, NT_MAILBOX_INVALID);
@@ -814,6 +1055,7 @@ struct MxOps MxMhOps = {
   .ac_find          = maildir_ac_find,
   .ac_add           = maildir_ac_add,
   .mbox_open        = mh_mbox_open,
+  .mbox_load        = mh_mbox_load,
   .mbox_open_append = mh_mbox_open_append,
   .mbox_check       = mh_mbox_check,
   .mbox_check_stats = mh_mbox_check_stats,
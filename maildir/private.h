@@ -28,9 +28,13 @@
 #include <stdio.h>
 #include <sys/types.h>
 #include <time.h>
+#include "mutt/lib.h"
+#include "core/lib.h"
+#ifdef USE_HCACHE
+#include "hcache/lib.h"
+#endif
 
 struct Account;
-struct Buffer;
 struct Email;
 struct Mailbox;
 struct Message;
@@ -44,6 +48,76 @@ struct MaildirEmailData
   char *maildir_flags; ///< Unknown Maildir flags
 };
 
+/**
+ * enum MaildirEventState - How far the monitor's file events can be trusted
+ */
+enum MaildirEventState
+{
+  MD_EVENTS_OFF = 0, ///< Not monitored, compare the directory mtimes
+  MD_EVENTS_RESYNC,  ///< Monitored, but some events may have been missed
+  MD_EVENTS_ON,      ///< Monitored, apply the queued events
+};
+
+/**
+ * struct MaildirScanStats - System calls used to read a Mailbox
+ *
+ * These are logged when a Mailbox is opened, to measure the cost of a scan.
+ */
+struct MaildirScanStats
+{
+  size_t entries;   ///< Directory entries read
+  size_t dir_calls; ///< Calls to read the directories, e.g. getdents64()
+  size_t stats;     ///< Files stat()ed to verify the header cache
+  size_t opens;     ///< Message files opened and parsed
+};
+
+/**
+ * struct MaildirStats - Message counts kept up to date by the file monitor
+ */
+struct MaildirStats
+{
+  int count;   ///< Total number of messages
+  int unread;  ///< Number of unread messages
+  int flagged; ///< Number of flagged messages
+  bool valid;  ///< The counts match the directories
+  bool raced;  ///< Files changed while the directories were being counted
+  struct HashTable *fresh; ///< Canonical names of the new messages
+  struct timespec visited; ///< Mailbox::last_visited when the new messages were counted
+};
+
+typedef uint8_t MhSeqFlags;     ///< Flags, e.g. #MH_SEQ_UNSEEN
+#define MH_SEQ_NO_FLAGS      0  ///< No flags are set
+#define MH_SEQ_UNSEEN  (1 << 0) ///< Email hasn't been read
+#define MH_SEQ_REPLIED (1 << 1) ///< Email has been replied to
+#define MH_SEQ_FLAGGED (1 << 2) ///< Email is flagged
+
+/**
+ * struct MhSeqRange - A run of consecutive MH message numbers
+ */
+struct MhSeqRange
+{
+  int first; ///< First message number
+  int last;  ///< Last message number (inclusive)
+};
+
+/**
+ * struct MhSeqSet - One MH sequence, e.g. "unseen"
+ */
+struct MhSeqSet
+{
+  struct MhSeqRange *ranges; ///< Disjoint ranges, in ascending order
+  size_t num;                ///< Number of ranges used
+  size_t size;               ///< Number of ranges allocated
+};
+
+/**
+ * struct MhSequences - Set of MH sequence numbers
+ */
+struct MhSequences
+{
+  struct MhSeqSet seqs[3]; ///< One sequence per flag, in the order of #MhSeqFlags
+};
+
 /**
  * struct MaildirMboxData - Maildir-specific Mailbox data - @extends Mailbox
  */
@@ -51,6 +125,17 @@ struct MaildirMboxData
 {
   struct timespec mtime_cur;
   mode_t mh_umask;
+  enum MaildirEventState events; ///< Are the monitor's events being used?
+  struct HashTable *changed;     ///< Files changed since the last check, canonical name -> ListHead of paths
+  struct HashTable *canon;       ///< Canonical name -> Email, used to apply the events
+  struct MaildirStats stats;     ///< Running counts, while the Mailbox is monitored
+  struct MaildirScanStats scan;  ///< System calls used by the last scan
+  struct FileBatch *batch;       ///< Renames and unlinks queued by mh_mbox_sync()
+  int batch_errors;              ///< Number of queued renames that failed
+  struct MhSequences mhs;        ///< MH sequences of the Emails, see mh_sequences_load()
+  bool mhs_dirty;                ///< The sequences haven't been written since they changed
+  struct Maildir *pending;       ///< Entries not read yet, see Mailbox.loading
+  struct HashTable *pending_hce; ///< Header cache entries of the pending Emails, see maildir_hcache_load()
 };
 
 /**
@@ -65,23 +150,30 @@ struct Maildir
   struct Maildir *next;
 };
 
-typedef uint8_t MhSeqFlags;     ///< Flags, e.g. #MH_SEQ_UNSEEN
-#define MH_SEQ_NO_FLAGS      0  ///< No flags are set
-#define MH_SEQ_UNSEEN  (1 << 0) ///< Email hasn't been read
-#define MH_SEQ_REPLIED (1 << 1) ///< Email has been replied to
-#define MH_SEQ_FLAGGED (1 << 2) ///< Email is flagged
-
 /**
- * struct MhSequences - Set of MH sequence numbers
+ * struct MaildirParseJob - A message to be read by maildir_delayed_parsing()
+ *
+ * The job may be run on a worker thread.  It may only touch its own Maildir
+ * entry and the fields below.
  */
-struct MhSequences
+struct MaildirParseJob
 {
-  int max;           ///< Number of flags stored
-  MhSeqFlags *flags; ///< Flags for each email
+  struct Maildir *md;    ///< Maildir entry to read
+  enum MailboxType type; ///< Mailbox type, e.g. #MUTT_MAILDIR
+  struct Buffer path;    ///< Full path of the message file
+  struct Buffer header;  ///< Header of the message, reused between jobs
+#ifdef USE_HCACHE
+  struct HCacheEntry hce; ///< Undecoded Email from the header cache (OPTIONAL)
+#endif
+  bool use_cache;        ///< The cached Email is still valid
+  bool parsed;           ///< The message file was parsed successfully
+  bool stat;             ///< The file was stat()ed
+  bool opened;           ///< The file was opened
 };
 
 extern bool  C_CheckNew;
 extern bool  C_MaildirCheckCur;
+extern short C_MaildirParseThreads;
 extern bool  C_MaildirTrash;
 extern bool  C_MhPurge;
 extern char *C_MhSeqFlagged;
@@ -97,6 +189,7 @@ int             maildir_path_parent(char *buf, size_t buflen);
 int             maildir_path_pretty(char *buf, size_t buflen, const char *folder);
 int             mh_mbox_check      (struct Mailbox *m);
 int             mh_mbox_close      (struct Mailbox *m);
+int             mh_mbox_load       (struct Mailbox *m);
 int             mh_mbox_sync       (struct Mailbox *m);
 int             mh_msg_close       (struct Mailbox *m, struct Message *msg);
 int             mh_msg_save_hcache (struct Mailbox *m, struct Email *e);
@@ -104,17 +197,25 @@ int             mh_msg_save_hcache (struct Mailbox *m, struct Email *e);
 /* Maildir/MH shared functions */
 void                    maildir_canon_filename (struct Buffer *dest, const char *src);
 void                    maildir_delayed_parsing(struct Mailbox *m, struct Maildir **md, struct Progress *progress);
+struct Maildir *        maildir_entry_parse    (struct Mailbox *m, const char *subdir, const char *name, ino_t inode);
 size_t                  maildir_hcache_keylen  (const char *fn);
 struct MaildirMboxData *maildir_mdata_get      (struct Mailbox *m);
+struct MaildirMboxData *maildir_mdata_init     (struct Mailbox *m);
+struct Email *          maildir_parse_file     (enum MailboxType type, const char *fname, bool is_old, struct Email *e, struct Buffer *buf);
 int                     maildir_mh_open_message(struct Mailbox *m, struct Message *msg, int msgno, bool is_maildir);
 int                     maildir_move_to_mailbox(struct Mailbox *m, struct Maildir **ptr);
 int                     maildir_parse_dir      (struct Mailbox *m, struct Maildir ***last, const char *subdir, int *count, struct Progress *progress);
+void                    maildir_pending_update (struct Mailbox *m, struct Maildir **md, bool scan_new, bool scan_cur);
 int                     md_commit_message      (struct Mailbox *m, struct Message *msg, struct Email *e);
 int                     mh_commit_msg          (struct Mailbox *m, struct Message *msg, struct Email *e, bool updseq);
 int                     mh_mkstemp             (struct Mailbox *m, FILE **fp, char **tgt);
 int                     mh_read_dir            (struct Mailbox *m, const char *subdir);
 int                     mh_read_sequences      (struct MhSequences *mhs, const char *path);
+int                     mh_sequences_write     (struct Mailbox *m, struct MhSequences *mhs);
+void                    mh_sequences_load      (struct Mailbox *m);
+void                    mh_sequences_update    (struct Mailbox *m, struct Email *e);
 MhSeqFlags              mhs_check              (struct MhSequences *mhs, int i);
+MhSeqFlags              mhs_clear              (struct MhSequences *mhs, int i, MhSeqFlags f);
 void                    mhs_sequences_free     (struct MhSequences *mhs);
 MhSeqFlags              mhs_set                (struct MhSequences *mhs, int i, MhSeqFlags f);
 mode_t                  mh_umask               (struct Mailbox *m);
@@ -62,6 +62,10 @@
 #endif
 
 #define INS_SORT_THRESHOLD 6
+#define MAILDIR_PARSE_BATCH 256 ///< Messages read by maildir_delayed_parsing() at a time
+#define MAILDIR_SNAPSHOT_MAGIC 0x4d445331 ///< "MDS1", marks a directory snapshot
+#define MAILDIR_HEADER_READ (16 * 1024)      ///< First read of a message's header
+#define MAILDIR_HEADER_READ_MAX (256 * 1024) ///< Largest header read into memory
 
 /**
  * maildir_edata_free - Free the private Email data - Implements Email::edata_free()
@@ -107,7 +111,12 @@ static void maildir_mdata_free(void **ptr)
   if (!ptr || !*ptr)
     return;
 
-  // struct MaildirMboxData *mdata = *ptr;
+  struct MaildirMboxData *mdata = *ptr;
+  mutt_hash_free(&mdata->changed);
+  mutt_hash_free(&mdata->canon);
+  mutt_hash_free(&mdata->stats.fresh);
+  mutt_hash_free(&mdata->pending_hce);
+  mhs_sequences_free(&mdata->mhs);
   FREE(ptr);
 }
 
@@ -133,6 +142,25 @@ struct MaildirMboxData *maildir_mdata_get(struct Mailbox *m)
   return m->mdata;
 }
 
+/**
+ * maildir_mdata_init - Attach the private data to a Mailbox
+ * @param m Mailbox
+ * @retval ptr MaildirMboxData
+ *
+ * The data is created if the Mailbox doesn't have any yet.
+ */
+struct MaildirMboxData *maildir_mdata_init(struct Mailbox *m)
+{
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (!mdata && m && ((m->type == MUTT_MAILDIR) || (m->type == MUTT_MH)))
+  {
+    mdata = maildir_mdata_new();
+    m->mdata = mdata;
+    m->mdata_free = maildir_mdata_free;
+  }
+  return mdata;
+}
+
 /**
  * mh_umask - Create a umask from the mailbox directory
  * @param  m   Mailbox
@@ -212,70 +240,30 @@ int mh_mkstemp(struct Mailbox *m, FILE **fp, char **tgt)
  */
 static void mh_sequences_add_one(struct Mailbox *m, int n, bool unseen, bool flagged, bool replied)
 {
-  bool unseen_done = false;
-  bool flagged_done = false;
-  bool replied_done = false;
-
-  char *tmpfname = NULL;
-  char sequences[PATH_MAX];
-
-  char seq_unseen[256];
-  char seq_replied[256];
-  char seq_flagged[256];
-
-  char *buf = NULL;
-  size_t sz;
-
-  FILE *fp_new = NULL;
-  if (mh_mkstemp(m, &fp_new, &tmpfname) == -1)
+  MhSeqFlags flags = MH_SEQ_NO_FLAGS;
+  if (unseen)
+    flags |= MH_SEQ_UNSEEN;
+  if (flagged)
+    flags |= MH_SEQ_FLAGGED;
+  if (replied)
+    flags |= MH_SEQ_REPLIED;
+
+  if (flags == MH_SEQ_NO_FLAGS)
     return;
 
-  snprintf(seq_unseen, sizeof(seq_unseen), "%s:", NONULL(C_MhSeqUnseen));
-  snprintf(seq_replied, sizeof(seq_replied), "%s:", NONULL(C_MhSeqReplied));
-  snprintf(seq_flagged, sizeof(seq_flagged), "%s:", NONULL(C_MhSeqFlagged));
+  /* Keep the open Mailbox's sequences in step with the file */
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (mdata)
+    mhs_set(&mdata->mhs, n, flags);
 
-  snprintf(sequences, sizeof(sequences), "%s/.mh_sequences", mailbox_path(m));
-  FILE *fp_old = fopen(sequences, "r");
-  if (fp_old)
+  /* The file may have been changed by another program, so re-read it */
+  struct MhSequences mhs = { 0 };
+  if (mh_read_sequences(&mhs, mailbox_path(m)) == 0)
   {
-    while ((buf = mutt_file_read_line(buf, &sz, fp_old, NULL, 0)))
-    {
-      if (unseen && mutt_strn_equal(buf, seq_unseen, mutt_str_len(seq_unseen)))
-      {
-        fprintf(fp_new, "%s %d\n", buf, n);
-        unseen_done = true;
-      }
-      else if (flagged && mutt_strn_equal(buf, seq_flagged, mutt_str_len(seq_flagged)))
-      {
-        fprintf(fp_new, "%s %d\n", buf, n);
-        flagged_done = true;
-      }
-      else if (replied && mutt_strn_equal(buf, seq_replied, mutt_str_len(seq_replied)))
-      {
-        fprintf(fp_new, "%s %d\n", buf, n);
-        replied_done = true;
-      }
-      else
-        fprintf(fp_new, "%s\n", buf);
-    }
+    mhs_set(&mhs, n, flags);
+    mh_sequences_write(m, &mhs);
   }
-  mutt_file_fclose(&fp_old);
-  FREE(&buf);
-
-  if (!unseen_done && unseen)
-    fprintf(fp_new, "%s: %d\n", NONULL(C_MhSeqUnseen), n);
-  if (!flagged_done && flagged)
-    fprintf(fp_new, "%s: %d\n", NONULL(C_MhSeqFlagged), n);
-  if (!replied_done && replied)
-    fprintf(fp_new, "%s: %d\n", NONULL(C_MhSeqReplied), n);
-
-  mutt_file_fclose(&fp_new);
-
-  unlink(sequences);
-  if (mutt_file_safe_rename(tmpfname, sequences) != 0)
-    unlink(tmpfname);
-
-  FREE(&tmpfname);
+  mhs_sequences_free(&mhs);
 }
 
 /**
@@ -351,6 +339,96 @@ static void maildir_update_mtime(struct Mailbox *m)
     mutt_file_get_stat_timespec(&m->mtime, &st, MUTT_STAT_MTIME);
 }
 
+/**
+ * maildir_entry_parse - Create a Maildir entry from a message's filename
+ * @param m      Mailbox
+ * @param subdir Subdirectory, e.g. 'new', or NULL for MH
+ * @param name   Filename of the message
+ * @param inode  Inode number of the file
+ * @retval ptr New Maildir entry
+ *
+ * Only the filename is examined.  The headers are read later by
+ * maildir_delayed_parsing().
+ */
+struct Maildir *maildir_entry_parse(struct Mailbox *m, const char *subdir,
+                                    const char *name, ino_t inode)
+{
+  struct Email *e = email_new();
+  e->edata = maildir_edata_new();
+  e->edata_free = maildir_edata_free;
+
+  e->old = (subdir && C_MarkOld) ? mutt_str_equal("cur", subdir) : false;
+  if (m->type == MUTT_MAILDIR)
+    maildir_parse_flags(e, name);
+
+  if (subdir)
+  {
+    struct Buffer *buf = mutt_buffer_pool_get();
+    mutt_buffer_printf(buf, "%s/%s", subdir, name);
+    e->path = mutt_buffer_strdup(buf);
+    mutt_buffer_pool_release(&buf);
+  }
+  else
+    e->path = mutt_str_dup(name);
+
+  struct Maildir *entry = maildir_entry_new();
+  entry->email = e;
+  entry->inode = inode;
+  return entry;
+}
+
+/**
+ * struct MaildirDirScan - Private data for maildir_parse_entry()
+ */
+struct MaildirDirScan
+{
+  struct Mailbox *m;          ///< Mailbox being read
+  const char *subdir;         ///< Subdirectory, e.g. 'new', or NULL for MH
+  struct Maildir ***last;     ///< Where to append the next entry
+  int *count;                 ///< Counter for the progress bar
+  struct Progress *progress;  ///< Progress bar
+  size_t entries;             ///< Number of directory entries seen
+};
+
+/**
+ * maildir_parse_entry - Queue a directory entry for parsing - Implements ::mutt_file_dir_t
+ */
+static bool maildir_parse_entry(const char *name, ino_t inode, unsigned char type, void *data)
+{
+  struct MaildirDirScan *scan = data;
+  struct Mailbox *m = scan->m;
+
+  if (SigInt == 1)
+    return false;
+
+  scan->entries++;
+
+  /* A subdirectory can't be a message */
+  if (type == DT_DIR)
+    return true;
+
+  if (((m->type == MUTT_MH) && !mh_valid_message(name)) ||
+      ((m->type == MUTT_MAILDIR) && (*name == '.')))
+  {
+    return true;
+  }
+
+  /* FOO - really ignore the return value? */
+  mutt_debug(LL_DEBUG2, "queueing %s\n", name);
+
+  if (scan->count)
+  {
+    (*scan->count)++;
+    if (m->verbose && scan->progress)
+      mutt_progress_update(scan->progress, *scan->count, -1);
+  }
+
+  struct Maildir *entry = maildir_entry_parse(m, scan->subdir, name, inode);
+  **scan->last = entry;
+  *scan->last = &entry->next;
+  return true;
+}
+
 /**
  * maildir_parse_dir - Read a Maildir mailbox
  * @param[in]  m        Mailbox
@@ -361,83 +439,40 @@ static void maildir_update_mtime(struct Mailbox *m)
  * @retval  0 Success
  * @retval -1 Error
  * @retval -2 Aborted
+ *
+ * Only the directory is read.  The inode numbers come from the directory
+ * entries, so none of the files need to be stat()ed.
  */
 int maildir_parse_dir(struct Mailbox *m, struct Maildir ***last,
                       const char *subdir, int *count, struct Progress *progress)
 {
-  struct dirent *de = NULL;
   int rc = 0;
-  bool is_old = false;
-  struct Maildir *entry = NULL;
-  struct Email *e = NULL;
 
   struct Buffer *buf = mutt_buffer_pool_get();
 
   if (subdir)
-  {
     mutt_buffer_printf(buf, "%s/%s", mailbox_path(m), subdir);
-    is_old = C_MarkOld ? mutt_str_equal("cur", subdir) : false;
-  }
   else
     mutt_buffer_strcpy(buf, mailbox_path(m));
 
-  DIR *dirp = opendir(mutt_b2s(buf));
-  if (!dirp)
-  {
+  struct MaildirDirScan scan = { m, subdir, last, count, progress, 0 };
+  size_t calls = 0;
+  if (mutt_file_read_dir(mutt_b2s(buf), maildir_parse_entry, &scan, &calls) < 0)
     rc = -1;
-    goto cleanup;
-  }
 
-  while (((de = readdir(dirp))) && (SigInt != 1))
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (mdata)
   {
-    if (((m->type == MUTT_MH) && !mh_valid_message(de->d_name)) ||
-        ((m->type == MUTT_MAILDIR) && (*de->d_name == '.')))
-    {
-      continue;
-    }
-
-    /* FOO - really ignore the return value? */
-    mutt_debug(LL_DEBUG2, "queueing %s\n", de->d_name);
-
-    e = email_new();
-    e->edata = maildir_edata_new();
-    e->edata_free = maildir_edata_free;
-
-    e->old = is_old;
-    if (m->type == MUTT_MAILDIR)
-      maildir_parse_flags(e, de->d_name);
-
-    if (count)
-    {
-      (*count)++;
-      if (m->verbose && progress)
-        mutt_progress_update(progress, *count, -1);
-    }
-
-    if (subdir)
-    {
-      mutt_buffer_printf(buf, "%s/%s", subdir, de->d_name);
-      e->path = mutt_buffer_strdup(buf);
-    }
-    else
-      e->path = mutt_str_dup(de->d_name);
-
-    entry = maildir_entry_new();
-    entry->email = e;
-    entry->inode = de->d_ino;
-    **last = entry;
-    *last = &entry->next;
+    mdata->scan.entries += scan.entries;
+    mdata->scan.dir_calls += calls;
   }
 
-  closedir(dirp);
-
   if (SigInt == 1)
   {
     SigInt = 0;
-    return -2; /* action aborted */
+    rc = -2; /* action aborted */
   }
 
-cleanup:
   mutt_buffer_pool_release(&buf);
 
   return rc;
@@ -510,7 +545,7 @@ size_t maildir_hcache_keylen(const char *fn)
  */
 static int md_cmp_inode(struct Maildir *a, struct Maildir *b)
 {
-  return a->inode - b->inode;
+  return (a->inode > b->inode) - (a->inode < b->inode);
 }
 
 /**
@@ -622,6 +657,24 @@ static struct Maildir *maildir_ins_sort(struct Maildir *list,
   return ret;
 }
 
+/**
+ * maildir_is_sorted - Is a Maildir list already in order?
+ * @param list Maildirs to check
+ * @param cmp  Comparison function for sorting
+ * @retval true The list doesn't need sorting
+ */
+static bool maildir_is_sorted(struct Maildir *list,
+                              int (*cmp)(struct Maildir *, struct Maildir *))
+{
+  for (; list && list->next; list = list->next)
+  {
+    if (cmp(list, list->next) > 0)
+      return false;
+  }
+
+  return true;
+}
+
 /**
  * maildir_sort - Sort Maildir list
  * @param list    Maildirs to sort
@@ -702,111 +755,726 @@ static struct Maildir *skip_duplicates(struct Maildir *p, struct Maildir **last)
 }
 
 /**
- * maildir_delayed_parsing - This function does the second parsing pass
- * @param[in]  m  Mailbox
- * @param[out] md Maildir to parse
- * @param[in]  progress Progress bar
+ * maildir_parse_job - Read one message for maildir_delayed_parsing() - Implements ::workqueue_job_t
+ *
+ * If there's a cached Email, check the file hasn't changed since it was
+ * stored.  Otherwise, parse the message file.
+ *
+ * @note This may be run on a worker thread
+ */
+static void maildir_parse_job(void *data)
+{
+  struct MaildirParseJob *job = data;
+
+#ifdef USE_HCACHE
+  /* The uidvalidity is the file's mtime when it was cached */
+  if (job->hce.email)
+  {
+    time_t mtime = 0;
+    job->stat = true;
+    if ((mutt_file_get_mtime(mutt_b2s(&job->path), &mtime) == 0) &&
+        (mtime <= job->hce.uidvalidity))
+    {
+      job->use_cache = true;
+      return;
+    }
+  }
+#endif
+
+  job->opened = true;
+  job->parsed = (maildir_parse_file(job->type, mutt_b2s(&job->path), job->md->email->old,
+                                    job->md->email, &job->header) != NULL);
+}
+
+#ifdef USE_HCACHE
+/**
+ * maildir_hcache_entry_free - Free a cached entry - Implements ::hash_hdata_free_t
+ */
+static void maildir_hcache_entry_free(int type, void *obj, intptr_t data)
+{
+  struct HCacheEntry *hce = obj;
+  mutt_hcache_entry_free(hce);
+  FREE(&hce);
+}
+
+/**
+ * maildir_hcache_scan - Keep an entry from the header cache - Implements ::hcache_scan_t
+ */
+static bool maildir_hcache_scan(const char *key, size_t keylen,
+                                struct HCacheEntry *hce, void *data)
+{
+  struct HashTable *cache = data;
+
+  struct HCacheEntry *copy = mutt_mem_malloc(sizeof(struct HCacheEntry));
+  *copy = *hce;
+  if (!mutt_hash_insert(cache, key, copy))
+    maildir_hcache_entry_free(0, copy, 0);
+
+  return true;
+}
+
+/**
+ * maildir_hcache_load - Read a whole folder from the header cache
+ * @param hc   Header cache handle
+ * @param type Mailbox type, #MUTT_MAILDIR or #MUTT_MH
+ * @param num  Expected number of messages
+ * @retval ptr  Hash Table of lazy HCacheEntry, keyed like the header cache
+ * @retval NULL The header cache can't be read in one pass
+ *
+ * Maildir keys start with a '/', which keeps folders like "inbox2" out of
+ * a scan of "inbox".  MH keys are just the message number.
+ */
+static struct HashTable *maildir_hcache_load(struct HeaderCache *hc,
+                                             enum MailboxType type, size_t num)
+{
+  struct HashTable *cache = mutt_hash_new(MAX(num, 1024), MUTT_HASH_STRDUP_KEYS);
+  mutt_hash_set_destructor(cache, maildir_hcache_entry_free, 0);
+
+  const char *prefix = (type == MUTT_MH) ? NULL : "/";
+  if (mutt_hcache_fetch_all(hc, prefix, prefix ? 1 : 0, 0, true, maildir_hcache_scan, cache) < 0)
+    mutt_hash_free(&cache);
+
+  return cache;
+}
+
+/**
+ * maildir_hcache_take - Take an entry from the preloaded header cache
+ * @param cache  Hash Table from maildir_hcache_load()
+ * @param key    Message identification string
+ * @param keylen Length of the key
+ * @retval obj HCacheEntry, empty if the message isn't cached
+ */
+static struct HCacheEntry maildir_hcache_take(struct HashTable *cache,
+                                              const char *key, size_t keylen)
+{
+  struct HCacheEntry hce = { 0 };
+
+  char buf[PATH_MAX];
+  mutt_strn_copy(buf, key, keylen, sizeof(buf));
+
+  struct HCacheEntry *found = mutt_hash_find(cache, buf);
+  if (found)
+  {
+    hce = *found;
+    memset(found, 0, sizeof(struct HCacheEntry));
+    mutt_hash_delete(cache, buf, found);
+  }
+
+  return hce;
+}
+
+/**
+ * struct MaildirSnapshot - A directory listing, stored in the header cache
+ *
+ * The header is followed by @a count entries, each a 64-bit inode number and
+ * a NUL-terminated filename.  The entries are in inode order.
+ */
+struct MaildirSnapshot
+{
+  uint32_t uidvalidity; ///< Always 0, so the record can't be decoded as an Email
+  uint32_t magic;       ///< #MAILDIR_SNAPSHOT_MAGIC
+  uint64_t dev;         ///< Device of the directory
+  uint64_t ino;         ///< Inode of the directory
+  int64_t mtime_sec;    ///< Modification time of the directory
+  int64_t mtime_nsec;   ///< Modification time of the directory (nanoseconds)
+  uint64_t count;       ///< Number of entries
+};
+
+/**
+ * maildir_snapshot_key - Generate the header cache key of a directory snapshot
+ * @param buf    Buffer for the result
+ * @param subdir Subdirectory, e.g. 'cur'
+ *
+ * A message's key is its filename after the subdirectory, e.g. "/name" for
+ * a Maildir, or just "name" for MH.  A filename can't contain a '/', so no
+ * message key has a second one, unlike "/SNAPSHOT/cur".
+ */
+static void maildir_snapshot_key(struct Buffer *buf, const char *subdir)
+{
+  mutt_buffer_printf(buf, "/SNAPSHOT/%s", subdir);
+}
+
+/**
+ * maildir_snapshot_matches - Does a snapshot describe a directory?
+ * @param snap Snapshot header
+ * @param st   Directory's stat info, taken before it was read
+ * @retval true The directory hasn't changed since the snapshot was taken
+ */
+static bool maildir_snapshot_matches(const struct MaildirSnapshot *snap,
+                                     const struct stat *st)
+{
+  struct timespec ts = { 0 };
+  mutt_file_get_stat_timespec(&ts, (struct stat *) st, MUTT_STAT_MTIME);
+
+  return (snap->dev == (uint64_t) st->st_dev) && (snap->ino == (uint64_t) st->st_ino) &&
+         (snap->mtime_sec == (int64_t) ts.tv_sec) &&
+         (snap->mtime_nsec == (int64_t) ts.tv_nsec);
+}
+
+/**
+ * maildir_snapshot_next - Read the next entry of a snapshot
+ * @param[in,out] pos   Current position, moved past the entry
+ * @param[in]     end   End of the snapshot
+ * @param[out]    inode Inode number of the file
+ * @retval ptr  Filename
+ * @retval NULL The snapshot is truncated
+ */
+static const char *maildir_snapshot_next(const char **pos, const char *end, ino_t *inode)
+{
+  uint64_t ino = 0;
+  if ((end - *pos) < (ptrdiff_t) sizeof(ino))
+    return NULL;
+
+  memcpy(&ino, *pos, sizeof(ino));
+  const char *name = *pos + sizeof(ino);
+  const char *nul = memchr(name, '\0', end - name);
+  if (!nul)
+    return NULL;
+
+  *inode = ino;
+  *pos = nul + 1;
+  return name;
+}
+
+/**
+ * maildir_snapshot_load - Read a directory listing from a snapshot
+ * @param[in]  m      Mailbox
+ * @param[in]  hc     Header cache handle
+ * @param[in]  subdir Subdirectory, e.g. 'cur'
+ * @param[in]  st     Directory's stat info, taken before it was read
+ * @param[out] last   Where to append the entries
+ * @param[out] count  Number of entries added
+ * @retval true The directory is unchanged and its entries have been added
+ */
+static bool maildir_snapshot_load(struct Mailbox *m, struct HeaderCache *hc,
+                                  const char *subdir, const struct stat *st,
+                                  struct Maildir ***last, int *count)
+{
+  struct Buffer *key = mutt_buffer_pool_get();
+  maildir_snapshot_key(key, subdir);
+
+  size_t dlen = 0;
+  void *data = mutt_hcache_fetch_raw(hc, mutt_b2s(key), mutt_buffer_len(key), &dlen);
+  mutt_buffer_pool_release(&key);
+  if (!data)
+    return false;
+
+  struct MaildirSnapshot snap = { 0 };
+  bool rc = false;
+  if (dlen >= sizeof(snap))
+    memcpy(&snap, data, sizeof(snap));
+  if ((snap.magic != MAILDIR_SNAPSHOT_MAGIC) || !maildir_snapshot_matches(&snap, st))
+    goto done;
+
+  const char *pos = (const char *) data + sizeof(snap);
+  const char *end = (const char *) data + dlen;
+  struct Maildir *md = NULL;
+  struct Maildir **tail = &md;
+  for (uint64_t i = 0; i < snap.count; i++)
+  {
+    ino_t inode = 0;
+    const char *name = maildir_snapshot_next(&pos, end, &inode);
+    if (!name)
+    {
+      maildir_free(&md);
+      goto done;
+    }
+
+    *tail = maildir_entry_parse(m, subdir, name, inode);
+    tail = &(*tail)->next;
+  }
+
+  **last = md;
+  *last = tail;
+  *count += snap.count;
+  rc = true;
+
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (mdata)
+    mdata->scan.entries += snap.count;
+  mutt_debug(LL_DEBUG2, "%s/%s is unchanged, using the snapshot of %" PRIu64 " files\n",
+             mailbox_path(m), subdir, snap.count);
+
+done:
+  mutt_hcache_free_raw(hc, &data);
+  return rc;
+}
+
+/**
+ * maildir_snapshot_merge - Put a directory listing in inode order, using a snapshot
+ * @param m      Mailbox
+ * @param hc     Header cache handle
+ * @param subdir Subdirectory, e.g. 'cur'
+ * @param md     Maildir list, as read from the directory
+ * @retval ptr Maildir list, sorted by inode
+ *
+ * Files that were in the previous snapshot are already in order, so only the
+ * new files need to be sorted.
+ */
+static struct Maildir *maildir_snapshot_merge(struct Mailbox *m, struct HeaderCache *hc,
+                                              const char *subdir, struct Maildir *md)
+{
+  struct Buffer *key = mutt_buffer_pool_get();
+  maildir_snapshot_key(key, subdir);
+
+  size_t dlen = 0;
+  void *data = mutt_hcache_fetch_raw(hc, mutt_b2s(key), mutt_buffer_len(key), &dlen);
+
+  struct MaildirSnapshot snap = { 0 };
+  if (data && (dlen >= sizeof(snap)))
+    memcpy(&snap, data, sizeof(snap));
+  if (snap.magic != MAILDIR_SNAPSHOT_MAGIC)
+  {
+    mutt_hcache_free_raw(hc, &data);
+    mutt_buffer_pool_release(&key);
+    return maildir_sort(md, (size_t) -1, md_cmp_inode);
+  }
+
+  struct HashTable *files = mutt_hash_new(MAX(snap.count, 64), MUTT_HASH_NO_FLAGS);
+  for (struct Maildir *p = md; p; p = p->next)
+    mutt_hash_insert(files, p->email->path, p);
+
+  /* Pick out the files the snapshot already knows about, in its order.
+   * Each entry is at least nine bytes, which limits a corrupt count. */
+  size_t max = MIN(snap.count, (dlen - sizeof(snap)) / (sizeof(uint64_t) + 1));
+  struct Maildir **known = mutt_mem_calloc(MAX(max, 1), sizeof(struct Maildir *));
+  const char *pos = (const char *) data + sizeof(snap);
+  const char *end = (const char *) data + dlen;
+  size_t num_known = 0;
+  for (size_t i = 0; i < max; i++)
+  {
+    ino_t inode = 0;
+    const char *name = maildir_snapshot_next(&pos, end, &inode);
+    if (!name)
+      break;
+
+    mutt_buffer_printf(key, "%s/%s", subdir, name);
+    struct Maildir *p = mutt_hash_find(files, mutt_b2s(key));
+    if (!p || (p->inode != inode))
+      continue;
+
+    mutt_hash_delete(files, mutt_b2s(key), p);
+    known[num_known++] = p;
+  }
+
+  /* Anything left in the table is new */
+  struct Maildir *added = NULL;
+  struct Maildir **tail = &added;
+  size_t num_added = 0;
+  for (struct Maildir *p = md, *next = NULL; p; p = next)
+  {
+    next = p->next;
+    if (mutt_hash_find(files, p->email->path) != p)
+      continue;
+    *tail = p;
+    tail = &p->next;
+    num_added++;
+  }
+  *tail = NULL;
+
+  for (size_t i = 0; i < num_known; i++)
+    known[i]->next = ((i + 1) < num_known) ? known[i + 1] : NULL;
+  md = (num_known > 0) ? known[0] : NULL;
+  FREE(&known);
+
+  mutt_debug(LL_DEBUG2, "%s/%s: %zu files from the snapshot, %zu new\n",
+             mailbox_path(m), subdir, num_known, num_added);
+
+  mutt_hash_free(&files);
+  mutt_hcache_free_raw(hc, &data);
+  mutt_buffer_pool_release(&key);
+
+  added = maildir_sort(added, (size_t) -1, md_cmp_inode);
+  return maildir_merge_lists(md, added, md_cmp_inode);
+}
+
+/**
+ * maildir_snapshot_save - Save a directory listing in the header cache
+ * @param hc     Header cache handle
+ * @param subdir Subdirectory, e.g. 'cur'
+ * @param st     Directory's stat info, taken before it was read
+ * @param md     Maildir list, sorted by inode
+ *
+ * If the directory was changed in the last second, another change may follow
+ * without altering its mtime, so the snapshot isn't saved.
+ */
+static void maildir_snapshot_save(struct HeaderCache *hc, const char *subdir,
+                                  const struct stat *st, struct Maildir *md)
+{
+  if (st->st_mtime >= (mutt_date_epoch() - 1))
+    return;
+
+  struct timespec ts = { 0 };
+  mutt_file_get_stat_timespec(&ts, (struct stat *) st, MUTT_STAT_MTIME);
+
+  struct MaildirSnapshot snap = { 0 };
+  snap.magic = MAILDIR_SNAPSHOT_MAGIC;
+  snap.dev = st->st_dev;
+  snap.ino = st->st_ino;
+  snap.mtime_sec = ts.tv_sec;
+  snap.mtime_nsec = ts.tv_nsec;
+
+  size_t len = sizeof(snap);
+  for (struct Maildir *p = md; p; p = p->next)
+  {
+    len += sizeof(uint64_t) + mutt_str_len(p->email->path) + 1;
+    snap.count++;
+  }
+
+  char *data = mutt_mem_malloc(len);
+  memcpy(data, &snap, sizeof(snap));
+  char *pos = data + sizeof(snap);
+  const size_t skip = mutt_str_len(subdir) + 1;
+  for (struct Maildir *p = md; p; p = p->next)
+  {
+    uint64_t ino = p->inode;
+    memcpy(pos, &ino, sizeof(ino));
+    pos += sizeof(ino);
+    size_t nlen = mutt_str_len(p->email->path + skip) + 1;
+    memcpy(pos, p->email->path + skip, nlen);
+    pos += nlen;
+  }
+
+  struct Buffer *key = mutt_buffer_pool_get();
+  maildir_snapshot_key(key, subdir);
+  mutt_hcache_store_raw(hc, mutt_b2s(key), mutt_buffer_len(key), data, pos - data);
+  mutt_buffer_pool_release(&key);
+  FREE(&data);
+}
+#endif
+
+/**
+ * maildir_parse_batch - Read a batch of messages
+ * @param m    Mailbox
+ * @param hc    Header cache handle
+ * @param cache Preloaded header cache entries, may be NULL
+ * @param wq    WorkQueue to read the messages
+ * @param jobs  Messages to read
+ * @param num   Number of messages
+ *
+ * The header cache is only read and written by the calling thread.  The
+ * WorkQueue does the stat()s and parsing, then the results are applied in
+ * order, and any new cache entries are written as one batch.
+ */
+static void maildir_parse_batch(struct Mailbox *m, struct HeaderCache *hc,
+                                struct HashTable *cache, struct WorkQueue *wq,
+                                struct MaildirParseJob *jobs, int num)
+{
+  for (int i = 0; i < num; i++)
+  {
+    struct MaildirParseJob *job = &jobs[i];
+    struct Maildir *p = job->md;
+
+    job->type = m->type;
+    job->use_cache = false;
+    job->parsed = false;
+    job->stat = false;
+    job->opened = false;
+    mutt_buffer_printf(&job->path, "%s/%s", mailbox_path(m), p->email->path);
+
+#ifdef USE_HCACHE
+    const char *key = NULL;
+    size_t keylen = 0;
+    if (m->type == MUTT_MH)
+    {
+      key = p->email->path;
+      keylen = strlen(key);
+    }
+    else
+    {
+      key = p->email->path + 3;
+      keylen = maildir_hcache_keylen(key);
+    }
+    /* The Envelope and Body are only decoded if the entry is still valid */
+    if (cache)
+      job->hce = maildir_hcache_take(cache, key, keylen);
+    else
+      job->hce = mutt_hcache_fetch_lazy(hc, key, keylen, 0);
+
+    if (job->hce.email && !C_MaildirHeaderCacheVerify)
+    {
+      job->use_cache = true;
+      continue;
+    }
+#endif
+
+    mutt_workqueue_add(wq, maildir_parse_job, job);
+  }
+
+  mutt_workqueue_wait(wq);
+
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  for (int i = 0; mdata && (i < num); i++)
+  {
+    mdata->scan.stats += jobs[i].stat;
+    mdata->scan.opens += jobs[i].opened;
+  }
+
+#ifdef USE_HCACHE
+  /* Write the whole batch to the cache at once */
+  mutt_hcache_begin(hc);
+#endif
+
+  for (int i = 0; i < num; i++)
+  {
+    struct MaildirParseJob *job = &jobs[i];
+    struct Maildir *p = job->md;
+
+#ifdef USE_HCACHE
+    if (job->use_cache)
+    {
+      mutt_hcache_entry_restore(&job->hce);
+      struct Email *e = job->hce.email;
+      job->hce.email = NULL;
+      e->edata = maildir_edata_new();
+      e->edata_free = maildir_edata_free;
+      e->old = p->email->old;
+      e->path = mutt_str_dup(p->email->path);
+      email_free(&p->email);
+      p->email = e;
+      if (m->type == MUTT_MAILDIR)
+        maildir_parse_flags(p->email, mutt_b2s(&job->path));
+      continue;
+    }
+
+    mutt_hcache_entry_free(&job->hce);
+#endif
+
+    if (job->parsed)
+    {
+      p->header_parsed = true;
+#ifdef USE_HCACHE
+      const char *key = NULL;
+      size_t keylen = 0;
+      if (m->type == MUTT_MH)
+      {
+        key = p->email->path;
+        keylen = strlen(key);
+      }
+      else
+      {
+        key = p->email->path + 3;
+        keylen = maildir_hcache_keylen(key);
+      }
+      mutt_hcache_store(hc, key, keylen, p->email, 0);
+#endif
+    }
+    else
+      email_free(&p->email);
+  }
+
+#ifdef USE_HCACHE
+  mutt_hcache_commit(hc);
+#endif
+}
+
+/**
+ * maildir_parse_list - Read the headers of a Maildir list
+ * @param[in]  m        Mailbox
+ * @param[out] md       Maildir to parse
+ * @param[in]  progress Progress bar
+ * @param[in]  hc       Header cache handle, may be NULL
+ *
+ * The messages are read in batches.  If $maildir_parse_threads is set, each
+ * batch is shared between that many threads.
+ */
+static void maildir_parse_list(struct Mailbox *m, struct Maildir **md,
+                               struct Progress *progress, struct HeaderCache *hc)
+{
+  struct Maildir *p = NULL, *last = NULL;
+  int count;
+  bool sort = false;
+  int num_jobs = 0;
+
+  struct HashTable *cache = NULL;
+#ifdef USE_HCACHE
+  /* When the mailbox is being opened, read the whole cache in one pass,
+   * unless there are only a few messages to look up, e.g. in new/.  If the
+   * mailbox is being read in batches, the entries are kept for the later
+   * batches, see mh_mbox_load(). */
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (hc && mdata && mdata->pending_hce)
+  {
+    cache = mdata->pending_hce;
+  }
+  else if (hc && (m->msg_count == 0))
+  {
+    size_t num = 0;
+    for (p = *md; p; p = p->next)
+      num++;
+    for (p = mdata ? mdata->pending : NULL; p; p = p->next)
+      num++;
+    if (num >= MAILDIR_PARSE_BATCH)
+      cache = maildir_hcache_load(hc, m->type, num);
+  }
+#endif
+
+  struct WorkQueue *wq = mutt_workqueue_new(C_MaildirParseThreads);
+  struct MaildirParseJob *jobs =
+      mutt_mem_calloc(MAILDIR_PARSE_BATCH, sizeof(struct MaildirParseJob));
+
+  for (p = *md, count = 0; p; p = p->next, count++)
+  {
+    if (!(p && p->email && !p->header_parsed))
+    {
+      last = p;
+      continue;
+    }
+
+    if (!sort)
+    {
+      if (!maildir_is_sorted(p, md_cmp_inode))
+      {
+        mutt_debug(LL_DEBUG3, "maildir: need to sort %s by inode\n", mailbox_path(m));
+        p = maildir_sort(p, (size_t) -1, md_cmp_inode);
+      }
+      if (last)
+        last->next = p;
+      else
+        *md = p;
+      sort = true;
+      p = skip_duplicates(p, &last);
+    }
+
+    jobs[num_jobs++].md = p;
+    if (num_jobs == MAILDIR_PARSE_BATCH)
+    {
+      maildir_parse_batch(m, hc, cache, wq, jobs, num_jobs);
+      num_jobs = 0;
+
+      if (m->verbose && progress)
+        mutt_progress_update(progress, count, -1);
+    }
+
+    last = p;
+  }
+
+  maildir_parse_batch(m, hc, cache, wq, jobs, num_jobs);
+
+  for (int i = 0; i < MAILDIR_PARSE_BATCH; i++)
+  {
+    mutt_buffer_dealloc(&jobs[i].path);
+    mutt_buffer_dealloc(&jobs[i].header);
+  }
+  FREE(&jobs);
+  mutt_workqueue_free(&wq);
+
+#ifdef USE_HCACHE
+  if (m->loading && mdata)
+    mdata->pending_hce = cache;
+  else
+    mutt_hash_free(&cache);
+#endif
+
+  mh_sort_natural(m, md);
+}
+
+/**
+ * maildir_delayed_parsing - This function does the second parsing pass
+ * @param[in]  m  Mailbox
+ * @param[out] md Maildir to parse
+ * @param[in]  progress Progress bar
+ */
+void maildir_delayed_parsing(struct Mailbox *m, struct Maildir **md, struct Progress *progress)
+{
+  struct HeaderCache *hc = NULL;
+#ifdef USE_HCACHE
+  hc = mutt_hcache_open(C_HeaderCache, mailbox_path(m), NULL);
+#endif
+
+  maildir_parse_list(m, md, progress, hc);
+
+#ifdef USE_HCACHE
+  mutt_hcache_close(hc);
+#endif
+}
+
+/**
+ * maildir_split - Split a Maildir list in two
+ * @param md  Maildir list, truncated to num entries
+ * @param num Number of entries to keep
+ * @retval ptr Remaining entries, or NULL
+ */
+static struct Maildir *maildir_split(struct Maildir **md, int num)
+{
+  struct Maildir **p = md;
+  for (; *p && (num > 0); num--)
+    p = &(*p)->next;
+
+  struct Maildir *rest = *p;
+  *p = NULL;
+  return rest;
+}
+
+/**
+ * maildir_pending_update - Replace the unread entries of a loading Mailbox
+ * @param m        Mailbox
+ * @param md       Entries just found that aren't in the Mailbox, consumed
+ * @param scan_new The 'new' directory was scanned
+ * @param scan_cur The 'cur' directory was scanned
+ *
+ * While a Mailbox is being read in batches, a check compares the directory
+ * with the Emails already read.  The pending entries from the directories
+ * that were scanned are replaced by the ones that were found, which also
+ * picks up new arrivals.  An MH folder is always scanned completely.
  */
-void maildir_delayed_parsing(struct Mailbox *m, struct Maildir **md, struct Progress *progress)
+void maildir_pending_update(struct Mailbox *m, struct Maildir **md, bool scan_new, bool scan_cur)
 {
-  struct Maildir *p = NULL, *last = NULL;
-  char fn[PATH_MAX];
-  int count;
-  bool sort = false;
-
-#ifdef USE_HCACHE
-  struct HeaderCache *hc = mutt_hcache_open(C_HeaderCache, mailbox_path(m), NULL);
-#endif
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (!mdata || !md)
+    return;
 
-  for (p = *md, count = 0; p; p = p->next, count++)
+  struct Maildir **pp = &mdata->pending;
+  while (*pp)
   {
-    if (!(p && p->email && !p->header_parsed))
+    struct Maildir *p = *pp;
+    const char *path = p->email ? p->email->path : "";
+    if ((m->type == MUTT_MH) || (scan_new && mutt_strn_equal(path, "new/", 4)) ||
+        (scan_cur && mutt_strn_equal(path, "cur/", 4)))
     {
-      last = p;
+      *pp = p->next;
+      maildir_entry_free(&p);
       continue;
     }
+    pp = &p->next;
+  }
 
-    if (m->verbose && progress)
-      mutt_progress_update(progress, count, -1);
-
-    if (!sort)
-    {
-      mutt_debug(LL_DEBUG3, "maildir: need to sort %s by inode\n", mailbox_path(m));
-      p = maildir_sort(p, (size_t) -1, md_cmp_inode);
-      if (last)
-        last->next = p;
-      else
-        *md = p;
-      sort = true;
-      p = skip_duplicates(p, &last);
-      snprintf(fn, sizeof(fn), "%s/%s", mailbox_path(m), p->email->path);
-    }
-
-    snprintf(fn, sizeof(fn), "%s/%s", mailbox_path(m), p->email->path);
-
-#ifdef USE_HCACHE
-    struct stat lastchanged = { 0 };
-    int rc = 0;
-    if (C_MaildirHeaderCacheVerify)
-    {
-      rc = stat(fn, &lastchanged);
-    }
-
-    const char *key = NULL;
-    size_t keylen = 0;
-    if (m->type == MUTT_MH)
+  while (*md)
+  {
+    struct Maildir *p = *md;
+    *md = p->next;
+    p->next = NULL;
+    if (p->email)
     {
-      key = p->email->path;
-      keylen = strlen(key);
+      *pp = p;
+      pp = &p->next;
     }
     else
     {
-      key = p->email->path + 3;
-      keylen = maildir_hcache_keylen(key);
+      maildir_entry_free(&p);
     }
-    struct HCacheEntry hce = mutt_hcache_fetch(hc, key, keylen, 0);
+  }
+}
 
-    if (hce.email && (rc == 0) && (lastchanged.st_mtime <= hce.uidvalidity))
-    {
-      hce.email->edata = maildir_edata_new();
-      hce.email->edata_free = maildir_edata_free;
-      hce.email->old = p->email->old;
-      hce.email->path = mutt_str_dup(p->email->path);
-      email_free(&p->email);
-      p->email = hce.email;
-      if (m->type == MUTT_MAILDIR)
-        maildir_parse_flags(p->email, fn);
-    }
-    else
-#endif
-    {
-      if (maildir_parse_message(m->type, fn, p->email->old, p->email))
-      {
-        p->header_parsed = true;
-#ifdef USE_HCACHE
-        if (m->type == MUTT_MH)
-        {
-          key = p->email->path;
-          keylen = strlen(key);
-        }
-        else
-        {
-          key = p->email->path + 3;
-          keylen = maildir_hcache_keylen(key);
-        }
-        mutt_hcache_store(hc, key, keylen, p->email, 0);
-#endif
-      }
-      else
-        email_free(&p->email);
-    }
-    last = p;
+/**
+ * maildir_read_list - Read the headers of a Maildir list into the Mailbox
+ * @param m        Mailbox
+ * @param md       Maildir list, consumed
+ * @param progress Progress bar, may be NULL
+ * @param hc       Header cache handle, may be NULL
+ */
+static void maildir_read_list(struct Mailbox *m, struct Maildir **md,
+                              struct Progress *progress, struct HeaderCache *hc)
+{
+  maildir_parse_list(m, md, progress, hc);
+
+  if (m->type == MUTT_MH)
+  {
+    struct MaildirMboxData *mdata = maildir_mdata_get(m);
+    mh_update_maildir(*md, &mdata->mhs);
   }
-#ifdef USE_HCACHE
-  mutt_hcache_close(hc);
-#endif
 
-  mh_sort_natural(m, md);
+  maildir_move_to_mailbox(m, md);
 }
 
 /**
@@ -823,7 +1491,6 @@ int mh_read_dir(struct Mailbox *m, const char *subdir)
     return -1;
 
   struct Maildir *md = NULL;
-  struct MhSequences mhs = { 0 };
   struct Maildir **last = NULL;
   struct Progress progress;
 
@@ -834,42 +1501,108 @@ int mh_read_dir(struct Mailbox *m, const char *subdir)
     mutt_progress_init(&progress, msg, MUTT_PROGRESS_READ, 0);
   }
 
-  struct MaildirMboxData *mdata = maildir_mdata_get(m);
-  if (!mdata)
-  {
-    mdata = maildir_mdata_new();
-    m->mdata = mdata;
-    m->mdata_free = maildir_mdata_free;
-  }
+  struct MaildirMboxData *mdata = maildir_mdata_init(m);
 
+  /* Any Emails we knew about have been freed */
+  mutt_hash_free(&mdata->canon);
+  memset(&mdata->scan, 0, sizeof(mdata->scan));
   maildir_update_mtime(m);
 
   md = NULL;
   last = &md;
   int count = 0;
-  if (maildir_parse_dir(m, &last, subdir, &count, &progress) < 0)
-    return -1;
 
-  if (m->verbose)
+  struct HeaderCache *hc = NULL;
+#ifdef USE_HCACHE
+  /* A Maildir directory that hasn't changed is listed from its snapshot */
+  struct stat st = { 0 };
+  bool snapshot = false;
+  if ((m->type == MUTT_MAILDIR) && subdir)
   {
-    char msg[PATH_MAX];
-    snprintf(msg, sizeof(msg), _("Reading %s..."), mailbox_path(m));
-    mutt_progress_init(&progress, msg, MUTT_PROGRESS_READ, count);
+    hc = mutt_hcache_open(C_HeaderCache, mailbox_path(m), NULL);
+    struct Buffer *buf = mutt_buffer_pool_get();
+    mutt_buffer_printf(buf, "%s/%s", mailbox_path(m), subdir);
+    snapshot = hc && (stat(mutt_b2s(buf), &st) == 0);
+    mutt_buffer_pool_release(&buf);
+  }
+
+  if (!snapshot || !maildir_snapshot_load(m, hc, subdir, &st, &last, &count))
+#endif
+  {
+    if (maildir_parse_dir(m, &last, subdir, &count, &progress) < 0)
+    {
+      maildir_free(&md);
+#ifdef USE_HCACHE
+      mutt_hcache_close(hc);
+#endif
+      return -1;
+    }
+
+#ifdef USE_HCACHE
+    if (snapshot)
+    {
+      md = maildir_snapshot_merge(m, hc, subdir, md);
+      maildir_snapshot_save(hc, subdir, &st, md);
+    }
+#endif
   }
-  maildir_delayed_parsing(m, &md, &progress);
 
+  /* The sequences are kept until every Email has been read */
   if (m->type == MUTT_MH)
   {
-    if (mh_read_sequences(&mhs, mailbox_path(m)) < 0)
+    mhs_sequences_free(&mdata->mhs);
+    mdata->mhs_dirty = false;
+    if (mh_read_sequences(&mdata->mhs, mailbox_path(m)) < 0)
     {
       maildir_free(&md);
+#ifdef USE_HCACHE
+      mutt_hcache_close(hc);
+#endif
       return -1;
     }
-    mh_update_maildir(md, &mhs);
-    mhs_sequences_free(&mhs);
   }
 
-  maildir_move_to_mailbox(m, &md);
+  /* When the Mailbox is opened progressively, only the first batch is read
+   * now.  The rest is kept for mh_mbox_load(). */
+  if (m->load_batch > 0)
+  {
+    struct Maildir *rest = maildir_split(&md, MAX(m->load_batch - m->msg_count, 0));
+    if (rest)
+    {
+      struct Maildir **tail = &mdata->pending;
+      while (*tail)
+        tail = &(*tail)->next;
+      *tail = rest;
+      m->loading = true;
+      count = MIN(count, m->load_batch);
+    }
+  }
+
+  if (md)
+  {
+    if (m->verbose)
+    {
+      char msg[PATH_MAX];
+      snprintf(msg, sizeof(msg), _("Reading %s..."), mailbox_path(m));
+      mutt_progress_init(&progress, msg, MUTT_PROGRESS_READ, count);
+    }
+
+#ifdef USE_HCACHE
+    if (!hc)
+      hc = mutt_hcache_open(C_HeaderCache, mailbox_path(m), NULL);
+#endif
+    maildir_read_list(m, &md, &progress, hc);
+  }
+#ifdef USE_HCACHE
+  mutt_hcache_close(hc);
+#endif
+
+  if ((m->type == MUTT_MH) && !m->loading)
+    mh_sequences_load(m);
+
+  mutt_debug(LL_DEBUG1, "%s%s%s: %zu entries, %zu directory reads, %zu stats, %zu opens\n",
+             mailbox_path(m), subdir ? "/" : "", NONULL(subdir), mdata->scan.entries,
+             mdata->scan.dir_calls, mdata->scan.stats, mdata->scan.opens);
 
   if (!mdata->mh_umask)
     mdata->mh_umask = mh_umask(m);
@@ -1304,19 +2037,20 @@ void maildir_parse_flags(struct Email *e, const char *path)
 }
 
 /**
- * maildir_parse_stream - Parse a Maildir message
+ * maildir_parse_header - Parse the header of a Maildir message
  * @param type   Mailbox type, e.g. #MUTT_MAILDIR
- * @param fp     Message file handle
+ * @param fp     Stream, positioned at the start of the message
+ * @param size   Size of the message file
  * @param fname  Message filename
  * @param is_old true, if the email is old (read)
- * @param e      Email
+ * @param e      Email (OPTIONAL)
  * @retval ptr Populated Email
  *
- * Actually parse a maildir message.  This may also be used to fill
- * out a fake header structure generated by lazy maildir parsing.
+ * Only the header is read from the stream.  The length of the body is
+ * calculated from the size of the file.
  */
-struct Email *maildir_parse_stream(enum MailboxType type, FILE *fp,
-                                   const char *fname, bool is_old, struct Email *e)
+static struct Email *maildir_parse_header(enum MailboxType type, FILE *fp, off_t size,
+                                          const char *fname, bool is_old, struct Email *e)
 {
   if (!e)
   {
@@ -1326,14 +2060,11 @@ struct Email *maildir_parse_stream(enum MailboxType type, FILE *fp,
   }
   e->env = mutt_rfc822_read_header(fp, e, false, false);
 
-  struct stat st;
-  fstat(fileno(fp), &st);
-
   if (!e->received)
     e->received = e->date_sent;
 
   /* always update the length since we have fresh information available. */
-  e->content->length = st.st_size - e->content->offset;
+  e->content->length = size - e->content->offset;
 
   e->index = -1;
 
@@ -1348,6 +2079,27 @@ struct Email *maildir_parse_stream(enum MailboxType type, FILE *fp,
   return e;
 }
 
+/**
+ * maildir_parse_stream - Parse a Maildir message
+ * @param type   Mailbox type, e.g. #MUTT_MAILDIR
+ * @param fp     Message file handle
+ * @param fname  Message filename
+ * @param is_old true, if the email is old (read)
+ * @param e      Email
+ * @retval ptr Populated Email
+ *
+ * Actually parse a maildir message.  This may also be used to fill
+ * out a fake header structure generated by lazy maildir parsing.
+ */
+struct Email *maildir_parse_stream(enum MailboxType type, FILE *fp,
+                                   const char *fname, bool is_old, struct Email *e)
+{
+  struct stat st = { 0 };
+  fstat(fileno(fp), &st);
+
+  return maildir_parse_header(type, fp, st.st_size, fname, is_old, e);
+}
+
 /**
  * maildir_parse_message - Actually parse a maildir message
  * @param type   Mailbox type, e.g. #MUTT_MAILDIR
@@ -1362,11 +2114,126 @@ struct Email *maildir_parse_stream(enum MailboxType type, FILE *fp,
 struct Email *maildir_parse_message(enum MailboxType type, const char *fname,
                                     bool is_old, struct Email *e)
 {
-  FILE *fp = fopen(fname, "r");
+  struct Buffer *buf = mutt_buffer_pool_get();
+  e = maildir_parse_file(type, fname, is_old, e, buf);
+  mutt_buffer_pool_release(&buf);
+  return e;
+}
+
+#ifdef HAVE_FMEMOPEN
+/**
+ * maildir_header_end - Find the blank line at the end of a message's header
+ * @param data Start of the message
+ * @param len  Length of data
+ * @retval true The whole header is in data
+ */
+static bool maildir_header_end(const char *data, size_t len)
+{
+  if ((len > 0) && (data[0] == '\n'))
+    return true;
+
+  for (const char *nl = memchr(data, '\n', len); nl;
+       nl = memchr(nl + 1, '\n', len - (nl + 1 - data)))
+  {
+    const size_t left = len - (nl + 1 - data);
+    if ((left > 0) && (nl[1] == '\n'))
+      return true;
+    if ((left > 1) && (nl[1] == '\r') && (nl[2] == '\n'))
+      return true;
+  }
+
+  return false;
+}
+
+/**
+ * maildir_read_header - Read the header of a message into memory
+ * @param fd   File descriptor of the message
+ * @param size Size of the message file
+ * @param buf  Buffer for the data
+ * @retval num Bytes read, including the whole header
+ * @retval 0   The header couldn't be read, or is too big
+ *
+ * The start of the message is read with a single pread().  A second, larger,
+ * read is only needed for unusually long headers.
+ */
+static size_t maildir_read_header(int fd, off_t size, struct Buffer *buf)
+{
+  size_t want = MAILDIR_HEADER_READ;
+  size_t len = 0;
+
+  mutt_buffer_reset(buf);
+  while (true)
+  {
+    want = MIN(want, (size_t) size);
+    mutt_buffer_alloc(buf, want + 1);
+
+    ssize_t rc = pread(fd, buf->dptr, want - len, len);
+    if (rc < 0)
+      return 0;
+    len += rc;
+    buf->dptr += rc;
+
+    /* A file that was read completely always holds its header */
+    if ((len == (size_t) size) || (rc == 0) || maildir_header_end(buf->data, len))
+      return len;
+
+    if (want >= MAILDIR_HEADER_READ_MAX)
+      return 0;
+    want = MAILDIR_HEADER_READ_MAX;
+  }
+}
+#endif
+
+/**
+ * maildir_parse_file - Parse a Maildir message, reading only its header
+ * @param type   Mailbox type, e.g. #MUTT_MAILDIR
+ * @param fname  Message filename
+ * @param is_old true, if the email is old (read)
+ * @param e      Email to populate (OPTIONAL)
+ * @param buf    Buffer for the header, may be reused between calls
+ * @retval ptr Populated Email
+ *
+ * The header is read into memory and parsed from there.  The body is never
+ * read: its length comes from the size of the file.  If the header is too
+ * large, the message is read through stdio instead.
+ */
+struct Email *maildir_parse_file(enum MailboxType type, const char *fname,
+                                 bool is_old, struct Email *e, struct Buffer *buf)
+{
+  int fd = open(fname, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+
+  struct stat st = { 0 };
+  if (fstat(fd, &st) != 0)
+  {
+    close(fd);
+    return NULL;
+  }
+
+#ifdef HAVE_FMEMOPEN
+  size_t len = maildir_read_header(fd, st.st_size, buf);
+  if (len > 0)
+  {
+    FILE *fp = fmemopen(buf->data, len, "r");
+    if (fp)
+    {
+      close(fd);
+      e = maildir_parse_header(type, fp, st.st_size, fname, is_old, e);
+      mutt_file_fclose(&fp);
+      return e;
+    }
+  }
+#endif
+
+  FILE *fp = fdopen(fd, "r");
   if (!fp)
+  {
+    close(fd);
     return NULL;
+  }
 
-  e = maildir_parse_stream(type, fp, fname, is_old, e);
+  e = maildir_parse_header(type, fp, st.st_size, fname, is_old, e);
   mutt_file_fclose(&fp);
   return e;
 }
@@ -1388,6 +2255,12 @@ int mh_sync_mailbox_message(struct Mailbox *m, int msgno, struct HeaderCache *hc
   if (!e)
     return -1;
 
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+
+  /* mh_update_sequences() will write the changes after the sync */
+  if ((m->type == MUTT_MH) && (e->deleted || e->changed))
+    mh_sequences_update(m, e);
+
   if (e->deleted && ((m->type != MUTT_MAILDIR) || !C_MaildirTrash))
   {
     char path[PATH_MAX];
@@ -1412,7 +2285,10 @@ int mh_sync_mailbox_message(struct Mailbox *m, int msgno, struct HeaderCache *hc
         mutt_hcache_delete_record(hc, key, keylen);
       }
 #endif
-      unlink(path);
+      if (mdata && mdata->batch)
+        mutt_filebatch_unlink(mdata->batch, path, NULL, NULL);
+      else
+        unlink(path);
     }
     else if (m->type == MUTT_MH)
     {
@@ -1421,8 +2297,16 @@ int mh_sync_mailbox_message(struct Mailbox *m, int msgno, struct HeaderCache *hc
       {
         char tmp[PATH_MAX];
         snprintf(tmp, sizeof(tmp), "%s/,%s", mailbox_path(m), e->path);
-        unlink(tmp);
-        rename(path, tmp);
+        if (mdata && mdata->batch)
+        {
+          /* rename() replaces any old file */
+          mutt_filebatch_rename(mdata->batch, path, tmp, NULL, NULL);
+        }
+        else
+        {
+          unlink(tmp);
+          rename(path, tmp);
+        }
       }
     }
   }
@@ -1732,6 +2616,25 @@ int maildir_path_parent(char *buf, size_t buflen)
   return -1;
 }
 
+/**
+ * maildir_sync_batch - Perform the renames and unlinks queued by a sync
+ * @param m Mailbox
+ * @retval  0 Success
+ * @retval -1 A message couldn't be renamed
+ */
+static int maildir_sync_batch(struct Mailbox *m)
+{
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (!mdata || !mdata->batch)
+    return 0;
+
+  mdata->batch_errors = 0;
+  mutt_filebatch_run(mdata->batch);
+  mutt_filebatch_free(&mdata->batch);
+
+  return (mdata->batch_errors == 0) ? 0 : -1;
+}
+
 /**
  * mh_mbox_sync - Save changes to the Mailbox - Implements MxOps::mbox_sync()
  * @retval #MUTT_REOPENED  mailbox has been externally modified
@@ -1759,6 +2662,11 @@ int mh_mbox_sync(struct Mailbox *m)
   if (check < 0)
     return check;
 
+  /* The caller will free the deleted Emails */
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (mdata)
+    mutt_hash_free(&mdata->canon);
+
 #ifdef USE_HCACHE
   if ((m->type == MUTT_MAILDIR) || (m->type == MUTT_MH))
     hc = mutt_hcache_open(C_HeaderCache, mailbox_path(m), NULL);
@@ -1771,6 +2679,11 @@ int mh_mbox_sync(struct Mailbox *m)
     mutt_progress_init(&progress, msg, MUTT_PROGRESS_WRITE, m->msg_count);
   }
 
+  /* Flag changes and deletions only rename or unlink files, so they're
+   * queued and performed together, see maildir_sync_batch() */
+  if (mdata)
+    mdata->batch = mutt_filebatch_new();
+
   for (i = 0; i < m->msg_count; i++)
   {
     if (m->verbose)
@@ -1780,6 +2693,9 @@ int mh_mbox_sync(struct Mailbox *m)
       goto err;
   }
 
+  if (maildir_sync_batch(m) == -1)
+    goto err;
+
 #ifdef USE_HCACHE
   if ((m->type == MUTT_MAILDIR) || (m->type == MUTT_MH))
     mutt_hcache_close(hc);
@@ -1810,6 +2726,8 @@ int mh_mbox_sync(struct Mailbox *m)
   return check;
 
 err:
+  /* Finish the operations for the messages that were synced */
+  maildir_sync_batch(m);
 #ifdef USE_HCACHE
   if ((m->type == MUTT_MAILDIR) || (m->type == MUTT_MH))
     mutt_hcache_close(hc);
@@ -1817,12 +2735,56 @@ err:
   return -1;
 }
 
+/**
+ * mh_mbox_load - Read the next batch of Emails - Implements MxOps::mbox_load()
+ */
+int mh_mbox_load(struct Mailbox *m)
+{
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (!mdata)
+    return -1;
+
+  const int oldcount = m->msg_count;
+  struct Maildir *md = mdata->pending;
+  mdata->pending = maildir_split(&md, MAX(m->load_batch, 1));
+
+  struct HeaderCache *hc = NULL;
+#ifdef USE_HCACHE
+  hc = mutt_hcache_open(C_HeaderCache, mailbox_path(m), NULL);
+#endif
+  maildir_read_list(m, &md, NULL, hc);
+#ifdef USE_HCACHE
+  mutt_hcache_close(hc);
+#endif
+
+  if (!mdata->pending)
+  {
+    m->loading = false;
+    mutt_hash_free(&mdata->pending_hce);
+    /* Drop the sequences of any messages that have vanished */
+    if (m->type == MUTT_MH)
+      mh_sequences_load(m);
+  }
+
+  mutt_debug(LL_DEBUG2, "%s: read %d emails, %s\n", mailbox_path(m),
+             m->msg_count - oldcount, m->loading ? "more to come" : "done");
+  return m->msg_count - oldcount;
+}
+
 /**
  * mh_mbox_close - Close a Mailbox - Implements MxOps::mbox_close()
  * @retval 0 Always
  */
 int mh_mbox_close(struct Mailbox *m)
 {
+  struct MaildirMboxData *mdata = maildir_mdata_get(m);
+  if (mdata)
+  {
+    mutt_hash_free(&mdata->canon);
+    maildir_free(&mdata->pending);
+    mutt_hash_free(&mdata->pending_hce);
+  }
+
   return 0;
 }
 
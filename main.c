@@ -1208,7 +1208,10 @@ int main(int argc, char *argv[], char *envp[])
 
     repeat_error = true;
     struct Mailbox *m = mx_resolve(mutt_b2s(&folder));
-    Context = mx_mbox_open(m, ((flags & MUTT_CLI_RO) || C_ReadOnly) ? MUTT_READONLY : MUTT_OPEN_NO_FLAGS);
+    OpenMailboxFlags open_flags = MUTT_PROGRESSIVE;
+    if ((flags & MUTT_CLI_RO) || C_ReadOnly)
+      open_flags |= MUTT_READONLY;
+    Context = mx_mbox_open(m, open_flags);
     if (!Context)
     {
       if (m->account)
@@ -1266,6 +1269,7 @@ main_exit:
   mutt_buffer_pool_free();
   mutt_envlist_free();
   mutt_browser_cleanup();
+  mutt_mailbox_poll_free();
   mutt_commands_cleanup();
   crypt_cleanup();
   mutt_opts_free();
@@ -30,9 +30,11 @@
 #include <stddef.h>
 #include <config/lib.h>
 #include <stdbool.h>
+#include "private.h"
 
 // clang-format off
 bool C_CheckMboxSize; ///< Config: (mbox,mmdf) Use mailbox size as an indicator of new mail
+bool C_MboxIndex;     ///< Config: (mbox,mmdf) Keep an index of message offsets next to the mailbox
 // clang-format on
 
 struct ConfigDef MboxVars[] = {
@@ -40,6 +42,9 @@ struct ConfigDef MboxVars[] = {
   { "check_mbox_size", DT_BOOL, &C_CheckMboxSize, false, 0, NULL,
     "(mbox,mmdf) Use mailbox size as an indicator of new mail"
   },
+  { "mbox_index", DT_BOOL, &C_MboxIndex, false, 0, NULL,
+    "(mbox,mmdf) Keep an index of message offsets next to the mailbox"
+  },
   { NULL, 0, NULL, 0, 0, NULL, NULL },
   // clang-format on
 };
@@ -0,0 +1,520 @@
+/**
+ * @file
+ * Index of the messages in an mbox file
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @page mbox_index Index of the messages in an mbox file
+ *
+ * Finding the message boundaries in an mbox file means reading every byte of
+ * it.  If `$mbox_index` is set, the location of each message is saved in a
+ * file next to the mailbox, `.NAME.index`.
+ *
+ * When the mailbox is opened again, only the headers of the messages are read.
+ * If new mail has been appended, only the new part of the file is parsed.
+ *
+ * The index is only trusted if:
+ * - the mailbox is the same file (device and inode)
+ * - the mailbox is the same size and has the same mtime, or
+ * - the mailbox has grown and a message separator follows the old end
+ * - the end of the last indexed message is unchanged (checksum)
+ *
+ * The index is a cache.  If it can't be read or written, it's ignored.
+ */
+
+#include "config.h"
+#include <inttypes.h> // IWYU pragma: keep
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "mutt/lib.h"
+#include "address/lib.h"
+#include "email/lib.h"
+#include "core/lib.h"
+#include "lib.h"
+#include "private.h"
+#include "mutt_globals.h"
+#include "progress.h"
+
+/// Identifies an mbox index file
+#define MBOX_INDEX_MAGIC "NMBOXIDX"
+/// Version of the index file format
+#define MBOX_INDEX_VERSION 1
+/// Maximum number of bytes of the last message to checksum
+#define MBOX_INDEX_SUM_MAX (64 * 1024)
+
+/**
+ * struct MboxIndexHeader - Validity data for an mbox index
+ *
+ * This is followed by an array of MboxIndexEntry.
+ */
+struct MboxIndexHeader
+{
+  char magic[8];          ///< #MBOX_INDEX_MAGIC
+  uint32_t version;       ///< #MBOX_INDEX_VERSION
+  int32_t type;           ///< Mailbox type, #MUTT_MBOX or #MUTT_MMDF
+  uint64_t dev;           ///< Device of the mailbox file
+  uint64_t ino;           ///< Inode of the mailbox file
+  int64_t size;           ///< Size of the mailbox when it was indexed
+  int64_t mtime_sec;      ///< Modification time when it was indexed
+  int64_t mtime_nsec;     ///< Modification time (nanoseconds)
+  unsigned char sum[16];  ///< MD5 checksum of the end of the last message
+  int32_t count;          ///< Number of indexed messages
+  int32_t padding;        ///< Unused
+};
+
+/**
+ * struct MboxIndexEntry - Location of a message in an mbox file
+ */
+struct MboxIndexEntry
+{
+  int64_t offset; ///< Email::offset
+  int64_t body;   ///< Body::offset
+  int64_t length; ///< Body::length
+  int64_t lines;  ///< Email::lines
+};
+
+/**
+ * index_path - Get the path of a mailbox's index file
+ * @param m   Mailbox
+ * @param buf Buffer for the result
+ */
+static void index_path(struct Mailbox *m, struct Buffer *buf)
+{
+  char *dir = mutt_path_dirname(mailbox_path(m));
+  mutt_buffer_printf(buf, "%s/.%s.index", dir, mutt_path_basename(mailbox_path(m)));
+  FREE(&dir);
+}
+
+/**
+ * index_sep_offset - Get the offset of a message's separator
+ * @param type Mailbox type, #MUTT_MBOX or #MUTT_MMDF
+ * @param mie  Indexed message
+ * @retval num Offset of the "From " line, or MMDF separator
+ */
+static int64_t index_sep_offset(int type, const struct MboxIndexEntry *mie)
+{
+  /* An MMDF message starts after its separator */
+  if (type == MUTT_MMDF)
+    return mie->offset - (sizeof(MMDF_SEP) - 1);
+  return mie->offset;
+}
+
+/**
+ * index_checksum - Checksum the end of the last message
+ * @param[in]  fd    File descriptor of the mailbox
+ * @param[in]  start Start of the last message
+ * @param[in]  end   End of the last message
+ * @param[out] sum   Buffer for the MD5 checksum (16 bytes)
+ * @retval true Success
+ *
+ * At most #MBOX_INDEX_SUM_MAX bytes are read.
+ */
+static bool index_checksum(int fd, int64_t start, int64_t end, unsigned char *sum)
+{
+  if (end - start > MBOX_INDEX_SUM_MAX)
+    start = end - MBOX_INDEX_SUM_MAX;
+
+  struct Md5Ctx ctx;
+  mutt_md5_init_ctx(&ctx);
+
+  char buf[8192];
+  while (start < end)
+  {
+    size_t want = MIN(sizeof(buf), (size_t) (end - start));
+    ssize_t got = pread(fd, buf, want, start);
+    if (got <= 0)
+      return false;
+    mutt_md5_process_bytes(buf, got, &ctx);
+    start += got;
+  }
+
+  mutt_md5_finish_ctx(&ctx, sum);
+  return true;
+}
+
+/**
+ * index_read - Read an index file
+ * @param[in]  m   Mailbox
+ * @param[out] mih Index header
+ * @param[out] entries Indexed messages, if not NULL
+ * @retval true Success
+ *
+ * If entries is NULL, only the header is read.  The caller must free entries.
+ */
+static bool index_read(struct Mailbox *m, struct MboxIndexHeader *mih,
+                       struct MboxIndexEntry **entries)
+{
+  struct Buffer *path = mutt_buffer_pool_get();
+  index_path(m, path);
+  FILE *fp = fopen(mutt_b2s(path), "r");
+  mutt_buffer_pool_release(&path);
+  if (!fp)
+    return false;
+
+  bool rc = false;
+  if ((fread(mih, sizeof(*mih), 1, fp) != 1) ||
+      (memcmp(mih->magic, MBOX_INDEX_MAGIC, sizeof(mih->magic)) != 0) ||
+      (mih->version != MBOX_INDEX_VERSION) || (mih->count < 0))
+  {
+    goto done;
+  }
+
+  if (entries)
+  {
+    *entries = NULL;
+    if (mih->count > 0)
+    {
+      *entries = mutt_mem_malloc(mih->count * sizeof(struct MboxIndexEntry));
+      const size_t num = mih->count;
+      if (fread(*entries, sizeof(struct MboxIndexEntry), num, fp) != num)
+      {
+        FREE(entries);
+        goto done;
+      }
+    }
+  }
+
+  rc = true;
+
+done:
+  fclose(fp);
+  return rc;
+}
+
+/**
+ * index_valid - Does the index describe the mailbox file?
+ * @param m       Mailbox
+ * @param fd      File descriptor of the mailbox
+ * @param sb      Mailbox file's stat info
+ * @param mih     Index header
+ * @param entries Indexed messages
+ * @retval true The index can be used
+ */
+static bool index_valid(struct Mailbox *m, int fd, struct stat *sb,
+                        const struct MboxIndexHeader *mih, const struct MboxIndexEntry *entries)
+{
+  if ((mih->type != m->type) || (mih->dev != (uint64_t) sb->st_dev) ||
+      (mih->ino != (uint64_t) sb->st_ino) || (mih->size > sb->st_size) || (mih->count == 0))
+  {
+    return false;
+  }
+
+  /* The entries must be in order, and within the file */
+  int64_t prev = -1;
+  for (int i = 0; i < mih->count; i++)
+  {
+    const struct MboxIndexEntry *mie = &entries[i];
+    if ((index_sep_offset(m->type, mie) <= prev) || (mie->body < mie->offset) ||
+        (mie->length < 0) || (mie->body + mie->length > mih->size))
+    {
+      return false;
+    }
+    prev = mie->offset;
+  }
+
+  if (mih->size == sb->st_size)
+  {
+    /* The same size, but changed, means the mailbox was rewritten */
+    struct timespec mtime = { mih->mtime_sec, mih->mtime_nsec };
+    if (mutt_file_stat_timespec_compare(sb, MUTT_STAT_MTIME, &mtime) != 0)
+      return false;
+  }
+  else
+  {
+    /* Mail has been appended.  An mbox message must start on a new line */
+    const bool mmdf = (m->type == MUTT_MMDF);
+    const char *sep = mmdf ? MMDF_SEP : "\nFrom ";
+    const size_t seplen = strlen(sep);
+    const int64_t off = mmdf ? mih->size : mih->size - 1;
+    char buf[16];
+    if ((pread(fd, buf, seplen, off) != (ssize_t) seplen) || (memcmp(buf, sep, seplen) != 0))
+    {
+      mutt_debug(LL_DEBUG2, "no message separator at " OFF_T_FMT "\n", (LOFF_T) mih->size);
+      return false;
+    }
+  }
+
+  unsigned char sum[16];
+  const int64_t last = index_sep_offset(m->type, &entries[mih->count - 1]);
+  if (!index_checksum(fd, last, mih->size, sum) || (memcmp(sum, mih->sum, sizeof(sum)) != 0))
+  {
+    mutt_debug(LL_DEBUG2, "last message has changed\n");
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * index_read_email - Read the headers of an indexed message
+ * @param m   Mailbox
+ * @param fp  Mailbox file
+ * @param mie Indexed message
+ * @retval ptr  New Email
+ * @retval NULL The message isn't where the index says
+ */
+static struct Email *index_read_email(struct Mailbox *m, FILE *fp,
+                                      const struct MboxIndexEntry *mie)
+{
+  char buf[8192];
+  char return_path[1024];
+  time_t t = 0;
+
+  if (fseeko(fp, mie->offset, SEEK_SET) != 0)
+    return NULL;
+
+  return_path[0] = '\0';
+  const bool from = fgets(buf, sizeof(buf), fp) &&
+                    is_from(buf, return_path, sizeof(return_path), &t);
+  if (m->type == MUTT_MBOX)
+  {
+    if (!from)
+      return NULL;
+  }
+  else if (!from && (fseeko(fp, mie->offset, SEEK_SET) != 0))
+  {
+    return NULL;
+  }
+
+  struct Email *e = email_new();
+  e->offset = mie->offset;
+  if (from)
+    e->received = t - mutt_date_local_tz(t);
+
+  e->env = mutt_rfc822_read_header(fp, e, false, false);
+  if (e->content->offset != mie->body)
+  {
+    mutt_debug(LL_DEBUG1, "headers of message at " OFF_T_FMT " have changed\n", e->offset);
+    email_free(&e);
+    return NULL;
+  }
+
+  e->content->length = mie->length;
+  e->lines = mie->lines;
+
+  if (TAILQ_EMPTY(&e->env->return_path) && return_path[0])
+    mutt_addrlist_parse(&e->env->return_path, return_path);
+
+  if (TAILQ_EMPTY(&e->env->from))
+    mutt_addrlist_copy(&e->env->from, &e->env->return_path, false);
+
+  return e;
+}
+
+/**
+ * mbox_index_load - Read the messages of a mailbox using its index
+ * @param m  Mailbox
+ * @param fp Mailbox file
+ * @retval num Number of messages read
+ *
+ * If the index matches the mailbox file, the headers of the indexed messages
+ * are read and the file is left positioned at the end of the last one.
+ * Anything appended after that still needs to be parsed.
+ *
+ * If the index can't be used, nothing is changed.
+ */
+int mbox_index_load(struct Mailbox *m, FILE *fp)
+{
+  if (!C_MboxIndex || !m || !fp)
+    return 0;
+
+  struct stat sb;
+  if (fstat(fileno(fp), &sb) != 0)
+    return 0;
+
+  struct MboxIndexHeader mih = { 0 };
+  struct MboxIndexEntry *entries = NULL;
+  if (!index_read(m, &mih, &entries))
+    return 0;
+
+  const LOFF_T pos = ftello(fp);
+  const int first = m->msg_count;
+  int count = 0;
+
+  if ((pos < 0) || !index_valid(m, fileno(fp), &sb, &mih, entries))
+    goto done;
+
+  struct Progress progress;
+  if (m->verbose)
+  {
+    char msg[PATH_MAX];
+    snprintf(msg, sizeof(msg), _("Reading %s..."), mailbox_path(m));
+    mutt_progress_init(&progress, msg, MUTT_PROGRESS_READ, mih.count);
+  }
+
+  for (; count < mih.count; count++)
+  {
+    if (SigInt == 1)
+      break;
+
+    if (m->verbose)
+      mutt_progress_update(&progress, count, -1);
+
+    struct Email *e = index_read_email(m, fp, &entries[count]);
+    if (!e)
+      break;
+
+    if (m->msg_count == m->email_max)
+      mx_alloc_memory(m);
+
+    e->index = m->msg_count;
+    m->emails[m->msg_count++] = e;
+  }
+
+  if ((count < mih.count) || (fseeko(fp, mih.size, SEEK_SET) != 0))
+  {
+    /* All or nothing, otherwise the parser would find the rest twice */
+    for (int i = first; i < m->msg_count; i++)
+      email_free(&m->emails[i]);
+    m->msg_count = first;
+    count = 0;
+    if (fseeko(fp, pos, SEEK_SET) != 0)
+      mutt_debug(LL_DEBUG1, "fseeko() failed\n");
+    goto done;
+  }
+
+  mutt_debug(LL_DEBUG2, "read %d messages using the index\n", count);
+
+done:
+  FREE(&entries);
+  return count;
+}
+
+/**
+ * index_entry_cmp - Compare two indexed messages by offset - Implements ::sort_t
+ */
+static int index_entry_cmp(const void *a, const void *b)
+{
+  const struct MboxIndexEntry *ma = a;
+  const struct MboxIndexEntry *mb = b;
+
+  if (ma->offset < mb->offset)
+    return -1;
+  return (ma->offset > mb->offset);
+}
+
+/**
+ * mbox_index_save - Save the location of a mailbox's messages
+ * @param m      Mailbox
+ * @param fp     Mailbox file
+ * @param purged The deleted Emails have already been removed from the file
+ *
+ * The index is only written if the Mailbox's messages describe the whole of
+ * the file and the index has changed.
+ */
+void mbox_index_save(struct Mailbox *m, FILE *fp, bool purged)
+{
+  if (!C_MboxIndex || !m || !fp)
+    return;
+
+  struct stat sb;
+  if ((fstat(fileno(fp), &sb) != 0) || !S_ISREG(sb.st_mode) || (sb.st_size != m->size))
+    return;
+
+  int count = 0;
+  for (int i = 0; i < m->msg_count; i++)
+    if (!purged || !m->emails[i]->deleted)
+      count++;
+  if (count == 0)
+    return;
+
+  struct MboxIndexHeader mih = { 0 };
+  if (index_read(m, &mih, NULL) && (mih.type == m->type) &&
+      (mih.dev == (uint64_t) sb.st_dev) && (mih.ino == (uint64_t) sb.st_ino) &&
+      (mih.size == sb.st_size) && (mih.count == count))
+  {
+    struct timespec mtime = { mih.mtime_sec, mih.mtime_nsec };
+    if (mutt_file_stat_timespec_compare(&sb, MUTT_STAT_MTIME, &mtime) == 0)
+      return; /* Up to date */
+  }
+
+  struct MboxIndexEntry *entries = mutt_mem_calloc(count, sizeof(struct MboxIndexEntry));
+  for (int i = 0, j = 0; i < m->msg_count; i++)
+  {
+    const struct Email *e = m->emails[i];
+    if (purged && e->deleted)
+      continue;
+    entries[j].offset = e->offset;
+    entries[j].body = e->content->offset;
+    entries[j].length = e->content->length;
+    entries[j].lines = e->lines;
+    j++;
+  }
+
+  /* The Emails may have been sorted */
+  qsort(entries, count, sizeof(struct MboxIndexEntry), index_entry_cmp);
+
+  struct Buffer *path = mutt_buffer_pool_get();
+  struct Buffer *tmp = mutt_buffer_pool_get();
+  FILE *fp_idx = NULL;
+
+  if (entries[count - 1].body + entries[count - 1].length > m->size)
+    goto done;
+
+  memcpy(mih.magic, MBOX_INDEX_MAGIC, sizeof(mih.magic));
+  mih.version = MBOX_INDEX_VERSION;
+  mih.type = m->type;
+  mih.dev = sb.st_dev;
+  mih.ino = sb.st_ino;
+  mih.size = sb.st_size;
+  struct timespec mtime = { 0 };
+  mutt_file_get_stat_timespec(&mtime, &sb, MUTT_STAT_MTIME);
+  mih.mtime_sec = mtime.tv_sec;
+  mih.mtime_nsec = mtime.tv_nsec;
+  mih.count = count;
+  mih.padding = 0;
+
+  const int64_t last = index_sep_offset(m->type, &entries[count - 1]);
+  if (!index_checksum(fileno(fp), last, mih.size, mih.sum))
+    goto done;
+
+  index_path(m, path);
+  mutt_buffer_printf(tmp, "%s.tmp", mutt_b2s(path));
+
+  fp_idx = fopen(mutt_b2s(tmp), "w");
+  if (!fp_idx)
+  {
+    mutt_debug(LL_DEBUG1, "can't create %s\n", mutt_b2s(tmp));
+    goto done;
+  }
+
+  bool ok = (fwrite(&mih, sizeof(mih), 1, fp_idx) == 1) &&
+            (fwrite(entries, sizeof(struct MboxIndexEntry), count, fp_idx) == (size_t) count);
+  if ((mutt_file_fclose(&fp_idx) != 0) || !ok || (rename(mutt_b2s(tmp), mutt_b2s(path)) != 0))
+  {
+    mutt_debug(LL_DEBUG1, "can't write %s\n", mutt_b2s(path));
+    unlink(mutt_b2s(tmp));
+    goto done;
+  }
+
+  mutt_debug(LL_DEBUG2, "indexed %d messages\n", count);
+
+done:
+  mutt_buffer_pool_release(&path);
+  mutt_buffer_pool_release(&tmp);
+  FREE(&entries);
+}
@@ -29,6 +29,7 @@
  * | File          | Description          |
  * | :------------ | :------------------- |
  * | mbox/config.c | @subpage mbox_config |
+ * | mbox/index.c  | @subpage mbox_index  |
  * | mbox/mbox.c   | @subpage mbox_mbox   |
  */
 
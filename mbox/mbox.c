@@ -31,16 +31,21 @@
  */
 
 #include "config.h"
+#include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h> // IWYU pragma: keep
 #include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 #include <utime.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 #include "mutt/lib.h"
 #include "address/lib.h"
 #include "config/lib.h"
@@ -48,6 +53,7 @@
 #include "core/lib.h"
 #include "mutt.h"
 #include "lib.h"
+#include "private.h"
 #include "copy.h"
 #include "mutt_globals.h"
 #include "mutt_header.h"
@@ -56,6 +62,9 @@
 #include "progress.h"
 #include "protos.h"
 #include "sort.h"
+#ifdef USE_HCACHE
+#include "hcache/lib.h"
+#endif
 
 /**
  * struct MUpdate - Store of new offsets, used by mutt_sync_mailbox()
@@ -69,6 +78,54 @@ struct MUpdate
   LOFF_T length;
 };
 
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#define MBOX_MMAP
+#endif
+
+#ifdef MBOX_MMAP
+/**
+ * struct MboxMap - A mailbox file mapped into memory
+ */
+struct MboxMap
+{
+  const char *data; ///< Start of the mapped file
+  size_t len;       ///< Length of the mapping
+  FILE *fp;         ///< Stream used by the header parser
+};
+#endif
+
+#ifdef USE_HCACHE
+/// Header cache key for the list of cached messages
+#define MBOX_HC_KEY "/MBOX"
+
+/**
+ * struct MboxCacheMsg - Location of a message in a cached mbox
+ */
+struct MboxCacheMsg
+{
+  LOFF_T offset;                ///< Offset of the message separator
+  LOFF_T length;                ///< Length of the message, including the separator
+  size_t hdr_length;            ///< Length of the separator and headers
+  unsigned char hdr_digest[16]; ///< MD5 digest of the separator and headers
+};
+
+/**
+ * struct MboxCacheHeader - Validity data for a cached mbox
+ *
+ * This is followed by an array of MboxCacheMsg.
+ */
+struct MboxCacheHeader
+{
+  unsigned int crc;      ///< Header cache CRC, see HeaderCache::crc
+  int type;              ///< Mailbox type, #MUTT_MBOX or #MUTT_MMDF
+  dev_t dev;             ///< Device of the mailbox file
+  ino_t ino;             ///< Inode of the mailbox file
+  LOFF_T size;           ///< Size of the file when it was cached
+  struct timespec mtime; ///< Modification time when it was cached
+  int count;             ///< Number of cached messages
+};
+#endif
+
 /**
  * mbox_adata_free - Free the private Account data - Implements Account::adata_free()
  */
@@ -174,6 +231,453 @@ static void mbox_unlock_mailbox(struct Mailbox *m)
   }
 }
 
+#ifdef MBOX_MMAP
+/**
+ * mbox_map_open - Map a mailbox file into memory
+ * @param[in]  m   Mailbox
+ * @param[out] map Mapped file
+ * @retval true  Success
+ * @retval false The file can't be mapped, the caller should use stdio
+ *
+ * The mailbox must be locked, so nobody else will truncate it.  Reading a
+ * truncated mapping would crash with SIGBUS.  If the lock couldn't be taken,
+ * e.g. when the mailbox was opened read-only, the caller falls back to stdio.
+ */
+static bool mbox_map_open(struct Mailbox *m, struct MboxMap *map)
+{
+  struct MboxAccountData *adata = mbox_adata_get(m);
+  if (!adata || !adata->fp || !adata->locked)
+    return false;
+
+  struct stat sb;
+  if ((fstat(fileno(adata->fp), &sb) != 0) || !S_ISREG(sb.st_mode) ||
+      (sb.st_size < m->size) || (m->size <= 0) || ((uint64_t) m->size > SIZE_MAX))
+  {
+    return false;
+  }
+
+  void *data = mmap(NULL, m->size, PROT_READ, MAP_PRIVATE, fileno(adata->fp), 0);
+  if (data == MAP_FAILED)
+  {
+    mutt_debug(LL_DEBUG1, "mmap failed: %s\n", strerror(errno));
+    return false;
+  }
+
+#ifdef MADV_SEQUENTIAL
+  madvise(data, m->size, MADV_SEQUENTIAL);
+#endif
+
+  map->data = data;
+  map->len = m->size;
+  map->fp = adata->fp;
+#ifdef USE_FMEMOPEN
+  /* Offsets in the memory stream match the offsets in the file */
+  FILE *fp = fmemopen(data, map->len, "r");
+  if (fp)
+    map->fp = fp;
+#endif
+  return true;
+}
+
+/**
+ * mbox_map_close - Unmap a mailbox file
+ * @param m   Mailbox
+ * @param map Mapped file
+ *
+ * The Mailbox's stream is left at the end of the mapped data, just as if it
+ * had been read using stdio.
+ */
+static void mbox_map_close(struct Mailbox *m, struct MboxMap *map)
+{
+  struct MboxAccountData *adata = mbox_adata_get(m);
+
+  if (map->fp != adata->fp)
+    mutt_file_fclose(&map->fp);
+  if (fseeko(adata->fp, map->len, SEEK_SET) != 0)
+    mutt_debug(LL_DEBUG1, "fseeko() failed\n");
+
+  munmap((void *) map->data, map->len);
+  map->data = NULL;
+  map->len = 0;
+}
+
+/**
+ * map_count_lines - Count the newlines in a block of memory
+ * @param data Start of block
+ * @param len  Length of block
+ * @retval num Number of newlines
+ */
+static size_t map_count_lines(const char *data, size_t len)
+{
+  size_t lines = 0;
+  const char *end = data + len;
+
+  while ((data < end) && (data = memchr(data, '\n', end - data)))
+  {
+    lines++;
+    data++;
+  }
+
+  return lines;
+}
+
+/**
+ * map_find_line - Find the next line that starts with a string
+ * @param map Mapped file
+ * @param pos Offset of the start of a line
+ * @param str String to look for
+ * @retval num Offset of the matching line, or the end of the file
+ */
+static size_t map_find_line(const struct MboxMap *map, size_t pos, const char *str)
+{
+  const size_t slen = strlen(str);
+  const char *data = map->data;
+  const size_t len = map->len;
+
+  if ((len - pos >= slen) && (memcmp(data + pos, str, slen) == 0))
+    return pos;
+
+  while (pos < len)
+  {
+#ifdef HAVE_MEMMEM
+    /* Skip straight to the next match, then check it starts a line */
+    const char *p = memmem(data + pos, len - pos, str, slen);
+    if (!p)
+      break;
+    pos = p - data;
+    if (data[pos - 1] == '\n')
+      return pos;
+    pos++;
+#else
+    const char *nl = memchr(data + pos, '\n', len - pos);
+    if (!nl)
+      break;
+    pos = nl - data + 1;
+    if ((len - pos >= slen) && (memcmp(data + pos, str, slen) == 0))
+      return pos;
+#endif
+  }
+
+  return len;
+}
+
+/**
+ * map_copy_line - Copy a line out of a mapped file
+ * @param map    Mapped file
+ * @param pos    Offset of the start of the line
+ * @param buf    Buffer for the line
+ * @param buflen Length of the buffer
+ * @retval num Offset of the next line
+ *
+ * Like fgets(), a line that's too long for the buffer is split.
+ */
+static size_t map_copy_line(const struct MboxMap *map, size_t pos, char *buf, size_t buflen)
+{
+  size_t n = MIN(map->len - pos, buflen - 1);
+  const char *nl = memchr(map->data + pos, '\n', n);
+  if (nl)
+    n = nl - (map->data + pos) + 1;
+
+  memcpy(buf, map->data + pos, n);
+  buf[n] = '\0';
+  return pos + n;
+}
+
+/**
+ * mmdf_parse_map - Read an MMDF mailbox from memory
+ * @param m        Mailbox
+ * @param map      Mapped file
+ * @param start    Offset to start parsing
+ * @param progress Progress bar
+ * @retval  0 Success
+ * @retval -1 Failure
+ * @retval -2 Aborted
+ *
+ * This must give the same results as the stdio code in mmdf_parse_mailbox().
+ */
+static int mmdf_parse_map(struct Mailbox *m, struct MboxMap *map, size_t start,
+                          struct Progress *progress)
+{
+  const size_t seplen = sizeof(MMDF_SEP) - 1;
+  const char *data = map->data;
+  char buf[8192];
+  char return_path[1024];
+  int count = 0;
+  time_t t;
+  size_t pos = start;
+
+  while ((pos < map->len) && (SigInt != 1))
+  {
+    if ((map->len - pos < seplen) || (memcmp(data + pos, MMDF_SEP, seplen) != 0))
+    {
+      mutt_debug(LL_DEBUG1, "corrupt mailbox\n");
+      mutt_error(_("Mailbox is corrupt"));
+      return -1;
+    }
+
+    LOFF_T loc = pos + seplen;
+
+    count++;
+    if (m->verbose)
+      mutt_progress_update(progress, count, (int) (loc / (m->size / 100 + 1)));
+
+    if (loc >= map->len)
+    {
+      mutt_debug(LL_DEBUG1, "unexpected EOF\n");
+      break;
+    }
+
+    if (m->msg_count == m->email_max)
+      mx_alloc_memory(m);
+    struct Email *e = email_new();
+    m->emails[m->msg_count] = e;
+    e->offset = loc;
+    e->index = m->msg_count;
+
+    return_path[0] = '\0';
+    LOFF_T hdr = map_copy_line(map, loc, buf, sizeof(buf));
+    if (is_from(buf, return_path, sizeof(return_path), &t))
+      e->received = t - mutt_date_local_tz(t);
+    else
+      hdr = loc;
+
+    if (fseeko(map->fp, hdr, SEEK_SET) != 0)
+    {
+      mutt_debug(LL_DEBUG1, "#1 fseek() failed\n");
+      mutt_error(_("Mailbox is corrupt"));
+      email_free(&m->emails[m->msg_count]);
+      return -1;
+    }
+    e->env = mutt_rfc822_read_header(map->fp, e, false, false);
+
+    loc = ftello(map->fp);
+    if (loc < 0)
+    {
+      email_free(&m->emails[m->msg_count]);
+      return -1;
+    }
+
+    pos = loc;
+    if ((e->content->length > 0) && (e->lines > 0))
+    {
+      LOFF_T tmploc = loc + e->content->length;
+
+      if ((tmploc > 0) && (tmploc < m->size) && (map->len - tmploc >= seplen) &&
+          (memcmp(data + tmploc, MMDF_SEP, seplen) == 0))
+      {
+        pos = tmploc + seplen;
+      }
+      else
+        e->content->length = -1;
+    }
+    else
+      e->content->length = -1;
+
+    if (e->content->length < 0)
+    {
+      size_t sep = map_find_line(map, loc, MMDF_SEP);
+      int lines = map_count_lines(data + loc, sep - loc);
+      if ((sep == map->len) && (sep > loc) && (data[sep - 1] != '\n'))
+        lines++;
+
+      e->lines = lines;
+      e->content->length = sep - e->content->offset;
+      pos = (sep < map->len) ? sep + seplen : sep;
+    }
+
+    if (TAILQ_EMPTY(&e->env->return_path) && return_path[0])
+      mutt_addrlist_parse(&e->env->return_path, return_path);
+
+    if (TAILQ_EMPTY(&e->env->from))
+      mutt_addrlist_copy(&e->env->from, &e->env->return_path, false);
+
+    m->msg_count++;
+  }
+
+  if (SigInt == 1)
+  {
+    SigInt = 0;
+    return -2; /* action aborted */
+  }
+
+  return 0;
+}
+
+/**
+ * mbox_map_find_from - Find the next message separator
+ * @param[in]  map        Mapped file
+ * @param[in]  pos        Offset of the start of a line
+ * @param[out] buf        Buffer for the "From " line
+ * @param[in]  buflen     Length of the buffer
+ * @param[out] return_path Buffer for the sender
+ * @param[in]  pathlen    Length of the sender buffer
+ * @param[out] tp         Time from the "From " line
+ * @retval num Offset of the "From " line, or the end of the file
+ */
+static size_t mbox_map_find_from(const struct MboxMap *map, size_t pos, char *buf,
+                                 size_t buflen, char *return_path, size_t pathlen, time_t *tp)
+{
+  while ((pos = map_find_line(map, pos, "From ")) < map->len)
+  {
+    size_t next = map_copy_line(map, pos, buf, buflen);
+    if (is_from(buf, return_path, pathlen, tp))
+      return pos;
+    pos = next;
+  }
+
+  return map->len;
+}
+
+/**
+ * mbox_parse_map - Read an mbox mailbox from memory
+ * @param m        Mailbox
+ * @param map      Mapped file
+ * @param start    Offset to start parsing
+ * @param progress Progress bar
+ * @retval  0 Success
+ * @retval -2 Aborted
+ *
+ * This must give the same results as the stdio code in mbox_parse_mailbox().
+ * The message separators are found by searching for "\nFrom " and the body
+ * lines are counted without reading the body line by line.
+ *
+ * @note Unlike fgets(), lines longer than 8KiB aren't split, so they're only
+ *       counted once.
+ */
+static int mbox_parse_map(struct Mailbox *m, struct MboxMap *map, size_t start,
+                          struct Progress *progress)
+{
+  const char *data = map->data;
+  char buf[8192], return_path[256];
+  time_t t;
+  int count = 0;
+  size_t lines = 0;
+  size_t pos = start;
+
+  while ((pos < map->len) && (SigInt != 1))
+  {
+    size_t from = mbox_map_find_from(map, pos, buf, sizeof(buf), return_path,
+                                     sizeof(return_path), &t);
+    lines += map_count_lines(data + pos, from - pos);
+    if (from == map->len)
+    {
+      /* An unterminated last line still counts */
+      if ((from > pos) && (data[from - 1] != '\n'))
+        lines++;
+      pos = from;
+      break;
+    }
+
+    /* Save the Content-Length of the previous message */
+    if (count > 0)
+    {
+      struct Email *e = m->emails[m->msg_count - 1];
+      if (e->content->length < 0)
+      {
+        e->content->length = from - e->content->offset - 1;
+        if (e->content->length < 0)
+          e->content->length = 0;
+      }
+      if (!e->lines)
+        e->lines = lines ? lines - 1 : 0;
+    }
+
+    count++;
+
+    if (m->verbose)
+      mutt_progress_update(progress, count, (int) (from / (m->size / 100 + 1)));
+
+    if (m->msg_count == m->email_max)
+      mx_alloc_memory(m);
+
+    struct Email *e_cur = email_new();
+    m->emails[m->msg_count] = e_cur;
+    e_cur->received = t - mutt_date_local_tz(t);
+    e_cur->offset = from;
+    e_cur->index = m->msg_count;
+
+    if (fseeko(map->fp, from + strlen(buf), SEEK_SET) != 0)
+      mutt_debug(LL_DEBUG1, "#1 fseek() failed\n");
+    e_cur->env = mutt_rfc822_read_header(map->fp, e_cur, false, false);
+
+    LOFF_T loc = ftello(map->fp);
+    pos = (loc < 0) ? map->len : loc;
+
+    /* if we know how long this message is, skip over the body */
+    if ((e_cur->content->length > 0) && (loc >= 0))
+    {
+      /* The test below avoids a potential integer overflow if the
+       * content-length is huge (thus necessarily invalid).  */
+      LOFF_T tmploc = (e_cur->content->length < m->size) ?
+                          (loc + e_cur->content->length + 1) :
+                          -1;
+
+      if ((tmploc > 0) && (tmploc < m->size))
+      {
+        /* check to see if the content-length looks valid.  we expect to
+         * to see a valid message separator at this point in the stream */
+        if ((map->len - tmploc < 5) || (memcmp(data + tmploc, "From ", 5) != 0))
+        {
+          mutt_debug(LL_DEBUG1, "bad content-length in message %d (cl=" OFF_T_FMT ")\n",
+                     e_cur->index, e_cur->content->length);
+          e_cur->content->length = -1;
+        }
+      }
+      else if (tmploc != m->size)
+      {
+        /* content-length would put us past the end of the file, so it
+         * must be wrong */
+        e_cur->content->length = -1;
+      }
+
+      if (e_cur->content->length != -1)
+      {
+        /* good content-length.  check to see if we know how many lines
+         * are in this message.  */
+        if (e_cur->lines == 0)
+          e_cur->lines = map_count_lines(data + loc, e_cur->content->length);
+
+        pos = tmploc;
+      }
+    }
+
+    m->msg_count++;
+
+    if (TAILQ_EMPTY(&e_cur->env->return_path) && return_path[0])
+      mutt_addrlist_parse(&e_cur->env->return_path, return_path);
+
+    if (TAILQ_EMPTY(&e_cur->env->from))
+      mutt_addrlist_copy(&e_cur->env->from, &e_cur->env->return_path, false);
+
+    lines = 0;
+  }
+
+  /* Only set the content-length of the previous message if we have read more
+   * than one message during _this_ invocation, see mbox_parse_mailbox() */
+  if (count > 0)
+  {
+    struct Email *e = m->emails[m->msg_count - 1];
+    if (e->content->length < 0)
+    {
+      e->content->length = pos - e->content->offset - 1;
+      if (e->content->length < 0)
+        e->content->length = 0;
+    }
+
+    if (!e->lines)
+      e->lines = lines ? lines - 1 : 0;
+  }
+
+  if (SigInt == 1)
+  {
+    SigInt = 0;
+    return -2; /* action aborted */
+  }
+
+  return 0;
+}
+#endif
+
 /**
  * mmdf_parse_mailbox - Read a mailbox in MMDF format
  * @param m Mailbox
@@ -218,6 +722,17 @@ static int mmdf_parse_mailbox(struct Mailbox *m)
     mutt_progress_init(&progress, msg, MUTT_PROGRESS_READ, 0);
   }
 
+#ifdef MBOX_MMAP
+  struct MboxMap map;
+  loc = ftello(adata->fp);
+  if ((loc >= 0) && mbox_map_open(m, &map))
+  {
+    int rc = mmdf_parse_map(m, &map, loc, &progress);
+    mbox_map_close(m, &map);
+    return rc;
+  }
+#endif
+
   while (true)
   {
     if (!fgets(buf, sizeof(buf) - 1, adata->fp))
@@ -384,6 +899,17 @@ static int mbox_parse_mailbox(struct Mailbox *m)
   }
 
   loc = ftello(adata->fp);
+
+#ifdef MBOX_MMAP
+  struct MboxMap map;
+  if ((loc >= 0) && mbox_map_open(m, &map))
+  {
+    int rc = mbox_parse_map(m, &map, loc, &progress);
+    mbox_map_close(m, &map);
+    return rc;
+  }
+#endif
+
   while ((fgets(buf, sizeof(buf), adata->fp)) && (SigInt != 1))
   {
     if (is_from(buf, return_path, sizeof(return_path), &t))
@@ -530,6 +1056,337 @@ static int mbox_parse_mailbox(struct Mailbox *m)
   return 0;
 }
 
+#ifdef USE_HCACHE
+/**
+ * mbox_hcache_key - Create a header cache key for a message
+ * @param buf    Buffer for the key
+ * @param buflen Length of buffer
+ * @param mcm    Location of the message
+ * @retval num Length of the key
+ */
+static size_t mbox_hcache_key(char *buf, size_t buflen, const struct MboxCacheMsg *mcm)
+{
+  return snprintf(buf, buflen, "/" OFF_T_FMT "/" OFF_T_FMT, mcm->offset, mcm->length);
+}
+
+/**
+ * mbox_hcache_sep_offset - Get the offset of a message's separator
+ * @param m Mailbox
+ * @param e Email
+ * @retval num Offset of the "From " line, or MMDF separator
+ */
+static LOFF_T mbox_hcache_sep_offset(struct Mailbox *m, const struct Email *e)
+{
+  /* An MMDF message starts after its separator */
+  if (m->type == MUTT_MMDF)
+    return e->offset - (sizeof(MMDF_SEP) - 1);
+  return e->offset;
+}
+
+/**
+ * mbox_hcache_digest - Get the digest of a message's separator and headers
+ * @param[in]  fd     File descriptor of the mailbox
+ * @param[in]  mcm    Location of the message
+ * @param[out] digest Buffer for the MD5 digest, 16 bytes
+ * @param[in]  buf    Scratch buffer, grown as needed
+ * @param[in]  buflen Length of the scratch buffer
+ * @retval true Success
+ *
+ * The flags live in the headers (Status:, X-Status:), so a digest of them
+ * catches changes that leave every message at the same offset.
+ */
+static bool mbox_hcache_digest(int fd, const struct MboxCacheMsg *mcm,
+                               unsigned char *digest, char **buf, size_t *buflen)
+{
+  if (mcm->hdr_length > *buflen)
+  {
+    *buflen = mcm->hdr_length;
+    mutt_mem_realloc(buf, *buflen);
+  }
+
+  if (pread(fd, *buf, mcm->hdr_length, mcm->offset) != (ssize_t) mcm->hdr_length)
+    return false;
+
+  mutt_md5_bytes(*buf, mcm->hdr_length, digest);
+  return true;
+}
+
+/**
+ * mbox_hcache_verify - Are the cached messages still in the file?
+ * @param m   Mailbox
+ * @param fd  File descriptor of the mailbox
+ * @param mch Cached mbox data
+ * @param mcm Cached message locations
+ * @retval true All the cached messages are unchanged
+ *
+ * If new mail has been appended to the mailbox, we expect the headers of
+ * every old message to be unchanged and a message separator at the old end
+ * of the file.  The bodies aren't cached, so they aren't checked.
+ */
+static bool mbox_hcache_verify(struct Mailbox *m, int fd, const struct MboxCacheHeader *mch,
+                               const struct MboxCacheMsg *mcm)
+{
+  /* "From " and MMDF_SEP are the same length */
+  const char *sep = (m->type == MUTT_MMDF) ? MMDF_SEP : "From ";
+  const size_t seplen = sizeof(MMDF_SEP) - 1;
+  char sepbuf[sizeof(MMDF_SEP)];
+
+  if ((pread(fd, sepbuf, seplen, mch->size) != (ssize_t) seplen) ||
+      (memcmp(sepbuf, sep, seplen) != 0))
+  {
+    mutt_debug(LL_DEBUG2, "no message separator at " OFF_T_FMT "\n", mch->size);
+    return false;
+  }
+
+  bool rc = true;
+  char *buf = NULL;
+  size_t buflen = 0;
+  unsigned char digest[16];
+  for (int i = 0; i < mch->count; i++)
+  {
+    if (!mbox_hcache_digest(fd, &mcm[i], digest, &buf, &buflen) ||
+        (memcmp(digest, mcm[i].hdr_digest, sizeof(digest)) != 0))
+    {
+      mutt_debug(LL_DEBUG2, "headers changed at " OFF_T_FMT "\n", mcm[i].offset);
+      rc = false;
+      break;
+    }
+  }
+
+  FREE(&buf);
+  return rc;
+}
+
+/**
+ * mbox_hcache_purge - Delete the cached messages that have gone
+ * @param hc    Header cache
+ * @param old   Previously cached message locations
+ * @param count Number of old locations
+ * @param mcm   Current message locations
+ * @param num   Number of current locations
+ *
+ * Each message is keyed by its location, so when the mailbox is rewritten
+ * (sync, expunge, another program) the old keys must be removed.
+ * Both lists are in file order.
+ */
+static void mbox_hcache_purge(struct HeaderCache *hc, const struct MboxCacheMsg *old,
+                              int count, const struct MboxCacheMsg *mcm, int num)
+{
+  char key[64];
+  int purged = 0;
+  for (int i = 0, j = 0; i < count; i++)
+  {
+    while ((j < num) && (mcm[j].offset < old[i].offset))
+      j++;
+    if ((j < num) && (mcm[j].offset == old[i].offset) && (mcm[j].length == old[i].length))
+      continue;
+
+    size_t keylen = mbox_hcache_key(key, sizeof(key), &old[i]);
+    mutt_hcache_delete_record(hc, key, keylen);
+    purged++;
+  }
+
+  if (purged > 0)
+    mutt_debug(LL_DEBUG2, "purged %d stale messages from the header cache\n", purged);
+}
+
+/**
+ * mbox_hcache_parse - Check the size of the cached mbox data
+ * @param[in]  data Raw data from the header cache
+ * @param[in]  dlen Length of the data
+ * @param[out] mch  Cached mbox data
+ * @retval true The data is valid, and followed by mch->count MboxCacheMsg
+ */
+static bool mbox_hcache_parse(const void *data, size_t dlen, struct MboxCacheHeader *mch)
+{
+  if (!data || (dlen < sizeof(*mch)))
+    return false;
+
+  memcpy(mch, data, sizeof(*mch));
+  return (mch->count >= 0) &&
+         (dlen == (sizeof(*mch) + mch->count * sizeof(struct MboxCacheMsg)));
+}
+
+/**
+ * mbox_hcache_restore - Restore the unchanged messages from the header cache
+ * @param m  Mailbox
+ * @param hc Header cache
+ * @param sb Mailbox file's stat info
+ * @retval num Number of messages restored
+ *
+ * If the mailbox hasn't changed, or new mail has only been appended to it, the
+ * cached messages are added to the Mailbox.  The file is left positioned at the
+ * first message that still needs parsing.
+ */
+static int mbox_hcache_restore(struct Mailbox *m, struct HeaderCache *hc,
+                               const struct stat *sb)
+{
+  struct MboxAccountData *adata = mbox_adata_get(m);
+  if (!adata || !hc)
+    return 0;
+
+  size_t dlen = 0;
+  void *data = mutt_hcache_fetch_raw(hc, MBOX_HC_KEY, sizeof(MBOX_HC_KEY) - 1, &dlen);
+  if (!data)
+    return 0;
+
+  int count = 0;
+  struct MboxCacheHeader mch;
+  if (!mbox_hcache_parse(data, dlen, &mch))
+    goto done;
+
+  if ((mch.crc != hc->crc) || (mch.type != m->type) || (mch.dev != sb->st_dev) ||
+      (mch.ino != sb->st_ino) || (mch.size > sb->st_size))
+  {
+    goto done;
+  }
+
+  struct MboxCacheMsg *mcm =
+      (mch.count > 0) ? mutt_mem_malloc(mch.count * sizeof(struct MboxCacheMsg)) : NULL;
+  if (mcm)
+    memcpy(mcm, (char *) data + sizeof(mch), mch.count * sizeof(struct MboxCacheMsg));
+
+  if (mch.size == sb->st_size)
+  {
+    /* The same size, but changed, means the mailbox was rewritten */
+    if (mutt_file_stat_timespec_compare((struct stat *) sb, MUTT_STAT_MTIME, &mch.mtime) != 0)
+    {
+      FREE(&mcm);
+      goto done;
+    }
+  }
+  else if (!mbox_hcache_verify(m, fileno(adata->fp), &mch, mcm))
+  {
+    FREE(&mcm);
+    goto done;
+  }
+
+  char key[64];
+  for (; count < mch.count; count++)
+  {
+    size_t keylen = mbox_hcache_key(key, sizeof(key), &mcm[count]);
+    struct HCacheEntry hce = mutt_hcache_fetch(hc, key, keylen, 0);
+    if (!hce.email)
+      break;
+
+    if (m->msg_count == m->email_max)
+      mx_alloc_memory(m);
+
+    hce.email->index = m->msg_count;
+    m->emails[m->msg_count++] = hce.email;
+  }
+
+  /* Parse everything after the last message we restored */
+  const LOFF_T tail = (count < mch.count) ? mcm[count].offset : mch.size;
+  if (fseeko(adata->fp, tail, SEEK_SET) != 0)
+  {
+    mutt_debug(LL_DEBUG1, "fseeko() failed\n");
+    for (int i = m->msg_count - count; i < m->msg_count; i++)
+      email_free(&m->emails[i]);
+    m->msg_count -= count;
+    count = 0;
+    rewind(adata->fp);
+  }
+
+  mutt_debug(LL_DEBUG2, "restored %d of %d messages from the header cache\n", count, mch.count);
+  FREE(&mcm);
+
+done:
+  mutt_hcache_free_raw(hc, &data);
+  return count;
+}
+
+/**
+ * mbox_hcache_save - Save the messages to the header cache
+ * @param m        Mailbox
+ * @param hc       Header cache
+ * @param restored Number of messages that came from the cache
+ *
+ * The newly parsed messages are stored, followed by the list of all the
+ * messages and the state of the mailbox file.
+ */
+static void mbox_hcache_save(struct Mailbox *m, struct HeaderCache *hc, int restored)
+{
+  struct MboxAccountData *adata = mbox_adata_get(m);
+  if (!adata || !hc)
+    return;
+
+  struct stat sb;
+  LOFF_T end = ftello(adata->fp);
+  if ((end < 0) || (fstat(fileno(adata->fp), &sb) != 0))
+    return;
+
+  const size_t dlen = sizeof(struct MboxCacheHeader) + m->msg_count * sizeof(struct MboxCacheMsg);
+  char *data = mutt_mem_calloc(1, dlen);
+  struct MboxCacheHeader *mch = (struct MboxCacheHeader *) data;
+  struct MboxCacheMsg *mcm = (struct MboxCacheMsg *) (data + sizeof(*mch));
+
+  mch->crc = hc->crc;
+  mch->type = m->type;
+  mch->dev = sb.st_dev;
+  mch->ino = sb.st_ino;
+  mch->size = end;
+  mutt_file_get_stat_timespec(&mch->mtime, &sb, MUTT_STAT_MTIME);
+  mch->count = m->msg_count;
+
+  for (int i = 0; i < m->msg_count; i++)
+    mcm[i].offset = mbox_hcache_sep_offset(m, m->emails[i]);
+  for (int i = 0; i < m->msg_count; i++)
+  {
+    struct Email *e = m->emails[i];
+    mcm[i].length = ((i + 1 < m->msg_count) ? mcm[i + 1].offset : end) - mcm[i].offset;
+    mcm[i].hdr_length = e->content ? (e->content->offset - mcm[i].offset) : 0;
+  }
+
+  /* The restored messages were verified, so their digests are unchanged */
+  size_t olen = 0;
+  void *odata = mutt_hcache_fetch_raw(hc, MBOX_HC_KEY, sizeof(MBOX_HC_KEY) - 1, &olen);
+  struct MboxCacheHeader omch = { 0 };
+  struct MboxCacheMsg *omcm = NULL;
+  if (mbox_hcache_parse(odata, olen, &omch) && (omch.count > 0))
+  {
+    omcm = mutt_mem_malloc(omch.count * sizeof(*omcm));
+    memcpy(omcm, (char *) odata + sizeof(omch), omch.count * sizeof(*omcm));
+  }
+  else
+  {
+    omch.count = 0;
+  }
+  mutt_hcache_free_raw(hc, &odata);
+
+  char *buf = NULL;
+  size_t buflen = 0;
+  for (int i = 0; i < m->msg_count; i++)
+  {
+    if ((i < restored) && (i < omch.count))
+      memcpy(mcm[i].hdr_digest, omcm[i].hdr_digest, sizeof(mcm[i].hdr_digest));
+    else if (!mbox_hcache_digest(fileno(adata->fp), &mcm[i], mcm[i].hdr_digest, &buf, &buflen))
+    {
+      mch->count = i; // Only cache the messages we can verify
+      break;
+    }
+  }
+  FREE(&buf);
+
+  mutt_hcache_begin(hc);
+
+  mbox_hcache_purge(hc, omcm, omch.count, mcm, mch->count);
+  FREE(&omcm);
+
+  char key[64];
+  for (int i = restored; i < mch->count; i++)
+  {
+    size_t keylen = mbox_hcache_key(key, sizeof(key), &mcm[i]);
+    mutt_hcache_store(hc, key, keylen, m->emails[i], 0);
+  }
+
+  mutt_hcache_store_raw(hc, MBOX_HC_KEY, sizeof(MBOX_HC_KEY) - 1, data,
+                        sizeof(*mch) + mch->count * sizeof(*mcm));
+  mutt_hcache_commit(hc);
+  FREE(&data);
+}
+#endif
+
 /**
  * reopen_mailbox - Close and reopen a mailbox
  * @param m          Mailbox
@@ -607,10 +1464,16 @@ static int reopen_mailbox(struct Mailbox *m)
       adata->fp = mutt_file_fopen(mailbox_path(m), "r");
       if (!adata->fp)
         rc = -1;
-      else if (m->type == MUTT_MBOX)
-        rc = mbox_parse_mailbox(m);
       else
-        rc = mmdf_parse_mailbox(m);
+      {
+        mbox_index_load(m, adata->fp);
+        if (m->type == MUTT_MBOX)
+          rc = mbox_parse_mailbox(m);
+        else
+          rc = mmdf_parse_mailbox(m);
+        if (rc == 0)
+          mbox_index_save(m, adata->fp, false);
+      }
       break;
 
     default:
@@ -954,6 +1817,20 @@ static int mbox_mbox_open(struct Mailbox *m)
   }
 
   m->has_new = true;
+
+  int restored = 0;
+#ifdef USE_HCACHE
+  struct HeaderCache *hc = NULL;
+  struct stat sb;
+  if (fstat(fileno(adata->fp), &sb) == 0)
+  {
+    hc = mutt_hcache_open(C_HeaderCache, mailbox_path(m), NULL);
+    restored = mbox_hcache_restore(m, hc, &sb);
+  }
+#endif
+  if (restored == 0)
+    mbox_index_load(m, adata->fp);
+
   int rc;
   if (m->type == MUTT_MBOX)
     rc = mbox_parse_mailbox(m);
@@ -962,6 +1839,14 @@ static int mbox_mbox_open(struct Mailbox *m)
   else
     rc = -1;
 
+#ifdef USE_HCACHE
+  if (rc == 0)
+    mbox_hcache_save(m, hc, restored);
+  mutt_hcache_close(hc);
+#endif
+  if (rc == 0)
+    mbox_index_save(m, adata->fp, false);
+
   if (!mbox_has_new(m))
     m->has_new = false;
   clearerr(adata->fp); // Clear the EOF flag
@@ -1103,7 +1988,10 @@ static int mbox_mbox_check(struct Mailbox *m)
             mmdf_parse_mailbox(m);
 
           if (m->msg_count > old_msg_count)
+          {
+            mbox_index_save(m, adata->fp, false);
             mailbox_changed(m, NT_MAILBOX_INVALID);
+          }
 
           /* Only unlock the folder if it was locked inside of this routine.
            * It may have been locked elsewhere, like in
@@ -1468,6 +2356,8 @@ static int mbox_mbox_sync(struct Mailbox *m)
   mutt_buffer_pool_release(&tempfile);
   mutt_sig_unblock();
 
+  mbox_index_save(m, adata->fp, true);
+
   if (C_CheckMboxSize)
   {
     struct Mailbox *m_tmp = mailbox_find(mailbox_path(m));
@@ -1851,6 +2741,7 @@ struct MxOps MxMboxOps = {
   .ac_find          = mbox_ac_find,
   .ac_add           = mbox_ac_add,
   .mbox_open        = mbox_mbox_open,
+  .mbox_load        = NULL,
   .mbox_open_append = mbox_mbox_open_append,
   .mbox_check       = mbox_mbox_check,
   .mbox_check_stats = mbox_mbox_check_stats,
@@ -1880,6 +2771,7 @@ struct MxOps MxMmdfOps = {
   .ac_find          = mbox_ac_find,
   .ac_add           = mbox_ac_add,
   .mbox_open        = mbox_mbox_open,
+  .mbox_load        = NULL,
   .mbox_open_append = mbox_mbox_open_append,
   .mbox_check       = mbox_mbox_check,
   .mbox_check_stats = mbox_mbox_check_stats,
@@ -0,0 +1,36 @@
+/**
+ * @file
+ * Mbox private types
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUTT_MBOX_PRIVATE_H
+#define MUTT_MBOX_PRIVATE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+struct Mailbox;
+
+extern bool C_MboxIndex;
+
+int  mbox_index_load(struct Mailbox *m, FILE *fp);
+void mbox_index_save(struct Mailbox *m, FILE *fp, bool purged);
+
+#endif /* MUTT_MBOX_PRIVATE_H */
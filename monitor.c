@@ -43,6 +43,7 @@
 #include "monitor.h"
 #include "context.h"
 #include "mutt_globals.h"
+#include "maildir/lib.h"
 #ifndef HAVE_INOTIFY_INIT1
 #include <fcntl.h>
 #endif
@@ -60,6 +61,8 @@ static int MonitorContextDescriptor = -1;
 
 #define INOTIFY_MASK_DIR (IN_MOVED_TO | IN_ATTRIB | IN_CLOSE_WRITE | IN_ISDIR)
 #define INOTIFY_MASK_FILE IN_CLOSE_WRITE
+#define INOTIFY_MASK_NAMED (IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE)
+#define INOTIFY_MASK_MAILDIR (INOTIFY_MASK_DIR | INOTIFY_MASK_NAMED)
 
 #define EVENT_BUFLEN MAX(4096, sizeof(struct inotify_event) + NAME_MAX + 1)
 
@@ -86,6 +89,8 @@ struct Monitor
   ino_t st_ino;
   enum MailboxType type;
   int desc;
+  int cur_desc;            ///< Watch descriptor of a Maildir's cur/ directory
+  struct Mailbox *mailbox; ///< Maildir whose counts are kept up to date
 };
 
 /**
@@ -209,6 +214,7 @@ static struct Monitor *monitor_new(struct MonitorInfo *info, int descriptor)
   monitor->st_dev = info->st_dev;
   monitor->st_ino = info->st_ino;
   monitor->desc = descriptor;
+  monitor->cur_desc = -1;
   monitor->next = Monitor;
   if (info->type == MUTT_MH)
     monitor->mh_backup_path = mutt_str_dup(info->path);
@@ -262,6 +268,120 @@ static void monitor_delete(struct Monitor *monitor)
   *ptr = monitor;
 }
 
+/**
+ * monitor_find - Find the monitor that owns a watch
+ * @param desc Watch descriptor
+ * @retval ptr Monitor
+ * @retval NULL Not found
+ */
+static struct Monitor *monitor_find(int desc)
+{
+  struct Monitor *iter = Monitor;
+  while (iter && (iter->desc != desc) && (iter->cur_desc != desc))
+    iter = iter->next;
+
+  return iter;
+}
+
+/**
+ * monitor_context_stop - Stop queueing events for the current Maildir
+ */
+static void monitor_context_stop(void)
+{
+  if (Context && Context->mailbox)
+    maildir_monitor_event(Context->mailbox, MAILDIR_EV_STOP, NULL, NULL);
+}
+
+/**
+ * monitor_maildir_event - Pass a file event to a monitor's Maildirs
+ * @param monitor Monitor that received the event
+ * @param ev      Event, e.g. #MAILDIR_EV_ADD
+ * @param subdir  Subdirectory of the file, e.g. 'new'
+ * @param name    Filename
+ *
+ * The Mailbox from the mailboxes list keeps its counts up to date.  If the
+ * current Mailbox is a separate object, it's told too.
+ */
+static void monitor_maildir_event(struct Monitor *monitor, enum MaildirEvent ev,
+                                  const char *subdir, const char *name)
+{
+  if (monitor->cur_desc == -1)
+    return;
+
+  if (monitor->mailbox)
+    maildir_monitor_event(monitor->mailbox, ev, subdir, name);
+
+  if ((monitor->desc == MonitorContextDescriptor) && Context &&
+      Context->mailbox && (Context->mailbox != monitor->mailbox))
+  {
+    maildir_monitor_event(Context->mailbox, ev, subdir, name);
+  }
+}
+
+/**
+ * monitor_maildir_watch - Report every file of a Maildir
+ * @param monitor Monitor of the Maildir's new/ directory
+ * @param m       Mailbox to keep up to date
+ *
+ * Add a watch on cur/ too, so that every file that's added to, or removed
+ * from, the Maildir is reported.  The driver uses the events to keep its
+ * counts up to date without rescanning the directories.
+ */
+static void monitor_maildir_watch(struct Monitor *monitor, struct Mailbox *m)
+{
+  if (!m || (monitor->type != MUTT_MAILDIR))
+    return;
+
+  if (monitor->cur_desc == -1)
+  {
+    struct Buffer *buf = mutt_buffer_pool_get();
+    mutt_buffer_printf(buf, "%s/cur", m->realpath);
+    monitor->cur_desc = inotify_add_watch(INotifyFd, mutt_b2s(buf), INOTIFY_MASK_MAILDIR);
+    if (monitor->cur_desc == -1)
+    {
+      mutt_debug(LL_DEBUG2, "inotify_add_watch failed for '%s', errno=%d %s\n",
+                 mutt_b2s(buf), errno, strerror(errno));
+    }
+    else
+    {
+      mutt_debug(LL_DEBUG3, "inotify_add_watch descriptor=%d for '%s'\n",
+                 monitor->cur_desc, mutt_b2s(buf));
+    }
+    mutt_buffer_pool_release(&buf);
+
+    if (monitor->cur_desc == -1)
+      return;
+  }
+
+  if (monitor->mailbox == m)
+    return;
+
+  if (monitor->mailbox)
+    maildir_monitor_event(monitor->mailbox, MAILDIR_EV_UNWATCH, NULL, NULL);
+  monitor->mailbox = m;
+  maildir_monitor_event(m, MAILDIR_EV_WATCH, NULL, NULL);
+}
+
+/**
+ * monitor_maildir_unwatch - Stop reporting the files of a Maildir
+ * @param monitor Monitor of the Maildir's new/ directory
+ */
+static void monitor_maildir_unwatch(struct Monitor *monitor)
+{
+  if (monitor->cur_desc != -1)
+  {
+    inotify_rm_watch(INotifyFd, monitor->cur_desc);
+    mutt_debug(LL_DEBUG3, "inotify_rm_watch descriptor=%d\n", monitor->cur_desc);
+    monitor->cur_desc = -1;
+  }
+
+  if (monitor->mailbox)
+  {
+    maildir_monitor_event(monitor->mailbox, MAILDIR_EV_UNWATCH, NULL, NULL);
+    monitor->mailbox = NULL;
+  }
+}
+
 /**
  * monitor_handle_ignore - Listen for when a backup file is closed
  * @param desc Watch descriptor
@@ -302,10 +422,15 @@ static int monitor_handle_ignore(int desc)
     }
 
     if (MonitorContextDescriptor == desc)
+    {
+      if (iter->cur_desc != -1)
+        monitor_context_stop();
       MonitorContextDescriptor = new_desc;
+    }
 
     if (new_desc == -1)
     {
+      monitor_maildir_unwatch(iter);
       monitor_delete(iter);
       monitor_check_free();
     }
@@ -380,6 +505,92 @@ static enum ResolveResult monitor_resolve(struct MonitorInfo *info, struct Mailb
   return iter ? RESOLVE_RES_OK_EXISTING : RESOLVE_RES_OK_NOTEXISTING;
 }
 
+/**
+ * monitor_read_events - Read and dispatch the queued inotify events
+ * @retval true At least one event was read
+ */
+static bool monitor_read_events(void)
+{
+  char buf[EVENT_BUFLEN] __attribute__((aligned(__alignof__(struct inotify_event))));
+  bool found = false;
+
+  const struct inotify_event *event = NULL;
+
+  while (true)
+  {
+    char *ptr = buf;
+    int len = read(INotifyFd, buf, sizeof(buf));
+    if (len == -1)
+    {
+      if (errno != EAGAIN)
+      {
+        mutt_debug(LL_DEBUG2, "read inotify events failed, errno=%d %s\n",
+                   errno, strerror(errno));
+      }
+      break;
+    }
+
+    found = true;
+    while (ptr < (buf + len))
+    {
+      event = (const struct inotify_event *) ptr;
+      mutt_debug(LL_DEBUG3, "+ detail: descriptor=%d mask=0x%x\n",
+                 event->wd, event->mask);
+      if (event->mask & IN_Q_OVERFLOW)
+      {
+        MonitorContextChanged = true;
+        for (struct Monitor *iter = Monitor; iter; iter = iter->next)
+          monitor_maildir_event(iter, MAILDIR_EV_OVERFLOW, NULL, NULL);
+      }
+      else if (event->mask & IN_IGNORED)
+      {
+        struct Monitor *monitor = monitor_find(event->wd);
+        if (monitor && (event->wd == monitor->cur_desc))
+        {
+          if (monitor->desc == MonitorContextDescriptor)
+            monitor_context_stop();
+          monitor_maildir_unwatch(monitor);
+        }
+        else
+          monitor_handle_ignore(event->wd);
+      }
+      else
+      {
+        struct Monitor *monitor = monitor_find(event->wd);
+        if (monitor && (monitor->desc == MonitorContextDescriptor))
+          MonitorContextChanged = true;
+
+        if (monitor && (event->len != 0) &&
+            (event->mask & INOTIFY_MASK_NAMED) && !(event->mask & IN_ISDIR))
+        {
+          monitor_maildir_event(monitor,
+                                (event->mask & (IN_CREATE | IN_MOVED_TO)) ?
+                                    MAILDIR_EV_ADD :
+                                    MAILDIR_EV_REMOVE,
+                                (event->wd == monitor->cur_desc) ? "cur" : "new",
+                                event->name);
+        }
+      }
+      ptr += sizeof(struct inotify_event) + event->len;
+    }
+  }
+
+  return found;
+}
+
+/**
+ * mutt_monitor_drain - Handle the queued filesystem changes now
+ *
+ * The events are dispatched as mutt_monitor_poll() would, without waiting.
+ * Call this before counting a Mailbox from scratch, so that changes the count
+ * already includes aren't applied again afterwards.
+ */
+void mutt_monitor_drain(void)
+{
+  if ((INotifyFd != -1) && monitor_read_events())
+    MonitorFilesChanged = true;
+}
+
 /**
  * mutt_monitor_poll - Check for filesystem changes
  * @retval -3 unknown/unexpected events: poll timeout / fds not handled by us
@@ -397,7 +608,6 @@ static enum ResolveResult monitor_resolve(struct MonitorInfo *info, struct Mailb
 int mutt_monitor_poll(void)
 {
   int rc = 0;
-  char buf[EVENT_BUFLEN] __attribute__((aligned(__alignof__(struct inotify_event))));
 
   MonitorFilesChanged = false;
 
@@ -429,34 +639,7 @@ int mutt_monitor_poll(void)
           {
             MonitorFilesChanged = true;
             mutt_debug(LL_DEBUG3, "file change(s) detected\n");
-            char *ptr = buf;
-            const struct inotify_event *event = NULL;
-
-            while (true)
-            {
-              int len = read(INotifyFd, buf, sizeof(buf));
-              if (len == -1)
-              {
-                if (errno != EAGAIN)
-                {
-                  mutt_debug(LL_DEBUG2, "read inotify events failed, errno=%d %s\n",
-                             errno, strerror(errno));
-                }
-                break;
-              }
-
-              while (ptr < (buf + len))
-              {
-                event = (const struct inotify_event *) ptr;
-                mutt_debug(LL_DEBUG3, "+ detail: descriptor=%d mask=0x%x\n",
-                           event->wd, event->mask);
-                if (event->mask & IN_IGNORED)
-                  monitor_handle_ignore(event->wd);
-                else if (event->wd == MonitorContextDescriptor)
-                  MonitorContextChanged = true;
-                ptr += sizeof(struct inotify_event) + event->len;
-              }
-            }
+            monitor_read_events();
           }
         }
       }
@@ -468,6 +651,28 @@ int mutt_monitor_poll(void)
   return rc;
 }
 
+/**
+ * monitor_watch - Attach a Mailbox to its monitor
+ * @param monitor Monitor
+ * @param m       Mailbox, NULL for the current Mailbox
+ *
+ * A Mailbox from the mailboxes list owns a Maildir's counts.  The current
+ * Mailbox only uses them if it isn't in the list.
+ */
+static void monitor_watch(struct Monitor *monitor, struct Mailbox *m)
+{
+  if (m)
+  {
+    monitor_maildir_watch(monitor, m);
+    return;
+  }
+
+  MonitorContextDescriptor = monitor->desc;
+  monitor_maildir_watch(monitor, monitor->mailbox ? monitor->mailbox : Context->mailbox);
+  if (monitor->cur_desc != -1)
+    maildir_monitor_event(Context->mailbox, MAILDIR_EV_START, NULL, NULL);
+}
+
 /**
  * mutt_monitor_add - Add a watch for a mailbox
  * @param m Mailbox to watch
@@ -485,13 +690,18 @@ int mutt_monitor_add(struct Mailbox *m)
   enum ResolveResult desc = monitor_resolve(&info, m);
   if (desc != RESOLVE_RES_OK_NOTEXISTING)
   {
-    if (!m && (desc == RESOLVE_RES_OK_EXISTING))
-      MonitorContextDescriptor = info.monitor->desc;
+    if (desc == RESOLVE_RES_OK_EXISTING)
+      monitor_watch(info.monitor, m);
     rc = (desc == RESOLVE_RES_OK_EXISTING) ? 0 : -1;
     goto cleanup;
   }
 
-  uint32_t mask = info.is_dir ? INOTIFY_MASK_DIR : INOTIFY_MASK_FILE;
+  /* Only a Maildir's events name the files, see monitor_maildir_watch() */
+  uint32_t mask = INOTIFY_MASK_FILE;
+  if (info.type == MUTT_MAILDIR)
+    mask = INOTIFY_MASK_MAILDIR;
+  else if (info.is_dir)
+    mask = INOTIFY_MASK_DIR;
   if (((INotifyFd == -1) && (monitor_init() == -1)) ||
       ((desc = inotify_add_watch(INotifyFd, info.path, mask)) == -1))
   {
@@ -502,10 +712,7 @@ int mutt_monitor_add(struct Mailbox *m)
   }
 
   mutt_debug(LL_DEBUG3, "inotify_add_watch descriptor=%d for '%s'\n", desc, info.path);
-  if (!m)
-    MonitorContextDescriptor = desc;
-
-  monitor_new(&info, desc);
+  monitor_watch(monitor_new(&info, desc), m);
 
 cleanup:
   monitor_info_free(&info);
@@ -531,6 +738,7 @@ int mutt_monitor_remove(struct Mailbox *m)
 
   if (!m)
   {
+    monitor_context_stop();
     MonitorContextDescriptor = -1;
     MonitorContextChanged = false;
   }
@@ -548,6 +756,9 @@ int mutt_monitor_remove(struct Mailbox *m)
       if ((monitor_resolve(&info2, NULL) == RESOLVE_RES_OK_EXISTING) &&
           (info.st_ino == info2.st_ino) && (info.st_dev == info2.st_dev))
       {
+        /* The current Mailbox takes over the counts */
+        if (info.monitor->mailbox == m)
+          monitor_maildir_watch(info.monitor, Context->mailbox);
         rc = 1;
         goto cleanup;
       }
@@ -562,7 +773,8 @@ int mutt_monitor_remove(struct Mailbox *m)
     }
   }
 
-  inotify_rm_watch(info.monitor->desc, INotifyFd);
+  monitor_maildir_unwatch(info.monitor);
+  inotify_rm_watch(INotifyFd, info.monitor->desc);
   mutt_debug(LL_DEBUG3, "inotify_rm_watch for '%s' descriptor=%d\n", info.path,
              info.monitor->desc);
 
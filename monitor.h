@@ -31,6 +31,7 @@ extern bool MonitorFilesChanged;   ///< true after a monitored file has changed
 extern bool MonitorContextChanged; ///< true after the current mailbox has changed
 
 int mutt_monitor_add(struct Mailbox *m);
+void mutt_monitor_drain(void);
 int mutt_monitor_remove(struct Mailbox *m);
 int mutt_monitor_poll(void);
 
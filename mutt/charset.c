@@ -34,6 +34,7 @@
 #include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "charset.h"
 #include "buffer.h"
@@ -44,6 +45,9 @@
 #ifdef ENABLE_NLS
 #include <libintl.h>
 #endif
+#ifdef USE_PTHREAD
+#include <pthread.h>
+#endif
 
 #ifndef EILSEQ
 #define EILSEQ EINVAL
@@ -431,22 +435,49 @@ bool mutt_ch_chscmp(const char *cs1, const char *cs2)
                           ((len1 > len2) ? cs2 : buf), MIN(len1, len2));
 }
 
+#ifdef USE_PTHREAD
+static pthread_once_t DefaultCharsetOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t DefaultCharsetKey; ///< Each thread's default charset buffer
+
+/**
+ * default_charset_key_create - Create the key for the per-thread buffer
+ */
+static void default_charset_key_create(void)
+{
+  pthread_key_create(&DefaultCharsetKey, free);
+}
+#endif
+
 /**
  * mutt_ch_get_default_charset - Get the default character set
  * @retval ptr Name of the default character set
  *
  * @warning This returns a pointer to a static buffer.  Do not free it.
+ *
+ * @note Each thread has its own buffer, so headers can be parsed on worker threads.
  */
 char *mutt_ch_get_default_charset(void)
 {
+#ifdef USE_PTHREAD
+  pthread_once(&DefaultCharsetOnce, default_charset_key_create);
+  char *fcharset = pthread_getspecific(DefaultCharsetKey);
+  if (!fcharset)
+  {
+    fcharset = mutt_mem_calloc(1, 128);
+    pthread_setspecific(DefaultCharsetKey, fcharset);
+  }
+  const size_t fsize = 128;
+#else
   static char fcharset[128];
+  const size_t fsize = sizeof(fcharset);
+#endif
   const char *c = C_AssumedCharset;
   const char *c1 = NULL;
 
   if (c)
   {
     c1 = strchr(c, ':');
-    mutt_str_copy(fcharset, c, c1 ? (c1 - c + 1) : sizeof(fcharset));
+    mutt_str_copy(fcharset, c, c1 ? MIN(c1 - c + 1, fsize) : fsize);
     return fcharset;
   }
   return strcpy(fcharset, "us-ascii");
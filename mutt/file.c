@@ -1627,3 +1627,130 @@ void mutt_file_resolve_symlink(struct Buffer *buf)
     }
   }
 }
+
+/**
+ * mutt_file_read_dir - Read the entries of a directory
+ * @param path  Directory to read
+ * @param cb    Callback function for each entry
+ * @param data  Private data passed to the callback
+ * @param calls Incremented by the number of system calls used (OPTIONAL)
+ * @retval  0 Success
+ * @retval  1 The callback stopped the read
+ * @retval -1 Error, see errno
+ *
+ * Where getdents64() is available, the entries are read in large batches, so
+ * even a huge directory only takes a handful of system calls.  Otherwise,
+ * readdir() is used and each entry is counted as a call.
+ *
+ * The inode number and type come straight from the directory, so the caller
+ * doesn't need to stat() the entries.  The type may be DT_UNKNOWN if the
+ * filesystem doesn't provide it.
+ */
+int mutt_file_read_dir(const char *path, mutt_file_dir_t cb, void *data, size_t *calls)
+{
+  if (!path || !cb)
+  {
+    errno = EINVAL;
+    return -1;
+  }
+
+  int rc = 0;
+#ifdef HAVE_GETDENTS64
+  const size_t buflen = 256 * 1024;
+
+  int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+
+  char *buf = mutt_mem_malloc(buflen);
+  while (rc == 0)
+  {
+    ssize_t len = getdents64(fd, buf, buflen);
+    if (calls)
+      (*calls)++;
+    if (len <= 0)
+    {
+      if (len < 0)
+        rc = -1;
+      break;
+    }
+
+    for (ssize_t off = 0; off < len;)
+    {
+      struct dirent64 *de = (struct dirent64 *) (buf + off);
+      off += de->d_reclen;
+      /* Deleted entries have no inode; readdir() skips them too */
+      if (de->d_ino == 0)
+        continue;
+      if (!cb(de->d_name, de->d_ino, de->d_type, data))
+      {
+        rc = 1;
+        break;
+      }
+    }
+  }
+
+  int err = errno;
+  FREE(&buf);
+  close(fd);
+  errno = err;
+#else
+  DIR *dirp = opendir(path);
+  if (!dirp)
+    return -1;
+
+  struct dirent *de = NULL;
+  while ((de = readdir(dirp)))
+  {
+    if (calls)
+      (*calls)++;
+#ifdef _DIRENT_HAVE_D_TYPE
+    const unsigned char type = de->d_type;
+#else
+    const unsigned char type = DT_UNKNOWN;
+#endif
+    if (!cb(de->d_name, de->d_ino, type, data))
+    {
+      rc = 1;
+      break;
+    }
+  }
+
+  closedir(dirp);
+#endif
+
+  return rc;
+}
+
+/**
+ * mutt_file_get_mtime - Get the modification time of a file
+ * @param[in]  path  File to examine
+ * @param[out] mtime Modification time
+ * @retval  0 Success
+ * @retval -1 Error, see errno
+ *
+ * Where statx() is available, only the mtime is requested, so the filesystem
+ * can skip gathering the rest of the file's details.
+ */
+int mutt_file_get_mtime(const char *path, time_t *mtime)
+{
+  if (!path || !mtime)
+  {
+    errno = EINVAL;
+    return -1;
+  }
+
+#ifdef HAVE_STATX
+  struct statx stx = { 0 };
+  if (statx(AT_FDCWD, path, 0, STATX_MTIME, &stx) != 0)
+    return -1;
+  *mtime = stx.stx_mtime.tv_sec;
+#else
+  struct stat st = { 0 };
+  if (stat(path, &st) != 0)
+    return -1;
+  *mtime = st.st_mtime;
+#endif
+
+  return 0;
+}
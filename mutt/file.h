@@ -82,6 +82,17 @@ struct MuttFileIter
  */
 typedef bool (*mutt_file_map_t)(char *line, int line_num, void *user_data);
 
+/**
+ * typedef mutt_file_dir_t - Callback function for mutt_file_read_dir()
+ * @param name  Name of the directory entry
+ * @param inode Inode number of the entry
+ * @param type  Type of the entry, e.g. DT_REG, or DT_UNKNOWN
+ * @param data  Private data passed to mutt_file_read_dir()
+ * @retval true  Continue reading
+ * @retval false Stop reading
+ */
+typedef bool (*mutt_file_dir_t)(const char *name, ino_t inode, unsigned char type, void *data);
+
 int         mutt_file_check_empty(const char *path);
 int         mutt_file_chmod(const char *path, mode_t mode);
 int         mutt_file_chmod_add(const char *path, mode_t mode);
@@ -96,6 +107,7 @@ void        mutt_file_expand_fmt_quote(char *dest, size_t destlen, const char *f
 int         mutt_file_fclose(FILE **fp);
 FILE *      mutt_file_fopen(const char *path, const char *mode);
 int         mutt_file_fsync_close(FILE **fp);
+int         mutt_file_get_mtime(const char *path, time_t *mtime);
 long        mutt_file_get_size(const char *path);
 void        mutt_file_get_stat_timespec(struct timespec *dest, struct stat *sb, enum MuttStatType type);
 bool        mutt_file_iter_line(struct MuttFileIter *iter, FILE *fp, int flags);
@@ -106,6 +118,7 @@ FILE *      mutt_file_mkstemp_full(const char *file, int line, const char *func)
 #define     mutt_file_mkstemp() mutt_file_mkstemp_full(__FILE__, __LINE__, __func__)
 int         mutt_file_open(const char *path, int flags);
 size_t      mutt_file_quote_filename(const char *filename, char *buf, size_t buflen);
+int         mutt_file_read_dir(const char *path, mutt_file_dir_t cb, void *data, size_t *calls);
 char *      mutt_file_read_keyword(const char *file, char *buf, size_t buflen);
 char *      mutt_file_read_line(char *line, size_t *size, FILE *fp, int *line_num, int flags);
 int         mutt_file_rename(const char *oldfile, const char *newfile);
@@ -0,0 +1,495 @@
+/**
+ * @file
+ * Batched file operations
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @page filebatch Batched file operations
+ *
+ * Renames and unlinks are queued, then performed together by
+ * mutt_filebatch_run().
+ *
+ * On Linux, if the kernel supports it, the whole batch is submitted through
+ * an io_uring, so a slow (e.g. network) filesystem can work on many files at
+ * once.  Otherwise, or if the io_uring can't be created, the operations are
+ * performed one at a time with rename() and unlink().
+ *
+ * Either way, the results are passed to the callbacks in the order the
+ * operations were added.
+ */
+
+#include "config.h"
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "filebatch.h"
+#include "logging.h"
+#include "memory.h"
+#include "string2.h"
+#ifdef USE_IO_URING
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#define FILEBATCH_RING_SIZE 256 ///< Operations in flight at once
+
+/**
+ * enum FileOpType - Type of a batched file operation
+ */
+enum FileOpType
+{
+  FILEOP_RENAME, ///< rename(oldpath, newpath)
+  FILEOP_UNLINK, ///< unlink(oldpath)
+};
+
+/**
+ * struct FileOp - A file operation waiting in a FileBatch
+ */
+struct FileOp
+{
+  enum FileOpType type;  ///< Type of operation
+  char *oldpath;         ///< File to rename or unlink
+  char *newpath;         ///< New name of the file (rename only)
+  filebatch_done_t done; ///< Callback for the result (OPTIONAL)
+  void *data;            ///< Private data for the callback
+  int err;               ///< Result, 0 or an errno
+};
+
+/**
+ * struct FileBatch - A set of file operations to be performed together
+ */
+struct FileBatch
+{
+  struct FileOp *ops; ///< Queued operations
+  size_t num;         ///< Number of queued operations
+  size_t max;         ///< Size of the array
+};
+
+#ifdef USE_IO_URING
+/**
+ * struct Uring - A mapped io_uring
+ */
+struct Uring
+{
+  int fd;                     ///< io_uring file descriptor
+  unsigned int entries;       ///< Size of the submission queue
+  unsigned int *sq_head;      ///< Submission queue head, moved by the kernel
+  unsigned int *sq_tail;      ///< Submission queue tail, moved by us
+  unsigned int *sq_mask;      ///< Submission queue index mask
+  unsigned int *sq_array;     ///< Submission queue indices into @a sqes
+  struct io_uring_sqe *sqes;  ///< Submission queue entries
+  unsigned int *cq_head;      ///< Completion queue head, moved by us
+  unsigned int *cq_tail;      ///< Completion queue tail, moved by the kernel
+  unsigned int *cq_mask;      ///< Completion queue index mask
+  struct io_uring_cqe *cqes;  ///< Completion queue entries
+  void *sq_ring;              ///< Mapped submission queue
+  size_t sq_ring_len;         ///< Length of the mapped submission queue
+  void *cq_ring;              ///< Mapped completion queue
+  size_t cq_ring_len;         ///< Length of the mapped completion queue
+  size_t sqes_len;            ///< Length of the mapped entries
+};
+
+/// Can io_uring perform renames and unlinks?  -1: not checked yet
+static int UringUsable = -1;
+
+/**
+ * uring_unmap - Release an io_uring
+ * @param ur io_uring
+ */
+static void uring_unmap(struct Uring *ur)
+{
+  if (ur->sqes)
+    munmap(ur->sqes, ur->sqes_len);
+  if (ur->cq_ring)
+    munmap(ur->cq_ring, ur->cq_ring_len);
+  if (ur->sq_ring)
+    munmap(ur->sq_ring, ur->sq_ring_len);
+  if (ur->fd >= 0)
+    close(ur->fd);
+  memset(ur, 0, sizeof(*ur));
+  ur->fd = -1;
+}
+
+/**
+ * uring_probe - Does the kernel support the operations we need?
+ * @param fd io_uring file descriptor
+ * @retval true IORING_OP_RENAMEAT and IORING_OP_UNLINKAT are supported
+ */
+static bool uring_probe(int fd)
+{
+  const size_t num = 256;
+  struct io_uring_probe *probe =
+      mutt_mem_calloc(1, sizeof(*probe) + (num * sizeof(struct io_uring_probe_op)));
+
+  bool rc = false;
+  if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, num) == 0)
+  {
+    rc = (probe->last_op >= IORING_OP_RENAMEAT) && (probe->last_op >= IORING_OP_UNLINKAT) &&
+         (probe->ops[IORING_OP_RENAMEAT].flags & IO_URING_OP_SUPPORTED) &&
+         (probe->ops[IORING_OP_UNLINKAT].flags & IO_URING_OP_SUPPORTED);
+  }
+
+  FREE(&probe);
+  return rc;
+}
+
+/**
+ * uring_setup - Create and map an io_uring
+ * @param ur io_uring to set up
+ * @retval true Success
+ */
+static bool uring_setup(struct Uring *ur)
+{
+  memset(ur, 0, sizeof(*ur));
+  ur->fd = -1;
+
+  if (UringUsable == 0)
+    return false;
+
+  struct io_uring_params p = { 0 };
+  ur->fd = syscall(__NR_io_uring_setup, FILEBATCH_RING_SIZE, &p);
+  if (ur->fd < 0)
+  {
+    mutt_debug(LL_DEBUG1, "io_uring unavailable: %s\n", strerror(errno));
+    UringUsable = 0;
+    return false;
+  }
+
+  if (UringUsable == -1)
+  {
+    UringUsable = uring_probe(ur->fd);
+    if (!UringUsable)
+      mutt_debug(LL_DEBUG1, "io_uring can't rename or unlink files\n");
+  }
+  if (!UringUsable)
+    goto fail;
+
+  ur->sq_ring_len = p.sq_off.array + (p.sq_entries * sizeof(unsigned int));
+  ur->sq_ring = mmap(NULL, ur->sq_ring_len, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ur->fd, IORING_OFF_SQ_RING);
+  if (ur->sq_ring == MAP_FAILED)
+  {
+    ur->sq_ring = NULL;
+    goto fail;
+  }
+
+  ur->cq_ring_len = p.cq_off.cqes + (p.cq_entries * sizeof(struct io_uring_cqe));
+  ur->cq_ring = mmap(NULL, ur->cq_ring_len, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ur->fd, IORING_OFF_CQ_RING);
+  if (ur->cq_ring == MAP_FAILED)
+  {
+    ur->cq_ring = NULL;
+    goto fail;
+  }
+
+  ur->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+  ur->sqes = mmap(NULL, ur->sqes_len, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ur->fd, IORING_OFF_SQES);
+  if (ur->sqes == MAP_FAILED)
+  {
+    ur->sqes = NULL;
+    goto fail;
+  }
+
+  char *sq = ur->sq_ring;
+  ur->sq_head = (unsigned int *) (sq + p.sq_off.head);
+  ur->sq_tail = (unsigned int *) (sq + p.sq_off.tail);
+  ur->sq_mask = (unsigned int *) (sq + p.sq_off.ring_mask);
+  ur->sq_array = (unsigned int *) (sq + p.sq_off.array);
+
+  char *cq = ur->cq_ring;
+  ur->cq_head = (unsigned int *) (cq + p.cq_off.head);
+  ur->cq_tail = (unsigned int *) (cq + p.cq_off.tail);
+  ur->cq_mask = (unsigned int *) (cq + p.cq_off.ring_mask);
+  ur->cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+
+  ur->entries = p.sq_entries;
+  return true;
+
+fail:
+  uring_unmap(ur);
+  return false;
+}
+
+/**
+ * uring_prep - Fill in a submission queue entry
+ * @param sqe   Submission queue entry
+ * @param op    File operation
+ * @param index Index of the operation in the batch
+ */
+static void uring_prep(struct io_uring_sqe *sqe, const struct FileOp *op, size_t index)
+{
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->fd = AT_FDCWD;
+  sqe->addr = (uintptr_t) op->oldpath;
+  sqe->user_data = index;
+
+  if (op->type == FILEOP_RENAME)
+  {
+    sqe->opcode = IORING_OP_RENAMEAT;
+    sqe->len = AT_FDCWD;
+    sqe->addr2 = (uintptr_t) op->newpath;
+  }
+  else
+  {
+    sqe->opcode = IORING_OP_UNLINKAT;
+  }
+}
+
+/**
+ * uring_reap - Collect the completed operations
+ * @param ur io_uring
+ * @param fb Batch of operations
+ * @retval num Number of operations completed
+ */
+static size_t uring_reap(struct Uring *ur, struct FileBatch *fb)
+{
+  size_t count = 0;
+  unsigned int head = *ur->cq_head;
+  const unsigned int tail = __atomic_load_n(ur->cq_tail, __ATOMIC_ACQUIRE);
+
+  for (; head != tail; head++, count++)
+  {
+    const struct io_uring_cqe *cqe = &ur->cqes[head & *ur->cq_mask];
+    if (cqe->user_data < fb->num)
+      fb->ops[cqe->user_data].err = (cqe->res < 0) ? -cqe->res : 0;
+  }
+
+  __atomic_store_n(ur->cq_head, head, __ATOMIC_RELEASE);
+  return count;
+}
+
+/**
+ * uring_run - Perform a batch of operations using an io_uring
+ * @param fb Batch of operations
+ * @retval num Number of operations that were submitted
+ *
+ * If the io_uring fails part way through, the operations that weren't
+ * submitted are left for the caller.  Any that were submitted, but whose
+ * results are lost, fail with EINPROGRESS.
+ */
+static size_t uring_run(struct FileBatch *fb)
+{
+  struct Uring ur;
+  if (!uring_setup(&ur))
+    return 0;
+
+  size_t next = 0;
+  size_t inflight = 0;
+  bool failed = false;
+
+  while ((!failed && (next < fb->num)) || (inflight > 0))
+  {
+    unsigned int tail = *ur.sq_tail;
+    while (!failed && (next < fb->num) && (inflight < ur.entries))
+    {
+      const unsigned int index = tail & *ur.sq_mask;
+      uring_prep(&ur.sqes[index], &fb->ops[next], next);
+      fb->ops[next].err = EINPROGRESS;
+      ur.sq_array[index] = index;
+      tail++;
+      next++;
+      inflight++;
+    }
+    __atomic_store_n(ur.sq_tail, tail, __ATOMIC_RELEASE);
+
+    /* Everything the kernel hasn't consumed yet, including entries left over
+     * from an interrupted or short submission */
+    const unsigned int to_submit = tail - __atomic_load_n(ur.sq_head, __ATOMIC_ACQUIRE);
+
+    int rc = syscall(__NR_io_uring_enter, ur.fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    if ((rc < 0) && (errno == EINTR))
+      continue;
+
+    if ((rc < 0) || ((rc == 0) && (to_submit > 0)))
+    {
+      /* The rest weren't accepted.  Wait for the earlier operations, then
+       * let the caller do the rest. */
+      mutt_debug(LL_DEBUG1, "io_uring_enter: %s\n", (rc < 0) ? strerror(errno) : "nothing submitted");
+      if (failed)
+        break;
+      failed = true;
+      next -= to_submit;
+      inflight -= to_submit;
+      __atomic_store_n(ur.sq_tail, tail - to_submit, __ATOMIC_RELEASE);
+      continue;
+    }
+
+    inflight -= uring_reap(&ur, fb);
+  }
+
+  uring_unmap(&ur);
+  return next;
+}
+#endif
+
+/**
+ * mutt_filebatch_new - Create a new FileBatch
+ * @retval ptr New FileBatch
+ */
+struct FileBatch *mutt_filebatch_new(void)
+{
+  return mutt_mem_calloc(1, sizeof(struct FileBatch));
+}
+
+/**
+ * filebatch_reset - Forget all the queued operations
+ * @param fb FileBatch
+ */
+static void filebatch_reset(struct FileBatch *fb)
+{
+  for (size_t i = 0; i < fb->num; i++)
+  {
+    FREE(&fb->ops[i].oldpath);
+    FREE(&fb->ops[i].newpath);
+  }
+  fb->num = 0;
+}
+
+/**
+ * mutt_filebatch_free - Free a FileBatch
+ * @param[out] ptr FileBatch to free
+ *
+ * Any operations that haven't been run are discarded.
+ */
+void mutt_filebatch_free(struct FileBatch **ptr)
+{
+  if (!ptr || !*ptr)
+    return;
+
+  struct FileBatch *fb = *ptr;
+  filebatch_reset(fb);
+  FREE(&fb->ops);
+  FREE(ptr);
+}
+
+/**
+ * filebatch_add - Add an operation to a FileBatch
+ * @param fb   FileBatch
+ * @param type Type of operation
+ * @param done Callback for the result
+ * @param data Private data for the callback
+ * @retval ptr New operation
+ */
+static struct FileOp *filebatch_add(struct FileBatch *fb, enum FileOpType type,
+                                    filebatch_done_t done, void *data)
+{
+  if (fb->num == fb->max)
+  {
+    fb->max = MAX(64, fb->max * 2);
+    mutt_mem_realloc(&fb->ops, fb->max * sizeof(struct FileOp));
+  }
+
+  struct FileOp *op = &fb->ops[fb->num++];
+  memset(op, 0, sizeof(*op));
+  op->type = type;
+  op->done = done;
+  op->data = data;
+  return op;
+}
+
+/**
+ * mutt_filebatch_rename - Queue a rename()
+ * @param fb      FileBatch
+ * @param oldpath File to rename
+ * @param newpath New name for the file
+ * @param done    Callback for the result (OPTIONAL)
+ * @param data    Private data for the callback
+ */
+void mutt_filebatch_rename(struct FileBatch *fb, const char *oldpath,
+                           const char *newpath, filebatch_done_t done, void *data)
+{
+  if (!fb || !oldpath || !newpath)
+    return;
+
+  struct FileOp *op = filebatch_add(fb, FILEOP_RENAME, done, data);
+  op->oldpath = mutt_str_dup(oldpath);
+  op->newpath = mutt_str_dup(newpath);
+}
+
+/**
+ * mutt_filebatch_unlink - Queue an unlink()
+ * @param fb   FileBatch
+ * @param path File to delete
+ * @param done Callback for the result (OPTIONAL)
+ * @param data Private data for the callback
+ */
+void mutt_filebatch_unlink(struct FileBatch *fb, const char *path,
+                           filebatch_done_t done, void *data)
+{
+  if (!fb || !path)
+    return;
+
+  struct FileOp *op = filebatch_add(fb, FILEOP_UNLINK, done, data);
+  op->oldpath = mutt_str_dup(path);
+}
+
+/**
+ * mutt_filebatch_run - Perform all the queued operations
+ * @param fb FileBatch
+ * @retval num Number of operations that failed
+ *
+ * The callbacks are run in the order that the operations were added.
+ * Afterwards the FileBatch is empty and can be reused.
+ *
+ * @note The operations may be performed in any order, so they must not depend
+ *       on each other.
+ */
+int mutt_filebatch_run(struct FileBatch *fb)
+{
+  if (!fb)
+    return 0;
+
+  size_t done = 0;
+#ifdef USE_IO_URING
+  if (fb->num > 1)
+    done = uring_run(fb);
+#endif
+  mutt_debug(LL_DEBUG2, "%zu operations, %zu by io_uring\n", fb->num, done);
+
+  for (size_t i = done; i < fb->num; i++)
+  {
+    struct FileOp *op = &fb->ops[i];
+    int rc;
+    if (op->type == FILEOP_RENAME)
+      rc = rename(op->oldpath, op->newpath);
+    else
+      rc = unlink(op->oldpath);
+    op->err = (rc == 0) ? 0 : errno;
+  }
+
+  int failed = 0;
+  for (size_t i = 0; i < fb->num; i++)
+  {
+    struct FileOp *op = &fb->ops[i];
+    if (op->err != 0)
+      failed++;
+    if (op->done)
+      op->done(op->err, op->data);
+  }
+
+  filebatch_reset(fb);
+  return failed;
+}
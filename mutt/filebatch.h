@@ -0,0 +1,44 @@
+/**
+ * @file
+ * Batched file operations
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUTT_LIB_FILEBATCH_H
+#define MUTT_LIB_FILEBATCH_H
+
+struct FileBatch;
+
+/**
+ * typedef filebatch_done_t - Prototype for the result of a batched file operation
+ * @param err  0 on success, otherwise the errno of the failure
+ * @param data Private data passed to mutt_filebatch_rename() or mutt_filebatch_unlink()
+ *
+ * @note The callbacks are run by mutt_filebatch_run(), on the caller's thread,
+ *       in the order the operations were added.
+ */
+typedef void (*filebatch_done_t)(int err, void *data);
+
+struct FileBatch *mutt_filebatch_new    (void);
+void              mutt_filebatch_free   (struct FileBatch **ptr);
+void              mutt_filebatch_rename (struct FileBatch *fb, const char *oldpath, const char *newpath, filebatch_done_t done, void *data);
+void              mutt_filebatch_unlink (struct FileBatch *fb, const char *path, filebatch_done_t done, void *data);
+int               mutt_filebatch_run    (struct FileBatch *fb);
+
+#endif /* MUTT_LIB_FILEBATCH_H */
@@ -34,6 +34,7 @@
  * | mutt/envlist.c   | @subpage envlist   |
  * | mutt/exit.c      | @subpage exit      |
  * | mutt/file.c      | @subpage file      |
+ * | mutt/filebatch.c | @subpage filebatch |
  * | mutt/filter.c    | @subpage filter    |
  * | mutt/hash.c      | @subpage hash      |
  * | mutt/list.c      | @subpage list      |
@@ -52,6 +53,7 @@
  * | mutt/slist.c     | @subpage slist     |
  * | mutt/signal.c    | @subpage signal    |
  * | mutt/string.c    | @subpage string    |
+ * | mutt/workqueue.c | @subpage workqueue |
  *
  * @note The library is self-contained -- some files may depend on others in
  *       the library, but none depends on source from outside.
@@ -68,6 +70,7 @@
 #include "envlist.h"
 #include "exit.h"
 #include "file.h"
+#include "filebatch.h"
 #include "filter.h"
 #include "hash.h"
 #include "list.h"
@@ -89,6 +92,7 @@
 #include "signal2.h"
 #include "slist.h"
 #include "string2.h"
+#include "workqueue.h"
 // IWYU pragma: end_exports
 
 #endif /* MUTT_MUTT_LIB_H */
@@ -24,10 +24,15 @@
  * @page pool A global pool of Buffers
  *
  * A shared pool of Buffers to save lots of allocs/frees.
+ *
+ * The pool may be used by several threads at once, see @ref workqueue.
  */
 
 #include "config.h"
 #include <stdio.h>
+#ifdef USE_PTHREAD
+#include <pthread.h>
+#endif
 #include "pool.h"
 #include "buffer.h"
 #include "logging.h"
@@ -38,6 +43,29 @@ static size_t BufferPoolLen = 0;
 static size_t BufferPoolIncrement = 20;
 static size_t BufferPoolInitialBufferSize = 1024;
 static struct Buffer **BufferPool = NULL;
+#ifdef USE_PTHREAD
+static pthread_mutex_t BufferPoolLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/**
+ * pool_lock - Lock the Buffer pool
+ */
+static void pool_lock(void)
+{
+#ifdef USE_PTHREAD
+  pthread_mutex_lock(&BufferPoolLock);
+#endif
+}
+
+/**
+ * pool_unlock - Unlock the Buffer pool
+ */
+static void pool_unlock(void)
+{
+#ifdef USE_PTHREAD
+  pthread_mutex_unlock(&BufferPoolLock);
+#endif
+}
 
 /**
  * buffer_new - Allocate a new Buffer on the heap
@@ -69,8 +97,8 @@ static void buffer_free(struct Buffer **p)
  */
 static void increase_buffer_pool(void)
 {
+  /* Called with the pool locked, so it mustn't log */
   BufferPoolLen += BufferPoolIncrement;
-  mutt_debug(LL_DEBUG1, "%zu\n", BufferPoolLen);
 
   mutt_mem_realloc(&BufferPool, BufferPoolLen * sizeof(struct Buffer *));
   while (BufferPoolCount < BufferPoolIncrement)
@@ -88,10 +116,12 @@ void mutt_buffer_pool_free(void)
 {
   mutt_debug(LL_DEBUG1, "%zu of %zu returned to pool\n", BufferPoolCount, BufferPoolLen);
 
+  pool_lock();
   while (BufferPoolCount)
     buffer_free(&BufferPool[--BufferPoolCount]);
   FREE(&BufferPool);
   BufferPoolLen = 0;
+  pool_unlock();
 }
 
 /**
@@ -100,9 +130,12 @@ void mutt_buffer_pool_free(void)
  */
 struct Buffer *mutt_buffer_pool_get(void)
 {
+  pool_lock();
   if (BufferPoolCount == 0)
     increase_buffer_pool();
-  return BufferPool[--BufferPoolCount];
+  struct Buffer *buf = BufferPool[--BufferPoolCount];
+  pool_unlock();
+  return buf;
 }
 
 /**
@@ -114,13 +147,6 @@ void mutt_buffer_pool_release(struct Buffer **pbuf)
   if (!pbuf || !*pbuf)
     return;
 
-  if (BufferPoolCount >= BufferPoolLen)
-  {
-    mutt_debug(LL_DEBUG1, "Internal buffer pool error\n");
-    buffer_free(pbuf);
-    return;
-  }
-
   struct Buffer *buf = *pbuf;
   if ((buf->dsize > (2 * BufferPoolInitialBufferSize)) ||
       (buf->dsize < BufferPoolInitialBufferSize))
@@ -129,7 +155,18 @@ void mutt_buffer_pool_release(struct Buffer **pbuf)
     mutt_mem_realloc(&buf->data, buf->dsize);
   }
   mutt_buffer_reset(buf);
+
+  pool_lock();
+  if (BufferPoolCount >= BufferPoolLen)
+  {
+    pool_unlock();
+    mutt_debug(LL_DEBUG1, "Internal buffer pool error\n");
+    buffer_free(pbuf);
+    return;
+  }
+
   BufferPool[BufferPoolCount++] = buf;
+  pool_unlock();
 
   *pbuf = NULL;
 }
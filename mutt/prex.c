@@ -24,12 +24,19 @@
  * @page prex Manage precompiled / predefined regular expressions
  *
  * Manage precompiled / predefined regular expressions.
+ *
+ * The regexes are compiled once and shared, but each thread gets its own
+ * storage for the matches, so mutt_prex_capture() may be called from a
+ * worker thread, see @ref workqueue.
  */
 
 #include "config.h"
 #include <assert.h>
 #include <stdbool.h>
 #include <stdint.h>
+#ifdef USE_PTHREAD
+#include <pthread.h>
+#endif
 #include "prex.h"
 #include "logging.h"
 #include "memory.h"
@@ -59,10 +66,10 @@ static bool pcre2_has_unicode(void)
  *
  * This struct holds a predefined / precompiled regex including data
  * representing the corresponding identification enum, the regular expression in
- * string format, information on how many matches it defines, and storage for
- * the actual matches.  The enum entry is not strictly necessary, but is kept
- * together with the regex for validation purposes, as it allows checking that
- * the enum and the array defined in prex() do not go out of sync.
+ * string format and information on how many matches it defines.  The enum
+ * entry is not strictly necessary, but is kept together with the regex for
+ * validation purposes, as it allows checking that the enum and the array
+ * defined in prex() do not go out of sync.
  */
 struct PrexStorage
 {
@@ -71,13 +78,82 @@ struct PrexStorage
   const char *str; ///< Regex string
 #ifdef HAVE_PCRE2
   pcre2_code *re;
-  pcre2_match_data *mdata;
 #else
   regex_t *re; ///< Compiled regex
 #endif
-  regmatch_t *matches; ///< Resulting matches
 };
 
+/**
+ * struct PrexMatches - Storage for the actual matches, one per thread
+ */
+struct PrexMatches
+{
+#ifdef HAVE_PCRE2
+  pcre2_match_data *mdata[PREX_MAX]; ///< PCRE2 match data
+#endif
+  regmatch_t *matches[PREX_MAX];     ///< Resulting matches
+};
+
+#ifdef USE_PTHREAD
+static pthread_mutex_t PrexLock = PTHREAD_MUTEX_INITIALIZER; ///< Protects compilation
+static pthread_once_t PrexKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t PrexKey; ///< Each thread's PrexMatches
+#else
+static struct PrexMatches *PrexMainMatches = NULL; ///< The only PrexMatches
+#endif
+
+/**
+ * prex_matches_free - Free a set of matches
+ * @param ptr PrexMatches to free
+ */
+static void prex_matches_free(void *ptr)
+{
+  struct PrexMatches *pm = ptr;
+  if (!pm)
+    return;
+
+  for (enum Prex which = 0; which < PREX_MAX; which++)
+  {
+#ifdef HAVE_PCRE2
+    pcre2_match_data_free(pm->mdata[which]);
+#endif
+    FREE(&pm->matches[which]);
+  }
+  FREE(&pm);
+}
+
+#ifdef USE_PTHREAD
+/**
+ * prex_key_create - Create the key for the per-thread matches
+ */
+static void prex_key_create(void)
+{
+  pthread_key_create(&PrexKey, prex_matches_free);
+}
+#endif
+
+/**
+ * prex_matches_get - Get the calling thread's storage for matches
+ * @retval ptr PrexMatches
+ */
+static struct PrexMatches *prex_matches_get(void)
+{
+#ifdef USE_PTHREAD
+  pthread_once(&PrexKeyOnce, prex_key_create);
+  struct PrexMatches *pm = pthread_getspecific(PrexKey);
+  if (!pm)
+  {
+    pm = mutt_mem_calloc(1, sizeof(*pm));
+    pthread_setspecific(PrexKey, pm);
+  }
+  return pm;
+#else
+  if (!PrexMainMatches)
+    PrexMainMatches = mutt_mem_calloc(1, sizeof(*PrexMainMatches));
+  return PrexMainMatches;
+#endif
+}
+
 #define PREX_MONTH "(Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|Sep|Oct|Nov|Dec)"
 #define PREX_DOW "(Mon|Tue|Wed|Thu|Fri|Sat|Sun)"
 #define PREX_DOW_NOCASE                                                        \
@@ -267,6 +343,9 @@ static struct PrexStorage *prex(enum Prex which)
   assert((which >= 0) && (which < PREX_MAX) && "Invalid 'which' argument");
   struct PrexStorage *h = &storage[which];
   assert((which == h->which) && "Fix 'storage' array");
+#ifdef USE_PTHREAD
+  pthread_mutex_lock(&PrexLock);
+#endif
   if (!h->re)
   {
 #ifdef HAVE_PCRE2
@@ -279,20 +358,20 @@ static struct PrexStorage *prex(enum Prex which)
     {
       assert("Fix your RE");
     }
-    h->mdata = pcre2_match_data_create_from_pattern(h->re, NULL);
     uint32_t ccount;
     pcre2_pattern_info(h->re, PCRE2_INFO_CAPTURECOUNT, &ccount);
     assert(ccount + 1 == h->nmatches && "Number of matches do not match (...)");
-    h->matches = mutt_mem_calloc(h->nmatches, sizeof(*h->matches));
 #else
     h->re = mutt_mem_calloc(1, sizeof(*h->re));
     if (regcomp(h->re, h->str, REG_EXTENDED) != 0)
     {
       assert("Fix your RE");
     }
-    h->matches = mutt_mem_calloc(h->nmatches, sizeof(*h->matches));
 #endif
   }
+#ifdef USE_PTHREAD
+  pthread_mutex_unlock(&PrexLock);
+#endif
   return h;
 }
 
@@ -302,6 +381,9 @@ static struct PrexStorage *prex(enum Prex which)
  * @param str   String to apply regex on
  * @retval ptr  Pointer to an array of matched captures
  * @retval NULL Regex didn't match
+ *
+ * @note The array belongs to the calling thread and will be overwritten by
+ *       its next call to mutt_prex_capture() for the same regex.
  */
 regmatch_t *mutt_prex_capture(enum Prex which, const char *str)
 {
@@ -309,9 +391,15 @@ regmatch_t *mutt_prex_capture(enum Prex which, const char *str)
     return NULL;
 
   struct PrexStorage *h = prex(which);
+  struct PrexMatches *pm = prex_matches_get();
+  if (!pm->matches[which])
+    pm->matches[which] = mutt_mem_calloc(h->nmatches, sizeof(regmatch_t));
+  regmatch_t *matches = pm->matches[which];
 #ifdef HAVE_PCRE2
+  if (!pm->mdata[which])
+    pm->mdata[which] = pcre2_match_data_create_from_pattern(h->re, NULL);
   size_t len = strlen(str);
-  int rc = pcre2_match(h->re, (PCRE2_SPTR8) str, len, 0, 0, h->mdata, NULL);
+  int rc = pcre2_match(h->re, (PCRE2_SPTR8) str, len, 0, 0, pm->mdata[which], NULL);
   if (rc < 0)
   {
     PCRE2_UCHAR errmsg[1024];
@@ -319,26 +407,26 @@ regmatch_t *mutt_prex_capture(enum Prex which, const char *str)
     mutt_debug(LL_DEBUG2, "pcre2_match - <%s> -> <%s> =  %s\n", h->str, str, errmsg);
     return NULL;
   }
-  PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(h->mdata);
+  PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(pm->mdata[which]);
   int i = 0;
   for (; i < rc; i++)
   {
-    h->matches[i].rm_so = ovector[i * 2];
-    h->matches[i].rm_eo = ovector[i * 2 + 1];
+    matches[i].rm_so = ovector[i * 2];
+    matches[i].rm_eo = ovector[i * 2 + 1];
   }
   for (; i < h->nmatches; i++)
   {
-    h->matches[i].rm_so = -1;
-    h->matches[i].rm_eo = -1;
+    matches[i].rm_so = -1;
+    matches[i].rm_eo = -1;
   }
 #else
-  if (regexec(h->re, str, h->nmatches, h->matches, 0))
+  if (regexec(h->re, str, h->nmatches, matches, 0))
     return NULL;
 
   assert((h->re->re_nsub == (h->nmatches - 1)) &&
          "Regular expression and matches enum are out of sync");
 #endif
-  return h->matches;
+  return matches;
 }
 
 /**
@@ -350,12 +438,20 @@ void mutt_prex_free(void)
   {
     struct PrexStorage *h = prex(which);
 #ifdef HAVE_PCRE2
-    pcre2_match_data_free(h->mdata);
     pcre2_code_free(h->re);
+    h->re = NULL;
 #else
     regfree(h->re);
     FREE(&h->re);
 #endif
-    FREE(&h->matches);
   }
+
+#ifdef USE_PTHREAD
+  pthread_once(&PrexKeyOnce, prex_key_create);
+  prex_matches_free(pthread_getspecific(PrexKey));
+  pthread_setspecific(PrexKey, NULL);
+#else
+  prex_matches_free(PrexMainMatches);
+  PrexMainMatches = NULL;
+#endif
 }
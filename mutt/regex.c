@@ -476,8 +476,8 @@ bool mutt_replacelist_match(struct ReplaceList *rl, char *buf, size_t buflen, co
   if (!rl || !buf || !str)
     return false;
 
-  static regmatch_t *pmatch = NULL;
-  static size_t nmatch = 0;
+  regmatch_t *pmatch = NULL;
+  size_t nmatch = 0;
   int tlen = 0;
   char *p = NULL;
 
@@ -509,7 +509,7 @@ bool mutt_replacelist_match(struct ReplaceList *rl, char *buf, size_t buflen, co
           long n = strtol(p, &e, 10);
           /* Ensure that the integer conversion succeeded (e!=p) and bounds check.  The upper bound check
            * should not strictly be necessary since add_to_spam_list() finds the largest value, and
-           * the static array above is always large enough based on that value. */
+           * the array above is always large enough based on that value. */
           if ((e != p) && (n >= 0) && (n <= np->nmatch) && (pmatch[n].rm_so != -1))
           {
             /* copy as much of the substring match as will fit in the output buffer, saving space for
@@ -538,10 +538,12 @@ bool mutt_replacelist_match(struct ReplaceList *rl, char *buf, size_t buflen, co
         buf[tlen] = '\0';
         mutt_debug(LL_DEBUG5, "\"%s\"\n", buf);
       }
+      FREE(&pmatch);
       return true;
     }
   }
 
+  FREE(&pmatch);
   return false;
 }
 
@@ -0,0 +1,405 @@
+/**
+ * @file
+ * A pool of worker threads
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @page workqueue A pool of worker threads
+ *
+ * A simple FIFO job queue serviced by a fixed number of threads.
+ *
+ * The caller adds jobs with mutt_workqueue_add() and then blocks in
+ * mutt_workqueue_wait() until they have all been run.  Results are passed
+ * back through the job's private data, so the caller decides the order in
+ * which they're consumed.
+ *
+ * If NeoMutt was built without thread support, or the queue was created with
+ * no threads, jobs are run immediately, on the caller's thread.
+ *
+ * While any queue is running, the log dispatcher is wrapped so that log lines
+ * from different threads are serialised and workers never touch the screen.
+ */
+
+#include "config.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include "workqueue.h"
+#include "memory.h"
+#include "queue.h"
+#ifdef USE_PTHREAD
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "logging.h"
+#endif
+
+#ifdef USE_PTHREAD
+/**
+ * struct WorkJob - A job waiting in a WorkQueue
+ */
+struct WorkJob
+{
+  workqueue_job_t job;          ///< Function to run
+  void *data;                   ///< Private data for the function
+  STAILQ_ENTRY(WorkJob) entries; ///< Linked list
+};
+STAILQ_HEAD(WorkJobList, WorkJob);
+#endif
+
+/**
+ * struct WorkQueue - A pool of worker threads
+ */
+struct WorkQueue
+{
+  int num_threads;              ///< Number of running worker threads
+#ifdef USE_PTHREAD
+  pthread_t *threads;           ///< Worker threads
+  pthread_mutex_t lock;         ///< Protects the fields below
+  pthread_cond_t cond_job;      ///< Signalled when a job is added, or on shutdown
+  pthread_cond_t cond_idle;     ///< Signalled when the last job completes
+  struct WorkJobList jobs;      ///< Jobs waiting to be run
+  size_t pending;               ///< Jobs queued or running
+  bool shutdown;                ///< Workers should exit
+#endif
+};
+
+#ifdef USE_PTHREAD
+static pthread_mutex_t SharedLock = PTHREAD_MUTEX_INITIALIZER; ///< Lock for mutt_workqueue_lock()
+static pthread_cond_t SharedCond = PTHREAD_COND_INITIALIZER; ///< Condition for mutt_workqueue_timedwait()
+static pthread_mutex_t LogLock = PTHREAD_MUTEX_INITIALIZER; ///< Serialises log lines
+static pthread_once_t WorkerKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t WorkerKey;        ///< Set on every worker thread
+static log_dispatcher_t WrappedLogger; ///< Real log dispatcher, while queues are running
+static int ActiveQueues = 0;           ///< Number of queues with running threads
+
+/**
+ * worker_key_create - Create the thread-specific key that marks workers
+ */
+static void worker_key_create(void)
+{
+  pthread_key_create(&WorkerKey, NULL);
+}
+
+/**
+ * workqueue_log_disp - Serialise logging from several threads - Implements ::log_dispatcher_t
+ *
+ * Messages that would be displayed to the user are demoted to debug messages
+ * if they come from a worker thread.
+ */
+static int workqueue_log_disp(time_t stamp, const char *file, int line,
+                              const char *function, enum LogLevel level, ...)
+{
+  const int err = errno;
+
+  char buf[1024];
+  va_list ap;
+  va_start(ap, level);
+  const char *fmt = va_arg(ap, const char *);
+  int len = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+
+  if ((level <= LL_MESSAGE) && mutt_workqueue_is_worker())
+  {
+    if ((level == LL_PERROR) && (len >= 0) && ((size_t) len < sizeof(buf)))
+    {
+      snprintf(buf + len, sizeof(buf) - len, ": %s (errno = %d)", strerror(err), err);
+    }
+    level = LL_DEBUG1;
+  }
+
+  pthread_mutex_lock(&LogLock);
+  errno = err;
+  int rc = WrappedLogger(stamp, file, line, function, level, "%s", buf);
+  pthread_mutex_unlock(&LogLock);
+
+  return rc;
+}
+
+/**
+ * workqueue_worker - Run jobs until the queue is shut down
+ * @param arg WorkQueue
+ * @retval NULL Always
+ */
+static void *workqueue_worker(void *arg)
+{
+  struct WorkQueue *wq = arg;
+
+  pthread_setspecific(WorkerKey, wq);
+
+  pthread_mutex_lock(&wq->lock);
+  while (true)
+  {
+    while (STAILQ_EMPTY(&wq->jobs) && !wq->shutdown)
+      pthread_cond_wait(&wq->cond_job, &wq->lock);
+
+    struct WorkJob *wj = STAILQ_FIRST(&wq->jobs);
+    if (!wj)
+      break; /* shutdown and no more work */
+
+    STAILQ_REMOVE_HEAD(&wq->jobs, entries);
+    pthread_mutex_unlock(&wq->lock);
+
+    wj->job(wj->data);
+    FREE(&wj);
+
+    pthread_mutex_lock(&wq->lock);
+    wq->pending--;
+    if (wq->pending == 0)
+      pthread_cond_broadcast(&wq->cond_idle);
+  }
+  pthread_mutex_unlock(&wq->lock);
+
+  return NULL;
+}
+#endif
+
+/**
+ * mutt_workqueue_new - Create a new WorkQueue
+ * @param num_threads Number of worker threads to start
+ * @retval ptr New WorkQueue
+ *
+ * If num_threads is less than one, or threads aren't available, the jobs will
+ * be run synchronously by mutt_workqueue_add().
+ */
+struct WorkQueue *mutt_workqueue_new(int num_threads)
+{
+  struct WorkQueue *wq = mutt_mem_calloc(1, sizeof(struct WorkQueue));
+
+#ifdef USE_PTHREAD
+  if (num_threads < 1)
+    return wq;
+
+  pthread_once(&WorkerKeyOnce, worker_key_create);
+
+  pthread_mutex_init(&wq->lock, NULL);
+  pthread_cond_init(&wq->cond_job, NULL);
+  pthread_cond_init(&wq->cond_idle, NULL);
+  STAILQ_INIT(&wq->jobs);
+  wq->threads = mutt_mem_calloc(num_threads, sizeof(pthread_t));
+
+  if (ActiveQueues++ == 0)
+  {
+    WrappedLogger = MuttLogger;
+    MuttLogger = workqueue_log_disp;
+  }
+
+  /* Signals must only be delivered to the main thread */
+  sigset_t all, old;
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, &old);
+  for (int i = 0; i < num_threads; i++)
+  {
+    if (pthread_create(&wq->threads[wq->num_threads], NULL, workqueue_worker, wq) != 0)
+    {
+      mutt_debug(LL_DEBUG1, "pthread_create failed after %d threads\n", wq->num_threads);
+      break;
+    }
+    wq->num_threads++;
+  }
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+#endif
+
+  return wq;
+}
+
+/**
+ * mutt_workqueue_free - Wait for the jobs to finish, then free the WorkQueue
+ * @param[out] ptr WorkQueue to free
+ */
+void mutt_workqueue_free(struct WorkQueue **ptr)
+{
+  if (!ptr || !*ptr)
+    return;
+
+  struct WorkQueue *wq = *ptr;
+
+#ifdef USE_PTHREAD
+  if (wq->threads)
+  {
+    pthread_mutex_lock(&wq->lock);
+    wq->shutdown = true;
+    pthread_cond_broadcast(&wq->cond_job);
+    pthread_mutex_unlock(&wq->lock);
+
+    for (int i = 0; i < wq->num_threads; i++)
+      pthread_join(wq->threads[i], NULL);
+
+    if (--ActiveQueues == 0)
+      MuttLogger = WrappedLogger;
+
+    pthread_cond_destroy(&wq->cond_idle);
+    pthread_cond_destroy(&wq->cond_job);
+    pthread_mutex_destroy(&wq->lock);
+    FREE(&wq->threads);
+  }
+#endif
+
+  FREE(ptr);
+}
+
+/**
+ * mutt_workqueue_add - Add a job to a WorkQueue
+ * @param wq   WorkQueue
+ * @param job  Function to run
+ * @param data Private data passed to the function
+ *
+ * If the WorkQueue has no threads, the job is run before this returns.
+ */
+void mutt_workqueue_add(struct WorkQueue *wq, workqueue_job_t job, void *data)
+{
+  if (!wq || !job)
+    return;
+
+#ifdef USE_PTHREAD
+  if (wq->num_threads > 0)
+  {
+    struct WorkJob *wj = mutt_mem_calloc(1, sizeof(struct WorkJob));
+    wj->job = job;
+    wj->data = data;
+
+    pthread_mutex_lock(&wq->lock);
+    STAILQ_INSERT_TAIL(&wq->jobs, wj, entries);
+    wq->pending++;
+    pthread_cond_signal(&wq->cond_job);
+    pthread_mutex_unlock(&wq->lock);
+    return;
+  }
+#endif
+
+  job(data);
+}
+
+/**
+ * mutt_workqueue_wait - Wait for all the queued jobs to finish
+ * @param wq WorkQueue
+ */
+void mutt_workqueue_wait(struct WorkQueue *wq)
+{
+  if (!wq)
+    return;
+
+#ifdef USE_PTHREAD
+  if (wq->num_threads == 0)
+    return;
+
+  pthread_mutex_lock(&wq->lock);
+  while (wq->pending > 0)
+    pthread_cond_wait(&wq->cond_idle, &wq->lock);
+  pthread_mutex_unlock(&wq->lock);
+#endif
+}
+
+/**
+ * mutt_workqueue_threads - How many worker threads are running?
+ * @param wq WorkQueue
+ * @retval num Number of threads
+ */
+int mutt_workqueue_threads(const struct WorkQueue *wq)
+{
+  if (!wq)
+    return 0;
+
+  return wq->num_threads;
+}
+
+/**
+ * mutt_workqueue_is_worker - Is the caller running on a worker thread?
+ * @retval true The caller is a worker thread
+ */
+bool mutt_workqueue_is_worker(void)
+{
+#ifdef USE_PTHREAD
+  pthread_once(&WorkerKeyOnce, worker_key_create);
+  return pthread_getspecific(WorkerKey) != NULL;
+#else
+  return false;
+#endif
+}
+
+/**
+ * mutt_workqueue_lock - Serialise access to shared state from a job
+ *
+ * Jobs that modify global data must hold this lock while they do so.
+ */
+void mutt_workqueue_lock(void)
+{
+#ifdef USE_PTHREAD
+  pthread_mutex_lock(&SharedLock);
+#endif
+}
+
+/**
+ * mutt_workqueue_signal - Wake up any threads in mutt_workqueue_timedwait()
+ *
+ * The caller must hold mutt_workqueue_lock().
+ */
+void mutt_workqueue_signal(void)
+{
+#ifdef USE_PTHREAD
+  pthread_cond_broadcast(&SharedCond);
+#endif
+}
+
+/**
+ * mutt_workqueue_timedwait - Wait for a job to call mutt_workqueue_signal()
+ * @param timeout_ms Maximum time to wait, in milliseconds
+ * @retval true  The thread was woken up
+ * @retval false The time ran out
+ *
+ * The caller must hold mutt_workqueue_lock(), which is released while waiting.
+ * Wake-ups may be spurious, so the caller should check its condition again.
+ *
+ * Without thread support, nothing can signal, so this returns immediately.
+ */
+bool mutt_workqueue_timedwait(int timeout_ms)
+{
+#ifdef USE_PTHREAD
+  if (timeout_ms < 0)
+    timeout_ms = 0;
+
+  struct timespec ts = { 0 };
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_sec += timeout_ms / 1000;
+  ts.tv_nsec += (long) (timeout_ms % 1000) * 1000000L;
+  if (ts.tv_nsec >= 1000000000L)
+  {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000L;
+  }
+
+  return pthread_cond_timedwait(&SharedCond, &SharedLock, &ts) != ETIMEDOUT;
+#else
+  return false;
+#endif
+}
+
+/**
+ * mutt_workqueue_unlock - Release the lock taken by mutt_workqueue_lock()
+ */
+void mutt_workqueue_unlock(void)
+{
+#ifdef USE_PTHREAD
+  pthread_mutex_unlock(&SharedLock);
+#endif
+}
@@ -0,0 +1,50 @@
+/**
+ * @file
+ * A pool of worker threads
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUTT_LIB_WORKQUEUE_H
+#define MUTT_LIB_WORKQUEUE_H
+
+#include <stdbool.h>
+
+struct WorkQueue;
+
+/**
+ * typedef workqueue_job_t - Prototype for a WorkQueue job
+ * @param data Private data passed to mutt_workqueue_add()
+ *
+ * @note Jobs may be run on any thread.  They must not touch the screen and
+ *       must use mutt_workqueue_lock() around any shared, mutable state.
+ */
+typedef void (*workqueue_job_t)(void *data);
+
+struct WorkQueue *mutt_workqueue_new     (int num_threads);
+void              mutt_workqueue_free    (struct WorkQueue **ptr);
+void              mutt_workqueue_add     (struct WorkQueue *wq, workqueue_job_t job, void *data);
+void              mutt_workqueue_wait    (struct WorkQueue *wq);
+int               mutt_workqueue_threads (const struct WorkQueue *wq);
+bool              mutt_workqueue_is_worker(void);
+void              mutt_workqueue_lock    (void);
+void              mutt_workqueue_signal  (void);
+bool              mutt_workqueue_timedwait(int timeout_ms);
+void              mutt_workqueue_unlock  (void);
+
+#endif /* MUTT_LIB_WORKQUEUE_H */
@@ -326,6 +326,12 @@ struct ConfigDef MainVars[] = {
   { "mail_check_stats_interval", DT_NUMBER|DT_NOT_NEGATIVE, &C_MailCheckStatsInterval, 60, 0, NULL,
     "How often to check for new mail"
   },
+  { "mail_check_threads", DT_NUMBER|DT_NOT_NEGATIVE, &C_MailCheckThreads, 0, 0, NULL,
+    "Number of threads used to look at local mailboxes"
+  },
+  { "mail_check_timeout", DT_NUMBER|DT_NOT_NEGATIVE, &C_MailCheckTimeout, 10, 0, NULL,
+    "Number of seconds to wait for a mailbox to be checked"
+  },
   { "mailcap_path", DT_SLIST|SLIST_SEP_COLON, &C_MailcapPath, IP "~/.mailcap:" PKGDATADIR "/mailcap:" SYSCONFDIR "/mailcap:/etc/mailcap:/usr/etc/mailcap:/usr/local/etc/mailcap", 0, NULL,
     "Colon-separated list of mailcap files"
   },
@@ -448,6 +454,9 @@ struct ConfigDef MainVars[] = {
   { "print_split", DT_BOOL, &C_PrintSplit, false, 0, NULL,
     "Print multiple messages separately"
   },
+  { "progressive_open", DT_NUMBER|DT_NOT_NEGATIVE, &C_ProgressiveOpen, 0, 0, NULL,
+    "Number of emails to read before showing the index"
+  },
   { "prompt_after", DT_BOOL, &C_PromptAfter, true, 0, NULL,
     "Pause after running an external pager"
   },
@@ -26,6 +26,8 @@
  */
 
 #include "config.h"
+#include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -40,6 +42,7 @@
 #include "muttlib.h"
 #include "mx.h"
 #include "protos.h"
+#include "imap/lib.h"
 #include "mbox/lib.h"
 
 static time_t MailboxTime = 0; ///< last time we started checking for mail
@@ -51,27 +54,388 @@ static short MailboxNotify = 0; ///< # of unnotified new boxes
 short C_MailCheck; ///< Config: Number of seconds before NeoMutt checks for new mail
 bool C_MailCheckStats;          ///< Config: Periodically check for new mail
 short C_MailCheckStatsInterval; ///< Config: How often to check for new mail
+short C_MailCheckThreads;       ///< Config: Number of threads used to look at local mailboxes
+short C_MailCheckTimeout;       ///< Config: Number of seconds to wait for a mailbox to be checked
+
+/**
+ * struct MailboxProbe - The type of a local Mailbox, and the file it was found from
+ *
+ * The type is reused, without probing the Mailbox, until the file is replaced
+ * or modified.
+ */
+struct MailboxProbe
+{
+  enum MailboxType type; ///< Type found by mx_path_probe()
+  dev_t dev;             ///< Device of the Mailbox
+  ino_t ino;             ///< Inode of the Mailbox
+  struct timespec mtime; ///< Modification time of the Mailbox
+};
+
+/**
+ * struct MailboxPoll - The type and stat() info of a Mailbox
+ *
+ * The stat() info and the type are found by mailbox_poll_job(), which may run
+ * on a worker thread, so the job only touches this struct.  The types that
+ * need the hooks, or that aren't in a local file, are probed on the main
+ * thread, by mailbox_poll_probe().
+ *
+ * If the job takes longer than $mail_check_timeout, the main thread stops
+ * waiting for it.  The Poll is freed by whichever of the two lets go of it
+ * last.
+ */
+struct MailboxPoll
+{
+  char *path;            ///< Path of the Mailbox
+  bool probe;            ///< Find the type of the Mailbox
+  bool cached;           ///< The Mailbox has been probed before, see #ProbeCache
+  struct MailboxProbe cache; ///< Result of the earlier probe
+  bool probed;           ///< The job looked inside the Mailbox, see mx_path_probe_local()
+  enum MailboxType type; ///< Type of the Mailbox
+  struct stat sb;        ///< stat() info for the Mailbox
+  int stat_rc;           ///< Return value of stat()
+  bool done;             ///< The job has finished
+  int refs;              ///< Number of references, the job and the main thread
+};
+
+/**
+ * struct MailboxCheck - The state of one Mailbox during mutt_mailbox_check()
+ */
+struct MailboxCheck
+{
+  struct Mailbox *mailbox;  ///< Mailbox to check
+  struct MailboxPoll *poll; ///< Type and stat() info, NULL if it isn't ready
+  bool check_stats;         ///< Count the total, new and flagged messages
+  bool queued;              ///< An IMAP STATUS command was queued
+#ifdef USE_SIDEBAR
+  short orig_new;           ///< Mailbox::has_new before the check
+  int orig_count;           ///< Mailbox::msg_count before the check
+  int orig_unread;          ///< Mailbox::msg_unread before the check
+  int orig_flagged;         ///< Mailbox::msg_flagged before the check
+#endif
+};
+
+static struct WorkQueue *PollQueue = NULL;    ///< Threads for mailbox_poll_job()
+static struct MailboxPoll **PollStuck = NULL; ///< Polls that timed out, but are still running
+static size_t PollStuckCount = 0;             ///< Number of Polls in PollStuck
+static struct HashTable *ProbeCache = NULL;   ///< Path -> MailboxProbe, for local Mailboxes
+static size_t CheckNext = 0; ///< Mailbox to count first, after a check ran out of time
+
+/**
+ * mailbox_probe_free - Free a MailboxProbe - Implements ::hash_hdata_free_t
+ */
+static void mailbox_probe_free(int type, void *obj, intptr_t data)
+{
+  FREE(&obj);
+}
+
+/**
+ * mailbox_probe_match - Is a cached probe still valid?
+ * @param mp MailboxProbe
+ * @param sb stat() info for the Mailbox
+ * @retval true The Mailbox is the same file, and it hasn't been modified
+ */
+static bool mailbox_probe_match(struct MailboxProbe *mp, struct stat *sb)
+{
+  return (mp->dev == sb->st_dev) && (mp->ino == sb->st_ino) &&
+         (mutt_file_stat_timespec_compare(sb, MUTT_STAT_MTIME, &mp->mtime) == 0);
+}
+
+/**
+ * mailbox_probe_update - Remember the type of a Mailbox
+ * @param poll Finished MailboxPoll
+ *
+ * Only local Mailboxes that were found are cached.  Probing a URL is cheap.
+ */
+static void mailbox_probe_update(struct MailboxPoll *poll)
+{
+  if (!poll->probe)
+    return;
+
+  if (!ProbeCache)
+  {
+    ProbeCache = mutt_hash_new(64, MUTT_HASH_STRDUP_KEYS);
+    mutt_hash_set_destructor(ProbeCache, mailbox_probe_free, 0);
+  }
+
+  struct MailboxProbe *mp = mutt_hash_find(ProbeCache, poll->path);
+  const struct MxOps *ops = mx_get_ops(poll->type);
+
+  if ((poll->stat_rc != 0) || !ops || !ops->is_local)
+  {
+    if (mp)
+      mutt_hash_delete(ProbeCache, poll->path, mp);
+    return;
+  }
+
+  if (!mp)
+  {
+    mp = mutt_mem_calloc(1, sizeof(*mp));
+    mutt_hash_insert(ProbeCache, poll->path, mp);
+  }
+
+  mp->type = poll->type;
+  mp->dev = poll->sb.st_dev;
+  mp->ino = poll->sb.st_ino;
+  mutt_file_get_stat_timespec(&mp->mtime, &poll->sb, MUTT_STAT_MTIME);
+}
+
+/**
+ * mutt_mailbox_probe_forget - Forget the cached type of a Mailbox
+ * @param m Mailbox that is being removed
+ */
+void mutt_mailbox_probe_forget(struct Mailbox *m)
+{
+  if (!m || !ProbeCache)
+    return;
+
+  mutt_hash_delete(ProbeCache, mailbox_path(m), NULL);
+}
+
+/**
+ * mailbox_poll_release - Release a reference to a MailboxPoll
+ * @param poll MailboxPoll
+ *
+ * The caller must hold mutt_workqueue_lock().
+ */
+static void mailbox_poll_release(struct MailboxPoll *poll)
+{
+  if (--poll->refs > 0)
+    return;
+
+  FREE(&poll->path);
+  FREE(&poll);
+}
+
+/**
+ * mailbox_poll_job - stat() and probe a Mailbox - Implements ::workqueue_job_t
+ */
+static void mailbox_poll_job(void *data)
+{
+  struct MailboxPoll *poll = data;
+
+  poll->stat_rc = stat(poll->path, &poll->sb);
+
+  /* An unchanged Mailbox keeps its type, so there's no need to look inside */
+  if (poll->probe && (poll->stat_rc == 0) &&
+      !(poll->cached && mailbox_probe_match(&poll->cache, &poll->sb)))
+  {
+    poll->type = mx_path_probe_local(poll->path, &poll->sb);
+    poll->probed = true;
+  }
+
+  mutt_workqueue_lock();
+  poll->done = true;
+  mutt_workqueue_signal();
+  mailbox_poll_release(poll);
+  mutt_workqueue_unlock();
+}
+
+/**
+ * mailbox_poll_probe - Find the type of a polled Mailbox
+ * @param poll Finished MailboxPoll
+ * @retval true The cached type was still valid
+ *
+ * Most local Mailboxes have already been probed by mailbox_poll_job().
+ */
+static bool mailbox_poll_probe(struct MailboxPoll *poll)
+{
+  if (!poll->probe)
+    return false;
+
+  if (poll->cached && (poll->stat_rc == 0) && mailbox_probe_match(&poll->cache, &poll->sb))
+  {
+    poll->type = poll->cache.type;
+    return true;
+  }
+
+  if (!poll->probed || (poll->type == MUTT_UNKNOWN))
+    poll->type = mx_path_probe(poll->path);
+  return false;
+}
+
+/**
+ * mailbox_poll_stuck - Is a Mailbox still being polled from an earlier check?
+ * @param path Path of the Mailbox (OPTIONAL)
+ * @retval true The earlier poll hasn't finished
+ *
+ * Polls that have finished since are freed.
+ */
+static bool mailbox_poll_stuck(const char *path)
+{
+  bool stuck = false;
+
+  mutt_workqueue_lock();
+  for (size_t i = 0; i < PollStuckCount;)
+  {
+    struct MailboxPoll *poll = PollStuck[i];
+    if (poll->done)
+    {
+      mailbox_poll_release(poll);
+      PollStuck[i] = PollStuck[--PollStuckCount];
+      continue;
+    }
+
+    if (mutt_str_equal(poll->path, path))
+      stuck = true;
+    i++;
+  }
+  mutt_workqueue_unlock();
+
+  return stuck;
+}
+
+/**
+ * mailbox_poll_start - Start polling the Mailboxes
+ * @param checks Mailboxes to check
+ * @param num    Number of Mailboxes
+ *
+ * The Mailboxes are stat()ed on the worker threads, if there are any,
+ * otherwise one at a time.  Monitored Mailboxes report their own changes, so
+ * they're not touched.
+ */
+static void mailbox_poll_start(struct MailboxCheck *checks, size_t num)
+{
+  /* A queue with jobs that are stuck can't be freed */
+  mailbox_poll_stuck(NULL);
+  if (PollQueue && (PollStuckCount == 0) &&
+      (mutt_workqueue_threads(PollQueue) != C_MailCheckThreads))
+  {
+    mutt_workqueue_free(&PollQueue);
+  }
+  if (!PollQueue && (C_MailCheckThreads > 0))
+    PollQueue = mutt_workqueue_new(C_MailCheckThreads);
+
+  struct WorkQueue *wq = (C_MailCheckThreads > 0) ? PollQueue : NULL;
+
+  for (size_t i = 0; i < num; i++)
+  {
+    struct Mailbox *m = checks[i].mailbox;
+
+    /* A monitored mailbox reports its own changes, there's no need to probe it */
+    if (!m->monitored && mailbox_poll_stuck(mailbox_path(m)))
+    {
+      mutt_debug(LL_DEBUG1, "%s is still being checked\n", mailbox_path(m));
+      continue;
+    }
+
+    struct MailboxPoll *poll = mutt_mem_calloc(1, sizeof(*poll));
+    poll->path = mutt_str_dup(mailbox_path(m));
+    poll->type = m->type;
+    poll->probe = !m->monitored;
+    poll->refs = 2;
+
+    struct MailboxProbe *mp = (poll->probe && ProbeCache) ?
+                                  mutt_hash_find(ProbeCache, poll->path) :
+                                  NULL;
+    if (mp)
+    {
+      poll->cache = *mp;
+      poll->cached = true;
+    }
+    checks[i].poll = poll;
+
+    if (m->monitored)
+    {
+      poll->done = true;
+      poll->refs = 1;
+    }
+    else if (wq)
+    {
+      mutt_workqueue_add(wq, mailbox_poll_job, poll);
+    }
+    else
+    {
+      mailbox_poll_job(poll);
+    }
+  }
+}
+
+/**
+ * mailbox_poll_wait - Wait for the Mailboxes to be polled
+ * @param checks Mailboxes to check
+ * @param num    Number of Mailboxes
+ * @param start  Time the check started, in milliseconds
+ *
+ * Mailboxes that haven't been polled within $mail_check_timeout are skipped.
+ * Their polls are kept until they finish, see mailbox_poll_stuck().
+ */
+static void mailbox_poll_wait(struct MailboxCheck *checks, size_t num, uint64_t start)
+{
+  const uint64_t limit = (uint64_t) C_MailCheckTimeout * 1000;
+
+  mutt_workqueue_lock();
+  for (size_t i = 0; i < num; i++)
+  {
+    struct MailboxPoll *poll = checks[i].poll;
+    if (!poll)
+      continue;
+
+    while (!poll->done)
+    {
+      const uint64_t elapsed = mutt_date_epoch_ms() - start;
+      if ((limit > 0) && (elapsed >= limit))
+        break;
+
+      mutt_workqueue_timedwait((limit > 0) ? (int) (limit - elapsed) : 1000);
+    }
+
+    if (poll->done)
+      continue;
+
+    mutt_debug(LL_DEBUG1, "%s didn't answer within %d seconds\n", poll->path,
+               C_MailCheckTimeout);
+    mutt_mem_realloc(&PollStuck, (PollStuckCount + 1) * sizeof(*PollStuck));
+    PollStuck[PollStuckCount++] = poll;
+    checks[i].poll = NULL;
+  }
+  mutt_workqueue_unlock();
+}
+
+/**
+ * mailbox_check_finish - Finish checking a Mailbox
+ * @param mc Mailbox being checked
+ */
+static void mailbox_check_finish(struct MailboxCheck *mc)
+{
+  struct Mailbox *m_check = mc->mailbox;
+
+#ifdef USE_SIDEBAR
+  if ((mc->orig_new != m_check->has_new) || (mc->orig_count != m_check->msg_count) ||
+      (mc->orig_unread != m_check->msg_unread) || (mc->orig_flagged != m_check->msg_flagged))
+  {
+    mutt_menu_set_current_redraw(REDRAW_SIDEBAR);
+  }
+#endif
+
+  if (!m_check->has_new)
+    m_check->notified = false;
+  else if (!m_check->notified)
+    MailboxNotify++;
+}
 
 /**
  * mailbox_check - Check a mailbox for new mail
- * @param m_cur       Current Mailbox
- * @param m_check     Mailbox to check
- * @param ctx_sb      stat() info for the current Mailbox
- * @param check_stats If true, also count the total, new and flagged messages
+ * @param m_cur  Current Mailbox
+ * @param mc     Mailbox to check
+ * @param ctx_sb stat() info for the current Mailbox
+ *
+ * The checks of IMAP Mailboxes are queued.  They're finished by
+ * mutt_mailbox_check() once the server has replied.
  */
-static void mailbox_check(struct Mailbox *m_cur, struct Mailbox *m_check,
-                          struct stat *ctx_sb, bool check_stats)
+static void mailbox_check(struct Mailbox *m_cur, struct MailboxCheck *mc, struct stat *ctx_sb)
 {
+  struct Mailbox *m_check = mc->mailbox;
+  struct MailboxPoll *poll = mc->poll;
   struct stat sb = { 0 };
 
 #ifdef USE_SIDEBAR
-  short orig_new = m_check->has_new;
-  int orig_count = m_check->msg_count;
-  int orig_unread = m_check->msg_unread;
-  int orig_flagged = m_check->msg_flagged;
+  mc->orig_new = m_check->has_new;
+  mc->orig_count = m_check->msg_count;
+  mc->orig_unread = m_check->msg_unread;
+  mc->orig_flagged = m_check->msg_flagged;
 #endif
 
-  enum MailboxType mb_type = mx_path_probe(mailbox_path(m_check));
+  enum MailboxType mb_type = poll->type;
 
   if ((m_cur == m_check) && C_MailCheckRecent)
     m_check->has_new = false;
@@ -85,10 +449,12 @@ static void mailbox_check(struct Mailbox *m_cur, struct Mailbox *m_check,
       m_check->type = mb_type;
       break;
     default:
-      if ((stat(mailbox_path(m_check), &sb) != 0) ||
+      if (m_check->monitored)
+        break;
+      sb = poll->sb;
+      if ((poll->stat_rc != 0) ||
           ((m_check->type == MUTT_UNKNOWN) && S_ISREG(sb.st_mode) && (sb.st_size == 0)) ||
-          ((m_check->type == MUTT_UNKNOWN) &&
-           ((m_check->type = mx_path_probe(mailbox_path(m_check))) <= 0)))
+          ((m_check->type == MUTT_UNKNOWN) && ((m_check->type = mb_type) <= 0)))
       {
         /* if the mailbox still doesn't exist, set the newly created flag to be
          * ready for when it does. */
@@ -103,19 +469,29 @@ static void mailbox_check(struct Mailbox *m_cur, struct Mailbox *m_check,
   /* check to see if the folder is the currently selected folder before polling */
   if (!m_cur || mutt_buffer_is_empty(&m_cur->pathbuf) ||
       (((m_check->type == MUTT_IMAP) || (m_check->type == MUTT_NNTP) ||
-        (m_check->type == MUTT_NOTMUCH) || (m_check->type == MUTT_POP)) ?
+        (m_check->type == MUTT_NOTMUCH) || (m_check->type == MUTT_POP) ||
+        m_check->monitored) ?
            !mutt_str_equal(mailbox_path(m_check), mailbox_path(m_cur)) :
            ((sb.st_dev != ctx_sb->st_dev) || (sb.st_ino != ctx_sb->st_ino))))
   {
     switch (m_check->type)
     {
+#ifdef USE_IMAP
       case MUTT_IMAP:
+        /* The reply is read by imap_mailbox_status_flush() */
+        if (mx_mbox_check_stats(m_check, mc->check_stats) >= 0)
+        {
+          mc->queued = true;
+          return;
+        }
+        break;
+#endif
       case MUTT_MBOX:
       case MUTT_MMDF:
       case MUTT_MAILDIR:
       case MUTT_MH:
       case MUTT_NOTMUCH:
-        if ((mx_mbox_check_stats(m_check, check_stats) > 0) && m_check->has_new)
+        if ((mx_mbox_check_stats(m_check, mc->check_stats) > 0) && m_check->has_new)
           MailboxCount++;
         break;
       default:; /* do nothing */
@@ -124,18 +500,24 @@ static void mailbox_check(struct Mailbox *m_cur, struct Mailbox *m_check,
   else if (C_CheckMboxSize && m_cur && mutt_buffer_is_empty(&m_cur->pathbuf))
     m_check->size = (off_t) sb.st_size; /* update the size of current folder */
 
-#ifdef USE_SIDEBAR
-  if ((orig_new != m_check->has_new) || (orig_count != m_check->msg_count) ||
-      (orig_unread != m_check->msg_unread) || (orig_flagged != m_check->msg_flagged))
+  mailbox_check_finish(mc);
+}
+
+/**
+ * mutt_mailbox_poll_free - Free the state kept between mail checks
+ *
+ * The worker threads are only stopped if none of them is stuck on a Mailbox.
+ */
+void mutt_mailbox_poll_free(void)
+{
+  mutt_hash_free(&ProbeCache);
+
+  mailbox_poll_stuck(NULL);
+  if (PollStuckCount == 0)
   {
-    mutt_menu_set_current_redraw(REDRAW_SIDEBAR);
+    mutt_workqueue_free(&PollQueue);
+    FREE(&PollStuck);
   }
-#endif
-
-  if (!m_check->has_new)
-    m_check->notified = false;
-  else if (!m_check->notified)
-    MailboxNotify++;
 }
 
 /**
@@ -149,6 +531,14 @@ static void mailbox_check(struct Mailbox *m_cur, struct Mailbox *m_check,
  * - MUTT_MAILBOX_CHECK_FORCE_STATS  ignore MailboxTime and calculate statistics
  *
  * Check all all Mailboxes for new mail and total/new/flagged messages
+ *
+ * The local Mailboxes are looked at together, by $mail_check_threads worker
+ * threads.  The STATUS commands for each IMAP server are sent in one go.
+ * The results are then used on the main thread, in the Mailboxes' order.
+ *
+ * The whole check, including counting the messages, is limited by
+ * $mail_check_timeout.  If it runs out of time, the remaining Mailboxes keep
+ * their old counts, and the next check starts with them.
  */
 int mutt_mailbox_check(struct Mailbox *m_cur, int force)
 {
@@ -196,18 +586,92 @@ int mutt_mailbox_check(struct Mailbox *m_cur, int force)
 
   struct MailboxList ml = STAILQ_HEAD_INITIALIZER(ml);
   neomutt_mailboxlist_get_all(&ml, NeoMutt, MUTT_MAILBOX_ANY);
+
+  size_t num = 0;
   struct MailboxNode *np = NULL;
   STAILQ_FOREACH(np, &ml, entries)
+  {
+    num++;
+  }
+
+  struct MailboxCheck *checks = mutt_mem_calloc(MAX(num, 1), sizeof(*checks));
+  num = 0;
+  STAILQ_FOREACH(np, &ml, entries)
   {
     if (np->mailbox->flags & MB_HIDDEN)
       continue;
 
-    mailbox_check(m_cur, np->mailbox, &contex_sb,
-                  check_stats || (!np->mailbox->first_check_stats_done && C_MailCheckStats));
-    np->mailbox->first_check_stats_done = true;
+    checks[num].mailbox = np->mailbox;
+    checks[num].check_stats =
+        check_stats || (!np->mailbox->first_check_stats_done && C_MailCheckStats);
+    num++;
   }
   neomutt_mailboxlist_clear(&ml);
 
+  const uint64_t start = mutt_date_epoch_ms();
+  const uint64_t limit = (uint64_t) C_MailCheckTimeout * 1000;
+  mailbox_poll_start(checks, num);
+  mailbox_poll_wait(checks, num, start);
+
+  const size_t first = (CheckNext < num) ? CheckNext : 0;
+  size_t checked = 0;
+  bool out_of_time = false;
+  CheckNext = 0;
+  for (size_t n = 0; n < num; n++)
+  {
+    const size_t i = (first + n) % num;
+    if (!checks[i].poll)
+      continue;
+
+    /* Always make some progress, even if polling used up all the time */
+    if (!out_of_time && (limit > 0) && (checked > 0) &&
+        ((mutt_date_epoch_ms() - start) >= limit))
+    {
+      mutt_debug(LL_DEBUG1, "out of time, %s and later will be checked next time\n",
+                 mailbox_path(checks[i].mailbox));
+      out_of_time = true;
+      CheckNext = i;
+    }
+
+    if (out_of_time)
+    {
+      if (checks[i].mailbox->has_new)
+        MailboxCount++;
+      continue;
+    }
+
+    if (!mailbox_poll_probe(checks[i].poll))
+      mailbox_probe_update(checks[i].poll);
+    mailbox_check(m_cur, &checks[i], &contex_sb);
+    checks[i].mailbox->first_check_stats_done = true;
+    checked++;
+  }
+
+#ifdef USE_IMAP
+  /* Read the replies to the STATUS commands.  Each Account is only flushed
+   * once, by the first of its Mailboxes. */
+  for (size_t i = 0; i < num; i++)
+  {
+    if (!checks[i].queued)
+      continue;
+
+    imap_mailbox_status_flush(checks[i].mailbox);
+
+    if (checks[i].mailbox->has_new)
+      MailboxCount++;
+    mailbox_check_finish(&checks[i]);
+  }
+#endif
+
+  mutt_workqueue_lock();
+  for (size_t i = 0; i < num; i++)
+  {
+    if (checks[i].poll)
+      mailbox_poll_release(checks[i].poll);
+  }
+  mutt_workqueue_unlock();
+  FREE(&checks);
+
   return MailboxCount;
 }
 
@@ -11,6 +11,8 @@ struct stat;
 extern short C_MailCheck;
 extern bool  C_MailCheckStats;
 extern short C_MailCheckStatsInterval;
+extern short C_MailCheckThreads;
+extern short C_MailCheckTimeout;
 
 /* force flags passed to mutt_mailbox_check() */
 #define MUTT_MAILBOX_CHECK_FORCE       (1 << 0)
@@ -21,6 +23,8 @@ void mutt_mailbox_cleanup     (const char *path, struct stat *st);
 bool mutt_mailbox_list        (void);
 struct Mailbox *mutt_mailbox_next(struct Mailbox *m_cur, struct Buffer *s);
 bool mutt_mailbox_notify      (struct Mailbox *m_cur);
+void mutt_mailbox_poll_free   (void);
+void mutt_mailbox_probe_forget(struct Mailbox *m);
 void mutt_mailbox_set_notified(struct Mailbox *m);
 
 #endif /* MUTT_MUTT_MAILBOX_H */
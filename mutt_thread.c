@@ -638,10 +638,10 @@ static int compare_threads(const void *a, const void *b)
                         &(*((struct MuttThread const *const *) b))->sort_key);
   }
   /* a hack to let us reset sort_func even though we can't
-   * have extra arguments because of qsort */
+   * have extra arguments because of qsort: b is the Mailbox */
   else
   {
-    sort_func = mutt_get_sort_func(C_Sort & SORT_MASK);
+    sort_func = mutt_get_sort_func(C_Sort & SORT_MASK, (struct Mailbox *) b);
     return sort_func ? 1 : 0;
   }
 }
@@ -649,10 +649,11 @@ static int compare_threads(const void *a, const void *b)
 /**
  * mutt_sort_subthreads - Sort the children of a thread
  * @param thread Thread to start at
+ * @param m      Mailbox being sorted
  * @param init   If true, rebuild the thread
  * @retval ptr Sorted threads
  */
-struct MuttThread *mutt_sort_subthreads(struct MuttThread *thread, bool init)
+struct MuttThread *mutt_sort_subthreads(struct MuttThread *thread, struct Mailbox *m, bool init)
 {
   struct MuttThread **array = NULL, *sort_key = NULL, *top = NULL, *tmp = NULL;
   struct Email *oldsort_key = NULL;
@@ -663,7 +664,7 @@ struct MuttThread *mutt_sort_subthreads(struct MuttThread *thread, bool init)
    * resorting, so we sort backwards and then put them back
    * in reverse order so they're forwards */
   C_Sort ^= SORT_REVERSE;
-  if (compare_threads(NULL, NULL) == 0)
+  if (compare_threads(NULL, m) == 0)
     return thread;
 
   top = thread;
@@ -1060,7 +1061,7 @@ void mutt_sort_threads(struct Context *ctx, bool init)
 
   if (ctx->tree)
   {
-    ctx->tree = mutt_sort_subthreads(ctx->tree, init);
+    ctx->tree = mutt_sort_subthreads(ctx->tree, ctx->mailbox, init);
 
     /* restore the oldsort order. */
     C_Sort = oldsort;
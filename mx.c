@@ -83,6 +83,7 @@
 bool C_KeepFlagged; ///< Config: Don't move flagged messages from #C_Spoolfile to #C_Mbox
 unsigned char C_MboxType; ///< Config: Default type for creating new mailboxes
 unsigned char C_Move; ///< Config: Move emails from #C_Spoolfile to #C_Mbox when read
+short C_ProgressiveOpen; ///< Config: Number of emails to read before showing the index
 char *C_Trash;        ///< Config: Folder to put deleted emails
 
 // clang-format off
@@ -398,6 +399,12 @@ struct Context *mx_mbox_open(struct Mailbox *m, OpenMailboxFlags flags)
   m->msg_tagged = 0;
   m->vcount = 0;
 
+  /* The driver may return early and read the rest with mx_mbox_load() */
+  m->loading = false;
+  m->load_batch = 0;
+  if ((flags & MUTT_PROGRESSIVE) && m->mx_ops->mbox_load)
+    m->load_batch = C_ProgressiveOpen;
+
   int rc = m->mx_ops->mbox_open(ctx->mailbox);
   m->opened++;
   if (rc == 0)
@@ -459,6 +466,7 @@ void mx_fastclose_mailbox(struct Mailbox *m)
 
   if (m->mx_ops)
     m->mx_ops->mbox_close(m);
+  m->loading = false;
 
   mutt_hash_free(&m->subj_hash);
   mutt_hash_free(&m->id_hash);
@@ -1149,6 +1157,39 @@ int mx_mbox_check(struct Mailbox *m)
   return rc;
 }
 
+/**
+ * mx_mbox_load - Read more Emails - Wrapper for MxOps::mbox_load()
+ * @param m Mailbox
+ * @retval >=0 Number of Emails read
+ * @retval  -1 Error
+ *
+ * A Mailbox opened with #MUTT_PROGRESSIVE may return before all its Emails
+ * have been read.  While Mailbox.loading is set, each call reads another
+ * batch.  The batches grow with the Mailbox, so re-sorting the index after
+ * each one stays a small part of the work.
+ *
+ * The caller adds the new Emails to the Context, see ctx_update_added().
+ * It should clear Mailbox.verbose, so the batches are read quietly.
+ */
+int mx_mbox_load(struct Mailbox *m)
+{
+  if (!m || !m->loading)
+    return 0;
+
+  if (!m->mx_ops || !m->mx_ops->mbox_load)
+  {
+    m->loading = false;
+    return -1;
+  }
+
+  m->load_batch = MAX(m->load_batch, m->msg_count / 8);
+  int rc = m->mx_ops->mbox_load(m);
+  if (rc < 0)
+    m->loading = false;
+
+  return rc;
+}
+
 /**
  * mx_msg_open - return a stream pointer for a message
  * @param m   Mailbox
@@ -1394,6 +1435,38 @@ enum MailboxType mx_path_probe(const char *path)
   return rc;
 }
 
+/**
+ * mx_path_probe_local - Find the type of a local Mailbox, without the hooks
+ * @param path Path to the Mailbox
+ * @param st   stat() info for the Mailbox
+ * @retval enum Type, e.g. #MUTT_MBOX, or #MUTT_UNKNOWN if it isn't sure
+ *
+ * Only the types that are found by looking inside the Mailbox are tried, and
+ * no errors are reported, so it may be called from a worker thread.  If it
+ * returns #MUTT_UNKNOWN, ask mx_path_probe(), e.g. for a compressed Mailbox.
+ */
+enum MailboxType mx_path_probe_local(const char *path, const struct stat *st)
+{
+  if (!path || !st || S_ISFIFO(st->st_mode))
+    return MUTT_UNKNOWN;
+
+  for (const struct MxOps **ops = mx_ops; *ops; ops++)
+  {
+    if (!(*ops)->is_local)
+      continue;
+#ifdef USE_COMP_MBOX
+    /* A compressed Mailbox is found by its hooks */
+    if (*ops == &MxCompOps)
+      continue;
+#endif
+    enum MailboxType rc = (*ops)->path_probe(path, st);
+    if (rc != MUTT_UNKNOWN)
+      return rc;
+  }
+
+  return MUTT_UNKNOWN;
+}
+
 /**
  * mx_path_canon - Canonicalise a mailbox path - Wrapper for MxOps::path_canon()
  */
@@ -43,6 +43,7 @@ extern unsigned char C_CatchupNewsgroup;
 extern bool          C_KeepFlagged;
 extern unsigned char C_MboxType;
 extern unsigned char C_Move;
+extern short         C_ProgressiveOpen;
 extern char *        C_Trash;
 
 extern struct EnumDef MboxTypeDef;
@@ -60,6 +61,7 @@ typedef uint8_t OpenMailboxFlags;   ///< Flags for mutt_open_mailbox(), e.g. #MU
 #define MUTT_PEEK          (1 << 5) ///< Revert atime back after taking a look (if applicable)
 #define MUTT_APPENDNEW     (1 << 6) ///< Set in mx_open_mailbox_append if the mailbox doesn't exist.
                                     ///< Used by maildir/mh to create the mailbox.
+#define MUTT_PROGRESSIVE   (1 << 7) ///< Return after the first $progressive_open emails, see mx_mbox_load()
 
 typedef uint8_t MsgOpenFlags;      ///< Flags for mx_msg_open_new(), e.g. #MUTT_ADD_FROM
 #define MUTT_MSG_NO_FLAGS       0  ///< No flags are set
@@ -135,6 +137,16 @@ struct MxOps
    */
   int (*mbox_open)       (struct Mailbox *m);
 
+  /**
+   * mbox_load - Read the next batch of Emails of a progressively opened Mailbox
+   * @param m Mailbox
+   * @retval >=0 Number of Emails read
+   * @retval  -1 Error
+   *
+   * The driver clears Mailbox.loading once it has read every Email.
+   */
+  int (*mbox_load)       (struct Mailbox *m);
+
   /**
    * mbox_open_append - Open a Mailbox for appending
    * @param m     Mailbox to open
@@ -295,6 +307,7 @@ struct MxOps
 int             mx_mbox_check      (struct Mailbox *m);
 int             mx_mbox_check_stats(struct Mailbox *m, int flags);
 int             mx_mbox_close      (struct Context **ptr);
+int             mx_mbox_load       (struct Mailbox *m);
 struct Context *mx_mbox_open       (struct Mailbox *m, OpenMailboxFlags flags);
 int             mx_mbox_sync       (struct Mailbox *m);
 int             mx_msg_close       (struct Mailbox *m, struct Message **msg);
@@ -308,6 +321,7 @@ int             mx_path_canon2     (struct Mailbox *m, const char *folder);
 int             mx_path_parent     (char *buf, size_t buflen);
 int             mx_path_pretty     (char *buf, size_t buflen, const char *folder);
 enum MailboxType mx_path_probe     (const char *path);
+enum MailboxType mx_path_probe_local(const char *path, const struct stat *st);
 struct Mailbox *mx_path_resolve    (const char *path);
 struct Mailbox *mx_resolve         (const char *path_or_name);
 int             mx_tags_commit     (struct Mailbox *m, struct Email *e, char *tags);
@@ -2879,6 +2879,7 @@ struct MxOps MxNntpOps = {
   .ac_find          = nntp_ac_find,
   .ac_add           = nntp_ac_add,
   .mbox_open        = nntp_mbox_open,
+  .mbox_load        = NULL,
   .mbox_open_append = NULL,
   .mbox_check       = nntp_mbox_check,
   .mbox_check_stats = NULL,
@@ -2595,6 +2595,7 @@ struct MxOps MxNotmuchOps = {
   .ac_find          = nm_ac_find,
   .ac_add           = nm_ac_add,
   .mbox_open        = nm_mbox_open,
+  .mbox_load        = NULL,
   .mbox_open_append = NULL,
   .mbox_check       = nm_mbox_check,
   .mbox_check_stats = nm_mbox_check_stats,
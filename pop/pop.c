@@ -441,6 +441,10 @@ static int pop_fetch_headers(struct Mailbox *m)
     }
 
     bool hcached = false;
+#ifdef USE_HCACHE
+    /* Save the new headers in one batch */
+    mutt_hcache_begin(hc);
+#endif
     for (i = old_count; i < new_count; i++)
     {
       if (m->verbose)
@@ -511,6 +515,9 @@ static int pop_fetch_headers(struct Mailbox *m)
 
       m->msg_count++;
     }
+#ifdef USE_HCACHE
+    mutt_hcache_commit(hc);
+#endif
   }
 
 #ifdef USE_HCACHE
@@ -1273,6 +1280,7 @@ struct MxOps MxPopOps = {
   .ac_find          = pop_ac_find,
   .ac_add           = pop_ac_add,
   .mbox_open        = pop_mbox_open,
+  .mbox_load        = NULL,
   .mbox_open_append = NULL,
   .mbox_check       = pop_mbox_check,
   .mbox_check_stats = NULL,
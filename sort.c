@@ -43,6 +43,9 @@
 #include "mutt_thread.h"
 #include "options.h"
 #include "score.h"
+#ifdef USE_IMAP
+#include "imap/lib.h"
+#endif
 #ifdef USE_NNTP
 #include "nntp/lib.h"
 #endif
@@ -319,10 +322,16 @@ static int compare_label(const void *a, const void *b)
 /**
  * mutt_get_sort_func - Get the sort function for a given sort id
  * @param method Sort type, see #SortType
+ * @param m      Mailbox being sorted, may be NULL
  * @retval ptr sort function - Implements ::sort_t
  */
-sort_t mutt_get_sort_func(enum SortType method)
+sort_t mutt_get_sort_func(enum SortType method, struct Mailbox *m)
 {
+#ifdef USE_IMAP
+  if (m && (m->type == MUTT_IMAP) && imap_sort_ranked(m, method))
+    return imap_compare_rank;
+#endif
+
   switch (method)
   {
     case SORT_DATE:
@@ -333,7 +342,7 @@ sort_t mutt_get_sort_func(enum SortType method)
       return compare_label;
     case SORT_ORDER:
 #ifdef USE_NNTP
-      if (Context && Context->mailbox && (Context->mailbox->type == MUTT_NNTP))
+      if (m && (m->type == MUTT_NNTP))
         return nntp_compare_order;
       else
 #endif
@@ -417,14 +426,14 @@ void mutt_sort_headers(struct Context *ctx, bool init)
       int i = C_Sort;
       C_Sort = C_SortAux;
       if (ctx->tree)
-        ctx->tree = mutt_sort_subthreads(ctx->tree, true);
+        ctx->tree = mutt_sort_subthreads(ctx->tree, m, true);
       C_Sort = i;
       OptSortSubthreads = false;
     }
     mutt_sort_threads(ctx, init);
   }
-  else if (!(sortfunc = mutt_get_sort_func(C_Sort & SORT_MASK)) ||
-           !(AuxSort = mutt_get_sort_func(C_SortAux & SORT_MASK)))
+  else if (!(sortfunc = mutt_get_sort_func(C_Sort & SORT_MASK, m)) ||
+           !(AuxSort = mutt_get_sort_func(C_SortAux & SORT_MASK, m)))
   {
     mutt_error(_("Could not find sorting function [report this bug]"));
     return;
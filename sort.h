@@ -31,6 +31,7 @@
 
 struct Address;
 struct Context;
+struct Mailbox;
 
 /* These Config Variables are only used in sort.c */
 extern bool C_ReverseAlias;
@@ -47,7 +48,7 @@ extern bool C_ReverseAlias;
  */
 typedef int (*sort_t)(const void *a, const void *b);
 
-sort_t mutt_get_sort_func(enum SortType method);
+sort_t mutt_get_sort_func(enum SortType method, struct Mailbox *m);
 
 void mutt_sort_headers(struct Context *ctx, bool init);
 int perform_auxsort(int retval, const void *a, const void *b);
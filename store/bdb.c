@@ -36,6 +36,7 @@
 #include <fcntl.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -223,6 +224,76 @@ static int store_bdb_delete_record(void *store, const char *key, size_t klen)
   return ctx->db->del(ctx->db, NULL, &dkey, 0);
 }
 
+/**
+ * store_bdb_begin - Implements StoreOps::begin()
+ *
+ * The environment isn't transactional, so records are written to the memory
+ * pool by store() and flushed to disk by commit().
+ */
+static int store_bdb_begin(void *store)
+{
+  if (!store)
+    return -1;
+
+  return 0;
+}
+
+/**
+ * store_bdb_commit - Implements StoreOps::commit()
+ */
+static int store_bdb_commit(void *store)
+{
+  if (!store)
+    return -1;
+
+  struct StoreDbCtx *ctx = store;
+
+  return ctx->db->sync(ctx->db, 0);
+}
+
+/**
+ * store_bdb_scan - Implements StoreOps::scan()
+ */
+static int store_bdb_scan(void *store, const char *prefix, size_t plen,
+                          store_scan_t cb, void *data)
+{
+  if (!store || !cb)
+    return -1;
+
+  struct StoreDbCtx *ctx = store;
+
+  DBC *cursor = NULL;
+  int rc = ctx->db->cursor(ctx->db, NULL, &cursor, 0);
+  if (rc != 0)
+    return rc;
+
+  DBT dkey;
+  DBT value;
+
+  /* The cursor replaces the key with the one it finds */
+  dbt_empty_init(&dkey);
+  dbt_empty_init(&value);
+  dkey.flags = DB_DBT_REALLOC;
+  value.flags = DB_DBT_REALLOC;
+  dkey.data = mutt_mem_malloc(MAX(plen, 1));
+  memcpy(dkey.data, prefix, plen);
+  dkey.size = plen;
+
+  rc = cursor->get(cursor, &dkey, &value, (plen == 0) ? DB_FIRST : DB_SET_RANGE);
+  for (; rc == 0; rc = cursor->get(cursor, &dkey, &value, DB_NEXT))
+  {
+    if ((dkey.size < plen) || (memcmp(dkey.data, prefix, plen) != 0))
+      break;
+    if (!cb(dkey.data, dkey.size, value.data, value.size, data))
+      break;
+  }
+  cursor->close(cursor);
+
+  FREE(&dkey.data);
+  FREE(&value.data);
+  return (rc == DB_NOTFOUND) ? 0 : rc;
+}
+
 /**
  * store_bdb_close - Implements StoreOps::close()
  */
@@ -124,6 +124,41 @@ static int store_gdbm_delete_record(void *store, const char *key, size_t klen)
   return gdbm_delete(db, dkey);
 }
 
+/**
+ * store_gdbm_begin - Implements StoreOps::begin()
+ *
+ * GDBM doesn't have transactions.  Each record is written by store().
+ */
+static int store_gdbm_begin(void *store)
+{
+  if (!store)
+    return -1;
+
+  return 0;
+}
+
+/**
+ * store_gdbm_commit - Implements StoreOps::commit()
+ */
+static int store_gdbm_commit(void *store)
+{
+  if (!store)
+    return -1;
+
+  return 0;
+}
+
+/**
+ * store_gdbm_scan - Implements StoreOps::scan()
+ *
+ * GDBM is a hash table, so its records can't be read in key order.
+ */
+static int store_gdbm_scan(void *store, const char *prefix, size_t plen,
+                           store_scan_t cb, void *data)
+{
+  return -1;
+}
+
 /**
  * store_gdbm_close - Implements StoreOps::close()
  */
@@ -32,7 +32,9 @@
 
 #include "config.h"
 #include <kclangc.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "mutt/lib.h"
 #include "lib.h"
 #include "mutt_globals.h"
@@ -125,6 +127,76 @@ static int store_kyotocabinet_delete_record(void *store, const char *key, size_t
   return 0;
 }
 
+/**
+ * store_kyotocabinet_begin - Implements StoreOps::begin()
+ */
+static int store_kyotocabinet_begin(void *store)
+{
+  if (!store)
+    return -1;
+
+  KCDB *db = store;
+  if (!kcdbbegintran(db, false))
+  {
+    int ecode = kcdbecode(db);
+    return ecode ? ecode : -1;
+  }
+  return 0;
+}
+
+/**
+ * store_kyotocabinet_commit - Implements StoreOps::commit()
+ */
+static int store_kyotocabinet_commit(void *store)
+{
+  if (!store)
+    return -1;
+
+  KCDB *db = store;
+  if (!kcdbendtran(db, true))
+  {
+    int ecode = kcdbecode(db);
+    return ecode ? ecode : -1;
+  }
+  return 0;
+}
+
+/**
+ * store_kyotocabinet_scan - Implements StoreOps::scan()
+ */
+static int store_kyotocabinet_scan(void *store, const char *prefix, size_t plen,
+                                   store_scan_t cb, void *data)
+{
+  if (!store || !cb)
+    return -1;
+
+  KCDB *db = store;
+  KCCUR *cur = kcdbcursor(db);
+  if (!cur)
+    return -1;
+
+  bool found = (plen == 0) ? kccurjump(cur) : kccurjumpkey(cur, prefix, plen);
+  while (found)
+  {
+    size_t klen = 0;
+    size_t vlen = 0;
+    const char *value = NULL;
+    char *key = kccurget(cur, &klen, &value, &vlen, true);
+    if (!key)
+      break;
+
+    bool more = (klen >= plen) && (memcmp(key, prefix, plen) == 0) &&
+                cb(key, klen, value, vlen, data);
+    kcfree(key);
+    if (!more)
+      break;
+  }
+
+  int ecode = kccurecode(cur);
+  kccurdel(cur);
+  return ((ecode == KCESUCCESS) || (ecode == KCENOREC)) ? 0 : ecode;
+}
+
 /**
  * store_kyotocabinet_close - Implements StoreOps::close()
  */
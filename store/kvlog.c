@@ -0,0 +1,996 @@
+/**
+ * @file
+ * Append-only log backend for the key/value Store
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @page store_kvlog Append-only log
+ *
+ * Built-in backend for the key/value Store.  It doesn't need any external
+ * libraries.
+ *
+ * The database is a single file.  After a small header, every store() or
+ * delete_record() appends a record to the end of the file.  Nothing is ever
+ * changed in place.
+ *
+ * | Record field | Size | Description                              |
+ * | :----------- | :--- | :--------------------------------------- |
+ * | sum          | 4    | FNV-1a checksum of the rest of the record |
+ * | flags        | 4    | #KVLOG_DELETED for a deleted key          |
+ * | klen         | 4    | Length of the key                        |
+ * | vlen         | 4    | Length of the value                      |
+ * | key          | klen |                                          |
+ * | value        | vlen |                                          |
+ *
+ * The file is mapped into memory.  When it's opened, the records are read to
+ * build a hash table of the latest version of each key.  fetch() returns a
+ * pointer straight into the map.
+ *
+ * ## Crash recovery
+ *
+ * When the store is closed, the length of the file is saved in the header.
+ * Records beyond that point must have been written since, so their checksums
+ * are verified when the file is opened.  The file is truncated at the first
+ * record that's incomplete, or corrupt.
+ *
+ * ## Compaction
+ *
+ * Replaced and deleted records are left in the file.  Whenever they take up
+ * more space than the live records, after a write, the live records are
+ * copied to a new file, which is renamed over the old one.  The store carries
+ * on using the new file.
+ *
+ * ## Locking
+ *
+ * A lock file is held for as long as the store is open, like the BerkeleyDB
+ * backend.
+ */
+
+#include "config.h"
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mutt/lib.h"
+#include "lib.h"
+
+/// Identifies a kvlog file
+#define KVLOG_MAGIC "NMKVLOG"
+/// Version of the file format, see store_kvlog_version()
+#define KVLOG_VERSION 1
+/// Record flag: the key has been deleted
+#define KVLOG_DELETED (1 << 0)
+/// Don't compact files with less than this much garbage
+#define KVLOG_COMPACT_MIN (1024 * 1024)
+/// Extra address space to map, so the file can grow without remapping
+#define KVLOG_MAP_SLACK (16 * 1024 * 1024)
+
+/**
+ * struct KvlogHeader - Header at the start of a kvlog file
+ */
+struct KvlogHeader
+{
+  char magic[8];    ///< #KVLOG_MAGIC
+  uint32_t version; ///< #KVLOG_VERSION
+  uint32_t padding;
+  uint64_t clean;   ///< Length of the file when it was last closed
+};
+
+/**
+ * struct KvlogRecord - Header of a record in a kvlog file
+ */
+struct KvlogRecord
+{
+  uint32_t sum;   ///< Checksum of the rest of the record
+  uint32_t flags; ///< Record flags, e.g. #KVLOG_DELETED
+  uint32_t klen;  ///< Length of the key
+  uint32_t vlen;  ///< Length of the value
+};
+
+/**
+ * struct KvlogSlot - Slot in the hash table
+ */
+struct KvlogSlot
+{
+  uint64_t offset; ///< Offset of the record in the file, 0 if the slot is empty
+  uint32_t hash;   ///< Hash of the key
+};
+
+/**
+ * struct KvlogMap - An old mapping of the file
+ *
+ * Values returned by fetch() point into the map, so old maps are kept until
+ * all the values have been freed.
+ */
+struct KvlogMap
+{
+  void *addr; ///< Start of the map
+  size_t len; ///< Length of the map
+};
+
+/**
+ * struct KvlogCtx - Append-only log context
+ */
+struct KvlogCtx
+{
+  int fd;                    ///< Database file
+  int lock_fd;               ///< Lock file
+  struct Buffer path;        ///< Path of the database file
+  struct Buffer lockfile;    ///< Path of the lock file
+
+  uint64_t size;             ///< Length of the file
+  uint64_t clean;            ///< Length of the file, when it was opened
+  char *map;                 ///< Mapping of the file
+  size_t map_len;            ///< Length of the mapping
+  struct KvlogMap *old_maps; ///< Earlier mappings
+  size_t num_old_maps;       ///< Number of earlier mappings
+  size_t num_fetched;        ///< Values returned by fetch() that haven't been freed
+
+  struct KvlogSlot *slots;   ///< Hash table of the live records
+  size_t num_slots;          ///< Size of the hash table, a power of two
+  size_t num_keys;           ///< Number of live records
+  uint64_t live;             ///< Bytes used by live records
+  uint64_t dead;             ///< Bytes used by replaced and deleted records
+
+  bool batch;                ///< A batch has been started
+  char *pending;             ///< Records waiting for commit()
+  size_t pending_len;        ///< Length of the pending records
+  size_t pending_size;       ///< Size of the pending buffer
+};
+
+/**
+ * kvlog_fnv - Calculate an FNV-1a checksum
+ * @param sum  Initial value
+ * @param data Data to check
+ * @param len  Length of data
+ * @retval num Checksum
+ */
+static uint32_t kvlog_fnv(uint32_t sum, const void *data, size_t len)
+{
+  const unsigned char *p = data;
+  for (size_t i = 0; i < len; i++)
+  {
+    sum ^= p[i];
+    sum *= 16777619U;
+  }
+  return sum;
+}
+
+/**
+ * kvlog_hash - Hash a key
+ * @param key  Key
+ * @param klen Length of the key
+ * @retval num Hash
+ */
+static uint32_t kvlog_hash(const char *key, size_t klen)
+{
+  return kvlog_fnv(2166136261U, key, klen);
+}
+
+/**
+ * kvlog_checksum - Calculate the checksum of a record
+ * @param rec   Record header
+ * @param key   Key
+ * @param value Value
+ * @retval num Checksum
+ */
+static uint32_t kvlog_checksum(const struct KvlogRecord *rec, const void *key,
+                               const void *value)
+{
+  uint32_t sum = kvlog_fnv(2166136261U, &rec->flags, 3 * sizeof(uint32_t));
+  sum = kvlog_fnv(sum, key, rec->klen);
+  return kvlog_fnv(sum, value, rec->vlen);
+}
+
+/**
+ * kvlog_retire_map - Stop using the current mapping of the file
+ * @param ctx Context
+ *
+ * If no fetched values are still in use, all the old mappings are removed.
+ * Otherwise, they're kept until the store is closed.
+ */
+static void kvlog_retire_map(struct KvlogCtx *ctx)
+{
+  if (ctx->map)
+  {
+    mutt_mem_realloc(&ctx->old_maps, (ctx->num_old_maps + 1) * sizeof(struct KvlogMap));
+    ctx->old_maps[ctx->num_old_maps].addr = ctx->map;
+    ctx->old_maps[ctx->num_old_maps].len = ctx->map_len;
+    ctx->num_old_maps++;
+    ctx->map = NULL;
+    ctx->map_len = 0;
+  }
+
+  if (ctx->num_fetched != 0)
+    return;
+
+  for (size_t i = 0; i < ctx->num_old_maps; i++)
+    munmap(ctx->old_maps[i].addr, ctx->old_maps[i].len);
+  FREE(&ctx->old_maps);
+  ctx->num_old_maps = 0;
+}
+
+/**
+ * kvlog_map - Make sure the file is mapped up to its current length
+ * @param ctx Context
+ * @retval true Success
+ *
+ * The file is mapped with some slack, so that it can grow without being
+ * remapped every time.
+ */
+static bool kvlog_map(struct KvlogCtx *ctx)
+{
+  if (ctx->size <= ctx->map_len)
+    return true;
+
+  size_t len = ctx->size + MAX(ctx->size, KVLOG_MAP_SLACK);
+  char *map = mmap(NULL, len, PROT_READ, MAP_SHARED, ctx->fd, 0);
+  if (map == MAP_FAILED)
+  {
+    mutt_debug(LL_DEBUG1, "mmap of %s failed: %s\n", mutt_b2s(&ctx->path), strerror(errno));
+    return false;
+  }
+
+  kvlog_retire_map(ctx);
+  ctx->map = map;
+  ctx->map_len = len;
+  return true;
+}
+
+/**
+ * kvlog_unmap - Remove all the mappings of the file
+ * @param ctx Context
+ */
+static void kvlog_unmap(struct KvlogCtx *ctx)
+{
+  for (size_t i = 0; i < ctx->num_old_maps; i++)
+    munmap(ctx->old_maps[i].addr, ctx->old_maps[i].len);
+  FREE(&ctx->old_maps);
+  ctx->num_old_maps = 0;
+
+  if (ctx->map)
+    munmap(ctx->map, ctx->map_len);
+  ctx->map = NULL;
+  ctx->map_len = 0;
+}
+
+/**
+ * kvlog_record - Get the record at an offset in the map
+ * @param[in]  ctx Context
+ * @param[in]  off Offset of the record
+ * @param[out] rec Record header
+ * @retval ptr Key, followed by the value
+ */
+static const char *kvlog_record(struct KvlogCtx *ctx, uint64_t off, struct KvlogRecord *rec)
+{
+  memcpy(rec, ctx->map + off, sizeof(struct KvlogRecord));
+  return ctx->map + off + sizeof(struct KvlogRecord);
+}
+
+/**
+ * kvlog_record_size - Get the size of a record
+ * @param klen Length of the key
+ * @param vlen Length of the value
+ * @retval num Size of the record
+ */
+static uint64_t kvlog_record_size(size_t klen, size_t vlen)
+{
+  return sizeof(struct KvlogRecord) + klen + vlen;
+}
+
+/**
+ * kvlog_find - Find the slot for a key
+ * @param ctx  Context
+ * @param key  Key
+ * @param klen Length of the key
+ * @param hash Hash of the key
+ * @retval ptr Slot holding the key, or the empty slot where it belongs
+ */
+static struct KvlogSlot *kvlog_find(struct KvlogCtx *ctx, const char *key,
+                                    size_t klen, uint32_t hash)
+{
+  const size_t mask = ctx->num_slots - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask)
+  {
+    struct KvlogSlot *slot = &ctx->slots[i];
+    if (slot->offset == 0)
+      return slot;
+    if (slot->hash != hash)
+      continue;
+
+    struct KvlogRecord rec;
+    const char *k = kvlog_record(ctx, slot->offset, &rec);
+    if ((rec.klen == klen) && (memcmp(k, key, klen) == 0))
+      return slot;
+  }
+}
+
+/**
+ * kvlog_grow - Double the size of the hash table
+ * @param ctx Context
+ */
+static void kvlog_grow(struct KvlogCtx *ctx)
+{
+  struct KvlogSlot *old = ctx->slots;
+  size_t num_old = ctx->num_slots;
+
+  ctx->num_slots = num_old ? (num_old * 2) : 1024;
+  ctx->slots = mutt_mem_calloc(ctx->num_slots, sizeof(struct KvlogSlot));
+
+  const size_t mask = ctx->num_slots - 1;
+  for (size_t i = 0; i < num_old; i++)
+  {
+    if (old[i].offset == 0)
+      continue;
+    size_t j = old[i].hash & mask;
+    while (ctx->slots[j].offset != 0)
+      j = (j + 1) & mask;
+    ctx->slots[j] = old[i];
+  }
+
+  FREE(&old);
+}
+
+/**
+ * kvlog_remove - Empty a slot of the hash table
+ * @param ctx  Context
+ * @param slot Slot to empty
+ *
+ * The following entries are shifted back, so that lookups don't need
+ * tombstones.
+ */
+static void kvlog_remove(struct KvlogCtx *ctx, struct KvlogSlot *slot)
+{
+  const size_t mask = ctx->num_slots - 1;
+  size_t i = slot - ctx->slots;
+  size_t j = i;
+
+  while (true)
+  {
+    j = (j + 1) & mask;
+    if (ctx->slots[j].offset == 0)
+      break;
+
+    /* Can the entry at j move back to the hole at i? */
+    size_t home = ctx->slots[j].hash & mask;
+    if (((j > i) && ((home <= i) || (home > j))) || ((j < i) && ((home <= i) && (home > j))))
+    {
+      ctx->slots[i] = ctx->slots[j];
+      i = j;
+    }
+  }
+
+  ctx->slots[i].offset = 0;
+  ctx->slots[i].hash = 0;
+  ctx->num_keys--;
+}
+
+/**
+ * kvlog_apply - Add a record to the hash table
+ * @param ctx Context
+ * @param off Offset of the record, which must be mapped
+ */
+static void kvlog_apply(struct KvlogCtx *ctx, uint64_t off)
+{
+  struct KvlogRecord rec;
+  const char *key = kvlog_record(ctx, off, &rec);
+  const uint64_t size = kvlog_record_size(rec.klen, rec.vlen);
+  const uint32_t hash = kvlog_hash(key, rec.klen);
+
+  if ((ctx->num_keys + 1) * 2 > ctx->num_slots)
+    kvlog_grow(ctx);
+
+  struct KvlogSlot *slot = kvlog_find(ctx, key, rec.klen, hash);
+  if (slot->offset != 0)
+  {
+    struct KvlogRecord old;
+    kvlog_record(ctx, slot->offset, &old);
+    const uint64_t old_size = kvlog_record_size(old.klen, old.vlen);
+    ctx->live -= old_size;
+    ctx->dead += old_size;
+  }
+
+  if (rec.flags & KVLOG_DELETED)
+  {
+    ctx->dead += size;
+    if (slot->offset != 0)
+      kvlog_remove(ctx, slot);
+    return;
+  }
+
+  if (slot->offset == 0)
+    ctx->num_keys++;
+  slot->offset = off;
+  slot->hash = hash;
+  ctx->live += size;
+}
+
+/**
+ * kvlog_load - Read the records and build the hash table
+ * @param ctx   Context
+ * @param clean Length of the file when it was last closed
+ * @retval true Success
+ *
+ * Records beyond the clean length are checked, and the file is truncated at
+ * the first bad one.
+ */
+static bool kvlog_load(struct KvlogCtx *ctx, uint64_t clean)
+{
+  uint64_t off = sizeof(struct KvlogHeader);
+  if (clean > ctx->size)
+    clean = 0; /* The file has been truncated, check everything */
+
+  while (off < ctx->size)
+  {
+    struct KvlogRecord rec;
+    if ((ctx->size - off) < sizeof(struct KvlogRecord))
+      break;
+
+    const char *key = kvlog_record(ctx, off, &rec);
+    const uint64_t size = kvlog_record_size(rec.klen, rec.vlen);
+    if ((ctx->size - off) < size)
+      break;
+
+    if ((off >= clean) && (kvlog_checksum(&rec, key, key + rec.klen) != rec.sum))
+      break;
+
+    kvlog_apply(ctx, off);
+    off += size;
+  }
+
+  if (off < ctx->size)
+  {
+    mutt_debug(LL_DEBUG1, "%s: discarding %llu bytes of incomplete records\n",
+               mutt_b2s(&ctx->path), (unsigned long long) (ctx->size - off));
+    if (ftruncate(ctx->fd, off) != 0)
+      return false;
+    ctx->size = off;
+  }
+
+  return true;
+}
+
+/**
+ * kvlog_append - Add a record to the pending buffer
+ * @param ctx   Context
+ * @param flags Record flags, e.g. #KVLOG_DELETED
+ * @param key   Key
+ * @param klen  Length of the key
+ * @param value Value
+ * @param vlen  Length of the value
+ */
+static void kvlog_append(struct KvlogCtx *ctx, uint32_t flags, const char *key,
+                         size_t klen, const void *value, size_t vlen)
+{
+  struct KvlogRecord rec = { 0 };
+  rec.flags = flags;
+  rec.klen = klen;
+  rec.vlen = vlen;
+  rec.sum = kvlog_checksum(&rec, key, value);
+
+  const size_t size = kvlog_record_size(klen, vlen);
+  if ((ctx->pending_len + size) > ctx->pending_size)
+  {
+    ctx->pending_size = MAX(ctx->pending_size * 2, ctx->pending_len + size);
+    mutt_mem_realloc(&ctx->pending, ctx->pending_size);
+  }
+
+  char *p = ctx->pending + ctx->pending_len;
+  memcpy(p, &rec, sizeof(rec));
+  memcpy(p + sizeof(rec), key, klen);
+  if (vlen != 0)
+    memcpy(p + sizeof(rec) + klen, value, vlen);
+  ctx->pending_len += size;
+}
+
+/**
+ * kvlog_flush - Write the pending records to the file
+ * @param ctx Context
+ * @retval 0   Success
+ * @retval num Error, an errno
+ */
+static int kvlog_flush(struct KvlogCtx *ctx)
+{
+  if (ctx->pending_len == 0)
+    return 0;
+
+  const uint64_t start = ctx->size;
+  size_t done = 0;
+  while (done < ctx->pending_len)
+  {
+    ssize_t rc = pwrite(ctx->fd, ctx->pending + done, ctx->pending_len - done, start + done);
+    if (rc < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      int err = errno;
+      mutt_debug(LL_DEBUG1, "write to %s failed: %s\n", mutt_b2s(&ctx->path), strerror(err));
+      ctx->pending_len = 0;
+      if (ftruncate(ctx->fd, start) != 0)
+        mutt_debug(LL_DEBUG1, "truncate of %s failed\n", mutt_b2s(&ctx->path));
+      return err;
+    }
+    done += rc;
+  }
+
+  ctx->size = start + ctx->pending_len;
+  ctx->pending_len = 0;
+  if (!kvlog_map(ctx))
+    return ENOMEM;
+
+  for (uint64_t off = start; off < ctx->size;)
+  {
+    struct KvlogRecord rec;
+    kvlog_record(ctx, off, &rec);
+    kvlog_apply(ctx, off);
+    off += kvlog_record_size(rec.klen, rec.vlen);
+  }
+
+  return 0;
+}
+
+/**
+ * kvlog_write_header - Write the header of a kvlog file
+ * @param fd    File to write to
+ * @param clean Length of the file
+ * @retval true Success
+ */
+static bool kvlog_write_header(int fd, uint64_t clean)
+{
+  struct KvlogHeader hdr = { 0 };
+  memcpy(hdr.magic, KVLOG_MAGIC, sizeof(KVLOG_MAGIC));
+  hdr.version = KVLOG_VERSION;
+  hdr.clean = clean;
+  return pwrite(fd, &hdr, sizeof(hdr), 0) == sizeof(hdr);
+}
+
+/**
+ * kvlog_cmp_offset - Compare two slots by their offset - Implements ::sort_t
+ */
+static int kvlog_cmp_offset(const void *a, const void *b)
+{
+  const struct KvlogSlot *sa = a;
+  const struct KvlogSlot *sb = b;
+  return (sa->offset > sb->offset) - (sa->offset < sb->offset);
+}
+
+/**
+ * kvlog_compact - Copy the live records to a new file
+ * @param ctx Context
+ * @retval true Success
+ *
+ * The records are copied in the order they were written.  The new file is
+ * renamed over the old one, and the store carries on using it.
+ */
+static bool kvlog_compact(struct KvlogCtx *ctx)
+{
+  struct Buffer *tmp = mutt_buffer_pool_get();
+  mutt_buffer_printf(tmp, "%s.tmp", mutt_b2s(&ctx->path));
+
+  bool rc = false;
+  struct KvlogSlot *live = mutt_mem_malloc(MAX(ctx->num_keys, 1) * sizeof(struct KvlogSlot));
+  size_t num = 0;
+  for (size_t i = 0; i < ctx->num_slots; i++)
+    if (ctx->slots[i].offset != 0)
+      live[num++] = ctx->slots[i];
+  qsort(live, num, sizeof(struct KvlogSlot), kvlog_cmp_offset);
+
+  int fd = open(mutt_b2s(tmp), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  if (fd < 0)
+    goto done;
+
+  int wfd = dup(fd);
+  FILE *fp = (wfd < 0) ? NULL : fdopen(wfd, "w");
+  if (!fp)
+  {
+    if (wfd >= 0)
+      close(wfd);
+    goto unlink;
+  }
+
+  uint64_t size = sizeof(struct KvlogHeader);
+  if (fseeko(fp, size, SEEK_SET) != 0)
+  {
+    mutt_file_fclose(&fp);
+    goto unlink;
+  }
+
+  size_t i = 0;
+  for (; i < num; i++)
+  {
+    struct KvlogRecord rec;
+    kvlog_record(ctx, live[i].offset, &rec);
+    const uint64_t rsize = kvlog_record_size(rec.klen, rec.vlen);
+    if (fwrite(ctx->map + live[i].offset, rsize, 1, fp) != 1)
+      break;
+    size += rsize;
+  }
+
+  /* Only replace the log if every record was written */
+  if ((i != num) || (fflush(fp) != 0) || ferror(fp) ||
+      !kvlog_write_header(fileno(fp), size) || (fsync(fileno(fp)) != 0))
+  {
+    mutt_file_fclose(&fp);
+    goto unlink;
+  }
+  mutt_file_fclose(&fp);
+
+  const size_t map_len = size + MAX(size, KVLOG_MAP_SLACK);
+  char *map = mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED)
+    goto unlink;
+
+  if (rename(mutt_b2s(tmp), mutt_b2s(&ctx->path)) != 0)
+  {
+    munmap(map, map_len);
+    goto unlink;
+  }
+
+  mutt_debug(LL_DEBUG2, "compacted %s from %llu to %llu bytes\n", mutt_b2s(&ctx->path),
+             (unsigned long long) ctx->size, (unsigned long long) size);
+
+  /* Switch to the new file and rebuild the hash table */
+  kvlog_retire_map(ctx);
+  close(ctx->fd);
+  ctx->fd = fd;
+  ctx->map = map;
+  ctx->map_len = map_len;
+  ctx->size = size;
+  ctx->clean = size;
+  FREE(&ctx->slots);
+  ctx->num_slots = 0;
+  ctx->num_keys = 0;
+  ctx->live = 0;
+  ctx->dead = 0;
+  kvlog_grow(ctx);
+  rc = kvlog_load(ctx, size);
+  goto done;
+
+unlink:
+  mutt_debug(LL_DEBUG1, "compaction of %s failed: %s\n", mutt_b2s(&ctx->path), strerror(errno));
+  unlink(mutt_b2s(tmp));
+  close(fd);
+
+done:
+  FREE(&live);
+  mutt_buffer_pool_release(&tmp);
+  return rc;
+}
+
+/**
+ * kvlog_needs_compaction - Is most of the file out of date?
+ * @param ctx Context
+ * @retval true The file should be compacted
+ */
+static bool kvlog_needs_compaction(const struct KvlogCtx *ctx)
+{
+  return (ctx->dead >= KVLOG_COMPACT_MIN) && (ctx->dead >= ctx->live);
+}
+
+/**
+ * kvlog_write - Write the pending records, then compact the file if necessary
+ * @param ctx Context
+ * @retval 0   Success
+ * @retval num Error, an errno
+ *
+ * Compacting while the store is open keeps a long session's file from growing
+ * without bound.  A failed compaction leaves the old file in place.
+ */
+static int kvlog_write(struct KvlogCtx *ctx)
+{
+  int rc = kvlog_flush(ctx);
+  if ((rc == 0) && kvlog_needs_compaction(ctx))
+    kvlog_compact(ctx);
+  return rc;
+}
+
+/**
+ * store_kvlog_open - Implements StoreOps::open()
+ */
+static void *store_kvlog_open(const char *path)
+{
+  if (!path)
+    return NULL;
+
+  struct KvlogCtx *ctx = mutt_mem_calloc(1, sizeof(struct KvlogCtx));
+  ctx->fd = -1;
+  ctx->path = mutt_buffer_make(0);
+  mutt_buffer_strcpy(&ctx->path, path);
+  ctx->lockfile = mutt_buffer_make(0);
+  mutt_buffer_printf(&ctx->lockfile, "%s-lock", path);
+
+  ctx->lock_fd = open(mutt_b2s(&ctx->lockfile), O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR);
+  if (ctx->lock_fd < 0)
+    goto fail;
+
+  if (mutt_file_lock(ctx->lock_fd, true, true) != 0)
+  {
+    close(ctx->lock_fd);
+    ctx->lock_fd = -1;
+    goto fail;
+  }
+
+  ctx->fd = open(path, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+  if (ctx->fd < 0)
+    goto fail;
+
+  struct stat st = { 0 };
+  if (fstat(ctx->fd, &st) != 0)
+    goto fail;
+
+  struct KvlogHeader hdr = { 0 };
+  if (st.st_size == 0)
+  {
+    if (!kvlog_write_header(ctx->fd, sizeof(hdr)))
+      goto fail;
+    hdr.clean = sizeof(hdr);
+    ctx->size = sizeof(hdr);
+  }
+  else
+  {
+    if ((st.st_size < (off_t) sizeof(hdr)) ||
+        (pread(ctx->fd, &hdr, sizeof(hdr), 0) != sizeof(hdr)) ||
+        (memcmp(hdr.magic, KVLOG_MAGIC, sizeof(KVLOG_MAGIC)) != 0) ||
+        (hdr.version != KVLOG_VERSION))
+    {
+      mutt_debug(LL_DEBUG1, "%s isn't a kvlog file\n", path);
+      goto fail;
+    }
+    ctx->size = st.st_size;
+  }
+
+  if (!kvlog_map(ctx))
+    goto fail;
+
+  kvlog_grow(ctx);
+  if (!kvlog_load(ctx, hdr.clean))
+    goto fail;
+  ctx->clean = (ctx->size == hdr.clean) ? ctx->size : 0;
+
+  return ctx;
+
+fail:
+  kvlog_unmap(ctx);
+  if (ctx->fd >= 0)
+    close(ctx->fd);
+  if (ctx->lock_fd >= 0)
+  {
+    mutt_file_unlock(ctx->lock_fd);
+    close(ctx->lock_fd);
+  }
+  FREE(&ctx->slots);
+  mutt_buffer_dealloc(&ctx->path);
+  mutt_buffer_dealloc(&ctx->lockfile);
+  FREE(&ctx);
+  return NULL;
+}
+
+/**
+ * store_kvlog_fetch - Implements StoreOps::fetch()
+ */
+static void *store_kvlog_fetch(void *store, const char *key, size_t klen, size_t *vlen)
+{
+  if (!store)
+    return NULL;
+
+  struct KvlogCtx *ctx = store;
+
+  struct KvlogSlot *slot = kvlog_find(ctx, key, klen, kvlog_hash(key, klen));
+  if (slot->offset == 0)
+    return NULL;
+
+  struct KvlogRecord rec;
+  const char *k = kvlog_record(ctx, slot->offset, &rec);
+  *vlen = rec.vlen;
+  ctx->num_fetched++;
+  return (void *) (k + rec.klen);
+}
+
+/**
+ * store_kvlog_free - Implements StoreOps::free()
+ */
+static void store_kvlog_free(void *store, void **ptr)
+{
+  if (!ptr || !*ptr)
+    return;
+
+  /* Values point into the map, which is owned by the database */
+  struct KvlogCtx *ctx = store;
+  if (ctx && (ctx->num_fetched > 0))
+    ctx->num_fetched--;
+  *ptr = NULL;
+}
+
+/**
+ * store_kvlog_store - Implements StoreOps::store()
+ */
+static int store_kvlog_store(void *store, const char *key, size_t klen, void *value, size_t vlen)
+{
+  if (!store)
+    return -1;
+
+  struct KvlogCtx *ctx = store;
+
+  kvlog_append(ctx, 0, key, klen, value, vlen);
+  if (ctx->batch)
+    return 0;
+
+  return kvlog_write(ctx);
+}
+
+/**
+ * store_kvlog_delete_record - Implements StoreOps::delete_record()
+ */
+static int store_kvlog_delete_record(void *store, const char *key, size_t klen)
+{
+  if (!store)
+    return -1;
+
+  struct KvlogCtx *ctx = store;
+
+  kvlog_append(ctx, KVLOG_DELETED, key, klen, NULL, 0);
+  if (ctx->batch)
+    return 0;
+
+  return kvlog_write(ctx);
+}
+
+/**
+ * store_kvlog_begin - Implements StoreOps::begin()
+ *
+ * Records are buffered in memory, then written with a single write().
+ */
+static int store_kvlog_begin(void *store)
+{
+  if (!store)
+    return -1;
+
+  struct KvlogCtx *ctx = store;
+  ctx->batch = true;
+  return 0;
+}
+
+/**
+ * store_kvlog_commit - Implements StoreOps::commit()
+ */
+static int store_kvlog_commit(void *store)
+{
+  if (!store)
+    return -1;
+
+  struct KvlogCtx *ctx = store;
+  ctx->batch = false;
+  return kvlog_write(ctx);
+}
+
+/**
+ * struct KvlogScan - A record found by scan()
+ */
+struct KvlogScan
+{
+  const char *key;   ///< Key
+  size_t klen;       ///< Length of the key
+  const char *value; ///< Value
+  size_t vlen;       ///< Length of the value
+};
+
+/**
+ * kvlog_cmp_key - Compare two records by their key - Implements ::sort_t
+ */
+static int kvlog_cmp_key(const void *a, const void *b)
+{
+  const struct KvlogScan *sa = a;
+  const struct KvlogScan *sb = b;
+
+  int rc = memcmp(sa->key, sb->key, MIN(sa->klen, sb->klen));
+  if (rc != 0)
+    return rc;
+  return (sa->klen > sb->klen) - (sa->klen < sb->klen);
+}
+
+/**
+ * store_kvlog_scan - Implements StoreOps::scan()
+ *
+ * The records aren't stored in order, so the matching keys are sorted first.
+ */
+static int store_kvlog_scan(void *store, const char *prefix, size_t plen,
+                            store_scan_t cb, void *data)
+{
+  if (!store || !cb)
+    return -1;
+
+  struct KvlogCtx *ctx = store;
+
+  struct KvlogScan *found = mutt_mem_malloc(MAX(ctx->num_keys, 1) * sizeof(struct KvlogScan));
+  size_t num = 0;
+  for (size_t i = 0; i < ctx->num_slots; i++)
+  {
+    if (ctx->slots[i].offset == 0)
+      continue;
+
+    struct KvlogRecord rec;
+    const char *key = kvlog_record(ctx, ctx->slots[i].offset, &rec);
+    if ((rec.klen < plen) || (memcmp(key, prefix, plen) != 0))
+      continue;
+
+    found[num].key = key;
+    found[num].klen = rec.klen;
+    found[num].value = key + rec.klen;
+    found[num].vlen = rec.vlen;
+    num++;
+  }
+
+  qsort(found, num, sizeof(struct KvlogScan), kvlog_cmp_key);
+
+  for (size_t i = 0; i < num; i++)
+  {
+    if (!cb(found[i].key, found[i].klen, found[i].value, found[i].vlen, data))
+      break;
+  }
+
+  FREE(&found);
+  return 0;
+}
+
+/**
+ * store_kvlog_close - Implements StoreOps::close()
+ */
+static void store_kvlog_close(void **ptr)
+{
+  if (!ptr || !*ptr)
+    return;
+
+  struct KvlogCtx *ctx = *ptr;
+
+  /* write any unfinished batch */
+  kvlog_write(ctx);
+
+  /* Mark the records as checked, once they're safely on disk */
+  if ((ctx->size != ctx->clean) && (fdatasync(ctx->fd) == 0))
+    kvlog_write_header(ctx->fd, ctx->size);
+
+  kvlog_unmap(ctx);
+  close(ctx->fd);
+  mutt_file_unlock(ctx->lock_fd);
+  close(ctx->lock_fd);
+  FREE(&ctx->slots);
+  FREE(&ctx->pending);
+  mutt_buffer_dealloc(&ctx->path);
+  mutt_buffer_dealloc(&ctx->lockfile);
+  FREE(ptr);
+}
+
+/**
+ * store_kvlog_version - Implements StoreOps::version()
+ */
+static const char *store_kvlog_version(void)
+{
+  return "kvlog 1";
+}
+
+STORE_BACKEND_OPS(kvlog)
@@ -33,6 +33,14 @@
  *
  * Each Store backend implements the StoreOps API.
  *
+ * Writes can be grouped into a batch, using begin() and commit().  Backends
+ * with transactions, or write batches, apply the whole batch at once.  The
+ * others simply write each record as it's stored.
+ *
+ * Backends that keep their keys in order can scan(), reading every record
+ * whose key starts with a prefix, in one pass.  Hash-based backends return an
+ * error and the caller falls back to fetch()ing each key.
+ *
  * ## Source
  *
  * @subpage store_store
@@ -42,6 +50,7 @@
  * | @subpage store_bdb     | store/bdb.c     | https://en.wikipedia.org/wiki/Berkeley_DB |
  * | @subpage store_gdbm    | store/gdbm.c    | https://www.gnu.org.ua/software/gdbm/     |
  * | @subpage store_kc      | store/kc.c      | https://fallabs.com/kyotocabinet/         |
+ * | @subpage store_kvlog   | store/kvlog.c   | Built-in                                  |
  * | @subpage store_lmdb    | store/lmdb.c    | https://symas.com/lmdb/                   |
  * | @subpage store_qdbm    | store/qdbm.c    | https://fallabs.com/qdbm/                 |
  * | @subpage store_rocksdb | store/rocksdb.c | https://rocksdb.org/                      |
@@ -55,6 +64,20 @@
 #include <stdbool.h>
 #include <stdlib.h>
 
+/**
+ * typedef store_scan_t - Prototype for a StoreOps::scan() callback
+ * @param key   Key of the record
+ * @param klen  Length of the Key
+ * @param value Value of the record
+ * @param vlen  Length of the Value
+ * @param data  Private data passed to scan()
+ * @retval true  Continue the scan
+ * @retval false Stop the scan
+ *
+ * @note The Key and Value are only valid until the callback returns
+ */
+typedef bool (*store_scan_t)(const char *key, size_t klen, const void *value, size_t vlen, void *data);
+
 /**
  * struct StoreOps - Key Value Store API
  */
@@ -114,6 +137,40 @@ struct StoreOps
    */
   int (*delete_record)(void *store, const char *key, size_t klen);
 
+  /**
+   * begin - Start a batch of writes
+   * @param[in] store Store retrieved via open()
+   * @retval 0   Success
+   * @retval num Error, a backend-specific error code
+   *
+   * Until commit() is called, any calls to store() or delete_record() are
+   * appended to the batch.  Records in an uncommitted batch may not be
+   * visible to fetch().
+   */
+  int (*begin)(void *store);
+
+  /**
+   * commit - Write a batch to the Store
+   * @param[in] store Store retrieved via open()
+   * @retval 0   Success
+   * @retval num Error, a backend-specific error code
+   */
+  int (*commit)(void *store);
+
+  /**
+   * scan - Read all the records whose Key starts with a prefix
+   * @param[in] store  Store retrieved via open()
+   * @param[in] prefix Prefix of the Keys
+   * @param[in] plen   Length of the prefix
+   * @param[in] cb     Function to call for each record
+   * @param[in] data   Private data passed to the callback
+   * @retval 0   Success
+   * @retval num Error, or the Store can't be scanned
+   *
+   * The records are passed to the callback in Key order.
+   */
+  int (*scan)(void *store, const char *prefix, size_t plen, store_scan_t cb, void *data);
+
   /**
    * close - Close a Store connection
    * @param[in,out] ptr Store retrieved via open()
@@ -139,6 +196,9 @@ bool                   store_is_valid_backend(const char *str);
     .free           = store_##_name##_free,                                    \
     .store          = store_##_name##_store,                                   \
     .delete_record  = store_##_name##_delete_record,                           \
+    .begin          = store_##_name##_begin,                                   \
+    .commit         = store_##_name##_commit,                                  \
+    .scan           = store_##_name##_scan,                                    \
     .close          = store_##_name##_close,                                   \
     .version        = store_##_name##_version,                                 \
   };
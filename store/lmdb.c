@@ -33,6 +33,7 @@
 #include "config.h"
 #include <stddef.h>
 #include <lmdb.h>
+#include <string.h>
 #include "mutt/lib.h"
 #include "lib.h"
 
@@ -287,6 +288,98 @@ static int store_lmdb_delete_record(void *store, const char *key, size_t klen)
   return rc;
 }
 
+/**
+ * store_lmdb_begin - Implements StoreOps::begin()
+ */
+static int store_lmdb_begin(void *store)
+{
+  if (!store)
+    return -1;
+
+  struct StoreLmdbCtx *ctx = store;
+
+  int rc = mdb_get_w_txn(ctx);
+  if (rc != MDB_SUCCESS)
+    mutt_debug(LL_DEBUG2, "mdb_get_w_txn: %s\n", mdb_strerror(rc));
+
+  return rc;
+}
+
+/**
+ * store_lmdb_commit - Implements StoreOps::commit()
+ */
+static int store_lmdb_commit(void *store)
+{
+  if (!store)
+    return -1;
+
+  struct StoreLmdbCtx *ctx = store;
+
+  if (!ctx->txn || (ctx->txn_mode != TXN_WRITE))
+    return MDB_SUCCESS;
+
+  /* The transaction is freed, even if the commit fails */
+  int rc = mdb_txn_commit(ctx->txn);
+  if (rc != MDB_SUCCESS)
+    mutt_debug(LL_DEBUG2, "mdb_txn_commit: %s\n", mdb_strerror(rc));
+
+  ctx->txn_mode = TXN_UNINITIALIZED;
+  ctx->txn = NULL;
+  return rc;
+}
+
+/**
+ * store_lmdb_scan - Implements StoreOps::scan()
+ */
+static int store_lmdb_scan(void *store, const char *prefix, size_t plen,
+                           store_scan_t cb, void *data)
+{
+  if (!store || !cb)
+    return -1;
+
+  struct StoreLmdbCtx *ctx = store;
+
+  int rc = mdb_get_r_txn(ctx);
+  if (rc != MDB_SUCCESS)
+  {
+    mutt_debug(LL_DEBUG2, "mdb_get_r_txn: %s\n", mdb_strerror(rc));
+    return rc;
+  }
+
+  MDB_cursor *cursor = NULL;
+  rc = mdb_cursor_open(ctx->txn, ctx->db, &cursor);
+  if (rc != MDB_SUCCESS)
+  {
+    mutt_debug(LL_DEBUG2, "mdb_cursor_open: %s\n", mdb_strerror(rc));
+    return rc;
+  }
+
+  MDB_val dkey;
+  MDB_val value;
+
+  dkey.mv_data = (void *) prefix;
+  dkey.mv_size = plen;
+  value.mv_data = NULL;
+  value.mv_size = 0;
+
+  /* LMDB doesn't allow empty keys, so an empty prefix starts at the beginning */
+  rc = mdb_cursor_get(cursor, &dkey, &value, (plen == 0) ? MDB_FIRST : MDB_SET_RANGE);
+  for (; rc == MDB_SUCCESS; rc = mdb_cursor_get(cursor, &dkey, &value, MDB_NEXT))
+  {
+    if ((dkey.mv_size < plen) || (memcmp(dkey.mv_data, prefix, plen) != 0))
+      break;
+    if (!cb(dkey.mv_data, dkey.mv_size, value.mv_data, value.mv_size, data))
+      break;
+  }
+  mdb_cursor_close(cursor);
+
+  if (rc == MDB_NOTFOUND)
+    return MDB_SUCCESS;
+  if (rc != MDB_SUCCESS)
+    mutt_debug(LL_DEBUG2, "mdb_cursor_get: %s\n", mdb_strerror(rc));
+  return rc;
+}
+
 /**
  * store_lmdb_close - Implements StoreOps::close()
  */
@@ -34,6 +34,7 @@
 #include <stddef.h>
 #include <depot.h>
 #include <stdbool.h>
+#include <string.h>
 #include <villa.h>
 #include "mutt/lib.h"
 #include "lib.h"
@@ -103,6 +104,62 @@ static int store_qdbm_delete_record(void *store, const char *key, size_t klen)
   return success ? 0 : dpecode ? dpecode : -1;
 }
 
+/**
+ * store_qdbm_begin - Implements StoreOps::begin()
+ */
+static int store_qdbm_begin(void *store)
+{
+  if (!store)
+    return -1;
+
+  VILLA *db = store;
+  bool success = vltranbegin(db);
+  return success ? 0 : dpecode ? dpecode : -1;
+}
+
+/**
+ * store_qdbm_commit - Implements StoreOps::commit()
+ */
+static int store_qdbm_commit(void *store)
+{
+  if (!store)
+    return -1;
+
+  VILLA *db = store;
+  bool success = vltrancommit(db);
+  return success ? 0 : dpecode ? dpecode : -1;
+}
+
+/**
+ * store_qdbm_scan - Implements StoreOps::scan()
+ */
+static int store_qdbm_scan(void *store, const char *prefix, size_t plen,
+                           store_scan_t cb, void *data)
+{
+  if (!store || !cb)
+    return -1;
+
+  VILLA *db = store;
+
+  bool found = (plen == 0) ? vlcurfirst(db) : vlcurjump(db, prefix, plen, VL_JFORWARD);
+  for (; found; found = vlcurnext(db))
+  {
+    int klen = 0;
+    int vlen = 0;
+    const char *key = vlcurkeycache(db, &klen);
+    const char *value = vlcurvalcache(db, &vlen);
+    if (!key || !value)
+      break;
+
+    if (((size_t) klen < plen) || (memcmp(key, prefix, plen) != 0))
+      break;
+    if (!cb(key, klen, value, vlen, data))
+      break;
+  }
+
+  return ((dpecode == DP_ENOERR) || (dpecode == DP_ENOITEM)) ? 0 : dpecode;
+}
+
 /**
  * store_qdbm_close - Implements StoreOps::close()
  */
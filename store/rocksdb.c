@@ -45,6 +45,7 @@ struct RocksDB_Ctx
   rocksdb_options_t *options;
   rocksdb_readoptions_t *read_options;
   rocksdb_writeoptions_t *write_options;
+  rocksdb_writebatch_t *batch; ///< Pending writes, between begin() and commit()
   char *err;
 };
 
@@ -60,6 +61,7 @@ static void *store_rocksdb_open(const char *path)
 
   /* RocksDB store errors in form of strings */
   ctx->err = NULL;
+  ctx->batch = NULL;
 
   /* setup generic options, create new db and limit log to one file */
   ctx->options = rocksdb_options_create();
@@ -129,6 +131,12 @@ static int store_rocksdb_store(void *store, const char *key, size_t klen,
 
   struct RocksDB_Ctx *ctx = store;
 
+  if (ctx->batch)
+  {
+    rocksdb_writebatch_put(ctx->batch, key, klen, value, vlen);
+    return 0;
+  }
+
   rocksdb_put(ctx->db, ctx->write_options, key, klen, value, vlen, &ctx->err);
   if (ctx->err)
   {
@@ -150,6 +158,12 @@ static int store_rocksdb_delete_record(void *store, const char *key, size_t klen
 
   struct RocksDB_Ctx *ctx = store;
 
+  if (ctx->batch)
+  {
+    rocksdb_writebatch_delete(ctx->batch, key, klen);
+    return 0;
+  }
+
   rocksdb_delete(ctx->db, ctx->write_options, key, klen, &ctx->err);
   if (ctx->err)
   {
@@ -161,6 +175,89 @@ static int store_rocksdb_delete_record(void *store, const char *key, size_t klen
   return 0;
 }
 
+/**
+ * store_rocksdb_begin - Implements StoreOps::begin()
+ */
+static int store_rocksdb_begin(void *store)
+{
+  if (!store)
+    return -1;
+
+  struct RocksDB_Ctx *ctx = store;
+
+  if (!ctx->batch)
+    ctx->batch = rocksdb_writebatch_create();
+
+  return 0;
+}
+
+/**
+ * store_rocksdb_commit - Implements StoreOps::commit()
+ */
+static int store_rocksdb_commit(void *store)
+{
+  if (!store)
+    return -1;
+
+  struct RocksDB_Ctx *ctx = store;
+
+  if (!ctx->batch)
+    return 0;
+
+  rocksdb_write(ctx->db, ctx->write_options, ctx->batch, &ctx->err);
+  rocksdb_writebatch_destroy(ctx->batch);
+  ctx->batch = NULL;
+
+  if (ctx->err)
+  {
+    rocksdb_free(ctx->err);
+    ctx->err = NULL;
+    return -1;
+  }
+
+  return 0;
+}
+
+/**
+ * store_rocksdb_scan - Implements StoreOps::scan()
+ */
+static int store_rocksdb_scan(void *store, const char *prefix, size_t plen,
+                              store_scan_t cb, void *data)
+{
+  if (!store || !cb)
+    return -1;
+
+  struct RocksDB_Ctx *ctx = store;
+
+  rocksdb_iterator_t *iter = rocksdb_create_iterator(ctx->db, ctx->read_options);
+  for (rocksdb_iter_seek(iter, prefix, plen); rocksdb_iter_valid(iter);
+       rocksdb_iter_next(iter))
+  {
+    size_t klen = 0;
+    size_t vlen = 0;
+    const char *key = rocksdb_iter_key(iter, &klen);
+    const char *value = rocksdb_iter_value(iter, &vlen);
+
+    if ((klen < plen) || (memcmp(key, prefix, plen) != 0))
+      break;
+    if (!cb(key, klen, value, vlen, data))
+      break;
+  }
+
+  rocksdb_iter_get_error(iter, &ctx->err);
+  rocksdb_iter_destroy(iter);
+
+  if (ctx->err)
+  {
+    mutt_debug(LL_DEBUG2, "rocksdb_iter: %s\n", ctx->err);
+    rocksdb_free(ctx->err);
+    ctx->err = NULL;
+    return -1;
+  }
+
+  return 0;
+}
+
 /**
  * store_rocksdb_close - Implements StoreOps::close()
  */
@@ -171,6 +268,9 @@ static void store_rocksdb_close(void **ptr)
 
   struct RocksDB_Ctx *ctx = *ptr;
 
+  /* write any unfinished batch */
+  store_rocksdb_commit(ctx);
+
   /* close database and free resources */
   rocksdb_close(ctx->db);
   rocksdb_options_destroy(ctx->options);
@@ -36,6 +36,7 @@
 #define STORE_BACKEND(name) extern const struct StoreOps store_##name##_ops;
 STORE_BACKEND(bdb)
 STORE_BACKEND(gdbm)
+STORE_BACKEND(kvlog)
 STORE_BACKEND(kyotocabinet)
 STORE_BACKEND(lmdb)
 STORE_BACKEND(qdbm)
@@ -71,6 +72,9 @@ const struct StoreOps *store_ops[] = {
 #endif
 #ifdef HAVE_LMDB
   &store_lmdb_ops,
+#endif
+#ifdef HAVE_KVLOG
+  &store_kvlog_ops,
 #endif
   NULL,
 };
@@ -31,7 +31,9 @@
  */
 
 #include "config.h"
+#include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
 #include <tcbdb.h>
 #include <tcutil.h>
 #include "mutt/lib.h"
@@ -117,6 +119,75 @@ static int store_tokyocabinet_delete_record(void *store, const char *key, size_t
   return 0;
 }
 
+/**
+ * store_tokyocabinet_begin - Implements StoreOps::begin()
+ */
+static int store_tokyocabinet_begin(void *store)
+{
+  if (!store)
+    return -1;
+
+  TCBDB *db = store;
+  if (!tcbdbtranbegin(db))
+  {
+    int ecode = tcbdbecode(db);
+    return ecode ? ecode : -1;
+  }
+  return 0;
+}
+
+/**
+ * store_tokyocabinet_commit - Implements StoreOps::commit()
+ */
+static int store_tokyocabinet_commit(void *store)
+{
+  if (!store)
+    return -1;
+
+  TCBDB *db = store;
+  if (!tcbdbtrancommit(db))
+  {
+    int ecode = tcbdbecode(db);
+    return ecode ? ecode : -1;
+  }
+  return 0;
+}
+
+/**
+ * store_tokyocabinet_scan - Implements StoreOps::scan()
+ */
+static int store_tokyocabinet_scan(void *store, const char *prefix, size_t plen,
+                                   store_scan_t cb, void *data)
+{
+  if (!store || !cb)
+    return -1;
+
+  TCBDB *db = store;
+  BDBCUR *cur = tcbdbcurnew(db);
+  if (!cur)
+    return -1;
+
+  bool found = (plen == 0) ? tcbdbcurfirst(cur) : tcbdbcurjump(cur, prefix, plen);
+  for (; found; found = tcbdbcurnext(cur))
+  {
+    int klen = 0;
+    int vlen = 0;
+    const char *key = tcbdbcurkey3(cur, &klen);
+    const char *value = tcbdbcurval3(cur, &vlen);
+    if (!key || !value)
+      break;
+
+    if (((size_t) klen < plen) || (memcmp(key, prefix, plen) != 0))
+      break;
+    if (!cb(key, klen, value, vlen, data))
+      break;
+  }
+  tcbdbcurdel(cur);
+
+  int ecode = tcbdbecode(db);
+  return ((ecode == TCESUCCESS) || (ecode == TCENOREC)) ? 0 : ecode;
+}
+
 /**
  * store_tokyocabinet_close - Implements StoreOps::close()
  */
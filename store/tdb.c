@@ -117,6 +117,41 @@ static int store_tdb_delete_record(void *store, const char *key, size_t klen)
   return tdb_delete(db, dkey);
 }
 
+/**
+ * store_tdb_begin - Implements StoreOps::begin()
+ */
+static int store_tdb_begin(void *store)
+{
+  if (!store)
+    return -1;
+
+  TDB_CONTEXT *db = store;
+  return tdb_transaction_start(db);
+}
+
+/**
+ * store_tdb_commit - Implements StoreOps::commit()
+ */
+static int store_tdb_commit(void *store)
+{
+  if (!store)
+    return -1;
+
+  TDB_CONTEXT *db = store;
+  return tdb_transaction_commit(db);
+}
+
+/**
+ * store_tdb_scan - Implements StoreOps::scan()
+ *
+ * TDB is a hash table, so its records can't be read in key order.
+ */
+static int store_tdb_scan(void *store, const char *prefix, size_t plen,
+                          store_scan_t cb, void *data)
+{
+  return -1;
+}
+
 /**
  * store_tdb_close - Implements StoreOps::close()
  */
@@ -34,7 +34,7 @@ void test_compress_lz4(void)
 {
   // void *open(short level);
   // void *compress(void *cctx, const char *data, size_t dlen, size_t *clen);
-  // void *decompress(void *cctx, const char *cbuf, size_t clen);
+  // void *decompress(void *cctx, const char *cbuf, size_t clen, size_t *dlen);
   // void  close(void **cctx);
 
   const struct ComprOps *cops = compress_get_ops("lz4");
@@ -44,7 +44,7 @@ void test_compress_lz4(void)
   {
     // Degenerate tests
     TEST_CHECK(cops->compress(NULL, NULL, 0, NULL) == NULL);
-    TEST_CHECK(cops->decompress(NULL, NULL, 0) == NULL);
+    TEST_CHECK(cops->decompress(NULL, NULL, 0, NULL) == NULL);
     void *cctx = NULL;
     cops->close(NULL);
     TEST_CHECK_(1, "cops->close(NULL)");
@@ -73,14 +73,15 @@ void test_compress_lz4(void)
     void *cctx = cops->open(MIN_COMP_LEVEL);
     TEST_CHECK(cctx != NULL);
 
+    size_t ulen = 0;
     const char zeroes[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
                             0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
-    void *result = cops->decompress(cctx, zeroes, sizeof(zeroes));
+    void *result = cops->decompress(cctx, zeroes, sizeof(zeroes), &ulen);
     TEST_CHECK(result == zeroes);
 
     const char ones[] = { 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
                           0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01 };
-    result = cops->decompress(cctx, ones, sizeof(ones));
+    result = cops->decompress(cctx, ones, sizeof(ones), &ulen);
     TEST_CHECK(result == NULL);
 
     cops->close(&cctx);
@@ -23,18 +23,21 @@
 #define TEST_NO_MAIN
 #include "config.h"
 #include "acutest.h"
+#include <stdio.h>
+#include <string.h>
 #include "mutt/lib.h"
 #include "common.h"
 #include "compress/lib.h"
 
 #define MIN_COMP_LEVEL 1  ///< Minimum compression level for zstd
 #define MAX_COMP_LEVEL 22 ///< Maximum compression level for zstd
+#define ZSTD_BOUND 1024   ///< Space for the compressed test data
 
 void test_compress_zstd(void)
 {
   // void *open(short level);
   // void *compress(void *cctx, const char *data, size_t dlen, size_t *clen);
-  // void *decompress(void *cctx, const char *cbuf, size_t clen);
+  // void *decompress(void *cctx, const char *cbuf, size_t clen, size_t *dlen);
   // void  close(void **cctx);
 
   const struct ComprOps *cops = compress_get_ops("zstd");
@@ -44,7 +47,7 @@ void test_compress_zstd(void)
   {
     // Degenerate tests
     TEST_CHECK(cops->compress(NULL, NULL, 0, NULL) == NULL);
-    TEST_CHECK(cops->decompress(NULL, NULL, 0) == NULL);
+    TEST_CHECK(cops->decompress(NULL, NULL, 0, NULL) == NULL);
     void *cctx = NULL;
     cops->close(NULL);
     TEST_CHECK_(1, "cops->close(NULL)");
@@ -73,13 +76,77 @@ void test_compress_zstd(void)
     void *cctx = cops->open(MIN_COMP_LEVEL);
     TEST_CHECK(cctx != NULL);
 
+    size_t ulen = 0;
     const char zeroes[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
                             0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
-    void *result = cops->decompress(cctx, zeroes, sizeof(zeroes));
+    void *result = cops->decompress(cctx, zeroes, sizeof(zeroes), &ulen);
     TEST_CHECK(result == NULL);
 
     cops->close(&cctx);
   }
 
+  {
+    // Dictionary
+    TEST_CHECK(cops->dict_train(NULL, NULL, NULL, 0, NULL) == NULL);
+    TEST_CHECK(cops->dict_load(NULL, NULL, 0) == false);
+
+    struct Buffer samples = mutt_buffer_make(0);
+    size_t sizes[500];
+    for (size_t i = 0; i < mutt_array_size(sizes); i++)
+    {
+      size_t len = mutt_buffer_len(&samples);
+      mutt_buffer_add_printf(&samples,
+                             "Message-ID: <%zu.example@neomutt.org>\n"
+                             "From: user%zu@example.com\nSubject: Report %zu\n"
+                             "Content-Type: text/plain; charset=us-ascii\n",
+                             i * 7919, i % 13, i);
+      sizes[i] = mutt_buffer_len(&samples) - len;
+    }
+
+    void *cctx = cops->open(MIN_COMP_LEVEL);
+    TEST_CHECK(cctx != NULL);
+
+    const char *plain = "Subject: no dictionary";
+    size_t plen = 0;
+    void *cbuf = cops->compress(cctx, plain, strlen(plain), &plen);
+    char *cplain = mutt_mem_malloc(ZSTD_BOUND);
+    memcpy(cplain, cbuf, plen);
+
+    size_t dlen = 0;
+    void *dict = cops->dict_train(cctx, samples.data, sizes, mutt_array_size(sizes), &dlen);
+    TEST_CHECK(dict != NULL);
+    TEST_CHECK(dlen > 0);
+
+    const char *text = "Message-ID: <123.example@neomutt.org>\nFrom: user3@example.com\n";
+    size_t tlen = strlen(text);
+    size_t clen = 0;
+    cbuf = cops->compress(cctx, text, tlen, &clen);
+    char *cdata = mutt_mem_malloc(ZSTD_BOUND);
+    memcpy(cdata, cbuf, clen);
+
+    size_t ulen = 0;
+    char *result = cops->decompress(cctx, cdata, clen, &ulen);
+    TEST_CHECK((result != NULL) && (ulen == tlen) && (memcmp(result, text, tlen) == 0));
+
+    // Data compressed before the dictionary can still be read
+    result = cops->decompress(cctx, cplain, plen, &ulen);
+    TEST_CHECK((result != NULL) && (memcmp(result, plain, strlen(plain)) == 0));
+
+    // A new context needs the dictionary
+    void *cctx2 = cops->open(MIN_COMP_LEVEL);
+    TEST_CHECK(cops->decompress(cctx2, cdata, clen, &ulen) == NULL);
+    TEST_CHECK(cops->dict_load(cctx2, dict, dlen) == true);
+    result = cops->decompress(cctx2, cdata, clen, &ulen);
+    TEST_CHECK((result != NULL) && (memcmp(result, text, tlen) == 0));
+
+    TEST_CHECK(cops->dict_load(cctx2, plain, strlen(plain)) == false);
+
+    cops->close(&cctx2);
+    cops->close(&cctx);
+    FREE(&cdata);
+    FREE(&cplain);
+    mutt_buffer_dealloc(&samples);
+  }
+
   compress_data_tests(cops, MIN_COMP_LEVEL, MAX_COMP_LEVEL);
 }
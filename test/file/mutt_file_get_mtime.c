@@ -0,0 +1,64 @@
+/**
+ * @file
+ * Test code for mutt_file_get_mtime()
+ *
+ * @authors
+ * Copyright (C) 2019 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+#include "mutt/lib.h"
+
+void test_mutt_file_get_mtime(void)
+{
+  // int mutt_file_get_mtime(const char *path, time_t *mtime);
+
+  {
+    time_t mtime = 0;
+    TEST_CHECK(mutt_file_get_mtime(NULL, &mtime) == -1);
+    TEST_CHECK(mutt_file_get_mtime("/", NULL) == -1);
+  }
+
+  {
+    time_t mtime = 0;
+    TEST_CHECK(mutt_file_get_mtime("/nonexistent/neomutt", &mtime) == -1);
+  }
+
+  {
+    char path[] = "/tmp/neomutt-get-mtime-XXXXXX";
+    int fd = mkstemp(path);
+    if (!TEST_CHECK(fd >= 0))
+      return;
+    close(fd);
+
+    struct utimbuf ut = { 1234567890, 1234567890 };
+    TEST_CHECK(utime(path, &ut) == 0);
+
+    time_t mtime = 0;
+    TEST_CHECK(mutt_file_get_mtime(path, &mtime) == 0);
+    TEST_CHECK(mtime == 1234567890);
+    TEST_MSG("Expected: %d, Actual: %ld", 1234567890, (long) mtime);
+    unlink(path);
+  }
+}
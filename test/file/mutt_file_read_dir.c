@@ -0,0 +1,106 @@
+/**
+ * @file
+ * Test code for mutt_file_read_dir()
+ *
+ * @authors
+ * Copyright (C) 2019 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "mutt/lib.h"
+
+struct ReadDirTest
+{
+  int files;
+  int dirs;
+  int limit;
+};
+
+static bool read_dir_count(const char *name, ino_t inode, unsigned char type, void *data)
+{
+  struct ReadDirTest *rdt = data;
+
+  if ((name[0] == '.') || (inode == 0))
+    return true;
+
+  if (type == DT_DIR)
+    rdt->dirs++;
+  else
+    rdt->files++;
+
+  return (rdt->limit == 0) || ((rdt->files + rdt->dirs) < rdt->limit);
+}
+
+void test_mutt_file_read_dir(void)
+{
+  // int mutt_file_read_dir(const char *path, mutt_file_dir_t cb, void *data, size_t *calls);
+
+  {
+    struct ReadDirTest rdt = { 0 };
+    TEST_CHECK(mutt_file_read_dir(NULL, read_dir_count, &rdt, NULL) == -1);
+    TEST_CHECK(mutt_file_read_dir("/", NULL, &rdt, NULL) == -1);
+  }
+
+  {
+    struct ReadDirTest rdt = { 0 };
+    TEST_CHECK(mutt_file_read_dir("/nonexistent/neomutt", read_dir_count, &rdt, NULL) == -1);
+  }
+
+  char dir[] = "/tmp/neomutt-read-dir-XXXXXX";
+  if (!TEST_CHECK(mkdtemp(dir) != NULL))
+    return;
+
+  char path[256];
+  for (int i = 0; i < 100; i++)
+  {
+    snprintf(path, sizeof(path), "%s/%d", dir, i);
+    FILE *fp = fopen(path, "w");
+    TEST_CHECK(fp != NULL);
+    if (fp)
+      fclose(fp);
+  }
+  snprintf(path, sizeof(path), "%s/sub", dir);
+  TEST_CHECK(mkdir(path, 0700) == 0);
+
+  {
+    struct ReadDirTest rdt = { 0 };
+    size_t calls = 0;
+    TEST_CASE("Whole directory");
+    TEST_CHECK(mutt_file_read_dir(dir, read_dir_count, &rdt, &calls) == 0);
+    TEST_CHECK(rdt.files == 100);
+    TEST_MSG("Expected: %d, Actual: %d", 100, rdt.files);
+    TEST_CHECK(rdt.dirs <= 1);
+    TEST_CHECK(calls > 0);
+  }
+
+  {
+    struct ReadDirTest rdt = { 0, 0, 10 };
+    TEST_CASE("Stopped by callback");
+    TEST_CHECK(mutt_file_read_dir(dir, read_dir_count, &rdt, NULL) == 1);
+    TEST_CHECK((rdt.files + rdt.dirs) == 10);
+  }
+
+  mutt_file_rmtree(dir);
+}
@@ -0,0 +1,48 @@
+/**
+ * @file
+ * Test code for mutt_filebatch_free()
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include "mutt/lib.h"
+
+void test_mutt_filebatch_free(void)
+{
+  // void mutt_filebatch_free(struct FileBatch **ptr);
+
+  {
+    mutt_filebatch_free(NULL);
+  }
+
+  {
+    struct FileBatch *fb = NULL;
+    mutt_filebatch_free(&fb);
+    TEST_CHECK_(1, "mutt_filebatch_free(&fb)");
+  }
+
+  {
+    struct FileBatch *fb = mutt_filebatch_new();
+    mutt_filebatch_unlink(fb, "/nonexistent/neomutt", NULL, NULL);
+    mutt_filebatch_free(&fb);
+    TEST_CHECK(fb == NULL);
+  }
+}
@@ -0,0 +1,81 @@
+/**
+ * @file
+ * Test code for mutt_filebatch_rename()
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "mutt/lib.h"
+#include "test_common.h"
+
+static void rename_done(int err, void *data)
+{
+  int *result = data;
+  *result = err;
+}
+
+void test_mutt_filebatch_rename(void)
+{
+  // void mutt_filebatch_rename(struct FileBatch *fb, const char *oldpath, const char *newpath, filebatch_done_t done, void *data);
+
+  {
+    mutt_filebatch_rename(NULL, "apple", "banana", NULL, NULL);
+    TEST_CHECK_(1, "mutt_filebatch_rename(NULL, \"apple\", \"banana\", NULL, NULL)");
+  }
+
+  {
+    struct FileBatch *fb = mutt_filebatch_new();
+    mutt_filebatch_rename(fb, NULL, "banana", NULL, NULL);
+    mutt_filebatch_rename(fb, "apple", NULL, NULL, NULL);
+    TEST_CHECK(mutt_filebatch_run(fb) == 0);
+    mutt_filebatch_free(&fb);
+  }
+
+  char dir[PATH_MAX];
+  test_gen_path(dir, sizeof(dir), "%s/tmp/XXXXXX");
+  if (!TEST_CHECK(mkdtemp(dir) != NULL))
+    return;
+
+  {
+    char oldpath[256];
+    char newpath[256];
+    snprintf(oldpath, sizeof(oldpath), "%s/apple", dir);
+    snprintf(newpath, sizeof(newpath), "%s/banana", dir);
+    FILE *fp = fopen(oldpath, "w");
+    if (TEST_CHECK(fp != NULL))
+      fclose(fp);
+
+    int result = -1;
+    struct FileBatch *fb = mutt_filebatch_new();
+    mutt_filebatch_rename(fb, oldpath, newpath, rename_done, &result);
+    TEST_CHECK(mutt_filebatch_run(fb) == 0);
+    TEST_CHECK(result == 0);
+    TEST_CHECK(access(oldpath, F_OK) != 0);
+    TEST_CHECK(access(newpath, F_OK) == 0);
+    mutt_filebatch_free(&fb);
+  }
+
+  mutt_file_rmtree(dir);
+}
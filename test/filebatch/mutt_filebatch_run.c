@@ -0,0 +1,119 @@
+/**
+ * @file
+ * Test code for mutt_filebatch_run()
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "mutt/lib.h"
+#include "test_common.h"
+
+#define NUM_FILES 1000
+
+struct RunResult
+{
+  int calls;
+  int order;
+  int failed;
+};
+
+struct RunOp
+{
+  struct RunResult *result;
+  int index;
+};
+
+static void run_done(int err, void *data)
+{
+  struct RunOp *op = data;
+  if (op->index == op->result->calls)
+    op->result->order++;
+  op->result->calls++;
+  if (err != 0)
+    op->result->failed++;
+}
+
+void test_mutt_filebatch_run(void)
+{
+  // int mutt_filebatch_run(struct FileBatch *fb);
+
+  {
+    TEST_CHECK(mutt_filebatch_run(NULL) == 0);
+  }
+
+  {
+    struct FileBatch *fb = mutt_filebatch_new();
+    TEST_CHECK(mutt_filebatch_run(fb) == 0);
+    mutt_filebatch_free(&fb);
+  }
+
+  char dir[PATH_MAX];
+  test_gen_path(dir, sizeof(dir), "%s/tmp/XXXXXX");
+  if (!TEST_CHECK(mkdtemp(dir) != NULL))
+    return;
+
+  {
+    // More files than fit in the io_uring at once, plus one failure
+    static struct RunOp ops[NUM_FILES + 1];
+    struct RunResult result = { 0 };
+    struct FileBatch *fb = mutt_filebatch_new();
+    char oldpath[256];
+    char newpath[256];
+
+    for (int i = 0; i < NUM_FILES; i++)
+    {
+      snprintf(oldpath, sizeof(oldpath), "%s/%d", dir, i);
+      snprintf(newpath, sizeof(newpath), "%s/%d:2,S", dir, i);
+      FILE *fp = fopen(oldpath, "w");
+      if (fp)
+        fclose(fp);
+      ops[i].result = &result;
+      ops[i].index = i;
+      if (i % 2)
+        mutt_filebatch_unlink(fb, oldpath, run_done, &ops[i]);
+      else
+        mutt_filebatch_rename(fb, oldpath, newpath, run_done, &ops[i]);
+    }
+
+    snprintf(oldpath, sizeof(oldpath), "%s/missing", dir);
+    ops[NUM_FILES].result = &result;
+    ops[NUM_FILES].index = NUM_FILES;
+    mutt_filebatch_unlink(fb, oldpath, run_done, &ops[NUM_FILES]);
+
+    TEST_CHECK(mutt_filebatch_run(fb) == 1);
+    TEST_CHECK(result.calls == (NUM_FILES + 1));
+    TEST_CHECK(result.order == (NUM_FILES + 1));
+    TEST_CHECK(result.failed == 1);
+
+    snprintf(newpath, sizeof(newpath), "%s/998:2,S", dir);
+    TEST_CHECK(access(newpath, F_OK) == 0);
+    snprintf(oldpath, sizeof(oldpath), "%s/999", dir);
+    TEST_CHECK(access(oldpath, F_OK) != 0);
+    mutt_filebatch_free(&fb);
+  }
+
+  mutt_file_rmtree(dir);
+}
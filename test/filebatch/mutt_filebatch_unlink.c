@@ -0,0 +1,87 @@
+/**
+ * @file
+ * Test code for mutt_filebatch_unlink()
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "mutt/lib.h"
+#include "test_common.h"
+
+static void unlink_done(int err, void *data)
+{
+  int *result = data;
+  *result = err;
+}
+
+void test_mutt_filebatch_unlink(void)
+{
+  // void mutt_filebatch_unlink(struct FileBatch *fb, const char *path, filebatch_done_t done, void *data);
+
+  {
+    mutt_filebatch_unlink(NULL, "apple", NULL, NULL);
+    TEST_CHECK_(1, "mutt_filebatch_unlink(NULL, \"apple\", NULL, NULL)");
+  }
+
+  {
+    struct FileBatch *fb = mutt_filebatch_new();
+    mutt_filebatch_unlink(fb, NULL, NULL, NULL);
+    TEST_CHECK(mutt_filebatch_run(fb) == 0);
+    mutt_filebatch_free(&fb);
+  }
+
+  {
+    int result = 0;
+    struct FileBatch *fb = mutt_filebatch_new();
+    mutt_filebatch_unlink(fb, "/nonexistent/neomutt", unlink_done, &result);
+    TEST_CHECK(mutt_filebatch_run(fb) == 1);
+    TEST_CHECK(result == ENOENT);
+    mutt_filebatch_free(&fb);
+  }
+
+  char dir[PATH_MAX];
+  test_gen_path(dir, sizeof(dir), "%s/tmp/XXXXXX");
+  if (!TEST_CHECK(mkdtemp(dir) != NULL))
+    return;
+
+  {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/apple", dir);
+    FILE *fp = fopen(path, "w");
+    if (TEST_CHECK(fp != NULL))
+      fclose(fp);
+
+    int result = -1;
+    struct FileBatch *fb = mutt_filebatch_new();
+    mutt_filebatch_unlink(fb, path, unlink_done, &result);
+    TEST_CHECK(mutt_filebatch_run(fb) == 0);
+    TEST_CHECK(result == 0);
+    TEST_CHECK(access(path, F_OK) != 0);
+    mutt_filebatch_free(&fb);
+  }
+
+  mutt_file_rmtree(dir);
+}
@@ -0,0 +1,205 @@
+/**
+ * @file
+ * Test code for reading header cache records in the old layout
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mutt/lib.h"
+#include "config/lib.h"
+#include "email/lib.h"
+#include "hcache/lib.h"
+#include "hcache/serialize.h"
+#include "test_common.h"
+
+/**
+ * dump_legacy - Write a record the way NeoMutt did before the flat format
+ * @param hc Header cache handle
+ * @param e  Email to write
+ * @param off Length of the record
+ * @retval ptr Record
+ *
+ * The old layout is a copy of the struct Email, then the Envelope, then a copy
+ * of the struct Body with its strings.
+ */
+static unsigned char *dump_legacy(struct HeaderCache *hc, struct Email *e, int *off)
+{
+  *off = 0;
+  unsigned char *d = mutt_mem_malloc(4096);
+
+  d = serial_dump_uint32_t(42, d, off);
+  d = serial_dump_int(hc->crc_legacy, d, off);
+
+  struct Email e_dump = *e;
+  e_dump.path = NULL;
+  e_dump.edata = NULL;
+  e_dump.notify = NULL;
+  STAILQ_INIT(&e_dump.tags);
+  lazy_realloc(&d, *off + sizeof(struct Email));
+  memcpy(d + *off, &e_dump, sizeof(struct Email));
+  *off += sizeof(struct Email);
+
+  d = serial_dump_envelope(e->env, d, off, false);
+
+  struct Body b_dump = *e->content;
+  b_dump.next = NULL;
+  b_dump.parts = NULL;
+  b_dump.email = NULL;
+  b_dump.language = NULL;
+  lazy_realloc(&d, *off + sizeof(struct Body));
+  memcpy(d + *off, &b_dump, sizeof(struct Body));
+  *off += sizeof(struct Body);
+
+  d = serial_dump_char(b_dump.xtype, d, off, false);
+  d = serial_dump_char(b_dump.subtype, d, off, false);
+  d = serial_dump_parameter(&b_dump.parameter, d, off, false);
+  d = serial_dump_char(b_dump.description, d, off, false);
+  d = serial_dump_char(b_dump.form_name, d, off, false);
+  d = serial_dump_char(b_dump.filename, d, off, false);
+  d = serial_dump_char(b_dump.d_filename, d, off, false);
+
+  return d;
+}
+
+static bool count_scan(const char *key, size_t keylen, struct HCacheEntry *hce, void *data)
+{
+  int *count = data;
+  if (hce->email && hce->email->env &&
+      mutt_str_equal(hce->email->env->subject, "legacy subject"))
+  {
+    (*count)++;
+  }
+  mutt_hcache_entry_free(hce);
+  return true;
+}
+
+void test_hcache_legacy(void)
+{
+  char path[PATH_MAX];
+  test_gen_path(path, sizeof(path), "%s/tmp/XXXXXX");
+  if (!TEST_CHECK(mkdtemp(path) != NULL))
+    return;
+
+  C_HeaderCacheBackend = "kvlog";
+  struct HeaderCache *hc = mutt_hcache_open(path, "/legacy/folder", NULL);
+  if (!TEST_CHECK(hc != NULL))
+    return;
+  TEST_CHECK(hc->crc_legacy != hc->crc);
+
+  struct Email *e = email_new();
+  e->read = true;
+  e->flagged = true;
+  e->lines = 17;
+  e->date_sent = 1234567890;
+  e->env = mutt_env_new();
+  e->env->subject = mutt_str_dup("legacy subject");
+  e->env->message_id = mutt_str_dup("<legacy@example.com>");
+  e->content = mutt_body_new();
+  e->content->type = TYPE_TEXT;
+  e->content->subtype = mutt_str_dup("plain");
+  e->content->length = 321;
+  mutt_param_set(&e->content->parameter, "charset", "us-ascii");
+
+  int len = 0;
+  unsigned char *rec = dump_legacy(hc, e, &len);
+  TEST_CHECK(mutt_hcache_store_raw(hc, "/1", 2, rec, len) == 0);
+  TEST_CHECK(mutt_hcache_store_raw(hc, "/2", 2, rec, len) == 0);
+  FREE(&rec);
+  email_free(&e);
+
+  // A record in the old layout is decoded
+  {
+    struct HCacheEntry hce = mutt_hcache_fetch(hc, "/1", 2, 0);
+    if (TEST_CHECK(hce.email != NULL))
+    {
+      TEST_CHECK(hce.uidvalidity == 42);
+      TEST_CHECK(hce.email->read && hce.email->flagged);
+      TEST_CHECK(hce.email->lines == 17);
+      TEST_CHECK(hce.email->date_sent == 1234567890);
+      TEST_CHECK(hce.email->path == NULL);
+      TEST_CHECK(mutt_str_equal(hce.email->env->subject, "legacy subject"));
+      TEST_CHECK(mutt_str_equal(hce.email->env->message_id, "<legacy@example.com>"));
+      TEST_CHECK(hce.email->content->type == TYPE_TEXT);
+      TEST_CHECK(mutt_str_equal(hce.email->content->subtype, "plain"));
+      TEST_CHECK(hce.email->content->length == 321);
+      TEST_CHECK(mutt_str_equal(mutt_param_get(&hce.email->content->parameter, "charset"),
+                                "us-ascii"));
+      TEST_CHECK(hce.email->content->next == NULL);
+    }
+    mutt_hcache_entry_free(&hce);
+  }
+
+  // ...and saved again in the current format
+  {
+    size_t dlen = 0;
+    unsigned char *data = mutt_hcache_fetch_raw(hc, "/1", 2, &dlen);
+    if (TEST_CHECK(data != NULL))
+    {
+      unsigned int crc = 0;
+      int off = sizeof(uint32_t);
+      serial_restore_int(&crc, data, &off);
+      TEST_CHECK(crc == hc->crc);
+      mutt_hcache_free_raw(hc, (void **) &data);
+    }
+
+    struct HCacheEntry hce = mutt_hcache_fetch_lazy(hc, "/1", 2, 42);
+    TEST_CHECK((hce.email != NULL) && mutt_hcache_entry_restore(&hce));
+    TEST_CHECK(hce.email && mutt_str_equal(hce.email->env->subject, "legacy subject"));
+    mutt_hcache_entry_free(&hce);
+  }
+
+  // A scan decodes old records too, and converts them afterwards
+  {
+    int count = 0;
+    TEST_CHECK(mutt_hcache_fetch_all(hc, "/", 1, 0, false, count_scan, &count) >= 0);
+    TEST_CHECK(count == 2);
+
+    size_t dlen = 0;
+    unsigned char *data = mutt_hcache_fetch_raw(hc, "/2", 2, &dlen);
+    if (TEST_CHECK(data != NULL))
+    {
+      unsigned int crc = 0;
+      int off = sizeof(uint32_t);
+      serial_restore_int(&crc, data, &off);
+      TEST_CHECK(crc == hc->crc);
+      mutt_hcache_free_raw(hc, (void **) &data);
+    }
+  }
+
+  // A record with an unknown version is ignored
+  {
+    unsigned char bad[64] = { 0 };
+    int off = 0;
+    serial_dump_uint32_t(42, bad, &off);
+    serial_dump_int(hc->crc_legacy ^ hc->crc ^ 1, bad, &off);
+    TEST_CHECK(mutt_hcache_store_raw(hc, "/3", 2, bad, sizeof(bad)) == 0);
+    struct HCacheEntry hce = mutt_hcache_fetch(hc, "/3", 2, 0);
+    TEST_CHECK(hce.email == NULL);
+  }
+
+  mutt_hcache_close(hc);
+  C_HeaderCacheBackend = NULL;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file
+ * Dummy code for working around build problems
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "mutt/lib.h"
+#include "config/lib.h"
+
+struct Email;
+struct Mailbox;
+struct Message;
+
+/* The Maildir code uses these from the main program, which isn't part of a
+ * library */
+
+bool MonitorContextChanged;
+
+void mutt_monitor_drain(void)
+{
+}
+
+int mutt_copy_message(FILE *fp_out, struct Mailbox *m, struct Email *e,
+                      uint16_t cmflags, uint32_t chflags, int wraplen)
+{
+  return -1;
+}
+
+void mx_alloc_memory(struct Mailbox *m)
+{
+}
+
+struct Message *mx_msg_open_new(struct Mailbox *m, struct Email *e, uint8_t flags)
+{
+  return NULL;
+}
+
+#ifdef USE_HCACHE
+/* So does the header cache */
+
+void mutt_encode_path(struct Buffer *buf, const char *src)
+{
+  /* src may point into buf */
+  char *copy = mutt_str_dup(src);
+  mutt_buffer_strcpy(buf, copy);
+  FREE(&copy);
+}
+
+int hcache_validator(const struct ConfigSet *cs, const struct ConfigDef *cdef,
+                     intptr_t value, struct Buffer *err)
+{
+  return CSR_SUCCESS;
+}
+
+#ifdef USE_HCACHE_COMPRESSION
+int compress_method_validator(const struct ConfigSet *cs, const struct ConfigDef *cdef,
+                              intptr_t value, struct Buffer *err)
+{
+  return CSR_SUCCESS;
+}
+
+int compress_level_validator(const struct ConfigSet *cs, const struct ConfigDef *cdef,
+                             intptr_t value, struct Buffer *err)
+{
+  return CSR_SUCCESS;
+}
+#endif
+#endif
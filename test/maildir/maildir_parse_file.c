@@ -0,0 +1,149 @@
+/**
+ * @file
+ * Test code for maildir_parse_file()
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "mutt/lib.h"
+#include "email/lib.h"
+#include "core/lib.h"
+#include "maildir/private.h"
+#include "test_common.h"
+
+#define HEADER_READ (16 * 1024) ///< Matches MAILDIR_HEADER_READ
+
+/**
+ * write_message - Write a test message
+ * @param path    File to create
+ * @param hdr_len Length of the header, including the blank line, 0 for none
+ * @param eol     Line ending, "\n" or "\r\n"
+ * @param body    Body of the message
+ * @retval true Success
+ *
+ * The header is padded with an X-Pad field, so it's exactly hdr_len bytes.
+ * Without a blank line, the file is just the header fields.
+ */
+static bool write_message(const char *path, size_t hdr_len, const char *eol, const char *body)
+{
+  FILE *fp = fopen(path, "w");
+  if (!fp)
+    return false;
+
+  const size_t eol_len = strlen(eol);
+  const bool blank = (hdr_len != 0);
+  if (!blank)
+    hdr_len = HEADER_READ + 100;
+
+  int len = fprintf(fp, "Subject: apple%s", eol);
+  len += fprintf(fp, "X-Pad: ");
+  const size_t end = hdr_len - eol_len - (blank ? eol_len : 0);
+  for (; (size_t) len < end; len++)
+    fputc('x', fp);
+  fprintf(fp, "%s%s%s", eol, blank ? eol : "", body);
+
+  return (fclose(fp) == 0);
+}
+
+/**
+ * check_message - Parse a test message and check its header
+ * @param path    Message file
+ * @param hdr_len Expected offset of the body
+ * @param size    Size of the file
+ */
+static void check_message(const char *path, size_t hdr_len, size_t size)
+{
+  struct Buffer *buf = mutt_buffer_pool_get();
+  struct Email *e = maildir_parse_file(MUTT_MAILDIR, path, false, NULL, buf);
+  mutt_buffer_pool_release(&buf);
+  if (!TEST_CHECK(e != NULL))
+    return;
+
+  TEST_CHECK(mutt_str_equal(e->env->subject, "apple"));
+  if (!TEST_CHECK(e->content->offset == hdr_len))
+    TEST_MSG("offset = %lld, expected %zu", (long long) e->content->offset, hdr_len);
+  TEST_CHECK(e->content->length == (size - hdr_len));
+  email_free(&e);
+}
+
+void test_maildir_parse_file(void)
+{
+  // struct Email *maildir_parse_file(enum MailboxType type, const char *fname, bool is_old, struct Email *e, struct Buffer *buf);
+
+  {
+    struct Buffer *buf = mutt_buffer_pool_get();
+    TEST_CHECK(maildir_parse_file(MUTT_MAILDIR, "/nonexistent/neomutt", false, NULL, buf) == NULL);
+    mutt_buffer_pool_release(&buf);
+  }
+
+  char dir[PATH_MAX];
+  test_gen_path(dir, sizeof(dir), "%s/tmp/XXXXXX");
+  if (!TEST_CHECK(mkdtemp(dir) != NULL))
+    return;
+
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/msg", dir);
+  const char *body = "banana\n";
+  const size_t body_len = strlen(body);
+
+  // A short header
+  {
+    TEST_CHECK(write_message(path, 100, "\n", body));
+    check_message(path, 100, 100 + body_len);
+  }
+
+  // The blank line ends exactly on the first read
+  {
+    TEST_CHECK(write_message(path, HEADER_READ, "\n", body));
+    check_message(path, HEADER_READ, HEADER_READ + body_len);
+  }
+
+  // The first read ends between the last field and the blank line
+  {
+    TEST_CHECK(write_message(path, HEADER_READ + 1, "\n", body));
+    check_message(path, HEADER_READ + 1, HEADER_READ + 1 + body_len);
+  }
+
+  // A header with no blank line, and no body
+  {
+    TEST_CHECK(write_message(path, 0, "\n", ""));
+    check_message(path, HEADER_READ + 100, HEADER_READ + 100);
+  }
+
+  // CRLF line endings
+  {
+    TEST_CHECK(write_message(path, 100, "\r\n", body));
+    check_message(path, 100, 100 + body_len);
+  }
+
+  // CRLF line endings, the first read ends inside the blank line
+  {
+    TEST_CHECK(write_message(path, HEADER_READ + 1, "\r\n", body));
+    check_message(path, HEADER_READ + 1, HEADER_READ + 1 + body_len);
+  }
+
+  mutt_file_rmtree(dir);
+}
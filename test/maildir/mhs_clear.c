@@ -0,0 +1,99 @@
+/**
+ * @file
+ * Test code for mhs_clear()
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include <limits.h>
+#include "mutt/lib.h"
+#include "maildir/private.h"
+
+void test_mhs_clear(void)
+{
+  // MhSeqFlags mhs_clear(struct MhSequences *mhs, int i, MhSeqFlags f);
+
+  {
+    struct MhSequences mhs = { 0 };
+    TEST_CHECK(mhs_clear(&mhs, 5, MH_SEQ_UNSEEN) == MH_SEQ_NO_FLAGS);
+    mhs_set(&mhs, 5, MH_SEQ_UNSEEN | MH_SEQ_REPLIED);
+    TEST_CHECK(mhs_clear(&mhs, 5, MH_SEQ_UNSEEN) == MH_SEQ_REPLIED);
+    TEST_CHECK(mhs_clear(&mhs, 4, MH_SEQ_REPLIED) == MH_SEQ_NO_FLAGS);
+    TEST_CHECK(mhs_check(&mhs, 5) == MH_SEQ_REPLIED);
+    mhs_sequences_free(&mhs);
+  }
+
+  // Removing a number from the middle splits its range
+  {
+    struct MhSequences mhs = { 0 };
+    struct MhSeqSet *set = &mhs.seqs[0];
+    for (int i = 1; i <= 5; i++)
+      mhs_set(&mhs, i, MH_SEQ_UNSEEN);
+    TEST_CHECK(set->num == 1);
+
+    mhs_clear(&mhs, 3, MH_SEQ_UNSEEN);
+    TEST_CHECK(set->num == 2);
+    TEST_CHECK((set->ranges[0].first == 1) && (set->ranges[0].last == 2));
+    TEST_CHECK((set->ranges[1].first == 4) && (set->ranges[1].last == 5));
+    TEST_CHECK(mhs_check(&mhs, 3) == MH_SEQ_NO_FLAGS);
+
+    // The ends of a range shrink it
+    mhs_clear(&mhs, 1, MH_SEQ_UNSEEN);
+    mhs_clear(&mhs, 5, MH_SEQ_UNSEEN);
+    TEST_CHECK(set->num == 2);
+    TEST_CHECK((set->ranges[0].first == 2) && (set->ranges[0].last == 2));
+    TEST_CHECK((set->ranges[1].first == 4) && (set->ranges[1].last == 4));
+
+    // A range of one number is removed
+    mhs_clear(&mhs, 2, MH_SEQ_UNSEEN);
+    TEST_CHECK(set->num == 1);
+    TEST_CHECK((set->ranges[0].first == 4) && (set->ranges[0].last == 4));
+
+    // The gap can be filled again
+    mhs_set(&mhs, 3, MH_SEQ_UNSEEN);
+    mhs_set(&mhs, 5, MH_SEQ_UNSEEN);
+    TEST_CHECK(set->num == 1);
+    TEST_CHECK((set->ranges[0].first == 3) && (set->ranges[0].last == 5));
+    mhs_sequences_free(&mhs);
+  }
+
+  // The first and last message numbers
+  {
+    struct MhSequences mhs = { 0 };
+    struct MhSeqSet *set = &mhs.seqs[0];
+    mhs_set(&mhs, 1, MH_SEQ_UNSEEN);
+    mhs_set(&mhs, 2, MH_SEQ_UNSEEN);
+    mhs_set(&mhs, INT_MAX - 1, MH_SEQ_UNSEEN);
+    mhs_set(&mhs, INT_MAX, MH_SEQ_UNSEEN);
+    TEST_CHECK(set->num == 2);
+
+    mhs_clear(&mhs, 1, MH_SEQ_UNSEEN);
+    mhs_clear(&mhs, INT_MAX, MH_SEQ_UNSEEN);
+    TEST_CHECK(set->num == 2);
+    TEST_CHECK((set->ranges[0].first == 2) && (set->ranges[0].last == 2));
+    TEST_CHECK((set->ranges[1].first == INT_MAX - 1) && (set->ranges[1].last == INT_MAX - 1));
+
+    mhs_clear(&mhs, 2, MH_SEQ_UNSEEN);
+    mhs_clear(&mhs, INT_MAX - 1, MH_SEQ_UNSEEN);
+    TEST_CHECK(set->num == 0);
+    mhs_sequences_free(&mhs);
+  }
+}
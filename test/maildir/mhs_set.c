@@ -0,0 +1,100 @@
+/**
+ * @file
+ * Test code for mhs_set()
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include <limits.h>
+#include "mutt/lib.h"
+#include "maildir/private.h"
+
+void test_mhs_set(void)
+{
+  // MhSeqFlags mhs_set(struct MhSequences *mhs, int i, MhSeqFlags f);
+
+  {
+    struct MhSequences mhs = { 0 };
+    TEST_CHECK(mhs_set(&mhs, 5, MH_SEQ_UNSEEN) == MH_SEQ_UNSEEN);
+    TEST_CHECK(mhs_set(&mhs, 5, MH_SEQ_FLAGGED) == (MH_SEQ_UNSEEN | MH_SEQ_FLAGGED));
+    TEST_CHECK(mhs_check(&mhs, 4) == MH_SEQ_NO_FLAGS);
+    TEST_CHECK(mhs_check(&mhs, 6) == MH_SEQ_NO_FLAGS);
+    mhs_sequences_free(&mhs);
+  }
+
+  // Adjacent numbers are merged into one range
+  {
+    struct MhSequences mhs = { 0 };
+    struct MhSeqSet *set = &mhs.seqs[0];
+    mhs_set(&mhs, 1, MH_SEQ_UNSEEN);
+    mhs_set(&mhs, 3, MH_SEQ_UNSEEN);
+    TEST_CHECK(set->num == 2);
+    mhs_set(&mhs, 2, MH_SEQ_UNSEEN);
+    TEST_CHECK(set->num == 1);
+    TEST_CHECK((set->ranges[0].first == 1) && (set->ranges[0].last == 3));
+
+    // A number that's already in a range changes nothing
+    mhs_set(&mhs, 2, MH_SEQ_UNSEEN);
+    TEST_CHECK(set->num == 1);
+
+    // Ranges on both sides are merged
+    mhs_set(&mhs, 6, MH_SEQ_UNSEEN);
+    mhs_set(&mhs, 7, MH_SEQ_UNSEEN);
+    mhs_set(&mhs, 5, MH_SEQ_UNSEEN);
+    TEST_CHECK(set->num == 2);
+    mhs_set(&mhs, 4, MH_SEQ_UNSEEN);
+    TEST_CHECK(set->num == 1);
+    TEST_CHECK((set->ranges[0].first == 1) && (set->ranges[0].last == 7));
+    mhs_sequences_free(&mhs);
+  }
+
+  // Many ranges, added out of order, stay sorted
+  {
+    struct MhSequences mhs = { 0 };
+    struct MhSeqSet *set = &mhs.seqs[0];
+    for (int i = 100; i > 0; i -= 2)
+      mhs_set(&mhs, i, MH_SEQ_UNSEEN);
+    TEST_CHECK(set->num == 50);
+    for (size_t i = 1; i < set->num; i++)
+      TEST_CHECK(set->ranges[i - 1].last < set->ranges[i].first);
+    TEST_CHECK(mhs_check(&mhs, 50) == MH_SEQ_UNSEEN);
+    TEST_CHECK(mhs_check(&mhs, 51) == MH_SEQ_NO_FLAGS);
+    mhs_sequences_free(&mhs);
+  }
+
+  // The first and last message numbers
+  {
+    struct MhSequences mhs = { 0 };
+    struct MhSeqSet *set = &mhs.seqs[0];
+    mhs_set(&mhs, 1, MH_SEQ_UNSEEN);
+    mhs_set(&mhs, INT_MAX, MH_SEQ_UNSEEN);
+    TEST_CHECK(set->num == 2);
+    TEST_CHECK(mhs_check(&mhs, 1) == MH_SEQ_UNSEEN);
+    TEST_CHECK(mhs_check(&mhs, 2) == MH_SEQ_NO_FLAGS);
+    TEST_CHECK(mhs_check(&mhs, INT_MAX - 1) == MH_SEQ_NO_FLAGS);
+    TEST_CHECK(mhs_check(&mhs, INT_MAX) == MH_SEQ_UNSEEN);
+
+    mhs_set(&mhs, INT_MAX - 1, MH_SEQ_UNSEEN);
+    TEST_CHECK(set->num == 2);
+    TEST_CHECK((set->ranges[1].first == INT_MAX - 1) && (set->ranges[1].last == INT_MAX));
+    mhs_sequences_free(&mhs);
+  }
+}
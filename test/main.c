@@ -212,6 +212,7 @@
   NEOMUTT_TEST_ITEM(test_mutt_file_fclose)                                     \
   NEOMUTT_TEST_ITEM(test_mutt_file_fopen)                                      \
   NEOMUTT_TEST_ITEM(test_mutt_file_fsync_close)                                \
+  NEOMUTT_TEST_ITEM(test_mutt_file_get_mtime)                                  \
   NEOMUTT_TEST_ITEM(test_mutt_file_get_size)                                   \
   NEOMUTT_TEST_ITEM(test_mutt_file_get_stat_timespec)                          \
   NEOMUTT_TEST_ITEM(test_mutt_file_iter_line)                                  \
@@ -221,6 +222,7 @@
   NEOMUTT_TEST_ITEM(test_mutt_file_mkstemp_full)                               \
   NEOMUTT_TEST_ITEM(test_mutt_file_open)                                       \
   NEOMUTT_TEST_ITEM(test_mutt_file_quote_filename)                             \
+  NEOMUTT_TEST_ITEM(test_mutt_file_read_dir)                                   \
   NEOMUTT_TEST_ITEM(test_mutt_file_read_keyword)                               \
   NEOMUTT_TEST_ITEM(test_mutt_file_read_line)                                  \
   NEOMUTT_TEST_ITEM(test_mutt_file_rename)                                     \
@@ -239,6 +241,13 @@
   NEOMUTT_TEST_ITEM(test_mutt_file_unlink_empty)                               \
   NEOMUTT_TEST_ITEM(test_mutt_file_unlock)                                     \
                                                                                \
+  /* filebatch */                                                              \
+  NEOMUTT_TEST_ITEM(test_mutt_filebatch_free)                                  \
+  NEOMUTT_TEST_ITEM(test_mutt_filebatch_new)                                   \
+  NEOMUTT_TEST_ITEM(test_mutt_filebatch_rename)                                \
+  NEOMUTT_TEST_ITEM(test_mutt_filebatch_run)                                   \
+  NEOMUTT_TEST_ITEM(test_mutt_filebatch_unlink)                                \
+                                                                               \
   /* filter */                                                                 \
   NEOMUTT_TEST_ITEM(test_filter_create)                                        \
   NEOMUTT_TEST_ITEM(test_filter_create_fd)                                     \
@@ -338,6 +347,11 @@
   NEOMUTT_TEST_ITEM(test_mailbox_size_sub)                                     \
   NEOMUTT_TEST_ITEM(test_mailbox_update)                                       \
                                                                                \
+  /* maildir */                                                                \
+  NEOMUTT_TEST_ITEM(test_maildir_parse_file)                                   \
+  NEOMUTT_TEST_ITEM(test_mhs_clear)                                            \
+  NEOMUTT_TEST_ITEM(test_mhs_set)                                              \
+                                                                               \
   /* mapping */                                                                \
   NEOMUTT_TEST_ITEM(test_mutt_map_get_name)                                    \
   NEOMUTT_TEST_ITEM(test_mutt_map_get_value)                                   \
@@ -556,7 +570,19 @@
   NEOMUTT_TEST_ITEM(test_url_pct_decode)                                       \
   NEOMUTT_TEST_ITEM(test_url_pct_encode)                                       \
   NEOMUTT_TEST_ITEM(test_url_tobuffer)                                         \
-  NEOMUTT_TEST_ITEM(test_url_tostring)
+  NEOMUTT_TEST_ITEM(test_url_tostring)                                         \
+                                                                               \
+  /* workqueue */                                                              \
+  NEOMUTT_TEST_ITEM(test_mutt_workqueue_add)                                   \
+  NEOMUTT_TEST_ITEM(test_mutt_workqueue_free)                                  \
+  NEOMUTT_TEST_ITEM(test_mutt_workqueue_is_worker)                             \
+  NEOMUTT_TEST_ITEM(test_mutt_workqueue_lock)                                  \
+  NEOMUTT_TEST_ITEM(test_mutt_workqueue_new)                                   \
+  NEOMUTT_TEST_ITEM(test_mutt_workqueue_signal)                                \
+  NEOMUTT_TEST_ITEM(test_mutt_workqueue_threads)                               \
+  NEOMUTT_TEST_ITEM(test_mutt_workqueue_timedwait)                             \
+  NEOMUTT_TEST_ITEM(test_mutt_workqueue_unlock)                                \
+  NEOMUTT_TEST_ITEM(test_mutt_workqueue_wait)
 
 /******************************************************************************
  * You probably don't need to touch what follows.
@@ -576,7 +602,10 @@ NEOMUTT_TEST_LIST
 #ifdef USE_ZSTD
   NEOMUTT_TEST_ITEM(test_compress_zstd)
 #endif
-#if defined(HAVE_BDB) || defined(HAVE_GDBM) || defined(HAVE_KC) || defined(HAVE_LMDB) || defined(HAVE_QDBM) || defined(HAVE_ROCKSDB) || defined(HAVE_TC) || defined(HAVE_TDB)
+#ifdef HAVE_KVLOG
+  NEOMUTT_TEST_ITEM(test_hcache_legacy)
+#endif
+#if defined(HAVE_BDB) || defined(HAVE_GDBM) || defined(HAVE_KC) || defined(HAVE_KVLOG) || defined(HAVE_LMDB) || defined(HAVE_QDBM) || defined(HAVE_ROCKSDB) || defined(HAVE_TC) || defined(HAVE_TDB)
   NEOMUTT_TEST_ITEM(test_store_store)
 #endif
 #ifdef HAVE_BDB
@@ -588,6 +617,9 @@ NEOMUTT_TEST_LIST
 #ifdef HAVE_KC
   NEOMUTT_TEST_ITEM(test_store_kc)
 #endif
+#ifdef HAVE_KVLOG
+  NEOMUTT_TEST_ITEM(test_store_kvlog)
+#endif
 #ifdef HAVE_LMDB
   NEOMUTT_TEST_ITEM(test_store_lmdb)
 #endif
@@ -620,7 +652,10 @@ NEOMUTT_TEST_ITEM(test_compress_common)
 #ifdef USE_ZSTD
   NEOMUTT_TEST_ITEM(test_compress_zstd)
 #endif
-#if defined(HAVE_BDB) || defined(HAVE_GDBM) || defined(HAVE_KC) || defined(HAVE_LMDB) || defined(HAVE_QDBM) || defined(HAVE_ROCKSDB) || defined(HAVE_TC) || defined(HAVE_TDB)
+#ifdef HAVE_KVLOG
+  NEOMUTT_TEST_ITEM(test_hcache_legacy)
+#endif
+#if defined(HAVE_BDB) || defined(HAVE_GDBM) || defined(HAVE_KC) || defined(HAVE_KVLOG) || defined(HAVE_LMDB) || defined(HAVE_QDBM) || defined(HAVE_ROCKSDB) || defined(HAVE_TC) || defined(HAVE_TDB)
   NEOMUTT_TEST_ITEM(test_store_store)
 #endif
 #ifdef HAVE_BDB
@@ -632,6 +667,9 @@ NEOMUTT_TEST_ITEM(test_compress_common)
 #ifdef HAVE_KC
   NEOMUTT_TEST_ITEM(test_store_kc)
 #endif
+#ifdef HAVE_KVLOG
+  NEOMUTT_TEST_ITEM(test_store_kvlog)
+#endif
 #ifdef HAVE_LMDB
   NEOMUTT_TEST_ITEM(test_store_lmdb)
 #endif
@@ -24,6 +24,7 @@
 #include "config.h"
 #include "acutest.h"
 #include <stdbool.h>
+#include <stdio.h>
 #include "mutt/lib.h"
 #include "test_common.h"
 #include "store/lib.h"
@@ -67,6 +68,15 @@ bool test_store_degenerate(const struct StoreOps *sops, const char *name)
   if (!TEST_CHECK(sops->delete_record(NULL, NULL, 0) != 0))
     return false;
 
+  if (!TEST_CHECK(sops->begin(NULL) != 0))
+    return false;
+
+  if (!TEST_CHECK(sops->commit(NULL) != 0))
+    return false;
+
+  if (!TEST_CHECK(sops->scan(NULL, NULL, 0, NULL, NULL) != 0))
+    return false;
+
   sops->close(NULL);
   TEST_CHECK_(1, "sops->close(NULL)");
 
@@ -107,5 +117,33 @@ bool test_store_db(const struct StoreOps *sops, void *db)
   if (!TEST_CHECK(rc == 0))
     return false;
 
+  rc = sops->begin(db);
+  if (!TEST_CHECK(rc == 0))
+    return false;
+
+  char bkey[32];
+  for (int i = 0; i < 10; i++)
+  {
+    snprintf(bkey, sizeof(bkey), "batch%d", i);
+    rc = sops->store(db, bkey, strlen(bkey), value, strlen(value));
+    if (!TEST_CHECK(rc == 0))
+      return false;
+  }
+
+  rc = sops->commit(db);
+  if (!TEST_CHECK(rc == 0))
+    return false;
+
+  for (int i = 0; i < 10; i++)
+  {
+    snprintf(bkey, sizeof(bkey), "batch%d", i);
+    vlen = 0;
+    data = sops->fetch(db, bkey, strlen(bkey), &vlen);
+    if (!TEST_CHECK(data != NULL))
+      return false;
+    TEST_CHECK(vlen == strlen(value));
+    sops->free(db, &data);
+  }
+
   return true;
 }
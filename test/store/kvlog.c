@@ -0,0 +1,233 @@
+/**
+ * @file
+ * Test code for the kvlog store
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mutt/lib.h"
+#include "common.h"
+#include "store/lib.h"
+
+#define DB_NAME "kvlog"
+
+static bool count_scan(const char *key, size_t klen, const void *value, size_t vlen, void *data)
+{
+  int *count = data;
+  (*count)++;
+  return true;
+}
+
+void test_store_kvlog(void)
+{
+  char path[PATH_MAX];
+
+  const struct StoreOps *sops = store_get_backend_ops(DB_NAME);
+  TEST_CHECK(sops != NULL);
+
+  TEST_CHECK(test_store_degenerate(sops, DB_NAME) == true);
+
+  TEST_CHECK(test_store_setup(path, sizeof(path)) == true);
+
+  mutt_str_cat(path, sizeof(path), "/");
+  mutt_str_cat(path, sizeof(path), DB_NAME);
+
+  void *db = sops->open(path);
+  TEST_CHECK(db != NULL);
+
+  TEST_CHECK(test_store_db(sops, db) == true);
+
+  sops->close(&db);
+
+  // The records survive a reopen, and can be scanned in order
+  {
+    db = sops->open(path);
+    TEST_CHECK(db != NULL);
+
+    size_t vlen = 0;
+    void *data = sops->fetch(db, "batch3", 6, &vlen);
+    TEST_CHECK(data != NULL);
+    sops->free(db, &data);
+
+    data = sops->fetch(db, "one", 3, &vlen);
+    TEST_CHECK(data == NULL);
+
+    int count = 0;
+    TEST_CHECK(sops->scan(db, "batch", 5, count_scan, &count) == 0);
+    TEST_CHECK(count == 10);
+
+    sops->close(&db);
+  }
+
+  // A torn write at the end of the file is discarded
+  {
+    struct stat st = { 0 };
+    TEST_CHECK(stat(path, &st) == 0);
+    TEST_CHECK(truncate(path, st.st_size + 7) == 0);
+
+    db = sops->open(path);
+    TEST_CHECK(db != NULL);
+
+    size_t vlen = 0;
+    void *data = sops->fetch(db, "batch9", 6, &vlen);
+    TEST_CHECK(data != NULL);
+    sops->free(db, &data);
+
+    TEST_CHECK(sops->store(db, "two", 3, "value", 5) == 0);
+    sops->close(&db);
+
+    db = sops->open(path);
+    TEST_CHECK(db != NULL);
+    data = sops->fetch(db, "two", 3, &vlen);
+    TEST_CHECK((data != NULL) && (vlen == 5));
+    sops->free(db, &data);
+    sops->close(&db);
+  }
+
+  // Overwrites and deletes are compacted away while the store is open
+  {
+    TEST_CHECK(unlink(path) == 0);
+    db = sops->open(path);
+    TEST_CHECK(db != NULL);
+
+    char key[32];
+    char value[1024];
+    memset(value, 'x', sizeof(value));
+    const int num_keys = 500;
+    const int rounds = 8;
+
+    // A fetched value stays readable while the file is replaced
+    TEST_CHECK(sops->store(db, "held", 4, "held value", 10) == 0);
+    size_t hlen = 0;
+    char *held = sops->fetch(db, "held", 4, &hlen);
+    TEST_CHECK((held != NULL) && (hlen == 10));
+
+    for (int round = 0; round < rounds; round++)
+    {
+      value[0] = 'a' + round;
+      for (int i = 0; i < num_keys; i++)
+      {
+        size_t klen = snprintf(key, sizeof(key), "key%d", i);
+        TEST_CHECK(sops->store(db, key, klen, value, sizeof(value)) == 0);
+      }
+    }
+
+    struct stat st = { 0 };
+    TEST_CHECK(stat(path, &st) == 0);
+    if (!TEST_CHECK(st.st_size < (rounds * num_keys * (off_t) sizeof(value)) / 2))
+      TEST_MSG("size = %lld\n", (long long) st.st_size);
+
+    TEST_CHECK(memcmp(held, "held value", 10) == 0);
+    sops->free(db, (void **) &held);
+
+    for (int i = 0; i < num_keys / 2; i++)
+    {
+      size_t klen = snprintf(key, sizeof(key), "key%d", i);
+      TEST_CHECK(sops->delete_record(db, key, klen) == 0);
+    }
+    sops->close(&db);
+
+    db = sops->open(path);
+    TEST_CHECK(db != NULL);
+
+    size_t vlen = 0;
+    void *data = sops->fetch(db, "key0", 4, &vlen);
+    TEST_CHECK(data == NULL);
+
+    data = sops->fetch(db, "key499", 6, &vlen);
+    TEST_CHECK((data != NULL) && (vlen == sizeof(value)) &&
+               (((char *) data)[0] == ('a' + rounds - 1)));
+    sops->free(db, &data);
+
+    data = sops->fetch(db, "held", 4, &vlen);
+    TEST_CHECK((data != NULL) && (vlen == 10));
+    sops->free(db, &data);
+
+    int count = 0;
+    TEST_CHECK(sops->scan(db, "key", 3, count_scan, &count) == 0);
+    TEST_CHECK(count == (num_keys / 2));
+
+    sops->close(&db);
+  }
+
+  // A compaction that can't write every record leaves the log alone
+  if (access("/dev/full", W_OK) == 0)
+  {
+    TEST_CHECK(unlink(path) == 0);
+    db = sops->open(path);
+    TEST_CHECK(db != NULL);
+
+    char tmp[PATH_MAX];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    TEST_CHECK(symlink("/dev/full", tmp) == 0);
+
+    char key[32];
+    char value[1024];
+    memset(value, 'x', sizeof(value));
+    const int num_keys = 500;
+    char last[500] = { 0 };
+
+    // The failed compaction removes the link to /dev/full
+    struct stat st = { 0 };
+    bool failed = false;
+    for (int round = 0; (round < 8) && !failed; round++)
+    {
+      value[0] = 'a' + round;
+      for (int i = 0; (i < num_keys) && !failed; i++)
+      {
+        size_t klen = snprintf(key, sizeof(key), "key%d", i);
+        TEST_CHECK(sops->store(db, key, klen, value, sizeof(value)) == 0);
+        last[i] = value[0];
+        failed = (lstat(tmp, &st) != 0);
+      }
+    }
+    TEST_CHECK(failed);
+    sops->close(&db);
+
+    db = sops->open(path);
+    TEST_CHECK(db != NULL);
+
+    int count = 0;
+    TEST_CHECK(sops->scan(db, "key", 3, count_scan, &count) == 0);
+    TEST_CHECK(count == num_keys);
+
+    for (int i = 0; i < num_keys; i++)
+    {
+      size_t klen = snprintf(key, sizeof(key), "key%d", i);
+      size_t vlen = 0;
+      void *data = sops->fetch(db, key, klen, &vlen);
+      if (!TEST_CHECK((data != NULL) && (vlen == sizeof(value)) &&
+                      (((char *) data)[0] == last[i])))
+      {
+        TEST_MSG("key = %s\n", key);
+      }
+      sops->free(db, &data);
+    }
+
+    sops->close(&db);
+  }
+}
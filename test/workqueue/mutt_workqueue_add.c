@@ -0,0 +1,74 @@
+/**
+ * @file
+ * Test code for mutt_workqueue_add()
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include "mutt/lib.h"
+
+static void square_job(void *data)
+{
+  int *num = data;
+  *num = *num * *num;
+}
+
+void test_mutt_workqueue_add(void)
+{
+  // void mutt_workqueue_add(struct WorkQueue *wq, workqueue_job_t job, void *data);
+
+  {
+    int num = 3;
+    mutt_workqueue_add(NULL, square_job, &num);
+    TEST_CHECK(num == 3);
+  }
+
+  {
+    struct WorkQueue *wq = mutt_workqueue_new(2);
+    mutt_workqueue_add(wq, NULL, NULL);
+    mutt_workqueue_free(&wq);
+  }
+
+  {
+    int num = 7;
+    struct WorkQueue *wq = mutt_workqueue_new(0);
+    mutt_workqueue_add(wq, square_job, &num);
+    TEST_CHECK(num == 49);
+    mutt_workqueue_free(&wq);
+  }
+
+  {
+    int nums[100];
+    struct WorkQueue *wq = mutt_workqueue_new(4);
+    for (int i = 0; i < mutt_array_size(nums); i++)
+    {
+      nums[i] = i;
+      mutt_workqueue_add(wq, square_job, &nums[i]);
+    }
+    mutt_workqueue_wait(wq);
+    for (int i = 0; i < mutt_array_size(nums); i++)
+    {
+      if (!TEST_CHECK(nums[i] == (i * i)))
+        TEST_MSG("nums[%d] = %d\n", i, nums[i]);
+    }
+    mutt_workqueue_free(&wq);
+  }
+}
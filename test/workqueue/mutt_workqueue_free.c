@@ -0,0 +1,59 @@
+/**
+ * @file
+ * Test code for mutt_workqueue_free()
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include "mutt/lib.h"
+
+static void count_job(void *data)
+{
+  int *count = data;
+  mutt_workqueue_lock();
+  (*count)++;
+  mutt_workqueue_unlock();
+}
+
+void test_mutt_workqueue_free(void)
+{
+  // void mutt_workqueue_free(struct WorkQueue **ptr);
+
+  {
+    mutt_workqueue_free(NULL);
+  }
+
+  {
+    struct WorkQueue *wq = NULL;
+    mutt_workqueue_free(&wq);
+    TEST_CHECK_(1, "mutt_workqueue_free(&wq)");
+  }
+
+  {
+    int count = 0;
+    struct WorkQueue *wq = mutt_workqueue_new(3);
+    for (int i = 0; i < 50; i++)
+      mutt_workqueue_add(wq, count_job, &count);
+    mutt_workqueue_free(&wq);
+    TEST_CHECK(wq == NULL);
+    TEST_CHECK(count == 50);
+  }
+}
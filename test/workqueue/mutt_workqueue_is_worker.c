@@ -0,0 +1,61 @@
+/**
+ * @file
+ * Test code for mutt_workqueue_is_worker()
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include "mutt/lib.h"
+
+static void worker_job(void *data)
+{
+  bool *is_worker = data;
+  *is_worker = mutt_workqueue_is_worker();
+}
+
+void test_mutt_workqueue_is_worker(void)
+{
+  // bool mutt_workqueue_is_worker(void);
+
+  {
+    TEST_CHECK(mutt_workqueue_is_worker() == false);
+  }
+
+  {
+    bool is_worker = true;
+    struct WorkQueue *wq = mutt_workqueue_new(0);
+    mutt_workqueue_add(wq, worker_job, &is_worker);
+    TEST_CHECK(is_worker == false);
+    mutt_workqueue_free(&wq);
+  }
+
+#ifdef USE_PTHREAD
+  {
+    bool is_worker = false;
+    struct WorkQueue *wq = mutt_workqueue_new(1);
+    mutt_workqueue_add(wq, worker_job, &is_worker);
+    mutt_workqueue_wait(wq);
+    TEST_CHECK(is_worker == true);
+    TEST_CHECK(mutt_workqueue_is_worker() == false);
+    mutt_workqueue_free(&wq);
+  }
+#endif
+}
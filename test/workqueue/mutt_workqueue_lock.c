@@ -0,0 +1,83 @@
+/**
+ * @file
+ * Test code for mutt_workqueue_lock()
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include <sched.h>
+#include <unistd.h>
+#include "mutt/lib.h"
+
+static int Counter = 0;
+
+static void count_job(void *data)
+{
+  int loops = *(int *) data;
+  for (int i = 0; i < loops; i++)
+  {
+    mutt_workqueue_lock();
+    int old = Counter;
+    sched_yield();
+    Counter = old + 1;
+    mutt_workqueue_unlock();
+  }
+}
+
+void test_mutt_workqueue_lock(void)
+{
+  // void mutt_workqueue_lock(void);
+
+  {
+    mutt_workqueue_lock();
+    mutt_workqueue_unlock();
+    TEST_CHECK_(1, "mutt_workqueue_lock()");
+  }
+
+  {
+    Counter = 0;
+    int loops = 500;
+    struct WorkQueue *wq = mutt_workqueue_new(4);
+    for (int i = 0; i < 8; i++)
+      mutt_workqueue_add(wq, count_job, &loops);
+    mutt_workqueue_wait(wq);
+    mutt_workqueue_free(&wq);
+    if (!TEST_CHECK(Counter == (8 * loops)))
+      TEST_MSG("Counter = %d\n", Counter);
+  }
+
+#ifdef USE_PTHREAD
+  {
+    // A job can't take the lock while the main thread holds it
+    Counter = 0;
+    int loops = 1;
+    struct WorkQueue *wq = mutt_workqueue_new(1);
+    mutt_workqueue_lock();
+    mutt_workqueue_add(wq, count_job, &loops);
+    usleep(50000);
+    TEST_CHECK(Counter == 0);
+    mutt_workqueue_unlock();
+    mutt_workqueue_wait(wq);
+    TEST_CHECK(Counter == 1);
+    mutt_workqueue_free(&wq);
+  }
+#endif
+}
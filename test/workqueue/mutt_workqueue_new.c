@@ -0,0 +1,56 @@
+/**
+ * @file
+ * Test code for mutt_workqueue_new()
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include "mutt/lib.h"
+
+void test_mutt_workqueue_new(void)
+{
+  // struct WorkQueue *mutt_workqueue_new(int num_threads);
+
+  {
+    struct WorkQueue *wq = mutt_workqueue_new(0);
+    TEST_CHECK(wq != NULL);
+    TEST_CHECK(mutt_workqueue_threads(wq) == 0);
+    mutt_workqueue_free(&wq);
+  }
+
+  {
+    struct WorkQueue *wq = mutt_workqueue_new(-1);
+    TEST_CHECK(wq != NULL);
+    TEST_CHECK(mutt_workqueue_threads(wq) == 0);
+    mutt_workqueue_free(&wq);
+  }
+
+  {
+    struct WorkQueue *wq = mutt_workqueue_new(4);
+    TEST_CHECK(wq != NULL);
+#ifdef USE_PTHREAD
+    TEST_CHECK(mutt_workqueue_threads(wq) == 4);
+#else
+    TEST_CHECK(mutt_workqueue_threads(wq) == 0);
+#endif
+    mutt_workqueue_free(&wq);
+  }
+}
@@ -0,0 +1,58 @@
+/**
+ * @file
+ * Test code for mutt_workqueue_timedwait()
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include "mutt/lib.h"
+
+static void done_job(void *data)
+{
+  bool *done = data;
+  mutt_workqueue_lock();
+  *done = true;
+  mutt_workqueue_signal();
+  mutt_workqueue_unlock();
+}
+
+void test_mutt_workqueue_timedwait(void)
+{
+  // bool mutt_workqueue_timedwait(int timeout_ms);
+
+  {
+    mutt_workqueue_lock();
+    TEST_CHECK(!mutt_workqueue_timedwait(10));
+    mutt_workqueue_unlock();
+  }
+
+  {
+    bool done = false;
+    struct WorkQueue *wq = mutt_workqueue_new(1);
+    mutt_workqueue_add(wq, done_job, &done);
+    mutt_workqueue_lock();
+    while (!done && mutt_workqueue_timedwait(5000))
+      ; // wait for the job
+    TEST_CHECK(done);
+    mutt_workqueue_unlock();
+    mutt_workqueue_free(&wq);
+  }
+}
@@ -0,0 +1,39 @@
+/**
+ * @file
+ * Test code for mutt_workqueue_unlock()
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include "mutt/lib.h"
+
+void test_mutt_workqueue_unlock(void)
+{
+  // void mutt_workqueue_unlock(void);
+
+  {
+    mutt_workqueue_lock();
+    mutt_workqueue_unlock();
+    mutt_workqueue_lock();
+    mutt_workqueue_unlock();
+    TEST_CHECK_(1, "mutt_workqueue_unlock()");
+  }
+}
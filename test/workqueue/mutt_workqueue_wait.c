@@ -0,0 +1,62 @@
+/**
+ * @file
+ * Test code for mutt_workqueue_wait()
+ *
+ * @authors
+ * Copyright (C) 2020 Richard Russon <rich@flatcap.org>
+ *
+ * @copyright
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_NO_MAIN
+#include "config.h"
+#include "acutest.h"
+#include "mutt/lib.h"
+
+static void sum_job(void *data)
+{
+  long *sum = data;
+  mutt_workqueue_lock();
+  *sum += 1;
+  mutt_workqueue_unlock();
+}
+
+void test_mutt_workqueue_wait(void)
+{
+  // void mutt_workqueue_wait(struct WorkQueue *wq);
+
+  {
+    mutt_workqueue_wait(NULL);
+  }
+
+  {
+    struct WorkQueue *wq = mutt_workqueue_new(2);
+    mutt_workqueue_wait(wq);
+    mutt_workqueue_free(&wq);
+  }
+
+  {
+    long sum = 0;
+    struct WorkQueue *wq = mutt_workqueue_new(8);
+    for (int batch = 1; batch <= 5; batch++)
+    {
+      for (int i = 0; i < 200; i++)
+        mutt_workqueue_add(wq, sum_job, &sum);
+      mutt_workqueue_wait(wq);
+      TEST_CHECK(sum == (batch * 200));
+    }
+    mutt_workqueue_free(&wq);
+  }
+}
@@ -324,6 +324,11 @@ static struct CompileOptions comp_opts[] = {
 #else
   { "sun_attachment", 0 },
 #endif
+#ifdef USE_PTHREAD
+  { "threads", 1 },
+#else
+  { "threads", 0 },
+#endif
 #ifdef HAVE_TYPEAHEAD
   { "typeahead", 1 },
 #else